@@ -0,0 +1,223 @@
+#include "Blockmap.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+#include <Level.hpp>
+#include <Geometry/Intersection.hpp>
+
+namespace
+{
+	constexpr size_t LUMP_HEADER_WORDS = 4;
+	constexpr uint16_t LIST_END = 0xFFFF;
+
+	/** @brief Calls visit(cell) for every cell of a blockmap's grid that a line touches */
+	template<typename Visit>
+	void forEachCell(const Blockmap& blockmap, const Level& level, uint32_t lineDefId, Visit&& visit)
+	{
+		const LineDef& lineDef = level.lineDefs[lineDefId];
+		const glm::vec2 start = level.vertices[lineDef.startVertexId] - blockmap.origin;
+		const glm::vec2 end = level.vertices[lineDef.endVertexId] - blockmap.origin;
+
+		const uint32_t firstColumn = static_cast<uint32_t>(std::min(start.x, end.x) / Blockmap::CELL_SIZE);
+		const uint32_t lastColumn = static_cast<uint32_t>(std::max(start.x, end.x) / Blockmap::CELL_SIZE);
+		const uint32_t firstRow = static_cast<uint32_t>(std::min(start.y, end.y) / Blockmap::CELL_SIZE);
+		const uint32_t lastRow = static_cast<uint32_t>(std::max(start.y, end.y) / Blockmap::CELL_SIZE);
+
+		for (uint32_t row = firstRow; row <= lastRow; row++) {
+			for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+				const glm::vec2 cellMin = glm::vec2{ column, row } * Blockmap::CELL_SIZE;
+				if (segmentTouchesBox(start, end, cellMin, cellMin + Blockmap::CELL_SIZE))
+					visit(static_cast<size_t>(row) * blockmap.columns + column);
+			}
+		}
+	}
+
+	/** @brief Returns true if a line lies entirely within a blockmap's grid */
+	bool lineOnGrid(const Blockmap& blockmap, const Level& level, uint32_t lineDefId)
+	{
+		const LineDef& lineDef = level.lineDefs[lineDefId];
+		const glm::vec2 gridSize = glm::vec2{ blockmap.columns, blockmap.rows } * Blockmap::CELL_SIZE;
+
+		for (uint32_t vertexId : { lineDef.startVertexId, lineDef.endVertexId }) {
+			const glm::vec2 position = level.vertices[vertexId] - blockmap.origin;
+			if (position.x < 0.0f || position.y < 0.0f || position.x >= gridSize.x || position.y >= gridSize.y)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+Blockmap Blockmap::build(const Level& level)
+{
+	Blockmap blockmap;
+	if (level.lineDefs.empty())
+		return blockmap;
+
+	glm::vec2 min{ std::numeric_limits<float>::max() };
+	glm::vec2 max{ std::numeric_limits<float>::lowest() };
+
+	for (const LineDef& lineDef : level.lineDefs) {
+		for (uint32_t vertexId : { lineDef.startVertexId, lineDef.endVertexId }) {
+			min = glm::min(min, level.vertices[vertexId]);
+			max = glm::max(max, level.vertices[vertexId]);
+		}
+	}
+
+	blockmap.origin = glm::floor(min);
+	blockmap.columns = static_cast<uint32_t>((max.x - blockmap.origin.x) / CELL_SIZE) + 1;
+	blockmap.rows = static_cast<uint32_t>((max.y - blockmap.origin.y) / CELL_SIZE) + 1;
+
+	// Count the lines in each cell first, so the lists can be filled in place. 
+	const size_t cellCount = static_cast<size_t>(blockmap.columns) * blockmap.rows;
+	std::vector<uint32_t> counts(cellCount + 1, 0);
+
+	for (uint32_t lineDefId = 0; lineDefId < level.lineDefs.size(); lineDefId++)
+		forEachCell(blockmap, level, lineDefId, [&](size_t cell) { counts[cell + 1]++; });
+
+	for (size_t i = 1; i <= cellCount; i++)
+		counts[i] += counts[i - 1];
+
+	blockmap.cellOffsets = counts;
+	blockmap.lineDefIds.resize(counts[cellCount]);
+
+	for (uint32_t lineDefId = 0; lineDefId < level.lineDefs.size(); lineDefId++)
+		forEachCell(blockmap, level, lineDefId, [&](size_t cell) { blockmap.lineDefIds[counts[cell]++] = lineDefId; });
+
+	return blockmap;
+}
+
+void Blockmap::updateLines(const Level& level, const std::vector<uint32_t>& movedLineDefIds)
+{
+	if (movedLineDefIds.empty())
+		return;
+
+	if (empty()) {
+		*this = build(level);
+		return;
+	}
+
+	for (uint32_t lineDefId : movedLineDefIds) {
+		if (!lineOnGrid(*this, level, lineDefId)) {
+			*this = build(level);
+			return;
+		}
+	}
+
+	// Only a few lines move at a time, so they're found in the old lists by binary search. 
+	std::vector<uint32_t> moved = movedLineDefIds;
+	std::sort(moved.begin(), moved.end());
+
+	// The cells each moved line is in now, in cell order so they can be merged into the lists.
+	std::vector<std::pair<size_t, uint32_t>> binned;
+	for (uint32_t lineDefId : moved)
+		forEachCell(*this, level, lineDefId, [&](size_t cell) { binned.push_back({ cell, lineDefId }); });
+
+	std::sort(binned.begin(), binned.end());
+
+	const size_t cellCount = cellOffsets.size() - 1;
+
+	std::vector<uint32_t> splicedOffsets;
+	std::vector<uint32_t> splicedLineDefIds;
+	splicedOffsets.reserve(cellOffsets.size());
+	splicedLineDefIds.reserve(lineDefIds.size() + binned.size());
+
+	auto next = binned.begin();
+
+	for (size_t cell = 0; cell < cellCount; cell++) {
+		splicedOffsets.push_back(static_cast<uint32_t>(splicedLineDefIds.size()));
+
+		for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++)
+			if (!std::binary_search(moved.begin(), moved.end(), lineDefIds[i]))
+				splicedLineDefIds.push_back(lineDefIds[i]);
+
+		for (; next != binned.end() && next->first == cell; ++next)
+			splicedLineDefIds.push_back(next->second);
+	}
+
+	splicedOffsets.push_back(static_cast<uint32_t>(splicedLineDefIds.size()));
+
+	cellOffsets = std::move(splicedOffsets);
+	lineDefIds = std::move(splicedLineDefIds);
+}
+
+Blockmap Blockmap::fromLump(const std::vector<uint16_t>& lump, size_t lineDefCount)
+{
+	if (lump.size() < LUMP_HEADER_WORDS)
+		return {};
+
+	Blockmap blockmap;
+	blockmap.origin = glm::vec2{ static_cast<int16_t>(lump[0]), static_cast<int16_t>(lump[1]) };
+	blockmap.columns = lump[2];
+	blockmap.rows = lump[3];
+
+	const size_t cellCount = static_cast<size_t>(blockmap.columns) * blockmap.rows;
+	if (cellCount == 0 || LUMP_HEADER_WORDS + cellCount > lump.size())
+		return {};
+
+	// Doom's own builder starts every list with a 0, which vanilla Doom reads as line 0 by
+	// mistake. Some builders leave it out, and then a leading 0 really is line 0, so it's only
+	// skipped when every list has it. 
+	bool listsHaveHeader = true;
+	for (size_t cell = 0; cell < cellCount && listsHaveHeader; cell++) {
+		const size_t offset = lump[LUMP_HEADER_WORDS + cell];
+		listsHaveHeader = offset < lump.size() && lump[offset] == 0;
+	}
+
+	blockmap.cellOffsets.reserve(cellCount + 1);
+
+	for (size_t cell = 0; cell < cellCount; cell++) {
+		blockmap.cellOffsets.push_back(static_cast<uint32_t>(blockmap.lineDefIds.size()));
+
+		size_t offset = lump[LUMP_HEADER_WORDS + cell] + (listsHaveHeader ? 1 : 0);
+
+		for (; offset < lump.size() && lump[offset] != LIST_END; offset++) {
+			if (lump[offset] >= lineDefCount)
+				return {};
+
+			blockmap.lineDefIds.push_back(lump[offset]);
+		}
+
+		if (offset >= lump.size())
+			return {};
+	}
+
+	blockmap.cellOffsets.push_back(static_cast<uint32_t>(blockmap.lineDefIds.size()));
+
+	return blockmap;
+}
+
+void Blockmap::findLines(glm::vec2 min, glm::vec2 max, std::vector<uint32_t>& foundLineDefIds) const
+{
+	foundLineDefIds.clear();
+	if (empty())
+		return;
+
+	const glm::vec2 first = glm::floor((min - origin) / CELL_SIZE);
+	const glm::vec2 last = glm::floor((max - origin) / CELL_SIZE);
+
+	if (last.x < 0.0f || last.y < 0.0f || first.x >= columns || first.y >= rows)
+		return;
+
+	const uint32_t firstColumn = static_cast<uint32_t>(std::max(first.x, 0.0f));
+	const uint32_t firstRow = static_cast<uint32_t>(std::max(first.y, 0.0f));
+	const uint32_t lastColumn = std::min(static_cast<uint32_t>(last.x), columns - 1);
+	const uint32_t lastRow = std::min(static_cast<uint32_t>(last.y), rows - 1);
+
+	for (uint32_t row = firstRow; row <= lastRow; row++) {
+		for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+			const size_t cell = static_cast<size_t>(row) * columns + column;
+			foundLineDefIds.insert(foundLineDefIds.end(),
+				lineDefIds.begin() + cellOffsets[cell], lineDefIds.begin() + cellOffsets[cell + 1]);
+		}
+	}
+
+	// A box only covers a few cells, so sorting is cheaper than keeping a set. 
+	if (firstColumn != lastColumn || firstRow != lastRow) {
+		std::sort(foundLineDefIds.begin(), foundLineDefIds.end());
+		foundLineDefIds.erase(std::unique(foundLineDefIds.begin(), foundLineDefIds.end()), foundLineDefIds.end());
+	}
+}
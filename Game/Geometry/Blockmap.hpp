@@ -0,0 +1,71 @@
+#ifndef BLOCKMAP_HPP_INCLUDED
+#define BLOCKMAP_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/**
+ * @brief A uniform grid over a level, listing the lines that pass through each cell.
+ *
+ * @details Anything that needs the lines near an area, like collision, looks up the cells the
+ *			area covers instead of testing every line in the level, so it only touches a
+ *			handful of lines no matter how big the level is. Cells are 128 units square, like
+ *			Doom's. 
+ *
+ *			Each cell's lines are stored one after another in cell order (compressed sparse
+ *			rows). The grid can be read from a Doom map's BLOCKMAP lump, or built from the
+ *			level's lines for maps without one.
+ */
+struct Blockmap
+{
+	static constexpr float CELL_SIZE = 128.0f;
+
+	glm::vec2				origin { 0.0f };	// The corner of the grid with the lowest coordinates
+	uint32_t				columns = 0;
+	uint32_t				rows = 0;
+
+	// The lines in cell (column, row) are in the range [cellOffsets[i], cellOffsets[i + 1]), 
+	// where i = row * columns + column
+	std::vector<uint32_t>	cellOffsets;
+	std::vector<uint32_t>	lineDefIds;
+
+	bool empty() const { return columns == 0 || rows == 0; }
+
+	/** @brief Builds a blockmap covering all of a level's lines */
+	static Blockmap build(const Level& level);
+
+	/**
+	 * @brief Moves some lines to the cells they're in now, after their vertices moved.
+	 *
+	 * @details Only the given lines are binned again. Every other line keeps the cells it was
+	 *			in, so a blockmap read from a lump keeps its own lists. The cell lists are spliced
+	 *			together in one pass over them. If a line moves off the grid, the whole blockmap
+	 *			is built again to cover it.
+	 */
+	void updateLines(const Level& level, const std::vector<uint32_t>& movedLineDefIds);
+
+	/**
+	 * @brief Reads a Doom BLOCKMAP lump, as 16-bit words.
+	 *
+	 * @details The lump is a header of the grid's origin and size, an offset to each cell's
+	 *			list, then the lists, each of which ends with 0xFFFF. Lists usually start with a 0,
+	 *			which is skipped when every list has one. Returns an empty blockmap if the lump is
+	 *			malformed, or refers to lines that don't exist, which happens when big maps
+	 *			overflow the 16-bit offsets.
+	 */
+	static Blockmap fromLump(const std::vector<uint16_t>& lump, size_t lineDefCount);
+
+	/**
+	 * @brief Finds every line in the cells that a box touches.
+	 *
+	 * @details Lines crossing more than one of the cells are only listed once. Lines come back in
+	 *			no particular order, and may not actually touch the box.
+	 */
+	void findLines(glm::vec2 min, glm::vec2 max, std::vector<uint32_t>& foundLineDefIds) const;
+};
+
+#endif//BLOCKMAP_HPP_INCLUDED
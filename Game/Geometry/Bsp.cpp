@@ -0,0 +1,302 @@
+#include "Bsp.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	// Small tolerance so points lying on a clipping line are kept on both sides of it. 
+	const float CLIP_EPSILON = 1.0f / 64.0f;
+
+	// Extra space around the segs of the tree when building subsector polygons, so every 
+	// polygon is closed even where the level's walls don't fully enclose it. 
+	const float BOUNDS_MARGIN = 64.0f;
+}
+
+void BspTree::clipPolygon(std::vector<glm::vec2>& polygon, glm::vec2 origin, glm::vec2 direction, int keepSide)
+{
+	if (polygon.empty())
+		return;
+
+	// Positive distances are on the side we want to keep. The length doesn't matter here, 
+	// but normalising it makes the epsilon consistent for lines of different lengths. 
+	const float length = glm::length(direction);
+	if (length == 0.0f)
+		return;
+
+	const float sign = keepSide == FRONT ? -1.0f : 1.0f;
+	auto distance = [&](glm::vec2 p) {
+		return sign * ((p.y - origin.y) * direction.x - (p.x - origin.x) * direction.y) / length;
+	};
+
+	std::vector<glm::vec2> clipped;
+	clipped.reserve(polygon.size() + 1);
+
+	for (size_t i = 0; i < polygon.size(); i++) {
+		glm::vec2 current = polygon[i];
+		glm::vec2 next = polygon[(i + 1) % polygon.size()];
+
+		float currentDistance = distance(current);
+		float nextDistance = distance(next);
+
+		if (currentDistance >= -CLIP_EPSILON)
+			clipped.push_back(current);
+
+		// Add the intersection if the edge properly crosses the line. 
+		if ((currentDistance > CLIP_EPSILON && nextDistance < -CLIP_EPSILON) ||
+			(currentDistance < -CLIP_EPSILON && nextDistance > CLIP_EPSILON)) {
+			float t = currentDistance / (currentDistance - nextDistance);
+			clipped.push_back(current + (next - current) * t);
+		}
+	}
+
+	polygon = std::move(clipped);
+}
+
+BspTree::QuantizedBox BspTree::QuantizedBox::fromBounds(glm::vec2 min, glm::vec2 max)
+{
+	auto quantize = [](float value) {
+		constexpr float low = std::numeric_limits<int16_t>::min();
+		constexpr float high = std::numeric_limits<int16_t>::max();
+		return static_cast<int16_t>(std::clamp(value, low, high));
+	};
+
+	// Round outwards so the box always contains the original bounds. 
+	return QuantizedBox{
+		quantize(std::floor(min.x)),
+		quantize(std::floor(min.y)),
+		quantize(std::ceil(max.x)),
+		quantize(std::ceil(max.y))
+	};
+}
+
+uint32_t BspTree::findSubsector(glm::vec2 point) const
+{
+	uint32_t child = root;
+
+	while (!isLeaf(child))
+		child = children[2 * child + pointSide(nodes[child], point)];
+
+	return leafIndex(child);
+}
+
+void BspTree::buildSubsectorPolygons()
+{
+	polygonVertices.clear();
+
+	if (empty() || segs.empty())
+		return;
+
+	boundsMin = segs[0].start;
+	boundsMax = segs[0].start;
+	for (const Seg& seg : segs) {
+		boundsMin = glm::min(boundsMin, glm::min(seg.start, seg.end));
+		boundsMax = glm::max(boundsMax, glm::max(seg.start, seg.end));
+	}
+	boundsMin -= glm::vec2{ BOUNDS_MARGIN, BOUNDS_MARGIN };
+	boundsMax += glm::vec2{ BOUNDS_MARGIN, BOUNDS_MARGIN };
+
+	std::vector<glm::vec2> region = {
+		{ boundsMin.x, boundsMin.y },
+		{ boundsMax.x, boundsMin.y },
+		{ boundsMax.x, boundsMax.y },
+		{ boundsMin.x, boundsMax.y }
+	};
+
+	buildPolygons(root, region);
+}
+
+void BspTree::buildPolygons(uint32_t child, std::vector<glm::vec2>& polygon)
+{
+	if (isLeaf(child)) {
+		Subsector& subsector = subsectors[leafIndex(child)];
+
+		// The subsector lies on the right of each of its segs, which is the front side in 
+		// the same convention the partition lines use. 
+		for (uint32_t i = 0; i < subsector.segCount; i++) {
+			const Seg& seg = segs[subsector.firstSegId + i];
+			clipPolygon(polygon, seg.start, seg.end - seg.start, FRONT);
+		}
+
+		subsector.firstPolygonVertexId = static_cast<uint32_t>(polygonVertices.size());
+		subsector.polygonVertexCount = static_cast<uint32_t>(polygon.size());
+
+		// Clipping keeps the winding of the starting box, which is counter-clockwise. 
+		polygonVertices.insert(polygonVertices.end(), polygon.begin(), polygon.end());
+		return;
+	}
+
+	const Node& node = nodes[child];
+
+	std::vector<glm::vec2> backPolygon = polygon;
+	clipPolygon(polygon, node.origin, node.direction, FRONT);
+	clipPolygon(backPolygon, node.origin, node.direction, BACK);
+
+	buildPolygons(children[2 * child + FRONT], polygon);
+	buildPolygons(children[2 * child + BACK], backPolygon);
+}
+
+uint32_t BspTree::append(const BspTree& fragment, uint32_t fragmentRoot)
+{
+	const uint32_t nodeBase = static_cast<uint32_t>(nodes.size());
+	const uint32_t subsectorBase = static_cast<uint32_t>(subsectors.size());
+	const uint32_t segBase = static_cast<uint32_t>(segs.size());
+	const uint32_t polygonBase = static_cast<uint32_t>(polygonVertices.size());
+
+	auto remap = [&](uint32_t child) {
+		return isLeaf(child) ? (LEAF_BIT | (leafIndex(child) + subsectorBase)) : child + nodeBase;
+	};
+
+	nodes.insert(nodes.end(), fragment.nodes.begin(), fragment.nodes.end());
+	for (uint32_t child : fragment.children)
+		children.push_back(remap(child));
+
+	for (Subsector subsector : fragment.subsectors) {
+		subsector.firstSegId += segBase;
+		subsector.firstPolygonVertexId += polygonBase;
+		subsectors.push_back(subsector);
+	}
+
+	segs.insert(segs.end(), fragment.segs.begin(), fragment.segs.end());
+	polygonVertices.insert(polygonVertices.end(), fragment.polygonVertices.begin(), fragment.polygonVertices.end());
+
+	return remap(fragmentRoot);
+}
+
+void BspTree::compact()
+{
+	if (empty())
+		return;
+
+	BspTree compacted;
+	compacted.boundsMin = boundsMin;
+	compacted.boundsMax = boundsMax;
+
+	// Copies a subtree into the compacted tree, children before their parents. 
+	auto copy = [&](auto& self, uint32_t child) -> uint32_t {
+		if (isLeaf(child)) {
+			Subsector subsector = subsectors[leafIndex(child)];
+
+			uint32_t firstSegId = static_cast<uint32_t>(compacted.segs.size());
+			uint32_t firstPolygonVertexId = static_cast<uint32_t>(compacted.polygonVertices.size());
+
+			compacted.segs.insert(compacted.segs.end(),
+				segs.begin() + subsector.firstSegId,
+				segs.begin() + subsector.firstSegId + subsector.segCount);
+			compacted.polygonVertices.insert(compacted.polygonVertices.end(),
+				polygonVertices.begin() + subsector.firstPolygonVertexId,
+				polygonVertices.begin() + subsector.firstPolygonVertexId + subsector.polygonVertexCount);
+
+			subsector.firstSegId = firstSegId;
+			subsector.firstPolygonVertexId = firstPolygonVertexId;
+			compacted.subsectors.push_back(subsector);
+
+			return LEAF_BIT | static_cast<uint32_t>(compacted.subsectors.size() - 1);
+		}
+
+		uint32_t front = self(self, children[2 * child + FRONT]);
+		uint32_t back = self(self, children[2 * child + BACK]);
+
+		compacted.nodes.push_back(nodes[child]);
+		compacted.children.push_back(front);
+		compacted.children.push_back(back);
+
+		return static_cast<uint32_t>(compacted.nodes.size() - 1);
+	};
+
+	compacted.root = copy(copy, root);
+
+	*this = std::move(compacted);
+}
+
+void BspTree::markPublished()
+{
+	replacedSincePublish = false;
+	changedNodeIds.clear();
+
+	publishedNodeCount = static_cast<uint32_t>(nodes.size());
+	publishedSubsectorCount = static_cast<uint32_t>(subsectors.size());
+	publishedSegCount = static_cast<uint32_t>(segs.size());
+	publishedPolygonVertexCount = static_cast<uint32_t>(polygonVertices.size());
+}
+
+void BspTree::takeUpdate(BspTreeUpdate& update)
+{
+	update.changedNodes.clear();
+	update.wholeTree = replacedSincePublish;
+
+	if (update.wholeTree) {
+		update.tree = *this;
+		markPublished();
+		return;
+	}
+
+	BspTree& appended = update.tree;
+
+	update.nodeBase = publishedNodeCount;
+	update.subsectorBase = publishedSubsectorCount;
+	update.segBase = publishedSegCount;
+	update.polygonVertexBase = publishedPolygonVertexCount;
+
+	appended.nodes.assign(nodes.begin() + publishedNodeCount, nodes.end());
+	appended.children.assign(children.begin() + 2 * static_cast<size_t>(publishedNodeCount), children.end());
+	appended.subsectors.assign(subsectors.begin() + publishedSubsectorCount, subsectors.end());
+	appended.segs.assign(segs.begin() + publishedSegCount, segs.end());
+	appended.polygonVertices.assign(polygonVertices.begin() + publishedPolygonVertexCount, polygonVertices.end());
+
+	appended.root = root;
+	appended.boundsMin = boundsMin;
+	appended.boundsMax = boundsMax;
+	appended.orphanedNodeCount = orphanedNodeCount;
+	appended.orphanedSubsectorCount = orphanedSubsectorCount;
+	appended.orphanedSegCount = orphanedSegCount;
+	appended.orphanedPolygonVertexCount = orphanedPolygonVertexCount;
+
+	// Nodes appended since the last update are sent whole already. 
+	std::sort(changedNodeIds.begin(), changedNodeIds.end());
+	changedNodeIds.erase(std::unique(changedNodeIds.begin(), changedNodeIds.end()), changedNodeIds.end());
+
+	for (uint32_t nodeId : changedNodeIds) {
+		if (nodeId >= publishedNodeCount)
+			break;
+
+		update.changedNodes.push_back({ nodeId, nodes[nodeId], { children[2 * nodeId + FRONT], children[2 * nodeId + BACK] } });
+	}
+
+	markPublished();
+}
+
+void BspTree::applyUpdate(const BspTreeUpdate& update)
+{
+	if (update.wholeTree) {
+		*this = update.tree;
+		return;
+	}
+
+	assert(nodes.size() == update.nodeBase && subsectors.size() == update.subsectorBase && "BSP update doesn't follow on from this copy");
+	assert(segs.size() == update.segBase && polygonVertices.size() == update.polygonVertexBase && "BSP update doesn't follow on from this copy");
+
+	const BspTree& appended = update.tree;
+
+	nodes.insert(nodes.end(), appended.nodes.begin(), appended.nodes.end());
+	children.insert(children.end(), appended.children.begin(), appended.children.end());
+	subsectors.insert(subsectors.end(), appended.subsectors.begin(), appended.subsectors.end());
+	segs.insert(segs.end(), appended.segs.begin(), appended.segs.end());
+	polygonVertices.insert(polygonVertices.end(), appended.polygonVertices.begin(), appended.polygonVertices.end());
+
+	for (const BspTreeUpdate::ChangedNode& changed : update.changedNodes) {
+		nodes[changed.nodeId] = changed.node;
+		children[2 * changed.nodeId + FRONT] = changed.children[FRONT];
+		children[2 * changed.nodeId + BACK] = changed.children[BACK];
+	}
+
+	root = appended.root;
+	boundsMin = appended.boundsMin;
+	boundsMax = appended.boundsMax;
+	orphanedNodeCount = appended.orphanedNodeCount;
+	orphanedSubsectorCount = appended.orphanedSubsectorCount;
+	orphanedSegCount = appended.orphanedSegCount;
+	orphanedPolygonVertexCount = appended.orphanedPolygonVertexCount;
+}
@@ -0,0 +1,257 @@
+#ifndef BSP_HPP_INCLUDED
+#define BSP_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+struct BspTreeUpdate;
+
+/**
+ * @brief A compact 2D BSP tree over a level's geometry. 
+ * 
+ * @details The tree is used for point location (which subsector/sector is a point in) and for
+ *			visiting subsectors in exact front-to-back order from a viewpoint. Each leaf is a
+ *			subsector, a convex region that belongs to exactly one sector. 
+ * 
+ *			To keep the tree cache friendly, nodes only hold their partition line and the bounds
+ *			of their two children, quantized to 16-bit map units, fitting two nodes in a cache 
+ *			line. The child references of every node are stored together in one separate array.
+ * 
+ *			Following Doom's convention, the front of a partition line is on its right, and a
+ *			subsector lies on the right of each of its segs. 
+ */
+struct BspTree
+{
+	// Child references with this bit set refer to a subsector rather than a node. 
+	static constexpr uint32_t LEAF_BIT = 0x80000000;
+	static constexpr uint32_t NO_CHILD = 0xFFFFFFFF;
+	static constexpr uint32_t NO_WALL = 0xFFFFFFFF;
+
+	static constexpr int FRONT = 0;
+	static constexpr int BACK = 1;
+
+	/** @brief An axis aligned bounding box, conservatively rounded to whole map units */
+	struct QuantizedBox
+	{
+		int16_t minX, minY, maxX, maxY;
+
+		static QuantizedBox fromBounds(glm::vec2 min, glm::vec2 max);
+
+		/** @brief Grows the box to also cover another box */
+		void expand(const QuantizedBox& other)
+		{
+			minX = std::min(minX, other.minX);
+			minY = std::min(minY, other.minY);
+			maxX = std::max(maxX, other.maxX);
+			maxY = std::max(maxY, other.maxY);
+		}
+
+		bool overlaps(const QuantizedBox& other) const
+		{
+			return minX <= other.maxX && other.minX <= maxX
+				&& minY <= other.maxY && other.minY <= maxY;
+		}
+	};
+
+	struct Node
+	{
+		glm::vec2		origin;		// A point on the partition line
+		glm::vec2		direction;	// Direction of the partition line
+		QuantizedBox	bounds[2];	// Bounds of the front and back children
+	};
+
+	/** @brief A piece of a wall (or a partition line, for minisegs) bounding a subsector */
+	struct Seg
+	{
+		glm::vec2	start;
+		glm::vec2	end;
+		uint32_t	wallId;			// The wall the seg is part of, or NO_WALL for minisegs
+	};
+
+	struct Subsector
+	{
+		uint32_t	firstSegId;
+		uint32_t	segCount;
+		uint32_t	sectorId;
+
+		// The convex polygon covering the subsector, counter-clockwise, in polygonVertices
+		uint32_t	firstPolygonVertexId;
+		uint32_t	polygonVertexCount;
+	};
+
+	std::vector<Node>			nodes;
+	std::vector<uint32_t>		children;	// children[2 * n + FRONT/BACK] are node n's children
+	std::vector<Subsector>		subsectors;
+	std::vector<Seg>			segs;
+	std::vector<glm::vec2>		polygonVertices;
+
+	uint32_t root = NO_CHILD;
+
+	// The area covered by the root of the tree. Subsector polygons are clipped from this box.
+	glm::vec2 boundsMin{ 0.0f, 0.0f };
+	glm::vec2 boundsMax{ 0.0f, 0.0f };
+
+	// Entries left unreachable by rebuilding parts of the tree in place. Once these outnumber the 
+	// entries still in use, the tree is compacted. 
+	uint32_t orphanedNodeCount = 0;
+	uint32_t orphanedSubsectorCount = 0;
+	uint32_t orphanedSegCount = 0;
+	uint32_t orphanedPolygonVertexCount = 0;
+
+	// What changed since the tree was last published to a copy of it. A new tree counts as
+	// replaced, since no copy has any of it yet. 
+	bool					replacedSincePublish = true;
+	std::vector<uint32_t>	changedNodeIds;
+	uint32_t				publishedNodeCount = 0;
+	uint32_t				publishedSubsectorCount = 0;
+	uint32_t				publishedSegCount = 0;
+	uint32_t				publishedPolygonVertexCount = 0;
+
+	bool empty() const { return root == NO_CHILD; }
+
+	/** @brief Returns true when more of the arrays' entries are unreachable than reachable */
+	bool mostlyOrphaned() const
+	{
+		const size_t orphaned = static_cast<size_t>(orphanedNodeCount) + orphanedSubsectorCount + orphanedSegCount + orphanedPolygonVertexCount;
+		const size_t total = nodes.size() + subsectors.size() + segs.size() + polygonVertices.size();
+		return orphaned > total / 2;
+	}
+
+	static bool isLeaf(uint32_t child) { return (child & LEAF_BIT) != 0; }
+	static uint32_t leafIndex(uint32_t child) { return child & ~LEAF_BIT; }
+
+	/** @brief Returns which side of a node's partition line a point is on */
+	static int pointSide(const Node& node, glm::vec2 point)
+	{
+		float cross = (point.y - node.origin.y) * node.direction.x - (point.x - node.origin.x) * node.direction.y;
+		return cross < 0.0f ? FRONT : BACK;
+	}
+
+	/** @brief Returns the subsector that contains a point, in O(depth) */
+	uint32_t findSubsector(glm::vec2 point) const;
+
+	/** @brief Returns the sector that contains a point */
+	uint32_t findSector(glm::vec2 point) const { return subsectors[findSubsector(point)].sectorId; }
+
+	/**
+	 * @brief Calls visit(subsectorId) for every subsector, nearest to the viewpoint first. 
+	 * 
+	 * @details Children whose bounding box is rejected by accept(box) are skipped entirely, 
+	 *			allowing the traversal to be culled, e.g. against the view frustum. 
+	 */
+	template<typename Visit, typename Accept>
+	void traverseFrontToBack(glm::vec2 viewPoint, Visit&& visit, Accept&& accept) const;
+
+	template<typename Visit>
+	void traverseFrontToBack(glm::vec2 viewPoint, Visit&& visit) const
+	{
+		traverseFrontToBack(viewPoint, visit, [](const QuantizedBox&) { return true; });
+	}
+
+	/**
+	 * @brief Builds the convex polygon of every subsector by clipping the tree's bounds against
+	 *		  the partition lines leading to it, and then against its own segs. 
+	 * 
+	 * @details The tree's bounds are set to a box a little larger than all of its segs first.
+	 */
+	void buildSubsectorPolygons();
+
+	/** @brief Builds the polygons of the subsectors below a child, given the region it covers */
+	void buildPolygons(uint32_t child, std::vector<glm::vec2>& region);
+
+	/**
+	 * @brief Appends the part of another tree below fragmentRoot to this tree's arrays. 
+	 * 
+	 * @details The appended part isn't linked to anything. The returned child reference should
+	 *			be made the root, or be stored as the child of one of this tree's nodes. 
+	 */
+	uint32_t append(const BspTree& fragment, uint32_t fragmentRoot);
+
+	/** @brief Rebuilds the arrays with only the parts reachable from the root */
+	void compact();
+
+	/** @brief Records that a node's bounds or children changed after the tree was published */
+	void markNodeChanged(uint32_t nodeId) { changedNodeIds.push_back(nodeId); }
+
+	/** @brief Records that every copy of the tree is now up to date with it */
+	void markPublished();
+
+	/** @brief Fills an update with what changed since the tree was last published, and marks it published */
+	void takeUpdate(BspTreeUpdate& update);
+
+	/** @brief Brings a copy of a tree up to date with an update taken from the original */
+	void applyUpdate(const BspTreeUpdate& update);
+
+	/** @brief Clips a convex polygon against a partition line, keeping the part on the given side */
+	static void clipPolygon(std::vector<glm::vec2>& polygon, glm::vec2 origin, glm::vec2 direction, int keepSide);
+};
+
+/**
+ * @brief What changed in a BSP tree since it was last published, for bringing a copy of it up to
+ *		  date without copying the whole tree.
+ *
+ * @details Rebuilding part of a tree in place only appends the new subtree to the arrays and
+ *			changes the nodes above it, so an update is usually the appended entries and a few
+ *			nodes. Once a tree is built again or compacted, the update holds all of it. 
+ */
+struct BspTreeUpdate
+{
+	struct ChangedNode
+	{
+		uint32_t		nodeId;
+		BspTree::Node	node;
+		uint32_t		children[2];
+	};
+
+	bool						wholeTree = false;
+
+	// The whole tree, or the entries appended since the last update along with the tree's root,
+	// bounds and orphan counts
+	BspTree						tree;
+
+	// Where the appended entries go in the copy's arrays
+	uint32_t					nodeBase = 0;
+	uint32_t					subsectorBase = 0;
+	uint32_t					segBase = 0;
+	uint32_t					polygonVertexBase = 0;
+
+	// Nodes from before the appended entries that changed
+	std::vector<ChangedNode>	changedNodes;
+};
+
+template<typename Visit, typename Accept>
+void BspTree::traverseFrontToBack(glm::vec2 viewPoint, Visit&& visit, Accept&& accept) const
+{
+	if (empty())
+		return;
+
+	// An explicit stack avoids recursion. The far child is pushed before the near one, so the
+	// near side is always fully visited first. 
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+
+	while (!stack.empty()) {
+		uint32_t child = stack.back();
+		stack.pop_back();
+
+		if (isLeaf(child)) {
+			visit(leafIndex(child));
+			continue;
+		}
+
+		const Node& node = nodes[child];
+		const int nearSide = pointSide(node, viewPoint);
+		const int farSide = nearSide ^ 1;
+
+		if (accept(node.bounds[farSide]))
+			stack.push_back(children[2 * child + farSide]);
+		if (accept(node.bounds[nearSide]))
+			stack.push_back(children[2 * child + nearSide]);
+	}
+}
+
+#endif//BSP_HPP_INCLUDED
@@ -0,0 +1,600 @@
+#include "BspBuilder.hpp"
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include <Utility/Timer.hpp>
+
+namespace
+{
+	// Segs closer than this to a partition line are considered to lie on it. A split seg has an
+	// end further than this on each side, so both of its pieces are at least this long.
+	const float SIDE_EPSILON = 1.0f / 64.0f;
+
+	// Walls shorter than this don't get a seg.
+	const float MIN_SEG_LENGTH = 1.0f / 32.0f;
+
+	/** @brief A seg while the tree is being built */
+	struct BuildSeg
+	{
+		glm::vec2	start;
+		glm::vec2	end;
+		uint32_t	wallId;
+		uint32_t	sectorId;
+	};
+
+	/** @brief State shared by every thread working on the same build */
+	struct BuildContext
+	{
+		const BspBuilder::Settings& settings;
+		uint32_t					maxParallelDepth;
+		std::atomic<uint32_t>		splitCount = 0;
+	};
+
+	/** @brief How a seg lies relative to a partition line */
+	enum class SegSide
+	{
+		Front,
+		Back,
+		Split
+	};
+
+	/**
+	 * @brief Signed distance of a point from a partition line, positive on the front (right)
+	 */
+	float sideDistance(glm::vec2 origin, glm::vec2 direction, float length, glm::vec2 point)
+	{
+		return ((point.x - origin.x) * direction.y - (point.y - origin.y) * direction.x) / length;
+	}
+
+	SegSide classify(glm::vec2 origin, glm::vec2 direction, float length, const BuildSeg& seg, float& startDistance, float& endDistance)
+	{
+		startDistance = sideDistance(origin, direction, length, seg.start);
+		endDistance = sideDistance(origin, direction, length, seg.end);
+
+		// Segs on the partition line go to the side they face. A seg's sector is on its right,
+		// so segs running the same way as the partition belong in front of it.
+		if (std::abs(startDistance) <= SIDE_EPSILON && std::abs(endDistance) <= SIDE_EPSILON)
+			return glm::dot(seg.end - seg.start, direction) > 0.0f ? SegSide::Front : SegSide::Back;
+
+		if (startDistance >= -SIDE_EPSILON && endDistance >= -SIDE_EPSILON)
+			return SegSide::Front;
+		if (startDistance <= SIDE_EPSILON && endDistance <= SIDE_EPSILON)
+			return SegSide::Back;
+
+		return SegSide::Split;
+	}
+
+	/**
+	 * @brief Finds the seg whose line makes the cheapest partition for a set of segs.
+	 *
+	 * @return The index of the chosen seg, or segs.size() if no line divides the set, meaning
+	 *		   the segs already bound a convex region.
+	 */
+	size_t choosePartition(const std::vector<BuildSeg>& segs, const BspBuilder::Settings& settings)
+	{
+		size_t best = segs.size();
+		float bestCost = std::numeric_limits<float>::max();
+
+		auto evaluate = [&](size_t candidate) {
+			const BuildSeg& partition = segs[candidate];
+			const glm::vec2 direction = partition.end - partition.start;
+			const float length = glm::length(direction);
+
+			int front = 0;
+			int back = 0;
+			int splits = 0;
+
+			for (const BuildSeg& seg : segs) {
+				float startDistance, endDistance;
+				switch (classify(partition.start, direction, length, seg, startDistance, endDistance)) {
+				case SegSide::Front:	front++;	break;
+				case SegSide::Back:		back++;		break;
+				case SegSide::Split:	splits++;	break;
+				}
+
+				// Stop early once this candidate can't beat the best one.
+				if (splits * settings.splitCost >= bestCost)
+					return;
+			}
+
+			// A line with everything in front of it doesn't divide anything.
+			if (back == 0 && splits == 0)
+				return;
+
+			float cost = splits * settings.splitCost + std::abs(front - back) * settings.balanceCost;
+			if (cost < bestCost) {
+				bestCost = cost;
+				best = candidate;
+			}
+		};
+
+		const size_t step = std::max<size_t>(1, segs.size() / std::max<uint32_t>(1, settings.maxCandidates));
+		for (size_t i = 0; i < segs.size(); i += step)
+			evaluate(i);
+
+		// If none of the sampled lines divide the segs, check the rest before deciding the set
+		// is convex.
+		if (best == segs.size() && step > 1) {
+			for (size_t i = 0; i < segs.size(); i++)
+				if (i % step != 0)
+					evaluate(i);
+		}
+
+		return best;
+	}
+
+	BspTree::QuantizedBox segBounds(const std::vector<BuildSeg>& segs)
+	{
+		glm::vec2 min = segs[0].start;
+		glm::vec2 max = segs[0].start;
+
+		for (const BuildSeg& seg : segs) {
+			min = glm::min(min, glm::min(seg.start, seg.end));
+			max = glm::max(max, glm::max(seg.start, seg.end));
+		}
+
+		return BspTree::QuantizedBox::fromBounds(min, max);
+	}
+
+	/**
+	 * @brief Recursively builds the subtree over a set of segs into a tree's arrays.
+	 *
+	 * @return The child reference of the subtree's root.
+	 */
+	uint32_t buildSubtree(std::vector<BuildSeg>& segs, BspTree& tree, BspTree::QuantizedBox& bounds, uint32_t depth, BuildContext& context)
+	{
+		bounds = segBounds(segs);
+
+		size_t partitionIndex = choosePartition(segs, context.settings);
+
+		// The segs bound a convex region, so they become a subsector.
+		if (partitionIndex == segs.size()) {
+			BspTree::Subsector subsector{};
+			subsector.firstSegId = static_cast<uint32_t>(tree.segs.size());
+			subsector.segCount = static_cast<uint32_t>(segs.size());
+			subsector.sectorId = segs[0].sectorId;
+
+			for (const BuildSeg& seg : segs)
+				tree.segs.push_back(BspTree::Seg{ seg.start, seg.end, seg.wallId });
+
+			tree.subsectors.push_back(subsector);
+			return BspTree::LEAF_BIT | static_cast<uint32_t>(tree.subsectors.size() - 1);
+		}
+
+		BspTree::Node node;
+		node.origin = segs[partitionIndex].start;
+		node.direction = segs[partitionIndex].end - segs[partitionIndex].start;
+		const float length = glm::length(node.direction);
+
+		std::vector<BuildSeg> frontSegs;
+		std::vector<BuildSeg> backSegs;
+		frontSegs.reserve(segs.size() / 2 + 1);
+		backSegs.reserve(segs.size() / 2 + 1);
+
+		uint32_t splitCount = 0;
+
+		for (const BuildSeg& seg : segs) {
+			float startDistance, endDistance;
+			switch (classify(node.origin, node.direction, length, seg, startDistance, endDistance)) {
+			case SegSide::Front:	frontSegs.push_back(seg);	break;
+			case SegSide::Back:		backSegs.push_back(seg);	break;
+			case SegSide::Split: {
+				const float t = startDistance / (startDistance - endDistance);
+				const glm::vec2 splitPoint = seg.start + (seg.end - seg.start) * t;
+
+				BuildSeg startPiece = seg;
+				BuildSeg endPiece = seg;
+				startPiece.end = splitPoint;
+				endPiece.start = splitPoint;
+
+				// Both pieces are kept, however short, so each side gets one. Dropping either could
+				// leave a side with no segs at all.
+				auto& startSide = startDistance > 0.0f ? frontSegs : backSegs;
+				auto& endSide = startDistance > 0.0f ? backSegs : frontSegs;
+
+				startSide.push_back(startPiece);
+				endSide.push_back(endPiece);
+
+				splitCount++;
+				break;
+			}
+			}
+		}
+
+		context.splitCount += splitCount;
+
+		// The parent's segs aren't needed anymore, and can use a lot of memory near the root.
+		std::vector<BuildSeg>().swap(segs);
+
+		uint32_t frontChild;
+		uint32_t backChild;
+
+		// Large subtrees are built in parallel. The back side is built into its own tree on
+		// another thread and appended afterwards, so the threads never share any arrays.
+		const bool parallel = frontSegs.size() + backSegs.size() > context.settings.parallelThreshold
+			&& depth < context.maxParallelDepth
+			&& !frontSegs.empty() && !backSegs.empty();
+
+		if (parallel) {
+			BspTree backTree;
+			auto backFuture = std::async(std::launch::async, [&] {
+				return buildSubtree(backSegs, backTree, node.bounds[BspTree::BACK], depth + 1, context);
+			});
+
+			frontChild = buildSubtree(frontSegs, tree, node.bounds[BspTree::FRONT], depth + 1, context);
+			backChild = tree.append(backTree, backFuture.get());
+		}
+		else {
+			frontChild = buildSubtree(frontSegs, tree, node.bounds[BspTree::FRONT], depth + 1, context);
+			backChild = buildSubtree(backSegs, tree, node.bounds[BspTree::BACK], depth + 1, context);
+		}
+
+		tree.nodes.push_back(node);
+		tree.children.push_back(frontChild);
+		tree.children.push_back(backChild);
+
+		return static_cast<uint32_t>(tree.nodes.size() - 1);
+	}
+
+	/** @brief Builds a tree over a set of segs, returning the root's child reference */
+	uint32_t buildTree(std::vector<BuildSeg>& segs, BspTree& tree, BspTree::QuantizedBox& bounds, const BspBuilder::Settings& settings, BspBuilder::Stats& stats)
+	{
+		// Splitting a few levels deep gives every core a subtree to work on.
+		const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+		const uint32_t maxParallelDepth = static_cast<uint32_t>(std::ceil(std::log2(threadCount))) + 1;
+
+		BuildContext context{ settings, maxParallelDepth };
+
+		stats.inputSegCount = static_cast<uint32_t>(segs.size());
+
+		uint32_t root = buildSubtree(segs, tree, bounds, 0, context);
+
+		stats.splitCount = context.splitCount;
+
+		return root;
+	}
+
+	/** @brief Fills in the size and depth measures of a tree's stats */
+	void measureTree(const BspTree& tree, BspBuilder::Stats& stats)
+	{
+		stats.nodeCount = static_cast<uint32_t>(tree.nodes.size()) - tree.orphanedNodeCount;
+		stats.subsectorCount = 0;
+		stats.segCount = 0;
+		stats.maxDepth = 0;
+
+		uint64_t depthSum = 0;
+
+		std::vector<std::pair<uint32_t, uint32_t>> stack = { { tree.root, 0 } };
+		while (!stack.empty()) {
+			auto [child, depth] = stack.back();
+			stack.pop_back();
+
+			if (BspTree::isLeaf(child)) {
+				stats.subsectorCount++;
+				stats.segCount += tree.subsectors[BspTree::leafIndex(child)].segCount;
+				stats.maxDepth = std::max(stats.maxDepth, depth);
+				depthSum += depth;
+				continue;
+			}
+
+			stack.push_back({ tree.children[2 * child + BspTree::FRONT], depth + 1 });
+			stack.push_back({ tree.children[2 * child + BspTree::BACK], depth + 1 });
+		}
+
+		stats.averageLeafDepth = stats.subsectorCount > 0 ? (float)depthSum / (float)stats.subsectorCount : 0.0f;
+	}
+
+	/**
+	 * @brief Creates the seg for a wall. Walls wind counter-clockwise with their sector on the
+	 *		  left, while segs have their sector on the right, so the direction is reversed.
+	 */
+	BuildSeg wallSeg(const Level& level, uint32_t wallId)
+	{
+		const Wall& wall = level.walls[wallId];
+		const LineDef& lineDef = level.lineDefs[wall.lineDefId];
+
+		const bool wallFollowsLine = wallId == lineDef.frontWallId;
+		const uint32_t startVertexId = wallFollowsLine ? lineDef.startVertexId : lineDef.endVertexId;
+		const uint32_t endVertexId = wallFollowsLine ? lineDef.endVertexId : lineDef.startVertexId;
+
+		return BuildSeg{ level.vertices[endVertexId], level.vertices[startVertexId], wallId, wall.sectorId };
+	}
+}
+
+BspBuilder::BspBuilder(const Settings& settings)
+	: _settings(settings)
+{
+}
+
+BspBuilder::Stats BspBuilder::build(Level& level) const
+{
+	Stats stats;
+
+	Timer timer;
+	timer.start();
+
+	std::vector<BuildSeg> segs;
+	segs.reserve(level.walls.size());
+
+	for (uint32_t wallId = 0; wallId < level.walls.size(); wallId++) {
+		BuildSeg seg = wallSeg(level, wallId);
+		if (glm::length(seg.end - seg.start) >= MIN_SEG_LENGTH)
+			segs.push_back(seg);
+	}
+
+	level.bsp = BspTree();
+
+	if (!segs.empty()) {
+		BspTree::QuantizedBox bounds;
+		level.bsp.root = buildTree(segs, level.bsp, bounds, _settings, stats);
+		level.bsp.buildSubsectorPolygons();
+	}
+
+	timer.stop();
+	stats.buildMilliseconds = timer.milleseconds();
+
+	if (!level.bsp.empty())
+		measureTree(level.bsp, stats);
+
+	return stats;
+}
+
+BspBuilder::Stats BspBuilder::rebuildSector(Level& level, uint32_t sectorId) const
+{
+	const Sector& sector = level.sectors[sectorId];
+
+	std::vector<uint32_t> vertexIds;
+	vertexIds.reserve(sector.wallCount);
+
+	for (uint32_t i = 0; i < sector.wallCount; i++) {
+		const LineDef& lineDef = level.lineDefs[level.walls[sector.firstWallId + i].lineDefId];
+		vertexIds.push_back(lineDef.startVertexId);
+		vertexIds.push_back(lineDef.endVertexId);
+	}
+
+	return rebuild(level, vertexIds);
+}
+
+BspBuilder::Stats BspBuilder::rebuild(Level& level, const std::vector<uint32_t>& movedVertexIds) const
+{
+	BspTree& tree = level.bsp;
+
+	if (tree.empty())
+		return build(level);
+
+	Timer timer;
+	timer.start();
+
+	// 1. Find the walls on every line touching a moved vertex.
+	std::vector<bool> vertexMoved(level.vertices.size(), false);
+	for (uint32_t vertexId : movedVertexIds)
+		vertexMoved[vertexId] = true;
+
+	std::vector<bool> wallAffected(level.walls.size(), false);
+	std::vector<uint32_t> affectedWalls;
+	std::vector<glm::vec2> affectedPoints;
+
+	for (const LineDef& lineDef : level.lineDefs) {
+		if (!vertexMoved[lineDef.startVertexId] && !vertexMoved[lineDef.endVertexId])
+			continue;
+
+		for (uint32_t wallId : { lineDef.frontWallId, lineDef.backWallId }) {
+			if (wallId != LineDef::NO_WALL) {
+				wallAffected[wallId] = true;
+				affectedWalls.push_back(wallId);
+			}
+		}
+
+		affectedPoints.push_back(level.vertices[lineDef.startVertexId]);
+		affectedPoints.push_back(level.vertices[lineDef.endVertexId]);
+	}
+
+	if (affectedWalls.empty())
+		return Stats{};
+
+	// If anything moved outside of the tree's bounds, the whole tree needs rebuilding anyway.
+	for (glm::vec2 point : affectedPoints) {
+		if (point.x < tree.boundsMin.x || point.y < tree.boundsMin.y || point.x > tree.boundsMax.x || point.y > tree.boundsMax.y)
+			return build(level);
+	}
+
+	// 2. Find the parent of every node and subsector, so we can walk up from the leaves.
+	constexpr uint32_t NO_PARENT = BspTree::NO_CHILD;
+
+	std::vector<uint32_t> nodeParent(tree.nodes.size(), NO_PARENT);
+	std::vector<uint32_t> nodeDepth(tree.nodes.size(), 0);
+	std::vector<uint32_t> subsectorParent(tree.subsectors.size(), NO_PARENT);
+
+	if (!BspTree::isLeaf(tree.root)) {
+		std::vector<uint32_t> stack = { tree.root };
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+
+			for (int side : { BspTree::FRONT, BspTree::BACK }) {
+				uint32_t child = tree.children[2 * node + side];
+				if (BspTree::isLeaf(child)) {
+					subsectorParent[BspTree::leafIndex(child)] = node;
+				}
+				else {
+					nodeParent[child] = node;
+					nodeDepth[child] = nodeDepth[node] + 1;
+					stack.push_back(child);
+				}
+			}
+		}
+	}
+
+	auto parentOf = [&](uint32_t child) {
+		return BspTree::isLeaf(child) ? subsectorParent[BspTree::leafIndex(child)] : nodeParent[child];
+	};
+
+	auto depthOf = [&](uint32_t child) {
+		if (!BspTree::isLeaf(child))
+			return nodeDepth[child];
+
+		uint32_t parent = parentOf(child);
+		return parent == NO_PARENT ? 0u : nodeDepth[parent] + 1;
+	};
+
+	// Finds the lowest common ancestor of two children.
+	auto commonAncestor = [&](uint32_t a, uint32_t b) {
+		while (a != b) {
+			if (depthOf(a) >= depthOf(b))
+				a = parentOf(a);
+			else
+				b = parentOf(b);
+		}
+		return a;
+	};
+
+	// 3. The subtree to rebuild has to contain every leaf the affected walls are in now...
+	uint32_t subtree = BspTree::NO_CHILD;
+	for (uint32_t i = 0; i < tree.subsectors.size(); i++) {
+		const BspTree::Subsector& subsector = tree.subsectors[i];
+		if (subsectorParent[i] == NO_PARENT && (BspTree::LEAF_BIT | i) != tree.root)
+			continue;	// Orphaned by an earlier rebuild
+
+		for (uint32_t s = 0; s < subsector.segCount; s++) {
+			uint32_t wallId = tree.segs[subsector.firstSegId + s].wallId;
+			if (wallId != BspTree::NO_WALL && wallAffected[wallId]) {
+				uint32_t leaf = BspTree::LEAF_BIT | i;
+				subtree = subtree == BspTree::NO_CHILD ? leaf : commonAncestor(subtree, leaf);
+				break;
+			}
+		}
+	}
+
+	if (subtree == BspTree::NO_CHILD)
+		subtree = BspTree::LEAF_BIT | tree.findSubsector(affectedPoints[0]);
+
+	// ...and the new positions of those walls. A subtree's region is the intersection of the
+	// partition half-planes above it, so we move up until every point is inside.
+	auto regionContains = [&](uint32_t child, glm::vec2 point) {
+		for (uint32_t parent = parentOf(child); parent != NO_PARENT; child = parent, parent = parentOf(parent)) {
+			const BspTree::Node& node = tree.nodes[parent];
+			const int side = tree.children[2 * parent + BspTree::FRONT] == child ? BspTree::FRONT : BspTree::BACK;
+
+			float distance = sideDistance(node.origin, node.direction, glm::length(node.direction), point);
+			if (side == BspTree::FRONT ? distance < -SIDE_EPSILON : distance > SIDE_EPSILON)
+				return false;
+		}
+		return true;
+	};
+
+	for (glm::vec2 point : affectedPoints) {
+		while (subtree != tree.root && !regionContains(subtree, point))
+			subtree = parentOf(subtree);
+	}
+
+	if (subtree == tree.root)
+		return build(level);
+
+	// 4. Gather the segs to rebuild from: everything in the subtree that wasn't affected, plus
+	// the affected walls at their new positions.
+	std::vector<BuildSeg> segs;
+	uint32_t removedNodeCount = 0;
+	uint32_t removedSubsectorCount = 0;
+	uint32_t removedSegCount = 0;
+	uint32_t removedPolygonVertexCount = 0;
+
+	std::vector<uint32_t> stack = { subtree };
+	while (!stack.empty()) {
+		uint32_t child = stack.back();
+		stack.pop_back();
+
+		if (BspTree::isLeaf(child)) {
+			const BspTree::Subsector& subsector = tree.subsectors[BspTree::leafIndex(child)];
+
+			removedSubsectorCount++;
+			removedSegCount += subsector.segCount;
+			removedPolygonVertexCount += subsector.polygonVertexCount;
+
+			for (uint32_t s = 0; s < subsector.segCount; s++) {
+				const BspTree::Seg& seg = tree.segs[subsector.firstSegId + s];
+				if (seg.wallId != BspTree::NO_WALL && wallAffected[seg.wallId])
+					continue;
+
+				uint32_t sectorId = seg.wallId != BspTree::NO_WALL ? level.walls[seg.wallId].sectorId : subsector.sectorId;
+				segs.push_back(BuildSeg{ seg.start, seg.end, seg.wallId, sectorId });
+			}
+			continue;
+		}
+
+		removedNodeCount++;
+		stack.push_back(tree.children[2 * child + BspTree::FRONT]);
+		stack.push_back(tree.children[2 * child + BspTree::BACK]);
+	}
+
+	for (uint32_t wallId : affectedWalls) {
+		BuildSeg seg = wallSeg(level, wallId);
+		if (glm::length(seg.end - seg.start) >= MIN_SEG_LENGTH)
+			segs.push_back(seg);
+	}
+
+	if (segs.empty())
+		return build(level);
+
+	// 5. Build the replacement subtree on its own and compute its polygons from the region the
+	// old subtree covered.
+	Stats stats;
+	stats.partialRebuild = true;
+
+	BspTree fragment;
+	BspTree::QuantizedBox bounds;
+	uint32_t fragmentRoot = buildTree(segs, fragment, bounds, _settings, stats);
+
+	std::vector<glm::vec2> region = {
+		{ tree.boundsMin.x, tree.boundsMin.y },
+		{ tree.boundsMax.x, tree.boundsMin.y },
+		{ tree.boundsMax.x, tree.boundsMax.y },
+		{ tree.boundsMin.x, tree.boundsMax.y }
+	};
+
+	std::vector<std::pair<uint32_t, int>> path;
+	for (uint32_t child = subtree, parent = parentOf(child); parent != NO_PARENT; child = parent, parent = parentOf(parent)) {
+		const int side = tree.children[2 * parent + BspTree::FRONT] == child ? BspTree::FRONT : BspTree::BACK;
+		path.push_back({ parent, side });
+	}
+
+	for (auto it = path.rbegin(); it != path.rend(); ++it) {
+		const BspTree::Node& node = tree.nodes[it->first];
+		BspTree::clipPolygon(region, node.origin, node.direction, it->second);
+	}
+
+	fragment.buildPolygons(fragmentRoot, region);
+
+	// 6. Splice the new subtree in where the old one was, and grow the bounds above it.
+	uint32_t newChild = tree.append(fragment, fragmentRoot);
+
+	auto [parent, side] = path.front();
+	tree.children[2 * parent + side] = newChild;
+	tree.nodes[parent].bounds[side] = bounds;
+	tree.markNodeChanged(parent);
+
+	for (size_t i = 1; i < path.size(); i++) {
+		tree.nodes[path[i].first].bounds[path[i].second].expand(bounds);
+		tree.markNodeChanged(path[i].first);
+	}
+
+	// Everything below the old subtree, leaves included, is left behind in the arrays. 
+	tree.orphanedNodeCount += removedNodeCount;
+	tree.orphanedSubsectorCount += removedSubsectorCount;
+	tree.orphanedSegCount += removedSegCount;
+	tree.orphanedPolygonVertexCount += removedPolygonVertexCount;
+
+	if (tree.mostlyOrphaned())
+		tree.compact();
+
+	timer.stop();
+	stats.buildMilliseconds = timer.milleseconds();
+
+	measureTree(tree, stats);
+
+	return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef BSP_BUILDER_HPP_INCLUDED
+#define BSP_BUILDER_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+#include <Level.hpp>
+#include <Geometry/Bsp.hpp>
+
+/**
+ * @brief Builds a BSP tree over a level's walls.
+ *
+ * @details Levels built in code, or in formats without node builder output, have no BSP. This
+ *			builds one directly from the level's walls, choosing each partition line from the walls
+ *			themselves, the same way Doom's node builders do.
+ *
+ *			Each partition is picked to minimise a weighted sum of how many walls it splits and
+ *			how unbalanced the two sides are. Splits add segs and polygons, while imbalance makes
+ *			the tree deeper, so the weights trade tree size against query depth.
+ *
+ *			Large subtrees are built in parallel. When part of a level moves, only the smallest
+ *			subtree containing both the old and new positions of the moved walls is rebuilt.
+ */
+class BspBuilder
+{
+public:
+	struct Settings
+	{
+		float		splitCost = 8.0f;			// Cost of each seg split by a partition
+		float		balanceCost = 1.0f;			// Cost of each seg of difference between the two sides
+		uint32_t	maxCandidates = 64;			// Partition lines tried per node. Evenly sampled from the segs
+		uint32_t	parallelThreshold = 512;	// Subtrees with more segs than this are split across threads
+	};
+
+	/** @brief Timings and quality measures of the last build or rebuild */
+	struct Stats
+	{
+		float		buildMilliseconds = 0.0f;
+
+		uint32_t	inputSegCount = 0;			// Segs the build started with, before splitting
+		uint32_t	splitCount = 0;				// Number of segs split by partitions
+		uint32_t	nodeCount = 0;
+		uint32_t	subsectorCount = 0;
+		uint32_t	segCount = 0;
+
+		uint32_t	maxDepth = 0;
+		float		averageLeafDepth = 0.0f;
+
+		bool		partialRebuild = false;		// True if only a subtree was rebuilt
+	};
+
+	BspBuilder() = default;
+	BspBuilder(const Settings& settings);
+
+	Settings& settings() { return _settings; }
+
+	/** @brief Builds a new BSP for the whole level, replacing any it already has */
+	Stats build(Level& level) const;
+
+	/**
+	 * @brief Updates the level's BSP after some of its vertices have moved.
+	 *
+	 * @details Only the subtree covering both the old and new positions of the walls touching
+	 *			the moved vertices is rebuilt. Falls back to a full build when that is the whole
+	 *			tree, or the vertices have moved outside of it.
+	 */
+	Stats rebuild(Level& level, const std::vector<uint32_t>& movedVertexIds) const;
+
+	/** @brief Updates the level's BSP after all of a sector's vertices have moved */
+	Stats rebuildSector(Level& level, uint32_t sectorId) const;
+
+private:
+	Settings _settings;
+};
+
+#endif//BSP_BUILDER_HPP_INCLUDED
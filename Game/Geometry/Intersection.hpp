@@ -0,0 +1,27 @@
+#ifndef INTERSECTION_HPP_INCLUDED
+#define INTERSECTION_HPP_INCLUDED
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Returns true if a segment touches an axis aligned box that its own bounding box overlaps.
+ *
+ * @details The boxes overlapping already rules out the box's axes, so the only separating axis
+ *			left to check is the segment's normal: the box's corners must not all be on one side
+ *			of the line.
+ */
+inline bool segmentTouchesBox(glm::vec2 start, glm::vec2 end, glm::vec2 min, glm::vec2 max)
+{
+	const glm::vec2 normal{ end.y - start.y, start.x - end.x };
+	const glm::vec2 center = (min + max) * 0.5f;
+	const glm::vec2 extent = (max - min) * 0.5f;
+
+	const float distance = glm::dot(center - start, normal);
+	const float radius = extent.x * std::abs(normal.x) + extent.y * std::abs(normal.y);
+
+	return std::abs(distance) <= radius;
+}
+
+#endif//INTERSECTION_HPP_INCLUDED
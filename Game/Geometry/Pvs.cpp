@@ -0,0 +1,365 @@
+#include "Pvs.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <Level.hpp>
+
+namespace
+{
+	// Points closer than this to a line are considered to lie on it.
+	const float SIDE_EPSILON = 1.0f / 64.0f;
+
+	// Portals clipped shorter than this can't be seen through.
+	const float MIN_PORTAL_LENGTH = 1.0f / 16.0f;
+
+	// Chains of portals deeper than this, or sectors whose flow takes more steps than this, stop
+	// clipping and just mark everything they can reach as visible. This bounds the time spent on
+	// pathological maps, while keeping the result conservative.
+	const uint32_t MAX_FLOW_DEPTH = 64;
+	const uint32_t MAX_FLOW_STEPS = 1 << 20;
+
+	struct Segment
+	{
+		glm::vec2 start;
+		glm::vec2 end;
+	};
+
+	/** @brief A portal out of a sector, with the sector on the left of its segment */
+	struct FlowPortal
+	{
+		Segment		segment;
+		uint32_t	lineDefId;
+		uint32_t	neighbourSectorId;
+	};
+
+	float length(const Segment& segment)
+	{
+		return glm::length(segment.end - segment.start);
+	}
+
+	/** @brief Signed distance of a point from the line through a and b, positive on the left */
+	float sideDistance(glm::vec2 a, glm::vec2 b, glm::vec2 point)
+	{
+		const glm::vec2 direction = b - a;
+		return (direction.x * (point.y - a.y) - direction.y * (point.x - a.x)) / glm::length(direction);
+	}
+
+	/**
+	 * @brief Clips a segment against the line through a and b, keeping the part on one side.
+	 *
+	 * @return False if nothing of the segment is left.
+	 */
+	bool clipSegment(Segment& segment, glm::vec2 a, glm::vec2 b, bool keepLeft)
+	{
+		float startDistance = sideDistance(a, b, segment.start);
+		float endDistance = sideDistance(a, b, segment.end);
+
+		if (!keepLeft) {
+			startDistance = -startDistance;
+			endDistance = -endDistance;
+		}
+
+		if (startDistance >= -SIDE_EPSILON && endDistance >= -SIDE_EPSILON)
+			return true;
+		if (startDistance < -SIDE_EPSILON && endDistance < -SIDE_EPSILON)
+			return false;
+
+		const float t = startDistance / (startDistance - endDistance);
+		const glm::vec2 clipPoint = segment.start + (segment.end - segment.start) * t;
+
+		(startDistance < 0.0f ? segment.start : segment.end) = clipPoint;
+		return true;
+	}
+
+	/**
+	 * @brief Clips a target segment to the part that can be reached by straight lines passing
+	 *		  through both the source and pass segments.
+	 *
+	 * @details That region is bounded by the separating lines: lines through an end of the source
+	 *			and an end of the pass, with the rest of the source and the rest of the pass on
+	 *			opposite sides. The target has to be on the pass's side of each of them.
+	 *
+	 * @return False if nothing of the target is left.
+	 */
+	bool clipToSeparators(const Segment& source, const Segment& pass, Segment& target)
+	{
+		const glm::vec2 sourcePoints[2] = { source.start, source.end };
+		const glm::vec2 passPoints[2] = { pass.start, pass.end };
+
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 2; j++) {
+				const glm::vec2 a = sourcePoints[i];
+				const glm::vec2 b = passPoints[j];
+
+				// Portals sharing a corner have no separating line through it.
+				if (glm::length(b - a) < SIDE_EPSILON)
+					continue;
+
+				const float sourceSide = sideDistance(a, b, sourcePoints[i ^ 1]);
+				const float passSide = sideDistance(a, b, passPoints[j ^ 1]);
+
+				if (std::abs(sourceSide) <= SIDE_EPSILON || std::abs(passSide) <= SIDE_EPSILON)
+					continue;
+				if ((sourceSide > 0.0f) == (passSide > 0.0f))
+					continue;
+
+				if (!clipSegment(target, a, b, passSide > 0.0f))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** @brief Flows visibility out of a single sector through the portals of a level */
+	class PortalFlow
+	{
+	public:
+		PortalFlow(const std::vector<std::vector<FlowPortal>>& sectorPortals, size_t lineDefCount)
+			: sectorPortals(sectorPortals), lineOnStack(lineDefCount, false)
+		{
+		}
+
+		void run(uint32_t sectorId, PotentiallyVisibleSet::SectorSet& visible)
+		{
+			this->visible = &visible;
+			steps = 0;
+
+			visible.insert(sectorId);
+
+			for (const FlowPortal& portal : sectorPortals[sectorId]) {
+				visible.insert(portal.neighbourSectorId);
+
+				// Everything past the first portal is seen through it, so it starts out as both
+				// the source and the pass.
+				lineOnStack[portal.lineDefId] = true;
+				flow(portal.segment, portal.segment, portal.neighbourSectorId, 1);
+				lineOnStack[portal.lineDefId] = false;
+			}
+		}
+
+	private:
+		const std::vector<std::vector<FlowPortal>>& sectorPortals;
+
+		// A straight line can't cross the same line twice, so lines already on the current
+		// portal chain are skipped.
+		std::vector<bool> lineOnStack;
+
+		PotentiallyVisibleSet::SectorSet* visible = nullptr;
+		uint32_t steps = 0;
+
+		/**
+		 * @param source	The part of the first portal that can still see through the chain
+		 * @param pass		The part of the last portal in the chain that can be seen through
+		 * @param sectorId	The sector behind the pass portal
+		 */
+		void flow(const Segment& source, const Segment& pass, uint32_t sectorId, uint32_t depth)
+		{
+			const bool firstPortal = depth == 1;
+
+			for (const FlowPortal& portal : sectorPortals[sectorId]) {
+				if (lineOnStack[portal.lineDefId])
+					continue;
+
+				// Each portal and the sector behind it are on the right of the previous portals.
+				Segment target = portal.segment;
+				if (!clipSegment(target, pass.start, pass.end, false))
+					continue;
+
+				if (!firstPortal) {
+					if (!clipSegment(target, source.start, source.end, false))
+						continue;
+					if (!clipToSeparators(source, pass, target))
+						continue;
+				}
+
+				if (length(target) < MIN_PORTAL_LENGTH)
+					continue;
+
+				visible->insert(portal.neighbourSectorId);
+
+				if (depth >= MAX_FLOW_DEPTH || ++steps >= MAX_FLOW_STEPS) {
+					flood(portal.neighbourSectorId);
+					continue;
+				}
+
+				// Only part of the source may be able to see the target, which narrows what can
+				// be seen further along the chain.
+				Segment narrowedSource = source;
+				if (!firstPortal && !clipToSeparators(target, pass, narrowedSource))
+					continue;
+				if (length(narrowedSource) < MIN_PORTAL_LENGTH)
+					continue;
+
+				lineOnStack[portal.lineDefId] = true;
+				flow(narrowedSource, target, portal.neighbourSectorId, depth + 1);
+				lineOnStack[portal.lineDefId] = false;
+			}
+		}
+
+		/** @brief Marks every sector reachable from a sector through portals as visible */
+		void flood(uint32_t sectorId)
+		{
+			std::vector<uint32_t> stack = { sectorId };
+			std::vector<bool> reached(sectorPortals.size(), false);
+			reached[sectorId] = true;
+
+			while (!stack.empty()) {
+				uint32_t current = stack.back();
+				stack.pop_back();
+
+				for (const FlowPortal& portal : sectorPortals[current]) {
+					if (!reached[portal.neighbourSectorId]) {
+						reached[portal.neighbourSectorId] = true;
+						visible->insert(portal.neighbourSectorId);
+						stack.push_back(portal.neighbourSectorId);
+					}
+				}
+			}
+		}
+	};
+}
+
+void PotentiallyVisibleSet::decompressRow(uint32_t sectorId, SectorSet& visible) const
+{
+	const uint32_t size = rowSize(sectorCount);
+	visible.bits.assign(size, 0);
+
+	uint32_t in = rowOffsets[sectorId];
+	uint32_t out = 0;
+
+	while (out < size) {
+		uint8_t value = rows[in++];
+
+		if (value != 0)
+			visible.bits[out++] = value;
+		else
+			out += rows[in++];
+	}
+}
+
+PotentiallyVisibleSet PotentiallyVisibleSet::compress(uint32_t sectorCount, const std::vector<uint8_t>& uncompressedRows)
+{
+	PotentiallyVisibleSet pvs;
+	pvs.sectorCount = sectorCount;
+	pvs.rowOffsets.reserve(sectorCount + 1);
+
+	const uint32_t size = rowSize(sectorCount);
+
+	for (uint32_t sectorId = 0; sectorId < sectorCount; sectorId++) {
+		pvs.rowOffsets.push_back(static_cast<uint32_t>(pvs.rows.size()));
+
+		const uint8_t* row = &uncompressedRows[sectorId * size];
+
+		for (uint32_t i = 0; i < size; i++) {
+			if (row[i] != 0) {
+				pvs.rows.push_back(row[i]);
+				continue;
+			}
+
+			// Runs of zeros are stored as a zero followed by the length of the run
+			uint32_t run = 1;
+			while (i + run < size && row[i + run] == 0 && run < 255)
+				run++;
+
+			pvs.rows.push_back(0);
+			pvs.rows.push_back(static_cast<uint8_t>(run));
+			i += run - 1;
+		}
+	}
+
+	pvs.rowOffsets.push_back(static_cast<uint32_t>(pvs.rows.size()));
+
+	return pvs;
+}
+
+PotentiallyVisibleSet PotentiallyVisibleSet::fromReject(uint32_t sectorCount, const uint8_t* reject)
+{
+	const uint32_t size = rowSize(sectorCount);
+	std::vector<uint8_t> uncompressedRows(static_cast<size_t>(size) * sectorCount, 0);
+
+	for (uint32_t i = 0; i < sectorCount; i++) {
+		uint8_t* row = &uncompressedRows[static_cast<size_t>(i) * size];
+
+		for (uint32_t j = 0; j < sectorCount; j++) {
+			const uint64_t bit = static_cast<uint64_t>(i) * sectorCount + j;
+			const bool rejected = (reject[bit >> 3] & (1 << (bit & 7))) != 0;
+
+			// Some tools reject a sector from itself, which never makes sense for rendering.
+			if (!rejected || i == j)
+				row[j >> 3] |= static_cast<uint8_t>(1 << (j & 7));
+		}
+	}
+
+	return compress(sectorCount, uncompressedRows);
+}
+
+PotentiallyVisibleSet computePvs(const Level& level)
+{
+	const uint32_t sectorCount = static_cast<uint32_t>(level.sectors.size());
+
+	// Collect the portals out of every sector, oriented with the sector on their left like the
+	// walls they come from.
+	std::vector<std::vector<FlowPortal>> sectorPortals(sectorCount);
+
+	// Levels put together by hand might not have their graph built yet. 
+	SectorGraph builtGraph;
+	if (level.sectorGraph.empty())
+		builtGraph.build(level);
+
+	const SectorGraph& graph = level.sectorGraph.empty() ? builtGraph : level.sectorGraph;
+
+	for (uint32_t sectorId = 0; sectorId < sectorCount; sectorId++) {
+		for (const SectorGraph::Portal& portal : graph.neighbours(sectorId)) {
+			const uint32_t lineDefId = level.walls[portal.wallId].lineDefId;
+			const LineDef& lineDef = level.lineDefs[lineDefId];
+
+			const bool wallFollowsLine = portal.wallId == lineDef.frontWallId;
+
+			Segment segment{ level.vertices[lineDef.startVertexId], level.vertices[lineDef.endVertexId] };
+			if (!wallFollowsLine)
+				std::swap(segment.start, segment.end);
+
+			if (length(segment) < MIN_PORTAL_LENGTH)
+				continue;
+
+			sectorPortals[sectorId].push_back({ segment, lineDefId, portal.neighbourSectorId });
+		}
+	}
+
+	// Every sector's row is independent of the others, so sectors are handed out to threads one
+	// at a time.
+	const uint32_t size = PotentiallyVisibleSet::rowSize(sectorCount);
+	std::vector<uint8_t> uncompressedRows(static_cast<size_t>(size) * sectorCount, 0);
+
+	std::atomic<uint32_t> nextSectorId = 0;
+
+	auto worker = [&] {
+		PortalFlow portalFlow(sectorPortals, level.lineDefs.size());
+		PotentiallyVisibleSet::SectorSet visible;
+
+		for (uint32_t sectorId = nextSectorId++; sectorId < sectorCount; sectorId = nextSectorId++) {
+			visible.bits.assign(size, 0);
+			portalFlow.run(sectorId, visible);
+
+			std::copy(visible.bits.begin(), visible.bits.end(), uncompressedRows.begin() + static_cast<size_t>(sectorId) * size);
+		}
+	};
+
+	const uint32_t threadCount = std::clamp(std::thread::hardware_concurrency(), 1u, std::max(sectorCount, 1u));
+	{
+		std::vector<std::jthread> threads;
+		for (uint32_t i = 1; i < threadCount; i++)
+			threads.emplace_back(worker);
+
+		worker();
+	}
+
+	return PotentiallyVisibleSet::compress(sectorCount, uncompressedRows);
+}
@@ -0,0 +1,72 @@
+#ifndef PVS_HPP_INCLUDED
+#define PVS_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+struct Level;
+
+/**
+ * @brief The set of sectors that can possibly be seen from each sector of a level.
+ *
+ * @details Each sector has a row of one bit per sector, set if any part of that sector can be
+ *			seen from anywhere in the row's sector. Most sectors can only see a small part of a
+ *			level, so rows are stored run-length compressed, Quake style: non-zero bytes are
+ *			stored as they are, while a zero byte is followed by the number of zero bytes in the
+ *			run.
+ *
+ *			Rows are decompressed into a SectorSet, which answers visibility for a sector in O(1).
+ */
+struct PotentiallyVisibleSet
+{
+	/** @brief A decompressed row: one bit per sector */
+	struct SectorSet
+	{
+		std::vector<uint8_t> bits;
+
+		bool contains(uint32_t sectorId) const { return (bits[sectorId >> 3] & (1 << (sectorId & 7))) != 0; }
+		void insert(uint32_t sectorId) { bits[sectorId >> 3] |= static_cast<uint8_t>(1 << (sectorId & 7)); }
+	};
+
+	uint32_t				sectorCount = 0;
+	std::vector<uint8_t>	rows;		// The compressed rows of every sector, one after another
+	std::vector<uint32_t>	rowOffsets;	// Row i is in the range [rowOffsets[i], rowOffsets[i + 1])
+
+	bool empty() const { return sectorCount == 0; }
+
+	/** @brief Number of bytes in a decompressed row */
+	static uint32_t rowSize(uint32_t sectorCount) { return (sectorCount + 7) / 8; }
+
+	/** @brief Decompresses the row of a sector into a set of every sector visible from it */
+	void decompressRow(uint32_t sectorId, SectorSet& visible) const;
+
+	/** @brief Builds a set from uncompressed rows of rowSize(sectorCount) bytes each */
+	static PotentiallyVisibleSet compress(uint32_t sectorCount, const std::vector<uint8_t>& uncompressedRows);
+
+	/**
+	 * @brief Builds a set from a Doom REJECT lump.
+	 *
+	 * @details REJECT is a bit matrix of sectorCount * sectorCount bits, where bit
+	 *			(i * sectorCount + j) is set when sector j can't be seen from sector i. It is meant
+	 *			for monster sight checks, but it is built the same way, so it can stand in for a
+	 *			PVS on maps that haven't been compiled. reject must hold at least
+	 *			(sectorCount * sectorCount + 7) / 8 bytes.
+	 */
+	static PotentiallyVisibleSet fromReject(uint32_t sectorCount, const uint8_t* reject);
+};
+
+/**
+ * @brief Computes the PVS of a level by flowing visibility through its portals.
+ *
+ * @details Portals are two-sided walls. From each sector, visibility flows out through every
+ *			portal, and a sector beyond a chain of portals is visible only if a straight line can
+ *			pass through every portal in the chain. This is checked by clipping each portal
+ *			against the separating lines between the source portal and the previous one, the 2D
+ *			version of Quake's vis.
+ *
+ *			The result is conservative: a sector may be marked visible when it isn't, but never
+ *			the other way around.
+ */
+PotentiallyVisibleSet computePvs(const Level& level);
+
+#endif//PVS_HPP_INCLUDED
@@ -0,0 +1,43 @@
+#include "SectorGraph.hpp"
+
+#include <Level.hpp>
+
+namespace
+{
+	/** @brief Finds the sector on the other side of a wall's line */
+	uint32_t findBehindSector(const Level& level, uint32_t wallId)
+	{
+		const LineDef& lineDef = level.lineDefs[level.walls[wallId].lineDefId];
+
+		const bool wallFollowsLine = wallId == lineDef.frontWallId;
+		const uint32_t behindWallId = wallFollowsLine ? lineDef.backWallId : lineDef.frontWallId;
+
+		if (behindWallId == LineDef::NO_WALL)
+			return SectorGraph::NO_SECTOR;
+
+		return level.walls[behindWallId].sectorId;
+	}
+}
+
+void SectorGraph::build(const Level& level)
+{
+	portals.clear();
+	portalOffsets.clear();
+	behindSectorIds.assign(level.walls.size(), NO_SECTOR);
+
+	portalOffsets.reserve(level.sectors.size() + 1);
+
+	for (const Sector& sector : level.sectors) {
+		portalOffsets.push_back(static_cast<uint32_t>(portals.size()));
+
+		for (uint32_t wallId = sector.firstWallId; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+			const uint32_t behindSectorId = findBehindSector(level, wallId);
+			behindSectorIds[wallId] = behindSectorId;
+
+			if (behindSectorId != NO_SECTOR)
+				portals.push_back({ wallId, behindSectorId });
+		}
+	}
+
+	portalOffsets.push_back(static_cast<uint32_t>(portals.size()));
+}
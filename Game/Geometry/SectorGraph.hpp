@@ -0,0 +1,74 @@
+#ifndef SECTOR_GRAPH_HPP_INCLUDED
+#define SECTOR_GRAPH_HPP_INCLUDED
+
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+struct Level;
+
+/**
+ * @brief Which sectors neighbour each other, and through which walls.
+ *
+ * @details Finding what is behind a wall means going from the wall to its line, to the line's
+ *			other wall, then to that wall's sector, touching three arrays. The graph does that
+ *			once when a level is loaded and keeps the answers in two flat arrays:
+ *
+ *			- The portals out of every sector, one after another in sector order (compressed
+ *			  sparse rows). A portal is a two-sided wall and the sector on its other side, so
+ *			  flood fills for visibility, sound or AI walk a sector's neighbours with sequential
+ *			  reads.
+ *			- The sector behind every wall, for code that is already looking at a wall, like
+ *			  building wall meshes or collision.
+ *
+ *			The graph has to be built again if a level's walls or lines change. Moving vertices
+ *			and sectors, which is all thinkers do, doesn't change it.
+ */
+struct SectorGraph
+{
+	static constexpr uint32_t NO_SECTOR = std::numeric_limits<uint32_t>::max();
+
+	/** @brief A two-sided wall leading out of a sector */
+	struct Portal
+	{
+		uint32_t	wallId;				// The wall on the near side of the portal
+		uint32_t	neighbourSectorId;	// The sector on the far side of the wall
+	};
+
+	/** @brief The portals out of one sector, for range-based for loops */
+	struct PortalRange
+	{
+		const Portal* first;
+		const Portal* last;
+
+		const Portal* begin() const { return first; }
+		const Portal* end() const { return last; }
+		size_t size() const { return static_cast<size_t>(last - first); }
+		bool empty() const { return first == last; }
+	};
+
+	// The portals out of sector i are in the range [portalOffsets[i], portalOffsets[i + 1])
+	std::vector<Portal>		portals;
+	std::vector<uint32_t>	portalOffsets;
+
+	// The sector behind each wall, or NO_SECTOR for one-sided walls
+	std::vector<uint32_t>	behindSectorIds;
+
+	bool empty() const { return portalOffsets.empty(); }
+
+	/** @brief Builds the graph for every sector and wall of a level */
+	void build(const Level& level);
+
+	/** @brief The portals leading out of a sector */
+	PortalRange neighbours(uint32_t sectorId) const
+	{
+		const Portal* data = portals.data();
+		return { data + portalOffsets[sectorId], data + portalOffsets[sectorId + 1] };
+	}
+
+	/** @brief The sector on the other side of a wall, or NO_SECTOR if it's one-sided */
+	uint32_t behindSector(uint32_t wallId) const { return behindSectorIds[wallId]; }
+};
+
+#endif//SECTOR_GRAPH_HPP_INCLUDED
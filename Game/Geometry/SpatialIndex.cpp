@@ -0,0 +1,451 @@
+#include "SpatialIndex.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <Level.hpp>
+#include <Geometry/Intersection.hpp>
+#include <Utility/ParallelFor.hpp>
+
+namespace
+{
+	// The size of the cells on the finest level of the grids
+	constexpr float BASE_CELL_SIZE = 64.0f;
+
+	// How many queries of a batch are done one after another on a thread
+	constexpr size_t QUERY_RUN_SIZE = 256;
+
+	float cross(glm::vec2 a, glm::vec2 b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	/** @brief Returns which side of the line through a and b that p is on, or 0 if it's on it */
+	float orientation(glm::vec2 a, glm::vec2 b, glm::vec2 p)
+	{
+		return cross(b - a, p - a);
+	}
+
+	/** @brief Returns true if a point on the line through a segment is within the segment */
+	bool withinSegment(glm::vec2 start, glm::vec2 end, glm::vec2 point)
+	{
+		return point.x >= std::min(start.x, end.x) && point.x <= std::max(start.x, end.x)
+			&& point.y >= std::min(start.y, end.y) && point.y <= std::max(start.y, end.y);
+	}
+
+	bool segmentsTouch(glm::vec2 a, glm::vec2 b, glm::vec2 c, glm::vec2 d)
+	{
+		const float ab0 = orientation(a, b, c);
+		const float ab1 = orientation(a, b, d);
+		const float cd0 = orientation(c, d, a);
+		const float cd1 = orientation(c, d, b);
+
+		if (((ab0 > 0.0f && ab1 < 0.0f) || (ab0 < 0.0f && ab1 > 0.0f))
+			&& ((cd0 > 0.0f && cd1 < 0.0f) || (cd0 < 0.0f && cd1 > 0.0f)))
+			return true;
+
+		// Otherwise they only touch if an end of one lies on the other.
+		return (ab0 == 0.0f && withinSegment(a, b, c))
+			|| (ab1 == 0.0f && withinSegment(a, b, d))
+			|| (cd0 == 0.0f && withinSegment(c, d, a))
+			|| (cd1 == 0.0f && withinSegment(c, d, b));
+	}
+
+	template<typename Bounds>
+	bool overlaps(const Bounds& a, const Bounds& b)
+	{
+		return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y;
+	}
+
+	/** @brief Converts a cell coordinate to an index, clamped to the grid */
+	uint32_t clampCell(float coordinate, uint32_t count)
+	{
+		return static_cast<uint32_t>(std::clamp(coordinate, 0.0f, static_cast<float>(count - 1)));
+	}
+}
+
+void SpatialIndex::build(const Level& level)
+{
+	// Find the lines using each vertex, so moving vertices can find what to update.
+	vertexLineOffsets.assign(level.vertices.size() + 1, 0);
+
+	for (const LineDef& lineDef : level.lineDefs) {
+		vertexLineOffsets[lineDef.startVertexId + 1]++;
+		vertexLineOffsets[lineDef.endVertexId + 1]++;
+	}
+
+	for (size_t i = 1; i < vertexLineOffsets.size(); i++)
+		vertexLineOffsets[i] += vertexLineOffsets[i - 1];
+
+	std::vector<uint32_t> fillOffsets = vertexLineOffsets;
+	vertexLineDefIds.resize(vertexLineOffsets.back());
+
+	for (uint32_t lineDefId = 0; lineDefId < level.lineDefs.size(); lineDefId++) {
+		const LineDef& lineDef = level.lineDefs[lineDefId];
+		vertexLineDefIds[fillOffsets[lineDef.startVertexId]++] = lineDefId;
+		vertexLineDefIds[fillOffsets[lineDef.endVertexId]++] = lineDefId;
+	}
+
+	std::vector<Bounds> bounds(level.lineDefs.size());
+	for (uint32_t lineDefId = 0; lineDefId < level.lineDefs.size(); lineDefId++)
+		bounds[lineDefId] = lineBounds(level, lineDefId);
+
+	lineGrid.build(bounds);
+
+	bounds.resize(level.sectors.size());
+	for (uint32_t sectorId = 0; sectorId < level.sectors.size(); sectorId++)
+		bounds[sectorId] = sectorBounds(level, sectorId);
+
+	sectorGrid.build(bounds);
+
+	wallSegments.resize(level.walls.size());
+	for (uint32_t wallId = 0; wallId < level.walls.size(); wallId++) {
+		const LineDef& lineDef = level.lineDefs[level.walls[wallId].lineDefId];
+		wallSegments[wallId] = { level.vertices[lineDef.startVertexId], level.vertices[lineDef.endVertexId] };
+	}
+
+	lineMarks.assign(level.lineDefs.size(), false);
+	sectorMarks.assign(level.sectors.size(), false);
+}
+
+void SpatialIndex::updateVertices(const Level& level, const std::vector<uint32_t>& vertexIds)
+{
+	if (vertexLineOffsets.size() != level.vertices.size() + 1 || lineMarks.size() != level.lineDefs.size()
+		|| sectorMarks.size() != level.sectors.size() || wallSegments.size() != level.walls.size()) {
+		build(level);
+		return;
+	}
+
+	std::vector<uint32_t> lineDefIds;
+	std::vector<uint32_t> sectorIds;
+
+	for (uint32_t vertexId : vertexIds) {
+		for (uint32_t i = vertexLineOffsets[vertexId]; i < vertexLineOffsets[vertexId + 1]; i++) {
+			const uint32_t lineDefId = vertexLineDefIds[i];
+			if (lineMarks[lineDefId])
+				continue;
+
+			lineMarks[lineDefId] = true;
+			lineDefIds.push_back(lineDefId);
+
+			const LineDef& lineDef = level.lineDefs[lineDefId];
+			for (uint32_t wallId : { lineDef.frontWallId, lineDef.backWallId }) {
+				if (wallId == LineDef::NO_WALL)
+					continue;
+
+				wallSegments[wallId] = { level.vertices[lineDef.startVertexId], level.vertices[lineDef.endVertexId] };
+
+				if (sectorMarks[level.walls[wallId].sectorId])
+					continue;
+
+				sectorMarks[level.walls[wallId].sectorId] = true;
+				sectorIds.push_back(level.walls[wallId].sectorId);
+			}
+		}
+	}
+
+	for (uint32_t lineDefId : lineDefIds) {
+		lineGrid.move(lineDefId, lineBounds(level, lineDefId));
+		lineMarks[lineDefId] = false;
+	}
+
+	for (uint32_t sectorId : sectorIds) {
+		sectorGrid.move(sectorId, sectorBounds(level, sectorId));
+		sectorMarks[sectorId] = false;
+	}
+}
+
+void SpatialIndex::findVertexLines(const std::vector<uint32_t>& vertexIds, std::vector<uint32_t>& lineDefIds) const
+{
+	lineDefIds.clear();
+
+	for (uint32_t vertexId : vertexIds)
+		lineDefIds.insert(lineDefIds.end(),
+			vertexLineDefIds.begin() + vertexLineOffsets[vertexId], vertexLineDefIds.begin() + vertexLineOffsets[vertexId + 1]);
+
+	std::sort(lineDefIds.begin(), lineDefIds.end());
+	lineDefIds.erase(std::unique(lineDefIds.begin(), lineDefIds.end()), lineDefIds.end());
+}
+
+uint32_t SpatialIndex::findSector(const Level& level, glm::vec2 point) const
+{
+	return findSector(level, point, NO_SECTOR);
+}
+
+void SpatialIndex::findSectors(const Level& level, const std::vector<glm::vec2>& points, std::vector<uint32_t>& sectorIds, uint32_t threadCount) const
+{
+	sectorIds.resize(points.size());
+
+	const size_t runCount = (points.size() + QUERY_RUN_SIZE - 1) / QUERY_RUN_SIZE;
+
+	parallelFor(runCount, threadCount, [&](size_t run) {
+		const size_t last = std::min(points.size(), (run + 1) * QUERY_RUN_SIZE);
+		uint32_t guessSectorId = NO_SECTOR;
+
+		for (size_t i = run * QUERY_RUN_SIZE; i < last; i++) {
+			sectorIds[i] = findSector(level, points[i], guessSectorId);
+			if (sectorIds[i] != NO_SECTOR)
+				guessSectorId = sectorIds[i];
+		}
+	});
+}
+
+void SpatialIndex::findLines(const Level& level, Segment segment, std::vector<uint32_t>& lineDefIds) const
+{
+	lineDefIds.clear();
+	appendLines(level, segment, lineDefIds);
+}
+
+void SpatialIndex::findLines(const Level& level, const std::vector<Segment>& segments, std::vector<uint32_t>& offsets, std::vector<uint32_t>& lineDefIds, uint32_t threadCount) const
+{
+	offsets.assign(segments.size() + 1, 0);
+	lineDefIds.clear();
+
+	// Each run collects its own lines, which are joined up in order afterwards.
+	const size_t runCount = (segments.size() + QUERY_RUN_SIZE - 1) / QUERY_RUN_SIZE;
+	std::vector<std::vector<uint32_t>> runLineDefIds(runCount);
+
+	parallelFor(runCount, threadCount, [&](size_t run) {
+		const size_t last = std::min(segments.size(), (run + 1) * QUERY_RUN_SIZE);
+
+		for (size_t i = run * QUERY_RUN_SIZE; i < last; i++) {
+			const size_t before = runLineDefIds[run].size();
+			appendLines(level, segments[i], runLineDefIds[run]);
+			offsets[i + 1] = static_cast<uint32_t>(runLineDefIds[run].size() - before);
+		}
+	});
+
+	for (size_t i = 1; i < offsets.size(); i++)
+		offsets[i] += offsets[i - 1];
+
+	lineDefIds.reserve(offsets.back());
+	for (const std::vector<uint32_t>& found : runLineDefIds)
+		lineDefIds.insert(lineDefIds.end(), found.begin(), found.end());
+}
+
+SpatialIndex::Bounds SpatialIndex::lineBounds(const Level& level, uint32_t lineDefId)
+{
+	const LineDef& lineDef = level.lineDefs[lineDefId];
+	const glm::vec2 start = level.vertices[lineDef.startVertexId];
+	const glm::vec2 end = level.vertices[lineDef.endVertexId];
+
+	return { glm::min(start, end), glm::max(start, end) };
+}
+
+SpatialIndex::Bounds SpatialIndex::sectorBounds(const Level& level, uint32_t sectorId)
+{
+	const Sector& sector = level.sectors[sectorId];
+	if (sector.wallCount == 0)
+		return { glm::vec2{ 0.0f }, glm::vec2{ 0.0f } };
+
+	Bounds bounds = lineBounds(level, level.walls[sector.firstWallId].lineDefId);
+
+	for (uint32_t wallId = sector.firstWallId + 1; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+		const Bounds wallBounds = lineBounds(level, level.walls[wallId].lineDefId);
+		bounds.min = glm::min(bounds.min, wallBounds.min);
+		bounds.max = glm::max(bounds.max, wallBounds.max);
+	}
+
+	return bounds;
+}
+
+bool SpatialIndex::sectorContains(const Level& level, uint32_t sectorId, glm::vec2 point) const
+{
+	// Counting crossings of every wall, holes included, makes points in holes come out as
+	// outside. Which way round each wall goes doesn't matter.
+	const Sector& sector = level.sectors[sectorId];
+	bool inside = false;
+
+	for (uint32_t wallId = sector.firstWallId; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+		const glm::vec2 start = wallSegments[wallId].start;
+		const glm::vec2 end = wallSegments[wallId].end;
+
+		if ((start.y > point.y) != (end.y > point.y)) {
+			const float crossingX = start.x + (point.y - start.y) / (end.y - start.y) * (end.x - start.x);
+			if (point.x < crossingX)
+				inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+uint32_t SpatialIndex::findSector(const Level& level, glm::vec2 point, uint32_t guessSectorId) const
+{
+	const Bounds box{ point, point };
+
+	if (guessSectorId != NO_SECTOR && overlaps(sectorGrid.bounds(guessSectorId), box)
+		&& sectorContains(level, guessSectorId, point))
+		return guessSectorId;
+
+	uint32_t foundSectorId = NO_SECTOR;
+
+	sectorGrid.query(box, [](const Bounds&) { return true; }, [&](uint32_t sectorId) {
+		if (sectorId == guessSectorId || !sectorContains(level, sectorId, point))
+			return false;
+
+		foundSectorId = sectorId;
+		return true;
+	});
+
+	return foundSectorId;
+}
+
+void SpatialIndex::appendLines(const Level& level, Segment segment, std::vector<uint32_t>& lineDefIds) const
+{
+	const Bounds box{ glm::min(segment.start, segment.end), glm::max(segment.start, segment.end) };
+
+	auto touchesCell = [&](const Bounds& cell) {
+		return segmentTouchesBox(segment.start, segment.end, cell.min, cell.max);
+	};
+
+	lineGrid.query(box, touchesCell, [&](uint32_t lineDefId) {
+		const LineDef& lineDef = level.lineDefs[lineDefId];
+
+		if (segmentsTouch(segment.start, segment.end, level.vertices[lineDef.startVertexId], level.vertices[lineDef.endVertexId]))
+			lineDefIds.push_back(lineDefId);
+
+		return false;
+	});
+}
+
+void SpatialIndex::LooseGrid::build(const std::vector<Bounds>& itemBounds)
+{
+	levels.clear();
+	cellHeads.clear();
+	_bounds = itemBounds;
+
+	if (itemBounds.empty())
+		return;
+
+	glm::vec2 min = itemBounds.front().min;
+	glm::vec2 max = itemBounds.front().max;
+
+	for (const Bounds& bounds : itemBounds) {
+		min = glm::min(min, bounds.min);
+		max = glm::max(max, bounds.max);
+	}
+
+	origin = min;
+
+	// Levels double in size until one cell covers everything. That level takes whatever doesn't
+	// fit anywhere else, even after moving outside the area the grid was built for.
+	uint32_t cellCount = 0;
+
+	for (float cellSize = BASE_CELL_SIZE; ; cellSize *= 2.0f) {
+		const uint32_t columns = std::max(1u, static_cast<uint32_t>(std::ceil((max.x - min.x) / cellSize)));
+		const uint32_t rows = std::max(1u, static_cast<uint32_t>(std::ceil((max.y - min.y) / cellSize)));
+
+		levels.push_back({ cellSize, columns, rows, cellCount });
+		cellCount += columns * rows;
+
+		if (columns == 1 && rows == 1)
+			break;
+	}
+
+	cellHeads.assign(cellCount, NO_ITEM);
+	nextItems.assign(itemBounds.size(), NO_ITEM);
+	previousItems.assign(itemBounds.size(), NO_ITEM);
+	itemCellIds.assign(itemBounds.size(), 0);
+
+	for (uint32_t itemId = 0; itemId < itemBounds.size(); itemId++)
+		link(itemId, findCell(itemBounds[itemId]));
+}
+
+void SpatialIndex::LooseGrid::move(uint32_t itemId, const Bounds& itemBounds)
+{
+	_bounds[itemId] = itemBounds;
+
+	const uint32_t cellId = findCell(itemBounds);
+	if (cellId != itemCellIds[itemId]) {
+		unlink(itemId);
+		link(itemId, cellId);
+	}
+}
+
+template<typename CellTest, typename Visit>
+bool SpatialIndex::LooseGrid::query(const Bounds& box, CellTest&& touchesCell, Visit&& visit) const
+{
+	auto visitCell = [&](uint32_t cellId) {
+		for (uint32_t itemId = cellHeads[cellId]; itemId != NO_ITEM; itemId = nextItems[itemId])
+			if (overlaps(_bounds[itemId], box) && visit(itemId))
+				return true;
+
+		return false;
+	};
+
+	for (size_t i = 0; i + 1 < levels.size(); i++) {
+		const GridLevel& gridLevel = levels[i];
+
+		// Items reach at most half a cell outside their own cell.
+		const glm::vec2 first = glm::ceil((box.min - origin) / gridLevel.cellSize - 1.5f);
+		const glm::vec2 last = glm::floor((box.max - origin) / gridLevel.cellSize + 0.5f);
+
+		if (last.x < 0.0f || last.y < 0.0f || first.x >= gridLevel.columns || first.y >= gridLevel.rows)
+			continue;
+
+		const uint32_t firstColumn = clampCell(first.x, gridLevel.columns);
+		const uint32_t lastColumn = clampCell(last.x, gridLevel.columns);
+		const uint32_t firstRow = clampCell(first.y, gridLevel.rows);
+		const uint32_t lastRow = clampCell(last.y, gridLevel.rows);
+
+		for (uint32_t row = firstRow; row <= lastRow; row++) {
+			for (uint32_t column = firstColumn; column <= lastColumn; column++) {
+				const glm::vec2 cellMin = origin + (glm::vec2{ column, row } - 0.5f) * gridLevel.cellSize;
+				if (!touchesCell(Bounds{ cellMin, cellMin + gridLevel.cellSize * 2.0f }))
+					continue;
+
+				if (visitCell(gridLevel.firstCellId + row * gridLevel.columns + column))
+					return true;
+			}
+		}
+	}
+
+	return !levels.empty() && visitCell(levels.back().firstCellId);
+}
+
+uint32_t SpatialIndex::LooseGrid::findCell(const Bounds& itemBounds) const
+{
+	const glm::vec2 size = itemBounds.max - itemBounds.min;
+	const glm::vec2 center = (itemBounds.min + itemBounds.max) * 0.5f - origin;
+
+	for (size_t i = 0; i + 1 < levels.size(); i++) {
+		const GridLevel& gridLevel = levels[i];
+		if (std::max(size.x, size.y) > gridLevel.cellSize)
+			continue;
+
+		const glm::vec2 cell = glm::floor(center / gridLevel.cellSize);
+		if (cell.x < 0.0f || cell.y < 0.0f || cell.x >= gridLevel.columns || cell.y >= gridLevel.rows)
+			continue;
+
+		return gridLevel.firstCellId + static_cast<uint32_t>(cell.y) * gridLevel.columns + static_cast<uint32_t>(cell.x);
+	}
+
+	return levels.back().firstCellId;
+}
+
+void SpatialIndex::LooseGrid::link(uint32_t itemId, uint32_t cellId)
+{
+	nextItems[itemId] = cellHeads[cellId];
+	previousItems[itemId] = NO_ITEM;
+
+	if (cellHeads[cellId] != NO_ITEM)
+		previousItems[cellHeads[cellId]] = itemId;
+
+	cellHeads[cellId] = itemId;
+	itemCellIds[itemId] = cellId;
+}
+
+void SpatialIndex::LooseGrid::unlink(uint32_t itemId)
+{
+	const uint32_t next = nextItems[itemId];
+	const uint32_t previous = previousItems[itemId];
+
+	if (previous != NO_ITEM)
+		nextItems[previous] = next;
+	else
+		cellHeads[itemCellIds[itemId]] = next;
+
+	if (next != NO_ITEM)
+		previousItems[next] = previous;
+}
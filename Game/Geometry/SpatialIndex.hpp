@@ -0,0 +1,154 @@
+#ifndef SPATIAL_INDEX_HPP_INCLUDED
+#define SPATIAL_INDEX_HPP_INCLUDED
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/**
+ * @brief Finds which sector points are in and which lines segments cross, for lots of queries
+ *			at once.
+ *
+ * @details Lines and sectors are each kept in a hierarchical loose grid. Every level of the grid
+ *			has cells twice the size of the one below, and each line or sector is put in the
+ *			cell its center is in, on the finest level whose cells are at least as big as it
+ *			is. Since nothing in a cell reaches more than half a cell past it, a query only has
+ *			to look at the cells around it on each level, and the coarsest level is a single
+ *			cell that holds whatever doesn't fit anywhere else.
+ *
+ *			Because things only belong to one cell, moving vertices just updates the bounds of
+ *			the lines and sectors using them, and moves those to another cell if their center
+ *			or size changed enough. There's no need to rebuild anything.
+ *
+ *			Queries read the level's geometry for exact tests, so they must be given the level
+ *			the index was built for.
+ */
+class SpatialIndex
+{
+public:
+	static constexpr uint32_t NO_SECTOR = std::numeric_limits<uint32_t>::max();
+
+	struct Segment
+	{
+		glm::vec2 start;
+		glm::vec2 end;
+	};
+
+	bool empty() const { return lineGrid.empty(); }
+
+	/** @brief Indexes every line and sector of a level */
+	void build(const Level& level);
+
+	/** @brief Brings the index up to date after some of the level's vertices moved */
+	void updateVertices(const Level& level, const std::vector<uint32_t>& vertexIds);
+
+	/** @brief Finds the lines that use any of some vertices, each listed once */
+	void findVertexLines(const std::vector<uint32_t>& vertexIds, std::vector<uint32_t>& lineDefIds) const;
+
+	/** @brief Finds the sector a point is in, or NO_SECTOR if it's outside the level */
+	uint32_t findSector(const Level& level, glm::vec2 point) const;
+
+	/**
+	 * @brief Finds the sector each of a batch of points is in.
+	 *
+	 * @details Points are worked through in runs, each of which tries the sector of the point
+	 *			before first, so batches of points that are near each other in order, like
+	 *			things sorted by where they are, skip most of the search. Runs are spread over
+	 *			threads when the thread count is more than 1, and 0 uses every hardware thread.
+	 */
+	void findSectors(const Level& level, const std::vector<glm::vec2>& points, std::vector<uint32_t>& sectorIds, uint32_t threadCount = 1) const;
+
+	/** @brief Finds every line that a segment crosses or touches, in no particular order */
+	void findLines(const Level& level, Segment segment, std::vector<uint32_t>& lineDefIds) const;
+
+	/**
+	 * @brief Finds the lines that each of a batch of segments crosses or touches.
+	 *
+	 * @details The lines for segment i are in the range [offsets[i], offsets[i + 1]) of the line
+	 *			ids. Threads are used like in findSectors.
+	 */
+	void findLines(const Level& level, const std::vector<Segment>& segments, std::vector<uint32_t>& offsets, std::vector<uint32_t>& lineDefIds, uint32_t threadCount = 1) const;
+
+private:
+	struct Bounds
+	{
+		glm::vec2 min;
+		glm::vec2 max;
+	};
+
+	/** @brief A hierarchical loose grid of items, each of which is just a box */
+	class LooseGrid
+	{
+	public:
+		bool empty() const { return levels.empty(); }
+
+		void build(const std::vector<Bounds>& itemBounds);
+
+		/** @brief Changes an item's box, moving it to another cell if it no longer fits its own */
+		void move(uint32_t itemId, const Bounds& itemBounds);
+
+		const Bounds& bounds(uint32_t itemId) const { return _bounds[itemId]; }
+
+		/**
+		 * @brief Calls visit with every item whose box overlaps a box, until visit returns true.
+		 *
+		 * @details Cells are skipped when touchesCell returns false for their loose bounds, which
+		 *			lets segments skip the cells their box covers but they don't pass through.
+		 */
+		template<typename CellTest, typename Visit>
+		bool query(const Bounds& box, CellTest&& touchesCell, Visit&& visit) const;
+
+	private:
+		static constexpr uint32_t NO_ITEM = std::numeric_limits<uint32_t>::max();
+
+		struct GridLevel
+		{
+			float		cellSize;
+			uint32_t	columns;
+			uint32_t	rows;
+			uint32_t	firstCellId;
+		};
+
+		glm::vec2				origin { 0.0f };
+		std::vector<GridLevel>	levels;
+
+		// The items in each cell are a doubly linked list, so they can be moved between cells
+		std::vector<uint32_t>	cellHeads;
+		std::vector<uint32_t>	nextItems;
+		std::vector<uint32_t>	previousItems;
+		std::vector<uint32_t>	itemCellIds;
+		std::vector<Bounds>		_bounds;
+
+		uint32_t findCell(const Bounds& itemBounds) const;
+		void link(uint32_t itemId, uint32_t cellId);
+		void unlink(uint32_t itemId);
+	};
+
+	LooseGrid				lineGrid;
+	LooseGrid				sectorGrid;
+
+	// The lines using vertex i are in the range [vertexLineOffsets[i], vertexLineOffsets[i + 1])
+	std::vector<uint32_t>	vertexLineOffsets;
+	std::vector<uint32_t>	vertexLineDefIds;
+
+	// Where each wall is, indexed by wall, so finding sectors reads each sector's walls in a row
+	std::vector<Segment>	wallSegments;
+
+	// Marks which lines and sectors an update has already seen
+	std::vector<bool>		lineMarks;
+	std::vector<bool>		sectorMarks;
+
+	static Bounds lineBounds(const Level& level, uint32_t lineDefId);
+	static Bounds sectorBounds(const Level& level, uint32_t sectorId);
+
+	bool sectorContains(const Level& level, uint32_t sectorId, glm::vec2 point) const;
+
+	uint32_t findSector(const Level& level, glm::vec2 point, uint32_t guessSectorId) const;
+	void appendLines(const Level& level, Segment segment, std::vector<uint32_t>& lineDefIds) const;
+};
+
+#endif//SPATIAL_INDEX_HPP_INCLUDED
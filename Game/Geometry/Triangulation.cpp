@@ -0,0 +1,69 @@
+#include "Triangulation.hpp"
+
+#include <vector>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include <CDT.h>
+
+size_t triangulateSector(const Level& level, const Sector& sector, std::vector<glm::vec2>& triangles)
+{
+	CDT::Triangulation<float> triangulation;
+
+	std::vector<glm::vec2> sectorVerts;
+	std::vector<std::pair<size_t, size_t>> sectorEdges;
+
+	sectorVerts.reserve(sector.wallCount);
+	sectorEdges.reserve(sector.wallCount);
+
+	size_t loopStartVertexIndex = 0;				// What vertex number did this edge loop start on?
+
+	// Loop through all of the walls in the sector so we can add them to the triangulation.
+	for (size_t i = 0; i < sector.wallCount; i++) {
+		const uint32_t wallId = sector.firstWallId + i;
+		const Wall& wall = level.walls[wallId];
+		const LineDef& lineDef = level.lineDefs[wall.lineDefId];
+
+		const bool wallFollowsLine = wallId == lineDef.frontWallId;
+		const uint32_t startVertexId = wallFollowsLine ? lineDef.startVertexId : lineDef.endVertexId;
+		glm::vec2 startVertex = level.vertices[startVertexId];
+		sectorVerts.push_back(startVertex);
+
+		// If we reach the end of the edge loop, mark the end vertex of the edge to be the start index
+		// for this loop. Otherwise, mark it as the next vertex we are going to add. 
+		size_t edgeEndVertexIndex = wall.endOfLoop ? loopStartVertexIndex : i + 1;
+		sectorEdges.push_back(std::make_pair(i, edgeEndVertexIndex));
+		
+		// If we have reached the end of this edge loop, set the index for the start of the
+		// next one. 
+		if (wall.endOfLoop) {
+			loopStartVertexIndex = i + 1;
+		}
+	}
+
+	triangulation.insertVertices(
+		sectorVerts.begin(),
+		sectorVerts.end(),
+		[](const glm::vec2& v) { return v.x; },
+		[](const glm::vec2& v) { return v.y; }
+	);
+
+	triangulation.insertEdges(
+		sectorEdges.begin(),
+		sectorEdges.end(),
+		[](const std::pair<size_t, size_t>& e) { return e.first; },
+		[](const std::pair<size_t, size_t>& e) { return e.second; }
+	);
+
+	triangulation.eraseOuterTrianglesAndHoles();
+
+	const auto& verts = triangulation.vertices;
+	for (const CDT::Triangle& tri : triangulation.triangles)
+	{
+		for (auto index : tri.vertices)
+			triangles.push_back(glm::vec2{ verts[index].x, verts[index].y });
+	}
+
+	return triangulation.triangles.size();
+}
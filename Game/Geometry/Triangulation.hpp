@@ -0,0 +1,21 @@
+#ifndef TRIANGULATION_HPP_INCLUDED
+#define TRIANGULATION_HPP_INCLUDED
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Level.hpp>
+
+/**
+ * @brief Triangulates the 2D shape of a sector, including any holes in it.
+ * 
+ * @details The triangles are appended to the output as three vertices each, wound counter-clockwise
+ *			when viewed from above. Since floors and ceilings share the same 2D shape, one
+ *			triangulation can be used to build both. 
+ * 
+ * @return The number of triangles that were added. 
+ */
+size_t triangulateSector(const Level& level, const Sector& sector, std::vector<glm::vec2>& triangles);
+
+#endif//TRIANGULATION_HPP_INCLUDED
@@ -2,11 +2,21 @@
 #define LEVEL_HPP_INCLUDED
 
 #include <vector> 
+#include <string>
 #include <numeric>
-#include <functional>
+#include <limits>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 
+#include <Geometry/Bsp.hpp>
+#include <Geometry/Pvs.hpp>
+#include <Geometry/SectorGraph.hpp>
+#include <Geometry/Blockmap.hpp>
+#include <Geometry/SpatialIndex.hpp>
+#include <World/Thinkers.hpp>
+#include <World/Things.hpp>
+
 // Brief explanation of the level format:
 //		Vertex	- 2D point used to define LineDefs
 //		LineDef - Physical line defined by two vertices, defining boundaries in a level
@@ -15,6 +25,11 @@
 // Wall Loops:
 //		Walls for a given sector should be stored together in memory, defining walls in counter-clockwise
 //		winding. 
+// Hot and cold data:
+//		Sectors and walls only hold what's needed to walk the level's geometry, which culling, collision
+//		and the BSP and PVS builders do constantly. How they look is kept in separate arrays of
+//		SectorAppearance and WallAppearance, indexed the same way, which only the renderer reads. This
+//		keeps geometry small, so walking it touches far fewer cache lines. 
 
 /**
  * @brief A 2D vertex used in defining a level
@@ -31,9 +46,25 @@ struct Sector
 
 	float floorZ;				// The Z-Height of this sector's floor
 	float ceilingZ;				// The Z-Height of this sector's ceiling
+};
+
+static_assert(sizeof(Sector) == 16, "Sector should be 16 bytes, four to a cache line. Appearance belongs in SectorAppearance");
+
+/**
+ * @brief How a sector is drawn. Kept apart from the sector, in Level::sectorAppearances.
+ */
+struct SectorAppearance
+{
+	static constexpr uint32_t NO_FLAT = std::numeric_limits<uint32_t>::max();
 
-	glm::vec3	floorColor;		// The color that the floor should be rendered as
-	glm::vec3	ceilingColor;	// The color that the ceiling should be rendered as
+	glm::vec3	floorColor		{ 1.0f };	// The color that the floor should be rendered as
+	glm::vec3	ceilingColor	{ 1.0f };	// The color that the ceiling should be rendered as
+
+	float		lightLevel = 255.0f;	// How bright the sector is, from 0 (dark) to 255 (fully lit) like Doom
+
+	// Indices into the level's flat names. Floors and ceilings without a flat use their color. 
+	uint32_t	floorFlatId		= NO_FLAT;
+	uint32_t	ceilingFlatId	= NO_FLAT;
 };
 
 /**
@@ -60,8 +91,26 @@ struct Wall
 {
 	uint32_t	lineDefId;	// The index of the line this wall lies on
 	uint32_t	sectorId;	// The index of the sector this wall is for
-	bool		endOfLoop;	//
-	glm::vec3	color;		// The color that this wall should be rendered as
+	bool		endOfLoop;	// True for the last wall of each loop in a sector
+};
+
+static_assert(sizeof(Wall) <= 12, "Wall should fit in 12 bytes: two ids and the loop flag. Appearance belongs in WallAppearance");
+
+/**
+ * @brief How a wall is drawn. Kept apart from the wall, in Level::wallAppearances.
+ */
+struct WallAppearance
+{
+	static constexpr uint32_t NO_TEXTURE = std::numeric_limits<uint32_t>::max();
+
+	glm::vec3	color { 1.0f };	// The color that this wall should be rendered as when it has no texture
+
+	// Indices into the level's texture names for the part of the wall above the sector behind,
+	// the part between its floor and ceiling, and the part below it. One-sided walls only use
+	// the middle texture. 
+	uint32_t	upperTextureId	= NO_TEXTURE;
+	uint32_t	middleTextureId	= NO_TEXTURE;
+	uint32_t	lowerTextureId	= NO_TEXTURE;
 };
 
 /**
@@ -74,10 +123,58 @@ struct Level
 	std::vector<Wall>		walls;
 	std::vector<Sector>		sectors;
 
-	// Function the engine calls each frame to update the level. 
-	// TODO: This is not flexible, and needs replaced with a better system like Doom's
-	//       thinker system
-	std::function<void(Level&, float)> onUpdate = nullptr;
+	// How each wall and sector looks, indexed the same as walls and sectors. 
+	std::vector<WallAppearance>		wallAppearances;
+	std::vector<SectorAppearance>	sectorAppearances;
+
+	// Names of the textures that the walls use. Walls refer to them by index. 
+	std::vector<std::string> textureNames;
+
+	// Names of the flats that the sectors use. Sectors refer to them by index. 
+	std::vector<std::string> flatNames;
+
+	// Monsters, items and decorations, grouped by the sector they're in. The things in sector i
+	// are in the range [sectorThingOffsets[i], sectorThingOffsets[i + 1]). Maps load them in map
+	// order, and the offsets stay empty until the game buckets them with the spatial index. 
+	std::vector<Thing>		things;
+	std::vector<uint32_t>	sectorThingOffsets;
+
+	// Optional BSP tree over the level. Empty when the level doesn't have one. 
+	BspTree					bsp;
+
+	// Optional set of sectors visible from each sector. Empty when every sector may be visible. 
+	PotentiallyVisibleSet	pvs;
+
+	// Which sectors neighbour each other. Built when the level is loaded, and must be built again
+	// if walls or lines change. 
+	SectorGraph				sectorGraph;
+
+	// Grid of which lines are in each part of the level, for collision. Lines have to be binned
+	// again with updateLines() when their vertices move. 
+	Blockmap				blockmap;
+
+	// Index for finding which sector points are in and which lines segments cross. Only the game
+	// builds it, and it's kept up to date as vertices move. 
+	SpatialIndex			spatialIndex;
+
+	// Everything in the level that moves or changes over time, updated by the engine each frame. 
+	ThinkerSystem			thinkers;
+
+	/** @brief Adds a wall and how it looks, keeping the two arrays in step */
+	uint32_t addWall(const Wall& wall, const WallAppearance& appearance = {})
+	{
+		walls.push_back(wall);
+		wallAppearances.push_back(appearance);
+		return static_cast<uint32_t>(walls.size() - 1);
+	}
+
+	/** @brief Adds a sector and how it looks, keeping the two arrays in step */
+	uint32_t addSector(const Sector& sector, const SectorAppearance& appearance = {})
+	{
+		sectors.push_back(sector);
+		sectorAppearances.push_back(appearance);
+		return static_cast<uint32_t>(sectors.size() - 1);
+	}
 };
 
 #endif//LEVEL_HPP_INCWED
\ No newline at end of file
@@ -1,14 +1,31 @@
 #include <iostream> 
 #include <memory>
 #include <filesystem>
-#include <map>
+#include <optional>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 #include <SDL2/SDL.h>
 #include <glad/glad.h>
 
 #include "Level.hpp"
+#include "Geometry/BspBuilder.hpp"
 #include "Renderer/Renderer.hpp"
 #include "Resource/WadFile.hpp"
+#include "Resource/MapLoader.hpp"
+#include "Resource/ResourceManager.hpp"
+#include "Resource/TextureComposer.hpp"
+#include "Resource/FlatSet.hpp"
+#include "Resource/SpriteSet.hpp"
+#include "Utility/FixedTimestep.hpp"
+#include "Utility/FramePacer.hpp"
+#include "World/SectorInterpolation.hpp"
+#include "World/LevelSnapshot.hpp"
+#include "World/Collision.hpp"
+#include "World/Raycast.hpp"
 
 #include <SDL2/SDL_opengl.h>
 
@@ -17,101 +34,56 @@
 #include <imgui.h>
 
 
-struct
+struct Player
 {
-    glm::vec3   pos = { 0, 0, 4 };
+    glm::vec3   pos = { 0, 0, 4 };              // In render space, like the camera
     float       angle = glm::radians(90.0); 
     float       yaw = 0.0f;
-} player;
+};
 
+// Where the player is now, and where they were before the last simulation tick. The camera is
+// drawn between the two. Once the game thread starts, only it touches these. 
+Player player;
+Player previousPlayer;
 
-void moveSectorUpAndDown(Level& level, float deltaTime) {
-    static float timer = 0.0;
-    static bool moving = 0;
-    static int direction = -1;
-    static float initialFloorZ = level.sectors[1].floorZ;
-    static float initialCeilingZ = level.sectors[1].ceilingZ;
+// The BSP builder is kept around so levels that move their walls can rebuild parts of the tree.
+// The stats are the ones shown in the UI, which the render thread updates from snapshots. 
+BspBuilder bspBuilder;
+BspBuilder::Stats bspStats;
 
-    const float moveAmount = 64.0f;
-    const float moveSpeed = 24.0f;
-    const float pauseTime = 4.0f;
+// The simulation runs at a fixed rate, separate from how often frames are drawn. 
+const float SIM_TICK_SECONDS = 1.0f / 100.0f;
 
-    // If moving, updaate 
-    if (moving) {
-        Sector& sector = level.sectors[1];
-
-        sector.floorZ += moveSpeed * direction * deltaTime;
-        sector.ceilingZ += moveSpeed * direction * deltaTime;
-
-        // If we reach the end of our movement range, stop the movement and clamp the position. 
-        if (direction < 0 && sector.floorZ <= initialFloorZ) {
-            sector.floorZ = initialFloorZ;
-            sector.ceilingZ = initialCeilingZ;
-
-            moving = false;
-        }
-        if (direction > 0 && sector.floorZ >= initialFloorZ + moveAmount) {
-            sector.floorZ = initialFloorZ + moveAmount;
-            sector.ceilingZ = initialCeilingZ + moveAmount;
-
-            moving = false;
-        }
-    }
-    else { // Wait to move again
-        timer += deltaTime;
-
-        if (timer >= pauseTime) {
-            direction *= -1;
-            timer = 0.0f;
-            moving = true;
-        }
-    }
-}
-
-void moveSectorInCircle(Level& level, float deltaTime)
+// Keys the game acts on. SDL's keyboard state is only safe to read on the thread that pumps
+// events, so the main thread packs the keys into a bitmask for the game thread. 
+enum InputKey : uint32_t
 {
-#if 0
-    // Config
-    const float radius = 128.0f;
-    constexpr float speed = glm::radians(20.0f);    // Radians per second for circle traversal
+    INPUT_FORWARD       = 1 << 0,
+    INPUT_BACK          = 1 << 1,
+    INPUT_LEFT          = 1 << 2,
+    INPUT_RIGHT         = 1 << 3,
+    INPUT_TURN_LEFT     = 1 << 4,
+    INPUT_TURN_RIGHT    = 1 << 5,
+    INPUT_LOOK_UP       = 1 << 6,
+    INPUT_LOOK_DOWN     = 1 << 7,
+    INPUT_CLIMB         = 1 << 8,
+    INPUT_DESCEND       = 1 << 9,
+};
 
-    // data we need to calculate positions
-    static std::vector<uint32_t> vertices;
-    static std::map<uint32_t, glm::vec2> offsets;
+// Frames are held to this rate when there is no vsync to do it. 
+const float FALLBACK_FPS = 60.0f;
 
-    static bool firstRun = true;
-    static float angle = 0.0f;
+// The player collides like Doom's, with the camera at Doom's eye height, both in level units.
+// -noclip turns collision off, to fly through walls like before. 
+const CollisionBody PLAYER_BODY = { 16.0f, 56.0f, 24.0f };
+const float PLAYER_EYE_HEIGHT = 41.0f;
 
-    Sector& sector = level.sectors[1];
+// How far to look for what the camera is aimed at, shown in the UI. Doom's hitscan range. 
+const float AIM_DISTANCE = 2048.0f;
 
-    // For the first run of the function, collect a list of vertices for the sector  
-    // and map each of the start positions for the vertices. 
-    if (firstRun) {
-        for (uint32_t i = 0; i < sector.wallCount; i++) {
-            const Wall& wall = level.walls[sector.firstWall + i];
+Collision collision;
+bool noClip = false;
 
-            vertices.push_back(wall.startVertex);
-            offsets[wall.startVertex] = level.vertices[wall.startVertex];
-        }
-
-        firstRun = false;
-    }
-
-    // New center for the sector
-    glm::vec2 center = glm::vec2{ cos(angle), sin(angle) } *radius;
-
-    // Loop through and update the position of each of the vertices since both sectors 
-    // referece the same set of vertices, we don't needto update anything for the 
-    // other sector. 
-    for (uint32_t vertexIndex : vertices) {
-        Vertex& vertex = level.vertices[vertexIndex];
-
-        vertex = center + offsets[vertexIndex];
-    }
-
-    angle += speed * deltaTime;
-#endif
-}
 
 /**w
  * @brief Constructs a hard-coded test level with just a few sectors.
@@ -217,23 +189,27 @@ std::unique_ptr<Level> buildHolyGeometry()
     level->lineDefs.push_back(LineDef{ 7, 6, 2, LineDef::NO_WALL });
 
     // Add all the walls, going in CCW winding order for defining the inside of the sectors
-    level->walls.push_back(Wall{ 0, 0, false, {1.0, 0.0, 0.0} });  // Sector 0, outside wall
-    level->walls.push_back(Wall{ 5, 0, false, {1.0, 0.0, 0.0} });
-    level->walls.push_back(Wall{ 7, 0, false, {1.0, 0.0, 0.0} });
-    level->walls.push_back(Wall{ 2, 0, true, {1.0, 0.0, 0.0} });
-
-    level->walls.push_back(Wall{ 1, 0, false, {1.0, 0.0, 0.0} });  // Sector 0, inside wall
-    level->walls.push_back(Wall{ 3, 0, false, {1.0, 0.0, 0.0} });  
-    level->walls.push_back(Wall{ 6, 0, false, {1.0, 0.0, 0.0} });
-    level->walls.push_back(Wall{ 4, 0, true, {1.0, 0.0, 0.0} });
-
-    level->walls.push_back(Wall{ 1, 1, false, {1.0, 0.0, 0.0} });  // Sector 1
-    level->walls.push_back(Wall{ 4, 1, false, {1.0, 0.0, 0.0} });
-    level->walls.push_back(Wall{ 6, 1, false, {1.0, 0.0, 0.0} });
-    level->walls.push_back(Wall{ 3, 1, true, {1.0, 0.0, 0.0} });
-
-    level->sectors.push_back(Sector{ 0, 8, 0, 64, {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0} });
-    level->sectors.push_back(Sector{ 8, 4, -32, 48, {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0} });
+    level->addWall(Wall{ 0, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });  // Sector 0, outside wall
+    level->addWall(Wall{ 5, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });
+    level->addWall(Wall{ 7, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });
+    level->addWall(Wall{ 2, 0, true }, WallAppearance{ {1.0, 0.0, 0.0} });
+
+    level->addWall(Wall{ 1, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });  // Sector 0, inside wall
+    level->addWall(Wall{ 3, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });  
+    level->addWall(Wall{ 6, 0, false }, WallAppearance{ {1.0, 0.0, 0.0} });
+    level->addWall(Wall{ 4, 0, true }, WallAppearance{ {1.0, 0.0, 0.0} });
+
+    level->addWall(Wall{ 1, 1, false }, WallAppearance{ {1.0, 0.0, 0.0} });  // Sector 1
+    level->addWall(Wall{ 4, 1, false }, WallAppearance{ {1.0, 0.0, 0.0} });
+    level->addWall(Wall{ 6, 1, false }, WallAppearance{ {1.0, 0.0, 0.0} });
+    level->addWall(Wall{ 3, 1, true }, WallAppearance{ {1.0, 0.0, 0.0} });
+
+    level->addSector(Sector{ 0, 8, 0, 64 }, SectorAppearance{ {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0} });
+    level->addSector(Sector{ 8, 4, -32, 48 }, SectorAppearance{ {1.0, 1.0, 1.0}, {1.0, 1.0, 1.0} });
+
+    level->sectorGraph.build(*level);
+    level->blockmap = Blockmap::build(*level);
+    bspStats = bspBuilder.build(*level);
     
     return std::move(level);
 }
@@ -242,7 +218,7 @@ std::unique_ptr<Level> buildDynamicLevelMovingFlat()
 {
     auto level = buildHolyGeometry();
     
-    level->onUpdate = moveSectorUpAndDown;
+    level->thinkers.addPlatform(*level, 1, 64.0f, 24.0f, 4.0f);
 
     return std::move(level);
 }
@@ -251,7 +227,7 @@ std::unique_ptr<Level> buildDynamicLevelMovingSector()
 {
     auto level = buildHolyGeometry();
     
-    level->onUpdate = moveSectorInCircle;
+    level->thinkers.addOrbit(*level, 1, 128.0f, glm::radians(20.0f));
 
     return std::move(level);
 }
@@ -302,32 +278,49 @@ std::unique_ptr<Level> getLevelSelection()
     }
 }
 
-void handleInput(float deltaTime)
+uint32_t sampleInput()
 {
     const Uint8* keys = SDL_GetKeyboardState(nullptr);
 
+    uint32_t input = 0;
+    if (keys[SDL_SCANCODE_W])       input |= INPUT_FORWARD;
+    if (keys[SDL_SCANCODE_S])       input |= INPUT_BACK;
+    if (keys[SDL_SCANCODE_A])       input |= INPUT_LEFT;
+    if (keys[SDL_SCANCODE_D])       input |= INPUT_RIGHT;
+    if (keys[SDL_SCANCODE_LEFT])    input |= INPUT_TURN_LEFT;
+    if (keys[SDL_SCANCODE_RIGHT])   input |= INPUT_TURN_RIGHT;
+    if (keys[SDL_SCANCODE_UP])      input |= INPUT_LOOK_UP;
+    if (keys[SDL_SCANCODE_DOWN])    input |= INPUT_LOOK_DOWN;
+    if (keys[SDL_SCANCODE_SPACE])   input |= INPUT_CLIMB;
+    if (keys[SDL_SCANCODE_LALT])    input |= INPUT_DESCEND;
+
+    return input;
+}
+
+void handleInput(const Level& level, uint32_t input, float deltaTime)
+{
     const float moveSpeed = 32.0f;                  // Units Per Second
     const float climbSpeed = 32.0f;                 // Units Per Second
     const float turnSpeed = glm::radians(90.0f + 45.0f);    // Radians per second
 
-    if (keys[SDL_SCANCODE_SPACE]) {
+    if (input & INPUT_CLIMB) {
         player.pos.z += climbSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_LALT]) {
+    if (input & INPUT_DESCEND) {
         player.pos.z -= climbSpeed * deltaTime;
     }
 
-    if (keys[SDL_SCANCODE_LEFT]) {
+    if (input & INPUT_TURN_LEFT) {
         player.angle += turnSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_RIGHT]) {
+    if (input & INPUT_TURN_RIGHT) {
         player.angle -= turnSpeed * deltaTime;
     }
 
-    if (keys[SDL_SCANCODE_UP]) {
+    if (input & INPUT_LOOK_UP) {
         player.yaw += turnSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_DOWN]) {
+    if (input & INPUT_LOOK_DOWN) {
         player.yaw -= turnSpeed * deltaTime;
     }
 
@@ -337,25 +330,132 @@ void handleInput(float deltaTime)
     constexpr float maxYaw = glm::radians(89.999f);
     player.yaw = glm::clamp(player.yaw, -maxYaw, maxYaw);
 
-    glm::vec3 forwards { glm::cos(player.angle), glm::sin(player.angle), 0.0f };
-    glm::vec3 right { forwards.y, -forwards.x, 0.0f };
+    glm::vec2 forwards { glm::cos(player.angle), glm::sin(player.angle) };
+    glm::vec2 right { forwards.y, -forwards.x };
+    glm::vec2 move { 0.0f };
 
-    if (keys[SDL_SCANCODE_W]) {
-        player.pos += forwards * moveSpeed * deltaTime;
+    if (input & INPUT_FORWARD) {
+        move += forwards * moveSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_S]) {
-        player.pos -= forwards * moveSpeed * deltaTime;
+    if (input & INPUT_BACK) {
+        move -= forwards * moveSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_A]) {
-        player.pos -= right * moveSpeed * deltaTime;
+    if (input & INPUT_LEFT) {
+        move -= right * moveSpeed * deltaTime;
     }
-    if (keys[SDL_SCANCODE_D]) {
-        player.pos += right * moveSpeed * deltaTime;
+    if (input & INPUT_RIGHT) {
+        move += right * moveSpeed * deltaTime;
+    }
+
+    if (noClip) {
+        player.pos += glm::vec3{ move, 0.0f };
+        return;
+    }
+
+    // Collision works with where the player's feet are, rather than the camera, and in level
+    // units rather than render space. 
+    const glm::vec3 eyeOffset { 0.0f, 0.0f, PLAYER_EYE_HEIGHT };
+    const glm::vec3 feet = player.pos / Renderer::WORLD_SCALE - eyeOffset;
+
+    const glm::vec3 moved = collision.slideMove(level, feet, move / Renderer::WORLD_SCALE, PLAYER_BODY).position;
+    player.pos = (moved + eyeOffset) * Renderer::WORLD_SCALE;
+}
+
+/**
+ * @brief The game thread. Simulates the level a frame at a time, and publishes what changed in
+ *          each frame as a snapshot for the render thread. 
+ * 
+ * @details The exchange only has room for one snapshot beyond the one being drawn, so the game
+ *          thread runs at most a frame ahead of the render thread, and frame times are measured
+ *          here from when each slot frees up. 
+ */
+void runGame(Level& level, SnapshotExchange& exchange, const std::atomic<uint32_t>& input)
+{
+    using Clock = std::chrono::steady_clock;
+
+    FixedTimestep timestep(SIM_TICK_SECONDS);
+    SectorInterpolation sectorInterpolation;
+    sectorInterpolation.reset(level);
+    previousPlayer = player;
+
+    BspBuilder::Stats gameBspStats = bspStats;
+    ThinkerChanges frameChanges;
+    std::vector<uint32_t> movedLineDefIds;
+    Timer simTimer;
+
+    Clock::time_point lastFrame = Clock::now();
+
+    while (LevelSnapshot* snapshot = exchange.beginWrite()) {
+        const Clock::time_point now = Clock::now();
+        const float frameSeconds = std::chrono::duration<float>(now - lastFrame).count();
+        lastFrame = now;
+
+        simTimer.reset();
+        simTimer.start();
+
+        // Run however many ticks are due for the time the last frame took, gathering up
+        // everything they changed. 
+        const uint32_t ticks = timestep.advance(frameSeconds);
+        const uint32_t keys = input.load(std::memory_order_relaxed);
+
+        frameChanges.reset(level.sectors.size(), level.vertices.size());
+        bool bspChanged = false;
+
+        for (uint32_t tick = 0; tick < ticks; tick++) {
+            previousPlayer = player;
+            sectorInterpolation.beginTick(level);
+
+            level.thinkers.think(level, SIM_TICK_SECONDS);
+
+            const ThinkerChanges& changes = level.thinkers.changes();
+
+            // Only the part of the BSP around vertices that moved needs rebuilding, and the
+            // spatial index and blockmap only move the lines that use them. 
+            if (!changes.vertexIds().empty()) {
+                gameBspStats = bspBuilder.rebuild(level, changes.vertexIds());
+                level.spatialIndex.updateVertices(level, changes.vertexIds());
+                level.spatialIndex.findVertexLines(changes.vertexIds(), movedLineDefIds);
+                level.blockmap.updateLines(level, movedLineDefIds);
+                bspChanged = true;
+            }
+
+            for (uint32_t sectorId : changes.sectorIds())
+                frameChanges.markSector(sectorId);
+            for (uint32_t vertexId : changes.vertexIds())
+                frameChanges.markVertex(vertexId);
+
+            handleInput(level, keys, SIM_TICK_SECONDS);
+        }
+
+        // Sectors that moved in the last tick are drawn between ticks until the next one, even
+        // on frames that run no ticks. 
+        for (uint32_t sectorId : level.thinkers.changes().sectorIds())
+            frameChanges.markSector(sectorId);
+
+        snapshot->capture(level, frameChanges, sectorInterpolation);
+
+        snapshot->bspChanged = bspChanged;
+        if (bspChanged) {
+            level.bsp.takeUpdate(snapshot->bspUpdate);
+            snapshot->bspStats = gameBspStats;
+        }
+
+        snapshot->previousCamera = { previousPlayer.pos, previousPlayer.angle, previousPlayer.yaw };
+        snapshot->camera = { player.pos, player.angle, player.yaw };
+        snapshot->alpha = timestep.alpha();
+        snapshot->ticks = ticks;
+
+        simTimer.stop();
+        snapshot->simMilliseconds = simTimer.milleseconds();
+
+        exchange.publish();
     }
 }
 
-void RenderUi(const Renderer& renderer)
+void RenderUi(const Renderer& renderer, const FramePacer& framePacer, bool vsync, const LevelSnapshot& snapshot, const RayHit& aim)
 {
+    const FramePacer::Stats frameStats = framePacer.stats();
+
     if (ImGui::Begin("Performance", nullptr, 0))
     {
         ImGui::SeparatorText("Frame Timings");
@@ -389,30 +489,166 @@ void RenderUi(const Renderer& renderer)
             ImGui::TableNextColumn();           ImGui::Text("--");
             ImGui::TableNextRow();
 
-            ImGui::TableNextColumn();           ImGui::Text("Game Sim");
+            ImGui::TableNextColumn();           ImGui::Text("        Textures");
+            ImGui::TableNextColumn();           ImGui::Text("%f", renderer.textureTimer.milleseconds());
             ImGui::TableNextColumn();           ImGui::Text("--");
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();           ImGui::Text("Game Sim");
+            ImGui::TableNextColumn();           ImGui::Text("%f", snapshot.simMilliseconds);
             ImGui::TableNextColumn();           ImGui::Text("--");
             ImGui::TableNextRow();
 
 
             ImGui::TableNextColumn();           ImGui::Text("Total Frame Time");
-            ImGui::TableNextColumn();           ImGui::Text("--");
-            ImGui::TableNextColumn();           ImGui::Text("--");
+            ImGui::TableNextColumn();           ImGui::Text("%f", frameStats.lastMs);
+            ImGui::TableNextColumn();           ImGui::Text("%f", frameStats.averageMs);
 
             ImGui::EndTable();
 
         }
 
+        ImGui::SeparatorText("Frame Pacing");
+
+        if (framePacer.targetFps() > 0.0f)
+            ImGui::Text("Limited to %.0f fps", framePacer.targetFps());
+        else
+            ImGui::Text(vsync ? "Vsync" : "Unlimited");
+
+        ImGui::Text("Deviation: %.3f ms (%.3f min, %.3f max)", frameStats.deviationMs, frameStats.minMs, frameStats.maxMs);
+        ImGui::PlotLines("##FrameTimes", framePacer.history().data(), FramePacer::FRAME_HISTORY, framePacer.historyStart(),
+            nullptr, 0.0f, std::max(frameStats.maxMs, 1.0f), ImVec2(0.0f, 48.0f));
+
+        ImGui::SeparatorText("Textures");
+
+        const TextureResidency::Stats& textureStats = renderer.textureStats();
+        const float megabyte = 1024.0f * 1024.0f;
+
+        ImGui::Text("Resident: %u (%.1f of %.1f MB)", textureStats.residentCount,
+            textureStats.residentBytes / megabyte, textureStats.budgetBytes / megabyte);
+        if (textureStats.residentBytes > textureStats.budgetBytes)
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Over budget! The visible textures don't fit");
+
+        ImGui::Text("Misses: %u (%llu total)", textureStats.missCount, (unsigned long long)textureStats.totalMissCount);
+        ImGui::Text("Evictions: %u (%llu total)", textureStats.evictionCount, (unsigned long long)textureStats.totalEvictionCount);
+        ImGui::Text("Streaming: %u", renderer.streamingTextureCount());
+        ImGui::Text("Sprites: %u", renderer.visibleSpriteCount());
+
+        ImGui::SeparatorText("BSP");
+
+        if (bspStats.nodeCount + bspStats.subsectorCount > 0) {
+            ImGui::Text("Last %s: %f ms", bspStats.partialRebuild ? "rebuild" : "build", bspStats.buildMilliseconds);
+            ImGui::Text("Segs: %u (%u input, %u splits)", bspStats.segCount, bspStats.inputSegCount, bspStats.splitCount);
+            ImGui::Text("Nodes: %u, Subsectors: %u", bspStats.nodeCount, bspStats.subsectorCount);
+            ImGui::Text("Depth: %u max, %.2f average", bspStats.maxDepth, bspStats.averageLeafDepth);
+        }
+        else {
+            ImGui::Text("Using the map's own nodes");
+        }
+
+        ImGui::SeparatorText("Aim");
+
+        switch (aim.surface)
+        {
+        case RayHit::Surface::Wall:     ImGui::Text("Wall %u of sector %u", aim.wallId, aim.sectorId); break;
+        case RayHit::Surface::Floor:    ImGui::Text("Floor of sector %u", aim.sectorId); break;
+        case RayHit::Surface::Ceiling:  ImGui::Text("Ceiling of sector %u", aim.sectorId); break;
+        case RayHit::Surface::None:     ImGui::Text("Nothing"); break;
+        }
+        if (aim.surface != RayHit::Surface::None)
+            ImGui::Text("Distance: %.1f", aim.distance);
+
         ImGui::End();
     }
 }
 
 int main(int argc, char** argv)
 {
-    DoomMapLoader loader("maps/TestMap1.wad");
-    loader.loadLevel();
+    // Archives given on the command line are mounted in order, so the IWAD should come first,
+    // followed by any PWADs that override it. 
+    ResourceManager resources;
+    std::string mapName = "MAP01";
+    bool indexedColor = false;
+    std::optional<uint64_t> textureBudgetMb;
+    std::optional<float> maxFps;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-map" && i + 1 < argc) {
+            mapName = argv[++i];
+            continue;
+        }
+
+        if (arg == "-indexed") {
+            indexedColor = true;
+            continue;
+        }
 
-    std::unique_ptr<Level> level = buildDynamicLevelMovingFlat();
+        if (arg == "-noclip") {
+            noClip = true;
+            continue;
+        }
+
+        if (arg == "-texture-budget" && i + 1 < argc) {
+            textureBudgetMb = std::strtoull(argv[++i], nullptr, 10);
+            continue;
+        }
+
+        // Turns vsync off and holds frames to a rate instead. 0 doesn't limit them at all. 
+        if (arg == "-max-fps" && i + 1 < argc) {
+            maxFps = std::strtof(argv[++i], nullptr);
+            continue;
+        }
+
+        try {
+            resources.mount(arg);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Could not mount archive '" << arg << "': " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    std::unique_ptr<Level> level;
+    std::vector<ComposedTexture> levelTextures;
+    std::unique_ptr<FlatSet> flats;
+    std::unique_ptr<SpriteSet> sprites;
+    std::unique_ptr<ColorMap> colorMap;
+    Palette palette = Palette::grayscale();
+
+    if (resources.archiveCount() > 0) {
+        try {
+            DoomMapLoader loader(resources, mapName);
+            level = loader.loadLevel();
+
+            // Maps without node builder output get a BSP built on load. 
+            if (level->bsp.empty())
+                bspStats = bspBuilder.build(*level);
+
+            // Every texture the map uses is composed up front, so none are missing on the first frame.
+            TextureComposer composer(resources);
+            levelTextures = composer.compose(level->textureNames);
+            palette = composer.palette();
+
+            flats = std::make_unique<FlatSet>(resources);
+            sprites = std::make_unique<SpriteSet>(resources, findThingSpriteNames(*level));
+
+            // Indexed color needs COLORMAP to shade with, so without it the textures stay RGBA.
+            if (indexedColor && resources.contains("COLORMAP"))
+                colorMap = std::make_unique<ColorMap>(ColorMap::fromLump(resources.lumpData("COLORMAP")));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Could not load map '" << mapName << "': " << e.what() << std::endl;
+            return -1;
+        }
+    }
+    else {
+        level = buildDynamicLevelMovingFlat();
+    }
+
+    level->spatialIndex.build(*level);
+    bucketThingsBySector(*level);
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "Could not initalize SDL2! SDL Error: " << SDL_GetError() << std::endl;
@@ -453,12 +689,58 @@ int main(int argc, char** argv)
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
     std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>();
+    if (colorMap != nullptr)
+        renderer->enableIndexedColor(palette, *colorMap);
+
+    if (textureBudgetMb)
+        renderer->setTextureBudget(*textureBudgetMb * 1024 * 1024);
+
+    renderer->setLevelTextures(std::move(levelTextures), palette);
+    levelTextures.clear();
+
+    if (flats != nullptr) {
+        renderer->setLevelFlats(*flats, palette, level->flatNames);
+        flats.reset();
+    }
+
+    if (sprites != nullptr) {
+        renderer->setLevelSprites(*sprites, palette, *level);
+        sprites.reset();
+    }
 
-    const int timeStepMs = 10;
-    const float deltaTime = 1.0f / 1000.0f * (float)timeStepMs;
+    // Vsync paces frames by itself. Without it, the frame pacer holds them to a rate. 
+    FramePacer framePacer;
+    bool vsync = false;
+
+    if (maxFps) {
+        SDL_GL_SetSwapInterval(0);
+        framePacer.setTargetFps(*maxFps);
+    }
+    else if (SDL_GL_SetSwapInterval(1) == 0) {
+        vsync = true;
+    }
+    else {
+        framePacer.setTargetFps(FALLBACK_FPS);
+    }
+
+    // The game thread simulates the level while this thread draws its own copy of it, kept up to
+    // date from the snapshots the game thread publishes. Snapshots don't keep the blockmap and
+    // spatial index up to date, so the copy goes without them, and rays cast on this thread
+    // find their sector with the BSP. 
+    Level renderLevel = *level;
+    renderLevel.thinkers.clear();
+    renderLevel.blockmap = Blockmap();
+    renderLevel.spatialIndex = SpatialIndex();
+    level->bsp.markPublished();
+
+    SnapshotExchange exchange;
+    std::atomic<uint32_t> input = 0;
+    std::jthread gameThread([&] { runGame(*level, exchange, input); });
 
     bool running = true;
     while (running) {
+        framePacer.beginFrame();
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             ImGui_ImplSDL2_ProcessEvent(&event);
@@ -468,10 +750,19 @@ int main(int argc, char** argv)
             }
         }
 
-        if (level->onUpdate != nullptr) 
-            level->onUpdate(*level, deltaTime);
+        input.store(sampleInput(), std::memory_order_relaxed);
 
-        handleInput(deltaTime);
+        // While this frame is drawn from the snapshot, the game thread is already simulating
+        // the next one. 
+        const LevelSnapshot* snapshot = exchange.beginRead();
+        if (snapshot == nullptr)
+            break;
+
+        snapshot->apply(renderLevel);
+        if (snapshot->bspChanged)
+            bspStats = snapshot->bspStats;
+
+        renderer->advanceAnimations(snapshot->ticks * SIM_TICK_SECONDS);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL2_NewFrame();
@@ -482,21 +773,38 @@ int main(int argc, char** argv)
 
         renderer->beginFrame(width, height);
 
-        renderer->renderLevel(*level, player.pos, player.angle, player.yaw);
+        // Draw the camera and moving sectors between where the last two ticks left them, so
+        // movement stays smooth when frames and ticks don't line up. 
+        const CameraState camera = snapshot->interpolatedCamera();
+
+        snapshot->interpolate(renderLevel);
+        renderer->renderLevel(renderLevel, camera.position, camera.angle, camera.yaw);
+
+        // The camera is in render space, while rays are cast in level units. 
+        const glm::vec3 aimDirection {
+            glm::cos(camera.angle) * glm::cos(camera.yaw), glm::sin(camera.angle) * glm::cos(camera.yaw), glm::sin(camera.yaw) };
+        const RayHit aim = castRay(renderLevel, { camera.position / Renderer::WORLD_SCALE, aimDirection, AIM_DISTANCE });
+
+        snapshot->restore(renderLevel);
 
         renderer->endFrame();
 
 
-        RenderUi(*renderer);
+        RenderUi(*renderer, framePacer, vsync, *snapshot, aim);
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         ImGui::EndFrame();
 
+        exchange.release();
+
         SDL_GL_SwapWindow(window);
 
-        SDL_Delay(timeStepMs);
+        framePacer.waitForNextFrame();
     }
 
+    exchange.close();
+    gameThread.join();
+
     // Manually release the renderer. 
     // We need to clear the OpenGL state before de-initializing opengl and whatnot. 
     renderer.release();
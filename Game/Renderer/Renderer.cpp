@@ -3,18 +3,26 @@
 #include "OpenGL.hpp"
 
 #include <Resource/MapLoader.hpp>
+#include <Geometry/Triangulation.hpp>
 
 #include <iostream>
+#include <filesystem>
+#include <chrono>
 #include <vector>
 #include <list>
+#include <optional>
+#include <unordered_map>
+#include <algorithm>
 #include <exception>
+#include <limits>
 #include <cassert>
+#include <cstddef>
+#include <cmath>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/vector_angle.hpp>
 
-#include <CDT.h>
 
 Renderer::Renderer()
 {
@@ -23,6 +31,8 @@ Renderer::Renderer()
 	glFrontFace(GL_CCW);
 
 	shader.load("Shaders/Main");
+	flatShader.load("Shaders/Flat");
+	spriteShader.load("Shaders/Sprite");
 
 	glGenVertexArrays(1, &_vertexArrayId);
 	checkGl();
@@ -34,17 +44,120 @@ Renderer::Renderer()
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferId);
 	checkGl();
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(0));						// Position 
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, position));
 	glEnableVertexAttribArray(0);
 	checkGl();
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));		// Color
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, uv));
 	glEnableVertexAttribArray(1);
 	checkGl();
+
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, color));
+	glEnableVertexAttribArray(2);
+	checkGl();
+
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, light));
+	glEnableVertexAttribArray(3);
+	checkGl();
+
+	glGenVertexArrays(1, &_flatVertexArrayId);
+	checkGl();
+	glGenBuffers(1, &_flatVertexBufferId);
+	checkGl();
+
+	glBindVertexArray(_flatVertexArrayId);
+	checkGl();
+	glBindBuffer(GL_ARRAY_BUFFER, _flatVertexBufferId);
+	checkGl();
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(FlatVertex), (void*)offsetof(FlatVertex, position));
+	glEnableVertexAttribArray(0);
+	checkGl();
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(FlatVertex), (void*)offsetof(FlatVertex, color));
+	glEnableVertexAttribArray(1);
+	checkGl();
+
+	glVertexAttribIPointer(2, 3, GL_UNSIGNED_INT, sizeof(FlatVertex), (void*)offsetof(FlatVertex, flat));
+	glEnableVertexAttribArray(2);
+	checkGl();
+
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(FlatVertex), (void*)offsetof(FlatVertex, light));
+	glEnableVertexAttribArray(3);
+	checkGl();
+
+	glGenVertexArrays(1, &_spriteVertexArrayId);
+	checkGl();
+
+	// The visible sectors' sprites change every frame, so their buffer is kept for good. 
+	glGenBuffers(1, &_spriteSectorBufferId);
+	glBindBuffer(GL_TEXTURE_BUFFER, _spriteSectorBufferId);
+	glGenTextures(1, &_spriteSectorTextureId);
+	glBindTexture(GL_TEXTURE_BUFFER, _spriteSectorTextureId);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, _spriteSectorBufferId);
+	checkGl();
+
+	// Untextured walls are drawn with a single white texel, so they can share the textured 
+	// shader and just use their vertex color. 
+	const uint32_t white = 0xFFFFFFFF;
+
+	glGenTextures(1, &_whiteTextureId);
+	glBindTexture(GL_TEXTURE_2D, _whiteTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	checkGl();
+
+	// Textures that aren't resident yet are drawn with this instead.
+	glGenTextures(1, &_placeholderTextureId);
+	glBindTexture(GL_TEXTURE_2D, _placeholderTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &PLACEHOLDER_COLOR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	checkGl();
+
+	_textureResidency.setBudget(DEFAULT_TEXTURE_BUDGET);
 }
 
 Renderer::~Renderer()
 {
+	deleteLevelTextures();
+	deleteLevelSprites();
+
+	glDeleteTextures(1, &_whiteTextureId);
+	glDeleteTextures(1, &_placeholderTextureId);
+	checkGl();
+	_whiteTextureId = 0;
+	_placeholderTextureId = 0;
+
+	glDeleteTextures(1, &_flatTextureArrayId);
+	checkGl();
+	_flatTextureArrayId = 0;
+
+	glDeleteTextures(1, &_paletteTextureId);
+	glDeleteTextures(1, &_colorMapTextureId);
+	checkGl();
+	_paletteTextureId = 0;
+	_colorMapTextureId = 0;
+
+	glDeleteBuffers(1, &_flatVertexBufferId);
+	checkGl();
+	_flatVertexBufferId = 0;
+
+	glDeleteVertexArrays(1, &_flatVertexArrayId);
+	checkGl();
+	_flatVertexArrayId = 0;
+
+	glDeleteTextures(1, &_spriteSectorTextureId);
+	glDeleteBuffers(1, &_spriteSectorBufferId);
+	checkGl();
+	_spriteSectorTextureId = 0;
+	_spriteSectorBufferId = 0;
+
+	glDeleteVertexArrays(1, &_spriteVertexArrayId);
+	checkGl();
+	_spriteVertexArrayId = 0;
+
 	glDeleteBuffers(1, &_vertexBufferId);
 	checkGl();
 	_vertexBufferId = 0;
@@ -54,6 +167,518 @@ Renderer::~Renderer()
 	_vertexArrayId = 0;
 }
 
+void Renderer::enableIndexedColor(const Palette& palette, const ColorMap& colorMap)
+{
+	_indexedColor = true;
+	_whiteIndex = palette.brightestIndex();
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// The shaders look colors up with texelFetch, so these are never filtered. 
+	glGenTextures(1, &_paletteTextureId);
+	glBindTexture(GL_TEXTURE_2D, _paletteTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Palette::COLOR_COUNT, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, palette.colors.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	checkGl();
+
+	glGenTextures(1, &_colorMapTextureId);
+	glBindTexture(GL_TEXTURE_2D, _colorMapTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, Palette::COLOR_COUNT, ColorMap::MAP_COUNT, 0, GL_RED, GL_UNSIGNED_BYTE, colorMap.maps.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	checkGl();
+
+	// Untextured walls use the white texel, and textures that aren't resident the placeholder,
+	// which now have to be indices too. There's no gray to be sure of, so both are white. 
+	for (unsigned int textureId : { _whiteTextureId, _placeholderTextureId }) {
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, 1, 1, 0, GL_RED, GL_UNSIGNED_BYTE, &_whiteIndex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+		checkGl();
+	}
+}
+
+void Renderer::setLevelTextures(std::vector<ComposedTexture> textures, const Palette& palette)
+{
+	deleteLevelTextures();
+
+	_levelTextures.resize(textures.size());
+	_textureImages.resize(textures.size());
+	_texturePalette = palette;
+
+	_textureResidency.reset(static_cast<uint32_t>(textures.size()));
+	_uploadAllMisses = true;
+
+	// Nothing is uploaded yet. The composed images are kept, since they're much smaller than 
+	// their textures, and each is uploaded the first time it's seen. 
+	for (size_t i = 0; i < textures.size(); i++) {
+		IndexedImage& image = textures[i].image;
+		LevelTexture& texture = _levelTextures[i];
+
+		if (image.empty()) {
+			// PNGs are truecolor, so they can't be drawn with indexed color. 
+			if (!_indexedColor)
+				findTextureFile(static_cast<uint32_t>(i), textures[i].name);
+			continue;
+		}
+
+		texture.source = TextureSource::Composed;
+		texture.width = image.width;
+		texture.height = image.height;
+		_textureImages[i] = std::move(image);
+	}
+}
+
+void Renderer::setTextureBudget(uint64_t bytes)
+{
+	_textureResidency.setBudget(bytes);
+}
+
+void Renderer::deleteLevelTextures()
+{
+	for (uint32_t textureId = 0; textureId < _levelTextures.size(); textureId++)
+		evictLevelTexture(textureId);
+
+	_levelTextures.clear();
+	_textureImages.clear();
+	_textureResidency.reset(0);
+}
+
+void Renderer::findTextureFile(uint32_t textureId, const std::string& name)
+{
+	// Only a stat happens here. Reading and decoding the file is left to the streamer's threads.
+	const std::string fileName = "Textures/" + name + ".png";
+
+	std::error_code error;
+	if (name.empty() || !std::filesystem::is_regular_file(fileName, error))
+		return;
+
+	// PNGs are drawn at the placeholder's size until they've been loaded once. 
+	LevelTexture& texture = _levelTextures[textureId];
+	texture.source = TextureSource::Png;
+	texture.fileName = fileName;
+	texture.width = PLACEHOLDER_SIZE;
+	texture.height = PLACEHOLDER_SIZE;
+}
+
+void Renderer::updateTextureResidency()
+{
+	using Clock = std::chrono::steady_clock;
+
+	const Clock::time_point start = Clock::now();
+	const auto budget = std::chrono::duration<float, std::milli>(TEXTURE_UPLOAD_BUDGET_MS);
+
+	// Misses are uploaded in the order they were seen, up to the frame's upload budget. The rest
+	// are drawn with the placeholder and missed again next frame. 
+	for (uint32_t textureId : _textureResidency.misses()) {
+		LevelTexture& texture = _levelTextures[textureId];
+
+		if (texture.source == TextureSource::Png) {
+			if (!texture.loading)
+				requestTextureFile(textureId);
+			continue;
+		}
+
+		if (!_uploadAllMisses && Clock::now() - start >= budget)
+			continue;
+
+		uploadLevelTexture(textureId);
+	}
+
+	_uploadAllMisses = false;
+
+	while (std::optional<uint32_t> textureId = _textureResidency.findEviction())
+		evictLevelTexture(*textureId);
+}
+
+void Renderer::uploadLevelTexture(uint32_t textureId)
+{
+	LevelTexture& texture = _levelTextures[textureId];
+	const IndexedImage& image = _textureImages[textureId];
+
+	glGenTextures(1, &texture.id);
+	glBindTexture(GL_TEXTURE_2D, texture.id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// Doom textures are often not a multiple of 4 wide, so rows can't be assumed to be aligned.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	const uint64_t pixelCount = static_cast<uint64_t>(image.width) * image.height;
+
+	if (_indexedColor) {
+		// Opaque textures are just their indices, with the mask channel reading as 1. Textures
+		// with holes keep their mask next to each index. Indices can't be blended, so there 
+		// are no mipmaps, the same as Doom. 
+		const bool opaque = std::all_of(image.mask.begin(), image.mask.end(), [](uint8_t mask) { return mask != 0; });
+
+		if (opaque) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, image.width, image.height, 0, GL_RED, GL_UNSIGNED_BYTE, image.indices.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+		}
+		else {
+			std::vector<uint8_t> indicesAndMask(image.indices.size() * 2);
+			for (size_t j = 0; j < image.indices.size(); j++) {
+				indicesAndMask[j * 2] = image.indices[j];
+				indicesAndMask[j * 2 + 1] = image.mask[j];
+			}
+
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, image.width, image.height, 0, GL_RG, GL_UNSIGNED_BYTE, indicesAndMask.data());
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		checkGl();
+
+		_textureResidency.markResident(textureId, pixelCount * (opaque ? 1 : 2));
+	}
+	else {
+		std::vector<uint32_t> rgba = image.toRgba(_texturePalette);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		checkGl();
+
+		_textureResidency.markResident(textureId, rgbaTextureSize(image.width, image.height));
+	}
+}
+
+void Renderer::requestTextureFile(uint32_t textureId)
+{
+	// The streamer needs a texture to upload into, which is left empty until the file arrives.
+	LevelTexture& texture = _levelTextures[textureId];
+	texture.loading = true;
+
+	glGenTextures(1, &texture.id);
+	glBindTexture(GL_TEXTURE_2D, texture.id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	checkGl();
+
+	_textureStreamer.request(TextureStreamer::Request{ texture.fileName, texture.id, -1, 0, textureId });
+}
+
+void Renderer::evictLevelTexture(uint32_t textureId)
+{
+	LevelTexture& texture = _levelTextures[textureId];
+
+	if (texture.id != 0) {
+		_textureStreamer.cancel(texture.id);
+		glDeleteTextures(1, &texture.id);
+		checkGl();
+	}
+
+	texture.id = 0;
+	texture.loading = false;
+
+	_textureResidency.markEvicted(textureId);
+}
+
+void Renderer::onTextureArrived(const TextureStreamer::Request& request, uint32_t width, uint32_t height)
+{
+	// Flats keep their placeholder's layer, so only ones that failed need anything done. They, and
+	// textures that failed, go back to being drawn with their color. 
+	if (request.layer >= 0) {
+		if (width == 0)
+			_flatLayers[request.tag] = FlatLayer{};
+		return;
+	}
+
+	LevelTexture& texture = _levelTextures[request.tag];
+	texture.loading = false;
+
+	if (width == 0) {
+		evictLevelTexture(request.tag);
+		texture = LevelTexture{};
+		return;
+	}
+
+	texture.width = width;
+	texture.height = height;
+	_textureResidency.markResident(request.tag, rgbaTextureSize(width, height));
+}
+
+uint64_t Renderer::rgbaTextureSize(uint32_t width, uint32_t height)
+{
+	// A full mip chain adds a third on top of the base level. 
+	return static_cast<uint64_t>(width) * height * sizeof(uint32_t) * 4 / 3;
+}
+
+void Renderer::setLevelFlats(const FlatSet& flats, const Palette& palette, const std::vector<std::string>& flatNames)
+{
+	if (_flatTextureArrayId != 0) {
+		_textureStreamer.cancel(_flatTextureArrayId);
+		glDeleteTextures(1, &_flatTextureArrayId);
+		_flatTextureArrayId = 0;
+	}
+
+	_flatLayers.assign(flatNames.size(), FlatLayer{});
+	_animationTime = 0.0f;
+
+	// Flats past the most layers the driver supports are drawn with their color instead.
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	uint32_t layerCount = std::min<uint32_t>(flats.layerCount(), static_cast<uint32_t>(maxLayers));
+	if (layerCount < flats.layerCount())
+		std::cerr << "Only " << layerCount << " of " << flats.layerCount() << " flats fit in a texture array" << std::endl;
+
+	// Flats that aren't in the set but have a PNG get a layer after the set's, which is streamed
+	// into once the texture array exists. 
+	struct StreamedFlat
+	{
+		uint32_t	flatId;
+		std::string	fileName;
+	};
+	std::vector<StreamedFlat> streamedFlats;
+
+	for (size_t flatId = 0; flatId < flatNames.size(); flatId++) {
+		std::optional<uint32_t> layer = flats.findLayer(flatNames[flatId]);
+		if (!layer) {
+			// PNGs are truecolor, so they can't be drawn with indexed color. 
+			if (_indexedColor || flatNames[flatId].empty() || layerCount >= static_cast<uint32_t>(maxLayers))
+				continue;
+
+			std::string fileName = "Flats/" + flatNames[flatId] + ".png";
+
+			std::error_code error;
+			if (!std::filesystem::is_regular_file(fileName, error))
+				continue;
+
+			_flatLayers[flatId] = FlatLayer{ layerCount, layerCount, 1 };
+			streamedFlats.push_back(StreamedFlat{ static_cast<uint32_t>(flatId), std::move(fileName) });
+			layerCount++;
+			continue;
+		}
+
+		const FlatSet::Animation& animation = flats.animation(*layer);
+		if (animation.firstLayer + animation.frameCount > layerCount)
+			continue;
+
+		_flatLayers[flatId] = FlatLayer{ *layer, animation.firstLayer, animation.frameCount };
+	}
+
+	if (layerCount == 0)
+		return;
+
+	glGenTextures(1, &_flatTextureArrayId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _flatTextureArrayId);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// Flats are always opaque, so with indexed color they're uploaded as they are. 
+	if (_indexedColor) {
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, FlatSet::FLAT_SIZE, FlatSet::FLAT_SIZE, layerCount, 0, GL_RED, GL_UNSIGNED_BYTE, flats.indices().data());
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		checkGl();
+	}
+	else {
+		// Streamed flats start out as the placeholder color. 
+		std::vector<uint32_t> rgba = flats.toRgba(palette);
+		rgba.resize(std::max<size_t>(rgba.size(), static_cast<size_t>(layerCount) * FlatSet::FLAT_SIZE * FlatSet::FLAT_SIZE), PLACEHOLDER_COLOR);
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, FlatSet::FLAT_SIZE, FlatSet::FLAT_SIZE, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		checkGl();
+	}
+
+	for (const StreamedFlat& flat : streamedFlats) {
+		const uint32_t layer = _flatLayers[flat.flatId].layer;
+		_textureStreamer.request(TextureStreamer::Request{ flat.fileName, _flatTextureArrayId, static_cast<int32_t>(layer), FlatSet::FLAT_SIZE, flat.flatId });
+	}
+}
+
+void Renderer::setLevelSprites(const SpriteSet& sprites, const Palette& palette, const Level& level)
+{
+	deleteLevelSprites();
+
+	if (sprites.pageCount() == 0 || level.sectorThingOffsets.size() != level.sectors.size() + 1)
+		return;
+
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	if (sprites.pageCount() > static_cast<uint32_t>(maxLayers)) {
+		std::cerr << "The sprite atlas has " << sprites.pageCount() << " pages, but a texture array only fits " << maxLayers << std::endl;
+		return;
+	}
+
+	// Each sprite frame gets one table of its rotations, however many things or types use it.
+	// Rotations without a picture fall back to the front, so anything with a front is drawn. 
+	constexpr uint32_t NO_ROTATIONS = std::numeric_limits<uint32_t>::max();
+
+	std::vector<uint32_t> rotationTables;
+	std::unordered_map<uint64_t, uint32_t, LumpNameHash> frameRotationsIds;
+	std::unordered_map<uint16_t, uint32_t> typeRotationsIds;
+
+	auto findRotationsId = [&](uint16_t type) {
+		auto [typeIt, typeInserted] = typeRotationsIds.try_emplace(type, NO_ROTATIONS);
+		if (!typeInserted)
+			return typeIt->second;
+
+		std::optional<ThingSprite> sprite = findThingSprite(type);
+		if (!sprite)
+			return NO_ROTATIONS;
+
+		const uint64_t frameName = packLumpName(std::string(sprite->name) + sprite->frame);
+		auto [frameIt, frameInserted] = frameRotationsIds.try_emplace(frameName, NO_ROTATIONS);
+
+		const SpriteSet::Rotation front = sprites.findRotation(sprite->name, sprite->frame, 1);
+		const uint32_t tableCount = static_cast<uint32_t>(rotationTables.size() / SPRITE_ROTATION_COUNT);
+
+		if (frameInserted && front.frameId != SpriteSet::NO_FRAME && tableCount < MAX_SPRITE_ROTATION_TABLES) {
+			frameIt->second = tableCount;
+
+			for (uint32_t i = 1; i <= SPRITE_ROTATION_COUNT; i++) {
+				SpriteSet::Rotation rotation = sprites.findRotation(sprite->name, sprite->frame, i);
+				if (rotation.frameId == SpriteSet::NO_FRAME)
+					rotation = front;
+
+				rotationTables.push_back((rotation.frameId << 1) | (rotation.mirrored ? 1 : 0));
+			}
+		}
+
+		typeIt->second = frameIt->second;
+		return typeIt->second;
+	};
+
+	// Things are drawn like Doom's default: single player, on medium skill. 
+	std::vector<SpriteInstance> instances;
+	instances.reserve(level.things.size());
+
+	_sectorSpriteOffsets.assign(level.sectors.size() + 1, 0);
+
+	for (uint32_t sectorId = 0; sectorId < level.sectors.size(); sectorId++) {
+		_sectorSpriteOffsets[sectorId] = static_cast<uint32_t>(instances.size());
+
+		for (uint32_t i = level.sectorThingOffsets[sectorId]; i < level.sectorThingOffsets[sectorId + 1]; i++) {
+			const Thing& thing = level.things[i];
+			if ((thing.flags & Thing::MULTIPLAYER_ONLY) || !(thing.flags & Thing::SKILL_MEDIUM))
+				continue;
+
+			const uint32_t rotationsId = findRotationsId(thing.type);
+			if (rotationsId == NO_ROTATIONS)
+				continue;
+
+			// Binary angles wrap around by themselves, like Doom's. 
+			const uint16_t angle = static_cast<uint16_t>(std::lround(glm::degrees(thing.angle) * (65536.0f / 360.0f)));
+
+			instances.push_back(SpriteInstance{ glm::vec3(thing.position, thing.height), angle, static_cast<uint16_t>(rotationsId) });
+		}
+
+		if (instances.size() > _sectorSpriteOffsets[sectorId])
+			_spriteSectorIds.push_back(sectorId);
+	}
+
+	_sectorSpriteOffsets.back() = static_cast<uint32_t>(instances.size());
+
+	if (instances.empty())
+		return;
+
+	// Two texels per frame: where it is in its page and its size, then its offsets and page. 
+	std::vector<int32_t> frames;
+	frames.reserve(sprites.frames().size() * 8);
+
+	for (const SpriteSet::Frame& frame : sprites.frames()) {
+		frames.insert(frames.end(), {
+			static_cast<int32_t>(frame.x), static_cast<int32_t>(frame.y), static_cast<int32_t>(frame.width), static_cast<int32_t>(frame.height),
+			frame.leftOffset, frame.topOffset, static_cast<int32_t>(frame.page), 0 });
+	}
+
+	auto createBufferTexture = [](GLenum format, const void* data, size_t size, unsigned int& bufferId, unsigned int& textureId) {
+		glGenBuffers(1, &bufferId);
+		glBindBuffer(GL_TEXTURE_BUFFER, bufferId);
+		glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STATIC_DRAW);
+
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_BUFFER, textureId);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, bufferId);
+		checkGl();
+	};
+
+	createBufferTexture(GL_RGBA32I, frames.data(), frames.size() * sizeof(int32_t), _spriteFrameBufferId, _spriteFrameTextureId);
+	createBufferTexture(GL_RGBA32UI, rotationTables.data(), rotationTables.size() * sizeof(uint32_t), _spriteRotationBufferId, _spriteRotationTextureId);
+	createBufferTexture(GL_RGBA32UI, instances.data(), instances.size() * sizeof(SpriteInstance), _spriteInstanceBufferId, _spriteInstanceTextureId);
+
+	// The shaders fetch texels rather than sampling them, so pictures next to each other in the
+	// atlas never bleed into each other. 
+	const uint32_t pageCount = sprites.pageCount();
+	const size_t pageTexelCount = static_cast<size_t>(SpriteSet::PAGE_SIZE) * sprites.pageHeight();
+
+	glGenTextures(1, &_spriteTextureArrayId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _spriteTextureArrayId);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// Sprites have holes, so with indexed color they keep their mask in green like wall textures.
+	if (_indexedColor) {
+		std::vector<uint8_t> texels(pageTexelCount * pageCount * 2);
+
+		for (uint32_t page = 0; page < pageCount; page++) {
+			const IndexedImage& image = sprites.page(page);
+			uint8_t* pageTexels = &texels[page * pageTexelCount * 2];
+
+			for (size_t i = 0; i < pageTexelCount; i++) {
+				pageTexels[i * 2] = image.indices[i];
+				pageTexels[i * 2 + 1] = image.mask[i];
+			}
+		}
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG8, SpriteSet::PAGE_SIZE, sprites.pageHeight(), pageCount, 0, GL_RG, GL_UNSIGNED_BYTE, texels.data());
+		checkGl();
+	}
+	else {
+		std::vector<uint32_t> rgba;
+		rgba.reserve(pageTexelCount * pageCount);
+
+		for (uint32_t page = 0; page < pageCount; page++) {
+			std::vector<uint32_t> pageRgba = sprites.page(page).toRgba(palette);
+			rgba.insert(rgba.end(), pageRgba.begin(), pageRgba.end());
+		}
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, SpriteSet::PAGE_SIZE, sprites.pageHeight(), pageCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		checkGl();
+	}
+}
+
+void Renderer::deleteLevelSprites()
+{
+	glDeleteTextures(1, &_spriteTextureArrayId);
+	glDeleteTextures(1, &_spriteFrameTextureId);
+	glDeleteTextures(1, &_spriteRotationTextureId);
+	glDeleteTextures(1, &_spriteInstanceTextureId);
+	glDeleteBuffers(1, &_spriteFrameBufferId);
+	glDeleteBuffers(1, &_spriteRotationBufferId);
+	glDeleteBuffers(1, &_spriteInstanceBufferId);
+	checkGl();
+
+	_spriteTextureArrayId = 0;
+	_spriteFrameTextureId = 0;
+	_spriteRotationTextureId = 0;
+	_spriteInstanceTextureId = 0;
+	_spriteFrameBufferId = 0;
+	_spriteRotationBufferId = 0;
+	_spriteInstanceBufferId = 0;
+
+	_sectorSpriteOffsets.clear();
+	_spriteSectorIds.clear();
+	_spriteSectors.clear();
+	_visibleSpriteCount = 0;
+}
+
+void Renderer::advanceAnimations(float deltaTime)
+{
+	_animationTime += deltaTime;
+}
+
 void Renderer::beginFrame(int width, int height)
 {
 	glViewport(0, 0, width, height);
@@ -69,16 +694,37 @@ void Renderer::beginFrame(int width, int height)
 
 	meshTimer.reset();
 	glTimer.reset();
+	textureTimer.reset();
 }
 
 void Renderer::renderLevel(const Level& level, glm::vec3 camPos, float angle, float yaw)
 {
-	std::vector<glm::vec3> data;
-	int vertexCount = buildMesh(level, data);
+	// The camera is in render space, which is the level scaled down by WORLD_SCALE. 
+	const glm::vec2 viewPoint = glm::vec2{ camPos.x, camPos.y } / WORLD_SCALE;
+
+	_textureResidency.beginFrame();
+
+	// Textures that arrive are uploaded before meshing, since their size changes the walls' UVs.
+	textureTimer.start();
+	_textureStreamer.upload(TEXTURE_UPLOAD_BUDGET_MS, [this](const TextureStreamer::Request& request, uint32_t width, uint32_t height) {
+		onTextureArrived(request, width, height);
+	});
+	textureTimer.stop();
+
+	buildMesh(level, viewPoint);
 
 	glTimer.start();
 
-	glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(glm::vec3), data.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferId);
+	glBufferData(GL_ARRAY_BUFFER, _mesh.size() * sizeof(MeshVertex), _mesh.data(), GL_DYNAMIC_DRAW);
+	checkGl();
+
+	glBindBuffer(GL_ARRAY_BUFFER, _flatVertexBufferId);
+	glBufferData(GL_ARRAY_BUFFER, _flatMesh.size() * sizeof(FlatVertex), _flatMesh.data(), GL_DYNAMIC_DRAW);
+	checkGl();
+
+	glBindBuffer(GL_TEXTURE_BUFFER, _spriteSectorBufferId);
+	glBufferData(GL_TEXTURE_BUFFER, _spriteSectors.size() * sizeof(SpriteSector), _spriteSectors.data(), GL_STREAM_DRAW);
 	checkGl();
 
 	glm::mat4 matProj = glm::perspective(
@@ -94,73 +740,138 @@ void Renderer::renderLevel(const Level& level, glm::vec3 camPos, float angle, fl
 		{ 0, 0.0, 1.0 }
 	);
 
-	const float scale = 1.0 / 8.0;
-	glm::mat4 matWorld = glm::scale(glm::vec3{ scale });
+	glm::mat4 matWorld = glm::scale(glm::vec3{ WORLD_SCALE });
 
 	glm::mat4 matTrans = matProj * matView * matWorld;
 
+	// The lookup textures for indexed color stay bound for both passes. 
+	if (_indexedColor) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, _colorMapTextureId);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, _paletteTextureId);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+
 	shader.use();
 	shader.setMat4("matTrans", matTrans);
+	shader.setInt("wallTexture", 0);
+	setIndexedColorUniforms(shader);
+
+	glBindVertexArray(_vertexArrayId);
+
+	for (const DrawBatch& batch : _drawBatches) {
+		glBindTexture(GL_TEXTURE_2D, batch.textureId);
+		glDrawArrays(GL_TRIANGLES, batch.firstVertex, batch.vertexCount);
+		checkGl();
+	}
+
+	// Every flat is drawn at once from the texture array. Animated flats are moved along by the
+	// frame uniform, which the shader adds to their layer. 
+	const uint32_t tics = static_cast<uint32_t>(_animationTime * 35.0f);
+
+	flatShader.use();
+	flatShader.setMat4("matTrans", matTrans);
+	flatShader.setInt("flatTextures", 0);
+	flatShader.setUint("flatAnimationFrame", tics / FlatSet::ANIMATION_TICS);
+	flatShader.setInt("whiteIndex", _whiteIndex);
+	setIndexedColorUniforms(flatShader);
 
-	glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+	glBindVertexArray(_flatVertexArrayId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _flatTextureArrayId);
+	glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(_flatMesh.size()));
 	checkGl();
 
+	// Every sprite in the visible sectors is drawn with one instanced call. Each instance finds
+	// its thing in the buffers, picks the rotation it's seen from, and builds its own quad
+	// facing the camera. 
+	if (_visibleSpriteCount > 0) {
+		spriteShader.use();
+		spriteShader.setMat4("matTrans", matTrans);
+		spriteShader.setVec2("cameraPosition", viewPoint);
+		spriteShader.setVec2("cameraRight", glm::vec2{ glm::sin(angle), -glm::cos(angle) });
+		spriteShader.setInt("spriteAtlas", 0);
+		spriteShader.setInt("spriteFrames", 3);
+		spriteShader.setInt("spriteInstances", 4);
+		spriteShader.setInt("spriteSectors", 5);
+		spriteShader.setInt("spriteRotations", 6);
+		spriteShader.setInt("spriteSectorCount", static_cast<GLint>(_spriteSectors.size()));
+		setIndexedColorUniforms(spriteShader);
+
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_BUFFER, _spriteFrameTextureId);
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_BUFFER, _spriteInstanceTextureId);
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_BUFFER, _spriteSectorTextureId);
+		glActiveTexture(GL_TEXTURE6);
+		glBindTexture(GL_TEXTURE_BUFFER, _spriteRotationTextureId);
+		glActiveTexture(GL_TEXTURE0);
+
+		glBindVertexArray(_spriteVertexArrayId);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, _spriteTextureArrayId);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_visibleSpriteCount));
+		checkGl();
+	}
+
 	glTimer.stop();
 }
 
+void Renderer::setIndexedColorUniforms(ShaderProgram& program)
+{
+	program.setBool("indexedColor", _indexedColor);
+	program.setInt("colorMap", 1);
+	program.setInt("palette", 2);
+	program.setFloat("distanceScale", 1.0f / WORLD_SCALE);
+}
+
 void Renderer::endFrame()
 {
 
 }
 
 /**
- * Adds the walls of the level to the render mesh.
+ * Adds the walls of the level to the render mesh, each into the bucket for its texture.
  * 
  * \param level	The level we are rendering
- * \param mesh  The mesh vector to add the data to
  * \return		The number of vertices added to the mesh
  */
-int Renderer::buildWallMesh(const Level& level, std::vector<glm::vec3>& mesh)
+int Renderer::buildWallMesh(const Level& level)
 {
 	int vertexCount = 0;
 
 	// Build a mesh for all the walls. 
-	for (const Sector& sector : level.sectors) {
+	for (uint32_t sectorId = 0; sectorId < level.sectors.size(); sectorId++) {
+		if (!isSectorVisible(sectorId))
+			continue;
+
+		const Sector& sector = level.sectors[sectorId];
+		const float sectorLight = level.sectorAppearances[sectorId].lightLevel;
 
 		for (int i = 0; i < sector.wallCount; i++) {
 			const uint32_t wallId = sector.firstWallId + i;
-			const Wall& wall = level.walls[wallId];
-			const LineDef& lineDef = level.lineDefs[wall.lineDefId];
+			const LineDef& lineDef = level.lineDefs[level.walls[wallId].lineDefId];
+			const WallAppearance& appearance = level.wallAppearances[wallId];
 
 			const bool wallFollowsLine = wallId == lineDef.frontWallId;
-			const uint32_t behindWallId = wallFollowsLine ? lineDef.backWallId : lineDef.frontWallId;
+			const uint32_t behindSectorId = level.sectorGraph.behindSector(wallId);
 
 			glm::vec2 start = level.vertices[lineDef.startVertexId];
 			glm::vec2 end = level.vertices[lineDef.endVertexId];
 
+			// Like Doom, walls running along the map's axes are a light level darker or lighter, 
+			// which makes corners easier to see. 
+			float light = sectorLight;
+			if (start.y == end.y)
+				light -= 16.0f;
+			else if (start.x == end.x)
+				light += 16.0f;
+
 			// If there is no sector behind this wall, we can add just a single quad and move on
-			// with our busy lives. 
-			if (behindWallId == LineDef::NO_WALL) {
-				glm::vec3 startBottom{ start, sector.floorZ };
-				glm::vec3 startTop{ start, sector.ceilingZ };
-				glm::vec3 endBottom{ end, sector.floorZ };
-				glm::vec3 endTop{ end, sector.ceilingZ };
-
-				mesh.push_back(startBottom);
-				mesh.push_back(wall.color);
-				mesh.push_back(startTop);
-				mesh.push_back(wall.color);
-				mesh.push_back(endTop);
-				mesh.push_back(wall.color);
-
-				mesh.push_back(startBottom);
-				mesh.push_back(wall.color);
-				mesh.push_back(endTop);
-				mesh.push_back(wall.color);
-				mesh.push_back(endBottom);
-				mesh.push_back(wall.color);
-
-				vertexCount += 6;
+			// with our busy lives. Its texture hangs down from the ceiling. 
+			if (behindSectorId == SectorGraph::NO_SECTOR) {
+				vertexCount += addWallQuad(start, end, sector.floorZ, sector.ceilingZ, sector.ceilingZ, appearance.middleTextureId, appearance.color, light);
 			}
 			else {	
 				// If we are on the back side of the linedef, we need to flip the vertex order to 
@@ -169,56 +880,23 @@ int Renderer::buildWallMesh(const Level& level, std::vector<glm::vec3>& mesh)
 
 				// If there is a wall behind, we could have 0, 1, or 2 quads to add. depending on the heights of the two
 				// connected sectors. We could have 3 if we had middle textures, but we don't in this demo. 
-				const Wall& behindWall = level.walls[behindWallId];
-				const Sector& behindSector = level.sectors[behindWall.sectorId];
+				const Sector& behindSector = level.sectors[behindSectorId];
 
 				// We need to add a wall from our floor to the behind sector's floor if their floor is higher. 
+				// Lower textures start at the top of the step. 
 				if (behindSector.floorZ > sector.floorZ) {
-					glm::vec3 startBottom{ start, sector.floorZ };
-					glm::vec3 startTop{ start, behindSector.floorZ };
-					glm::vec3 endBottom{ end, sector.floorZ };
-					glm::vec3 endTop{ end, behindSector.floorZ };
-
-					mesh.push_back(startBottom);
-					mesh.push_back(wall.color);
-					mesh.push_back(startTop);
-					mesh.push_back(wall.color);
-					mesh.push_back(endTop);
-					mesh.push_back(wall.color);
-
-					mesh.push_back(startBottom);
-					mesh.push_back(wall.color);
-					mesh.push_back(endTop);
-					mesh.push_back(wall.color);
-					mesh.push_back(endBottom);
-					mesh.push_back(wall.color);
-
-					vertexCount += 6;
+					vertexCount += addWallQuad(start, end, sector.floorZ, behindSector.floorZ, behindSector.floorZ, appearance.lowerTextureId, appearance.color, light);
 				}
 
 				// We need to add a wall from our ceiling to the behind sector's ceiling if their ceiling
-				// is lower. 
+				// is lower. Upper textures sit on the bottom of the step, so they're pegged a texture's
+				// height above it. 
 				if (behindSector.ceilingZ < sector.ceilingZ) {
-					glm::vec3 startBottom{ start, behindSector.ceilingZ };
-					glm::vec3 startTop{ start, sector.ceilingZ };
-					glm::vec3 endBottom{ end, behindSector.ceilingZ };
-					glm::vec3 endTop{ end, sector.ceilingZ };
-
-					mesh.push_back(startBottom);
-					mesh.push_back(wall.color);
-					mesh.push_back(startTop);
-					mesh.push_back(wall.color);
-					mesh.push_back(endTop);
-					mesh.push_back(wall.color);
-
-					mesh.push_back(startBottom);
-					mesh.push_back(wall.color);
-					mesh.push_back(endTop);
-					mesh.push_back(wall.color);
-					mesh.push_back(endBottom);
-					mesh.push_back(wall.color);
-
-					vertexCount += 6;
+					float pegZ = behindSector.ceilingZ;
+					if (appearance.upperTextureId < _levelTextures.size())
+						pegZ += static_cast<float>(_levelTextures[appearance.upperTextureId].height);
+
+					vertexCount += addWallQuad(start, end, behindSector.ceilingZ, sector.ceilingZ, pegZ, appearance.upperTextureId, appearance.color, light);
 				}
 			}
 		}
@@ -228,106 +906,221 @@ int Renderer::buildWallMesh(const Level& level, std::vector<glm::vec3>& mesh)
 }
 
 /**
- * Adds the flats (Floor, Ceilings) to the render mesh.
+ * Adds one wall quad to the bucket for its texture, and marks the texture as used. The texture
+ * repeats at one texel per level unit, across from the wall's start and down from pegZ. Walls
+ * without a texture, or whose texture couldn't be composed or loaded, go in the untextured bucket
+ * and are drawn with their color. 
  *
- * \param level The level we are rendering
- * \param mesh  The mesh vector to add to
- * \return		The number of vertices added to the mesh
+ * \return The number of vertices added to the mesh
  */
-int Renderer::buildFlatMesh(const Level& level, std::vector<glm::vec3>& mesh)
+int Renderer::addWallQuad(glm::vec2 start, glm::vec2 end, float bottomZ, float topZ, float pegZ, uint32_t textureId, glm::vec3 color, float light)
 {
-	int vertexCount = 0;
+	uint32_t bucketId = 0;
+	glm::vec2 texelSize{ 1.0f };
 
-	for (const Sector& sector : level.sectors) {
-		CDT::Triangulation<float> triangulation;
+	if (textureId < _levelTextures.size() && _levelTextures[textureId].source != TextureSource::None) {
+		const LevelTexture& texture = _levelTextures[textureId];
+		_textureResidency.use(textureId);
 
-		std::vector<glm::vec2> sectorVerts;
-		std::vector<std::pair<size_t, size_t>> sectorEdges;
+		bucketId = textureId + 1;
+		texelSize = glm::vec2{ 1.0f / texture.width, 1.0f / texture.height };
+		color = glm::vec3{ 1.0f };
+	}
 
-		uint32_t loopStartWallIndex = sector.firstWallId;	// Which wall did this edge loop start on?
-		size_t loopStartVertexIndex = 0;				// What vertex number did this edge loop start on?
+	const float length = glm::length(end - start);
 
-		// Loop through all of the walls in the sector so we can add them to the triangulation.
-		for (size_t i = 0; i < sector.wallCount; i++) {
-			const uint32_t wallId = sector.firstWallId + i;
-			const Wall& wall = level.walls[wallId];
-			const LineDef& lineDef = level.lineDefs[wall.lineDefId];
+	const MeshVertex startBottom{ { start, bottomZ }, glm::vec2{ 0.0f, pegZ - bottomZ } * texelSize, color, light };
+	const MeshVertex startTop{ { start, topZ }, glm::vec2{ 0.0f, pegZ - topZ } * texelSize, color, light };
+	const MeshVertex endBottom{ { end, bottomZ }, glm::vec2{ length, pegZ - bottomZ } * texelSize, color, light };
+	const MeshVertex endTop{ { end, topZ }, glm::vec2{ length, pegZ - topZ } * texelSize, color, light };
 
-			const bool wallFollowsLine = wallId == lineDef.frontWallId;
-			const uint32_t startVertexId = wallFollowsLine ? lineDef.startVertexId : lineDef.endVertexId;
-			glm::vec2 startVertex = level.vertices[startVertexId];
-			sectorVerts.push_back(startVertex);
-
-			// If we reach the end of the edge loop, mark the end vertex of the edge to be the start index
-			// for this loop. Otherwise, mark it as the next vertex we are going to add. 
-			size_t edgeEndVertexIndex = wall.endOfLoop ? loopStartVertexIndex : i + 1;
-			sectorEdges.push_back(std::make_pair(i, edgeEndVertexIndex));
-			
-			// If we have reached the end of this edge loop, set the indices for the start of the
-			// next one. 
-			if (wall.endOfLoop) {
-				loopStartWallIndex = sector.firstWallId + i + 1;
-				loopStartVertexIndex = i + 1;
-			}
-		}
+	std::vector<MeshVertex>& mesh = _meshBuckets[bucketId];
+
+	mesh.push_back(startBottom);
+	mesh.push_back(startTop);
+	mesh.push_back(endTop);
+
+	mesh.push_back(startBottom);
+	mesh.push_back(endTop);
+	mesh.push_back(endBottom);
+
+	return 6;
+}
+
+/**
+ * Adds the flats (Floor, Ceilings) to the render mesh.
+ *
+ * \param level		The level we are rendering
+ * \param viewPoint	The camera position in level space
+ * \param mesh		The mesh vector to add to
+ * \return			The number of vertices added to the mesh
+ */
+int Renderer::buildFlatMesh(const Level& level, glm::vec2 viewPoint, std::vector<FlatVertex>& mesh)
+{
+	// Levels with a BSP already have every sector split into convex subsectors, so they can be
+	// fanned directly without triangulating, and added nearest first to help early depth rejection.
+	if (!level.bsp.empty())
+		return buildSubsectorFlatMesh(level, viewPoint, mesh);
+
+	int vertexCount = 0;
+
+	std::vector<glm::vec2> triangles;
 
-		triangulation.insertVertices(
-			sectorVerts.begin(),
-			sectorVerts.end(),
-			[](const glm::vec2& v) { return v.x; },
-			[](const glm::vec2& v) { return v.y; }
-		);
+	for (uint32_t sectorId = 0; sectorId < level.sectors.size(); sectorId++) {
+		if (!isSectorVisible(sectorId))
+			continue;
 
-		triangulation.insertEdges(
-			sectorEdges.begin(),
-			sectorEdges.end(),
-			[](const std::pair<size_t, size_t>& e) { return e.first; },
-			[](const std::pair<size_t, size_t>& e) { return e.second; }
-		);
+		const Sector& sector = level.sectors[sectorId];
 
-		triangulation.eraseOuterTrianglesAndHoles();
+		triangles.clear();
+		triangulateSector(level, sector, triangles);
 
 		// Since sector ceilings and floors are the same 2D-shape, we can triangulate once and then
 		// build both the floor and ceiling from the same triangulation
-		CDT::TriangleVec tris = triangulation.triangles;
-		auto verts = triangulation.vertices;
-		for (CDT::Triangle& tri : tris)
-		{
-			auto v1 = verts[tri.vertices[0]];
-			auto v2 = verts[tri.vertices[1]];
-			auto v3 = verts[tri.vertices[2]];
-
-			// Add the floor triangles
-			mesh.push_back(glm::vec3{ v1.x, v1.y, sector.floorZ });
-			mesh.push_back(sector.floorColor);
-			mesh.push_back(glm::vec3{ v2.x, v2.y, sector.floorZ });
-			mesh.push_back(sector.floorColor);
-			mesh.push_back(glm::vec3{ v3.x, v3.y, sector.floorZ });
-			mesh.push_back(sector.floorColor);
-
-			// Add the ceiling triangles. These have to have the opposite winding from the floor.
-			mesh.push_back(glm::vec3{ v3.x, v3.y, sector.ceilingZ });
-			mesh.push_back(sector.ceilingColor);
-			mesh.push_back(glm::vec3{ v2.x, v2.y, sector.ceilingZ });
-			mesh.push_back(sector.ceilingColor);
-			mesh.push_back(glm::vec3{ v1.x, v1.y, sector.ceilingZ });
-			mesh.push_back(sector.ceilingColor);
-
-			vertexCount += 6;
-		}
+		const SectorAppearance& appearance = level.sectorAppearances[sectorId];
+		for (size_t i = 0; i < triangles.size(); i += 3)
+			vertexCount += addFlatTriangle(sector, appearance, triangles[i], triangles[i + 1], triangles[i + 2], mesh);
 	}
 
 	return vertexCount;
 }
 
-int Renderer::buildMesh(const Level& level, std::vector<glm::vec3>& mesh)
+/**
+ * Adds the flats to the render mesh using the convex polygons of the level's subsectors, 
+ * visiting the subsectors front to back from the view point.
+ */
+int Renderer::buildSubsectorFlatMesh(const Level& level, glm::vec2 viewPoint, std::vector<FlatVertex>& mesh)
+{
+	const BspTree& bsp = level.bsp;
+	int vertexCount = 0;
+
+	bsp.traverseFrontToBack(viewPoint, [&](uint32_t subsectorId) {
+		const BspTree::Subsector& subsector = bsp.subsectors[subsectorId];
+		if (!isSectorVisible(subsector.sectorId))
+			return;
+
+		const Sector& sector = level.sectors[subsector.sectorId];
+		const SectorAppearance& appearance = level.sectorAppearances[subsector.sectorId];
+		const glm::vec2* polygon = &bsp.polygonVertices[subsector.firstPolygonVertexId];
+
+		// Subsectors are convex, so a triangle fan covers them. 
+		for (uint32_t i = 2; i < subsector.polygonVertexCount; i++)
+			vertexCount += addFlatTriangle(sector, appearance, polygon[0], polygon[i - 1], polygon[i], mesh);
+	});
+
+	return vertexCount;
+}
+
+/**
+ * Adds one counter-clockwise triangle of a sector's shape to the mesh, as both a floor and a
+ * ceiling triangle.
+ *
+ * \return The number of vertices added to the mesh
+ */
+int Renderer::addFlatTriangle(const Sector& sector, const SectorAppearance& appearance, glm::vec2 v1, glm::vec2 v2, glm::vec2 v3, std::vector<FlatVertex>& mesh) const
+{
+	// Textured flats are drawn as they are, and the others with their sector's colors. 
+	const FlatLayer floor = findFlatLayer(appearance.floorFlatId);
+	const FlatLayer ceiling = findFlatLayer(appearance.ceilingFlatId);
+
+	const glm::vec3 floorColor = floor.frameCount > 0 ? glm::vec3{ 1.0f } : appearance.floorColor;
+	const glm::vec3 ceilingColor = ceiling.frameCount > 0 ? glm::vec3{ 1.0f } : appearance.ceilingColor;
+	const float light = appearance.lightLevel;
+
+	// Add the floor triangles
+	mesh.push_back(FlatVertex{ { v1, sector.floorZ }, floorColor, floor, light });
+	mesh.push_back(FlatVertex{ { v2, sector.floorZ }, floorColor, floor, light });
+	mesh.push_back(FlatVertex{ { v3, sector.floorZ }, floorColor, floor, light });
+
+	// Add the ceiling triangles. These have to have the opposite winding from the floor.
+	mesh.push_back(FlatVertex{ { v3, sector.ceilingZ }, ceilingColor, ceiling, light });
+	mesh.push_back(FlatVertex{ { v2, sector.ceilingZ }, ceilingColor, ceiling, light });
+	mesh.push_back(FlatVertex{ { v1, sector.ceilingZ }, ceilingColor, ceiling, light });
+
+	return 6;
+}
+
+/**
+ * Finds the sectors that can be seen from the camera using the level's PVS. This happens before
+ * any other culling, so the mesh builders can skip everything else with one bit test per sector.
+ */
+void Renderer::findVisibleSectors(const Level& level, glm::vec2 viewPoint)
+{
+	_cullWithPvs = !level.pvs.empty() && !level.bsp.empty() && level.pvs.sectorCount == level.sectors.size();
+	if (!_cullWithPvs)
+		return;
+
+	level.pvs.decompressRow(level.bsp.findSector(viewPoint), _visibleSectors);
+}
+
+/**
+ * Finds where the sprites of each visible sector are, along with the sector's floor height and
+ * light, which is all the CPU does for sprites each frame. The sprites themselves are never 
+ * touched, however many there are. 
+ */
+void Renderer::buildSpriteSectors(const Level& level)
+{
+	_spriteSectors.clear();
+	_visibleSpriteCount = 0;
+
+	if (_sectorSpriteOffsets.size() != level.sectors.size() + 1)
+		return;
+
+	for (uint32_t sectorId : _spriteSectorIds) {
+		if (!isSectorVisible(sectorId))
+			continue;
+
+		const uint32_t firstInstance = _sectorSpriteOffsets[sectorId];
+		_spriteSectors.push_back(SpriteSector{
+			_visibleSpriteCount,
+			firstInstance,
+			level.sectors[sectorId].floorZ,
+			level.sectorAppearances[sectorId].lightLevel
+		});
+
+		_visibleSpriteCount += _sectorSpriteOffsets[sectorId + 1] - firstInstance;
+	}
+}
+
+void Renderer::buildMesh(const Level& level, glm::vec2 viewPoint)
 {
 	meshTimer.start();
 
-	int vertexCount = buildWallMesh(level, mesh);
-	vertexCount += buildFlatMesh(level, mesh);
+	findVisibleSectors(level, viewPoint);
+
+	_meshBuckets.resize(_levelTextures.size() + 1);
+	for (std::vector<MeshVertex>& bucket : _meshBuckets)
+		bucket.clear();
+
+	_flatMesh.clear();
 
+	buildWallMesh(level);
+	buildFlatMesh(level, viewPoint, _flatMesh);
+	buildSpriteSectors(level);
+
+	// Meshing has found which textures are visible, so the ones that are missing can be uploaded
+	// before they're bound. 
 	meshTimer.stop();
+	textureTimer.start();
+	updateTextureResidency();
+	textureTimer.stop();
+	meshTimer.start();
 
-	return vertexCount;
+	_mesh.clear();
+	_drawBatches.clear();
+
+	for (size_t bucketId = 0; bucketId < _meshBuckets.size(); bucketId++) {
+		const std::vector<MeshVertex>& bucket = _meshBuckets[bucketId];
+		if (bucket.empty())
+			continue;
+
+		unsigned int textureId = _whiteTextureId;
+		if (bucketId != 0)
+			textureId = _textureResidency.isResident(bucketId - 1) ? _levelTextures[bucketId - 1].id : _placeholderTextureId;
+
+		_drawBatches.push_back(DrawBatch{ textureId, static_cast<int>(_mesh.size()), static_cast<int>(bucket.size()) });
+		_mesh.insert(_mesh.end(), bucket.begin(), bucket.end());
+	}
+
+	meshTimer.stop();
 }
@@ -2,8 +2,13 @@
 #define RENDERER_HPP
 
 #include <Resource/MapLoader.hpp>
+#include <Resource/TextureComposer.hpp>
+#include <Resource/FlatSet.hpp>
+#include <Resource/SpriteSet.hpp>
 #include "OpenGL.hpp"
 #include "Shader.hpp"
+#include "TextureStreamer.hpp"
+#include "TextureResidency.hpp"
 #include <Utility/Timer.hpp>
 
 extern struct Level;
@@ -15,29 +20,266 @@ class Renderer
 {
 public:
 
+	// Scale from level units to render units. The camera is given in render units.
+	static constexpr float WORLD_SCALE = 1.0f / 8.0f;
+
 	Renderer();
 	~Renderer();
 
 	void beginFrame(int width, int height);
 
+	/**
+	 * @brief Switches to drawing with palette indices, which are shaded through COLORMAP in the 
+	 *			shaders by the sector's light level and the distance, the way Doom does it.
+	 * 
+	 * @details Textures are then kept as one byte palette indices instead of RGBA, so this has to
+	 *			be called before the level's textures and flats are set. 
+	 */
+	void enableIndexedColor(const Palette& palette, const ColorMap& colorMap);
+
+	/**
+	 * @brief Sets the textures a level uses, replacing any from a previous level.
+	 * 
+	 * @details The textures must be in the same order as the level's texture names, since walls
+	 *			refer to them by their index. Textures are only uploaded once a visible wall uses
+	 *			them, and are evicted, least recently used first, when they go over the texture
+	 *			budget. The first frame uploads every texture it sees, so the level doesn't start
+	 *			out with placeholders. After that, uploads are limited to a time budget per frame.
+	 *
+	 *			Textures that weren't composed are loaded from Textures/<name>.png instead, if there
+	 *			is one. Those are streamed in the background, and drawn with a placeholder until
+	 *			they arrive. 
+	 */
+	void setLevelTextures(std::vector<ComposedTexture> textures, const Palette& palette);
+
+	/** @brief Sets how much GPU memory the level's wall textures can take up */
+	void setTextureBudget(uint64_t bytes);
+
+	/**
+	 * @brief Uploads every flat into one texture array, replacing any from a previous level.
+	 * 
+	 * @details The level's flat names are looked up once here, so meshing only has to index a
+	 *			table to find each sector's layer, and all flats are drawn in a single batch.
+	 *			Flats that aren't in the set are streamed from Flats/<name>.png into extra layers.
+	 */
+	void setLevelFlats(const FlatSet& flats, const Palette& palette, const std::vector<std::string>& flatNames);
+
+	/**
+	 * @brief Uploads the sprite atlas and the level's things, replacing any from a previous level.
+	 * 
+	 * @details The level's things must already be bucketed by sector. Each sprite frame the
+	 *			things use gets a table of the frames for its eight rotations, and the things that
+	 *			are in single player on medium skill and have a sprite are kept in a buffer, in
+	 *			sector order. Each frame then only uploads where the visible sectors' things are,
+	 *			and every sprite is drawn with one instanced draw call. The vertex shader picks
+	 *			each one's rotation from which way it faces and where the camera is, and builds
+	 *			its quad. 
+	 */
+	void setLevelSprites(const SpriteSet& sprites, const Palette& palette, const Level& level);
+
+	/** @brief Moves animated flats along. Only a uniform changes, nothing is re-uploaded */
+	void advanceAnimations(float deltaTime);
+
 	void renderLevel(const Level& level, glm::vec3 camPos, float angle, float yaw);
 
 	void endFrame();
 
 	Timer meshTimer;
 	Timer glTimer;
+	Timer textureTimer;
+
+	const TextureResidency::Stats& textureStats() const { return _textureResidency.stats(); }
+	uint32_t streamingTextureCount() const { return _textureStreamer.pendingCount(); }
+	uint32_t visibleSpriteCount() const { return _visibleSpriteCount; }
 
 private:
 
-	int buildMesh(const Level& level, std::vector<glm::vec3>& mesh);
-	int buildWallMesh(const Level& level, std::vector<glm::vec3>& mesh);
-	int buildFlatMesh(const Level& level, std::vector<glm::vec3>& mesh);
+	// Streamed textures are drawn as this gray, at this size, until they arrive
+	static constexpr uint32_t PLACEHOLDER_COLOR = 0xFF808080;
+	static constexpr uint32_t PLACEHOLDER_SIZE = 64;
+
+	// How long each frame can spend uploading textures, and how much memory they can take up
+	static constexpr float TEXTURE_UPLOAD_BUDGET_MS = 2.0f;
+	static constexpr uint64_t DEFAULT_TEXTURE_BUDGET = 256ull * 1024 * 1024;
+
+	// Sectors that can be seen from the camera's sector. Only used when the level has a PVS, and
+	// a BSP to find the camera's sector with. 
+	PotentiallyVisibleSet::SectorSet _visibleSectors;
+	bool _cullWithPvs = false;
+
+	struct MeshVertex
+	{
+		glm::vec3	position;
+		glm::vec2	uv;
+		glm::vec3	color;
+		float		light;
+	};
+
+	enum class TextureSource
+	{
+		None,		// Drawn with the wall's color
+		Composed,	// Uploaded from the composed image
+		Png,		// Streamed from a file
+	};
+
+	struct LevelTexture
+	{
+		unsigned int	id		= 0;	// 0 when the texture isn't in GPU memory
+		uint32_t		width	= 0;
+		uint32_t		height	= 0;
+
+		TextureSource	source	= TextureSource::None;
+		std::string		fileName;
+		bool			loading	= false;
+	};
+
+	// The layer of the flat array a flat is drawn from, and the animation it's part of. Flats that 
+	// are missing have a frame count of 0, and are drawn with their sector's color instead. 
+	struct FlatLayer
+	{
+		uint32_t	layer		= 0;
+		uint32_t	firstLayer	= 0;
+		uint32_t	frameCount	= 0;
+	};
+
+	struct FlatVertex
+	{
+		glm::vec3	position;
+		glm::vec3	color;
+		FlatLayer	flat;
+		float		light;
+	};
+
+	// A thing as the sprite vertex shader reads it. It's on the floor of its sector plus its
+	// height, so it follows moving floors. 
+	struct SpriteInstance
+	{
+		glm::vec3	position;
+		uint16_t	angle;			// Which way it faces, as a binary angle where 65536 is a full turn
+		uint16_t	rotationsId;	// Which table of rotations it's drawn with
+	};
+
+	// Rotation tables hold the frame for each of a sprite frame's eight rotations, starting from
+	// its front, with the lowest bit set for frames that are drawn mirrored. 
+	static constexpr uint32_t SPRITE_ROTATION_COUNT = 8;
+	static constexpr uint32_t MAX_SPRITE_ROTATION_TABLES = 65536;
+
+	// Where a visible sector's sprites are. The instance drawn is found by searching these for
+	// the last sector whose sprites start at or before it. 
+	struct SpriteSector
+	{
+		uint32_t	firstDrawn;		// Among the instances drawn this frame
+		uint32_t	firstInstance;	// Among every instance
+		float		floorZ;
+		float		light;
+	};
+
+	// A run of the mesh that is drawn with one texture
+	struct DrawBatch
+	{
+		unsigned int	textureId;
+		int				firstVertex;
+		int				vertexCount;
+	};
+
+	// Textures of the current level, indexed by the level's texture ids. Textures that couldn't be
+	// composed or loaded have no source, and the walls using them are drawn with their color
+	// instead. Composed images are kept so they can be uploaded again after they're evicted. 
+	std::vector<LevelTexture> _levelTextures;
+	std::vector<IndexedImage> _textureImages;
+	Palette _texturePalette;
+	unsigned int _whiteTextureId = 0;
+	unsigned int _placeholderTextureId = 0;
+
+	TextureResidency _textureResidency;
+	bool _uploadAllMisses = false;
+
+	// The mesh is built into one bucket per texture, with the untextured bucket first, and then
+	// the buckets are joined so each texture only needs one draw call. These are kept between
+	// frames so their memory is reused.
+	std::vector<std::vector<MeshVertex>> _meshBuckets;
+	std::vector<MeshVertex> _mesh;
+	std::vector<DrawBatch> _drawBatches;
+
+	// Flats are all in one texture array, so they're kept in their own mesh that's drawn at once.
+	// Flat layers are indexed by the level's flat ids. 
+	std::vector<FlatLayer> _flatLayers;
+	std::vector<FlatVertex> _flatMesh;
+	unsigned int _flatTextureArrayId = 0;
+
+	// Sprites are drawn from a texture array with a page of the sprite atlas in each layer. Their
+	// frames, rotation tables and things are in buffer textures, and the things in sector i are
+	// the instances in [_sectorSpriteOffsets[i], _sectorSpriteOffsets[i + 1]). Only sectors with
+	// sprites are checked each frame. 
+	std::vector<uint32_t> _sectorSpriteOffsets;
+	std::vector<uint32_t> _spriteSectorIds;
+	std::vector<SpriteSector> _spriteSectors;
+	uint32_t _visibleSpriteCount = 0;
+	unsigned int _spriteTextureArrayId = 0;
+	unsigned int _spriteFrameBufferId = 0;
+	unsigned int _spriteFrameTextureId = 0;
+	unsigned int _spriteRotationBufferId = 0;
+	unsigned int _spriteRotationTextureId = 0;
+	unsigned int _spriteInstanceBufferId = 0;
+	unsigned int _spriteInstanceTextureId = 0;
+	unsigned int _spriteSectorBufferId = 0;
+	unsigned int _spriteSectorTextureId = 0;
+
+	// Time since the level started, which animations are played from
+	float _animationTime = 0.0f;
+
+	// With indexed color, textures hold palette indices and these lookup textures turn them into
+	// colors. Untextured surfaces are drawn with the palette's closest color to white. 
+	bool _indexedColor = false;
+	unsigned int _paletteTextureId = 0;
+	unsigned int _colorMapTextureId = 0;
+	uint8_t _whiteIndex = 0;
+
+	TextureStreamer _textureStreamer;
+
+	void deleteLevelTextures();
+	void deleteLevelSprites();
+
+	void findTextureFile(uint32_t textureId, const std::string& name);
+
+	void updateTextureResidency();
+	void uploadLevelTexture(uint32_t textureId);
+	void requestTextureFile(uint32_t textureId);
+	void evictLevelTexture(uint32_t textureId);
+	void onTextureArrived(const TextureStreamer::Request& request, uint32_t width, uint32_t height);
+
+	static uint64_t rgbaTextureSize(uint32_t width, uint32_t height);
+
+	void findVisibleSectors(const Level& level, glm::vec2 viewPoint);
+	bool isSectorVisible(uint32_t sectorId) const { return !_cullWithPvs || _visibleSectors.contains(sectorId); }
+
+	void buildMesh(const Level& level, glm::vec2 viewPoint);
+	void buildSpriteSectors(const Level& level);
+	int buildWallMesh(const Level& level);
+	int buildFlatMesh(const Level& level, glm::vec2 viewPoint, std::vector<FlatVertex>& mesh);
+	int buildSubsectorFlatMesh(const Level& level, glm::vec2 viewPoint, std::vector<FlatVertex>& mesh);
+
+	int addWallQuad(glm::vec2 start, glm::vec2 end, float bottomZ, float topZ, float pegZ, uint32_t textureId, glm::vec3 color, float light);
+
+	int addFlatTriangle(const Sector& sector, const SectorAppearance& appearance, glm::vec2 v1, glm::vec2 v2, glm::vec2 v3, std::vector<FlatVertex>& mesh) const;
+
+	void setIndexedColorUniforms(ShaderProgram& program);
+
+	FlatLayer findFlatLayer(uint32_t flatId) const { return flatId < _flatLayers.size() ? _flatLayers[flatId] : FlatLayer{}; }
 
 	ShaderProgram shader;
+	ShaderProgram flatShader;
+	ShaderProgram spriteShader;
 
 	unsigned int _vertexBufferId	= 0;
 	unsigned int _vertexArrayId		= 0;
 
+	unsigned int _flatVertexBufferId	= 0;
+	unsigned int _flatVertexArrayId		= 0;
+
+	// Sprites have no vertex attributes, but core profile still needs a vertex array to draw with
+	unsigned int _spriteVertexArrayId	= 0;
+
 	int _width, _height;
 };
 
@@ -0,0 +1,118 @@
+#include "TextureResidency.hpp"
+
+void TextureResidency::reset(uint32_t textureCount)
+{
+	entries.assign(textureCount, Entry{});
+	_misses.clear();
+
+	mostRecent = NONE;
+	leastRecent = NONE;
+
+	const uint64_t budgetBytes = _stats.budgetBytes;
+	_stats = Stats{};
+	_stats.budgetBytes = budgetBytes;
+}
+
+void TextureResidency::beginFrame()
+{
+	frame++;
+	_misses.clear();
+
+	_stats.missCount = 0;
+	_stats.evictionCount = 0;
+}
+
+bool TextureResidency::use(uint32_t textureId)
+{
+	Entry& entry = entries[textureId];
+
+	// Textures are used once for every wall they're on, so only the first use in a frame counts.
+	if (entry.lastUsedFrame == frame)
+		return entry.resident;
+
+	entry.lastUsedFrame = frame;
+
+	if (entry.resident) {
+		unlink(textureId);
+		link(textureId);
+		return true;
+	}
+
+	_misses.push_back(textureId);
+	_stats.missCount++;
+	_stats.totalMissCount++;
+	return false;
+}
+
+void TextureResidency::markResident(uint32_t textureId, uint64_t bytes)
+{
+	Entry& entry = entries[textureId];
+	if (entry.resident)
+		return;
+
+	entry.resident = true;
+	entry.bytes = bytes;
+	link(textureId);
+
+	_stats.residentCount++;
+	_stats.residentBytes += bytes;
+}
+
+void TextureResidency::markEvicted(uint32_t textureId)
+{
+	Entry& entry = entries[textureId];
+	if (!entry.resident)
+		return;
+
+	unlink(textureId);
+	entry.resident = false;
+
+	_stats.residentCount--;
+	_stats.residentBytes -= entry.bytes;
+	_stats.evictionCount++;
+	_stats.totalEvictionCount++;
+}
+
+std::optional<uint32_t> TextureResidency::findEviction() const
+{
+	if (!isOverBudget() || leastRecent == NONE)
+		return std::nullopt;
+
+	// Everything more recent than this was used this frame too.
+	if (entries[leastRecent].lastUsedFrame == frame)
+		return std::nullopt;
+
+	return leastRecent;
+}
+
+void TextureResidency::link(uint32_t textureId)
+{
+	Entry& entry = entries[textureId];
+	entry.moreRecent = NONE;
+	entry.lessRecent = mostRecent;
+
+	if (mostRecent != NONE)
+		entries[mostRecent].moreRecent = textureId;
+	else
+		leastRecent = textureId;
+
+	mostRecent = textureId;
+}
+
+void TextureResidency::unlink(uint32_t textureId)
+{
+	Entry& entry = entries[textureId];
+
+	if (entry.moreRecent != NONE)
+		entries[entry.moreRecent].lessRecent = entry.lessRecent;
+	else
+		mostRecent = entry.lessRecent;
+
+	if (entry.lessRecent != NONE)
+		entries[entry.lessRecent].moreRecent = entry.moreRecent;
+	else
+		leastRecent = entry.moreRecent;
+
+	entry.moreRecent = NONE;
+	entry.lessRecent = NONE;
+}
@@ -0,0 +1,102 @@
+#ifndef TEXTURE_RESIDENCY_HPP_INCLUDED
+#define TEXTURE_RESIDENCY_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Keeps track of which of a level's textures are in GPU memory, and which to evict when
+ *			they go over a memory budget.
+ *
+ * @details This only does the bookkeeping. The renderer tells it which textures each frame uses,
+ *			then uploads the ones it reports as missing and deletes the ones it picks to evict.
+ *
+ *			Resident textures are kept in a list ordered by when they were last used, so marking
+ *			a texture as used and finding the least recently used one are both constant time.
+ *			Textures used in the current frame are never evicted, so a view that needs more than
+ *			the budget stays over it rather than thrashing.
+ */
+class TextureResidency
+{
+public:
+	struct Stats
+	{
+		uint32_t	residentCount	= 0;
+		uint64_t	residentBytes	= 0;
+		uint64_t	budgetBytes		= 0;
+
+		// Counted for the current frame. Misses are textures that were needed but not resident.
+		uint32_t	missCount		= 0;
+		uint32_t	evictionCount	= 0;
+
+		uint64_t	totalMissCount		= 0;
+		uint64_t	totalEvictionCount	= 0;
+	};
+
+	/** @brief Forgets every texture, and starts tracking a new set that are all not resident */
+	void reset(uint32_t textureCount);
+
+	void setBudget(uint64_t bytes) { _stats.budgetBytes = bytes; }
+
+	/** @brief Starts a new frame, which clears the frame's misses */
+	void beginFrame();
+
+	/**
+	 * @brief Marks a texture as used this frame.
+	 * 
+	 * @return True if it's resident. If it isn't, it's added to this frame's misses the first time.
+	 */
+	bool use(uint32_t textureId);
+
+	/** @brief The textures that were used this frame but weren't resident, in the order they were used */
+	const std::vector<uint32_t>& misses() const { return _misses; }
+
+	bool isResident(uint32_t textureId) const { return entries[textureId].resident; }
+
+	void markResident(uint32_t textureId, uint64_t bytes);
+	void markEvicted(uint32_t textureId);
+
+	bool isOverBudget() const { return _stats.residentBytes > _stats.budgetBytes; }
+
+	/**
+	 * @brief Picks the next texture to evict to get back under budget.
+	 * 
+	 * @return	The least recently used resident texture, or nothing if the textures are within
+	 *			the budget or every resident texture has been used this frame.
+	 */
+	std::optional<uint32_t> findEviction() const;
+
+	const Stats& stats() const { return _stats; }
+
+private:
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	struct Entry
+	{
+		uint64_t	bytes			= 0;
+		uint32_t	lastUsedFrame	= 0;
+		bool		resident		= false;
+
+		// Neighbours in the list of resident textures
+		uint32_t	moreRecent		= NONE;
+		uint32_t	lessRecent		= NONE;
+	};
+
+	std::vector<Entry>		entries;
+	std::vector<uint32_t>	_misses;
+
+	// The ends of the list of resident textures
+	uint32_t				mostRecent	= NONE;
+	uint32_t				leastRecent	= NONE;
+
+	// Frames start at 1, so no texture counts as used before the first one
+	uint32_t				frame		= 1;
+
+	Stats					_stats;
+
+	void link(uint32_t textureId);
+	void unlink(uint32_t textureId);
+};
+
+#endif//TEXTURE_RESIDENCY_HPP_INCLUDED
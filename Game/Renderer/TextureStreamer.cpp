@@ -0,0 +1,215 @@
+#include "TextureStreamer.hpp"
+
+#include "OpenGL.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Resource/PngDecoder.hpp>
+
+TextureStreamer::TextureStreamer(uint32_t threadCount)
+{
+	glGenBuffers(PIXEL_BUFFER_COUNT, pixelBufferIds.data());
+	checkGl();
+
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+
+	for (uint32_t i = 0; i < threadCount; i++)
+		workers.emplace_back([this](std::stop_token stopToken) { workerLoop(stopToken); });
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// The workers have to be stopped before the queues they use go away. 
+	for (std::jthread& worker : workers)
+		worker.request_stop();
+	workers.clear();
+
+	glDeleteBuffers(PIXEL_BUFFER_COUNT, pixelBufferIds.data());
+	checkGl();
+}
+
+void TextureStreamer::request(Request request)
+{
+	{
+		std::lock_guard lock(mutex);
+		queue.push_back(Job{ std::move(request), nextSequence++ });
+	}
+
+	_pendingCount++;
+	workAvailable.notify_one();
+}
+
+void TextureStreamer::cancel(unsigned int textureId)
+{
+	std::lock_guard lock(mutex);
+
+	textureCancelledBefore[textureId] = nextSequence;
+
+	const size_t queued = std::erase_if(queue, [&](const Job& job) { return job.request.textureId == textureId; });
+	const size_t finished = std::erase_if(decoded, [&](const DecodedImage& image) { return image.job.request.textureId == textureId; });
+	_pendingCount -= static_cast<uint32_t>(queued + finished);
+}
+
+void TextureStreamer::cancelAll()
+{
+	std::lock_guard lock(mutex);
+
+	// Everything's cancelled now, so the per texture cancels are no longer needed. 
+	cancelledBefore = nextSequence;
+	textureCancelledBefore.clear();
+
+	_pendingCount -= static_cast<uint32_t>(queue.size() + decoded.size());
+	queue.clear();
+	decoded.clear();
+}
+
+bool TextureStreamer::isCancelled(const Job& job) const
+{
+	if (job.sequence < cancelledBefore)
+		return true;
+
+	auto it = textureCancelledBefore.find(job.request.textureId);
+	return it != textureCancelledBefore.end() && job.sequence < it->second;
+}
+
+void TextureStreamer::upload(float budgetMilliseconds, const ArrivalCallback& onArrival)
+{
+	using Clock = std::chrono::steady_clock;
+
+	const Clock::time_point start = Clock::now();
+	const auto budget = std::chrono::duration<float, std::milli>(budgetMilliseconds);
+
+	do {
+		DecodedImage image;
+		{
+			std::lock_guard lock(mutex);
+			if (decoded.empty())
+				return;
+
+			image = std::move(decoded.front());
+			decoded.pop_front();
+		}
+
+		_pendingCount--;
+
+		// Images that failed to decode or upload arrive with no size, so they can fall back.
+		if (image.mipLevels.empty() || !uploadImage(image)) {
+			onArrival(image.job.request, 0, 0);
+			continue;
+		}
+
+		onArrival(image.job.request, image.mipLevels[0].width, image.mipLevels[0].height);
+	} while (Clock::now() - start < budget);
+}
+
+void TextureStreamer::workerLoop(std::stop_token stopToken)
+{
+	while (true) {
+		Job job;
+		{
+			std::unique_lock lock(mutex);
+			if (!workAvailable.wait(lock, stopToken, [this] { return !queue.empty(); }))
+				return;
+
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		std::vector<RgbaImage> mipLevels = loadImage(job.request);
+
+		// The texture may have been cancelled while its image was being decoded.
+		std::lock_guard lock(mutex);
+		if (isCancelled(job))
+			_pendingCount--;
+		else
+			decoded.push_back(DecodedImage{ std::move(job), std::move(mipLevels) });
+	}
+}
+
+std::vector<RgbaImage> TextureStreamer::loadImage(const Request& request)
+{
+	try {
+		std::ifstream file(request.fileName, std::ios::binary);
+		if (!file)
+			throw std::runtime_error("The file could not be opened");
+
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		RgbaImage image = decodePng(data.data(), data.size());
+
+		if (request.size != 0 && (image.width != request.size || image.height != request.size))
+			image = resizeNearest(image, request.size, request.size);
+
+		return buildMipChain(std::move(image));
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Could not load texture '" << request.fileName << "': " << e.what() << std::endl;
+		return {};
+	}
+}
+
+bool TextureStreamer::uploadImage(const DecodedImage& image)
+{
+	size_t totalSize = 0;
+	for (const RgbaImage& level : image.mipLevels)
+		totalSize += level.pixels.size() * sizeof(uint32_t);
+
+	// The buffers are used round robin and orphaned before each write, so writing one never waits
+	// on the GPU to finish reading what was last uploaded from it. 
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBufferIds[nextPixelBuffer]);
+	nextPixelBuffer = (nextPixelBuffer + 1) % PIXEL_BUFFER_COUNT;
+
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+	uint8_t* mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, totalSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	checkGl();
+
+	if (mapped == nullptr) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return false;
+	}
+
+	size_t offset = 0;
+	for (const RgbaImage& level : image.mipLevels) {
+		std::memcpy(mapped + offset, level.pixels.data(), level.pixels.size() * sizeof(uint32_t));
+		offset += level.pixels.size() * sizeof(uint32_t);
+	}
+
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// With a pixel buffer bound, the data pointers are offsets into it. 
+	const Request& request = image.job.request;
+	offset = 0;
+
+	if (request.layer < 0) {
+		glBindTexture(GL_TEXTURE_2D, request.textureId);
+
+		for (size_t i = 0; i < image.mipLevels.size(); i++) {
+			const RgbaImage& level = image.mipLevels[i];
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+			offset += level.pixels.size() * sizeof(uint32_t);
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mipLevels.size() - 1));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, request.textureId);
+
+		for (size_t i = 0; i < image.mipLevels.size(); i++) {
+			const RgbaImage& level = image.mipLevels[i];
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(i), 0, 0, request.layer, level.width, level.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+			offset += level.pixels.size() * sizeof(uint32_t);
+		}
+	}
+	checkGl();
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return true;
+}
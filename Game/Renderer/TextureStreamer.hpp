@@ -0,0 +1,115 @@
+#ifndef TEXTURE_STREAMER_HPP_INCLUDED
+#define TEXTURE_STREAMER_HPP_INCLUDED
+
+#include <mutex>
+#include <deque>
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <Resource/RgbaImage.hpp>
+
+/**
+ * @brief Loads PNG textures in the background and uploads them to existing GL textures.
+ *
+ * @details Files are read, decoded and mipmapped on worker threads, so asking for a texture
+ *			never blocks. The GL thread then uploads whatever has finished through a small ring
+ *			of pixel buffer objects, stopping once the frame's time budget is spent. Until then
+ *			the target texture keeps whatever placeholder the renderer gave it.
+ *
+ *			Requests can be cancelled by the texture they go into, before that texture is deleted,
+ *			or all at once. Images that are already being decoded when they're cancelled are
+ *			dropped once they finish rather than uploaded. 
+ */
+class TextureStreamer
+{
+public:
+	/** @brief An image to load, and where to put it */
+	struct Request
+	{
+		std::string		fileName;
+		unsigned int	textureId	= 0;	// The GL texture to upload into
+		int32_t			layer		= -1;	// The layer of a GL_TEXTURE_2D_ARRAY, or -1 for a GL_TEXTURE_2D
+		uint32_t		size		= 0;	// Array layers have a fixed size, which images are scaled to
+		uint32_t		tag			= 0;	// Handed back when the image arrives, for the caller's use
+	};
+
+	/** @brief Called on the GL thread once a request is finished. Failed requests have a size of 0 */
+	using ArrivalCallback = std::function<void(const Request& request, uint32_t width, uint32_t height)>;
+
+	/** @brief Starts the worker threads. A count of 0 uses half the hardware threads */
+	TextureStreamer(uint32_t threadCount = 0);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	void request(Request request);
+
+	/** @brief Drops the requests for a texture that haven't been uploaded yet */
+	void cancel(unsigned int textureId);
+
+	/** @brief Drops every request that hasn't been uploaded yet */
+	void cancelAll();
+
+	/**
+	 * @brief Uploads finished images until the time budget runs out. Must be called on the GL thread.
+	 *
+	 * @details At least one image is uploaded per call if any are ready, so streaming always
+	 *			makes progress no matter how small the budget is.
+	 */
+	void upload(float budgetMilliseconds, const ArrivalCallback& onArrival);
+
+	/** @brief The number of requests that haven't arrived yet */
+	uint32_t pendingCount() const { return _pendingCount; }
+
+private:
+	struct Job
+	{
+		Request					request;
+		uint64_t				sequence;	// Numbers requests in the order they were made
+	};
+
+	struct DecodedImage
+	{
+		Job						job;
+		std::vector<RgbaImage>	mipLevels;	// Empty if the image failed to load
+	};
+
+	static constexpr uint32_t PIXEL_BUFFER_COUNT = 3;
+
+	std::mutex						mutex;
+	std::condition_variable_any		workAvailable;
+	std::deque<Job>					queue;		// Requests waiting for a worker
+	std::deque<DecodedImage>		decoded;	// Images waiting to be uploaded
+
+	// Requests made before these sequence numbers were cancelled, either all of them or just the
+	// ones for a texture. Jobs that were being decoded at the time are checked against these.
+	uint64_t						nextSequence = 0;
+	uint64_t						cancelledBefore = 0;
+	std::unordered_map<unsigned int, uint64_t> textureCancelledBefore;
+
+	std::atomic<uint32_t>			_pendingCount = 0;
+
+	std::array<unsigned int, PIXEL_BUFFER_COUNT> pixelBufferIds = {};
+	uint32_t						nextPixelBuffer = 0;
+
+	// Declared last so the workers stop before anything they use is destroyed
+	std::vector<std::jthread>		workers;
+
+	void workerLoop(std::stop_token stopToken);
+
+	bool isCancelled(const Job& job) const;
+
+	static std::vector<RgbaImage> loadImage(const Request& request);
+
+	bool uploadImage(const DecodedImage& image);
+};
+
+#endif//TEXTURE_STREAMER_HPP_INCLUDED
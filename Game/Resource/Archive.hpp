@@ -0,0 +1,93 @@
+#ifndef ARCHIVE_HPP_INCLUDED
+#define ARCHIVE_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <Resource/Utilities.hpp>
+
+/**
+ * @brief A read-only view of a lump's data.
+ * 
+ * @details The view shares ownership of whatever holds the data, which might be a buffer read
+ *			just for this view, an archive's cache of decompressed lumps, or the archive's memory
+ *			mapping. The data stays valid for as long as the view does, even if the archive drops
+ *			it from a cache in the meantime. 
+ */
+class LumpView
+{
+public:
+	LumpView() = default;
+
+	LumpView(std::shared_ptr<const std::vector<uint8_t>> buffer)
+		: _data(buffer->data()), _size(buffer->size()), _owner(std::move(buffer))
+	{
+	}
+
+	LumpView(const uint8_t* data, size_t size, std::shared_ptr<const void> owner)
+		: _data(data), _size(size), _owner(std::move(owner))
+	{
+	}
+
+	const uint8_t* data() const { return _data; }
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+
+	const uint8_t& operator[](size_t index) const { return _data[index]; }
+
+	const uint8_t* begin() const { return _data; }
+	const uint8_t* end() const { return _data + _size; }
+
+private:
+	const uint8_t*				_data = nullptr;
+	size_t						_size = 0;
+	std::shared_ptr<const void>	_owner;
+};
+
+/**
+ * @brief Interface for archives of named lumps, such as Doom's WAD files and PK3s. 
+ * 
+ * @details Lumps are addressed by their index in the archive's directory. Names don't need to
+ *			be unique, since Doom reuses lump names for every map in a wad. Archives are read-only
+ *			once opened, so they can be shared between threads. 
+ */
+class Archive
+{
+public:
+	virtual ~Archive() = default;
+
+	/** @brief Returns the name of the file the archive was loaded from */
+	virtual const std::string& archiveName() const = 0;
+
+	/** @brief Returns the number of lumps in the archive's directory */
+	virtual uint32_t lumpCount() const = 0;
+
+	virtual uint32_t lumpSize(uint32_t index) const = 0;
+
+	/** @brief Returns the name of the lump at the specified index */
+	virtual const std::string& lumpName(uint32_t index) const = 0;
+
+	/** @brief Returns a stream for reading a lump specified by the given index */
+	virtual FileSubsetStream lumpStream(uint32_t index) const = 0;
+
+	/** 
+	 * @brief Returns the whole of a lump's data. 
+	 * 
+	 * @details Archives that can hand out their data without copying it, or that cache it, 
+	 *			override this. Otherwise the lump is read through its stream. 
+	 */
+	virtual LumpView lumpData(uint32_t index) const
+	{
+		FileSubsetStream stream = lumpStream(index);
+		BinaryStreamReader reader(stream);
+
+		auto buffer = std::make_shared<std::vector<uint8_t>>();
+		reader.readArray(*buffer, lumpSize(index));
+
+		return LumpView(std::move(buffer));
+	}
+};
+
+#endif//ARCHIVE_HPP_INCLUDED
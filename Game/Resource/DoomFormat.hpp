@@ -0,0 +1,225 @@
+#ifndef DOOM_FORMAT_HPP_INCLUDED
+#define DOOM_FORMAT_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+#include <Resource/LumpName.hpp>
+
+// Layouts of the fixed size records in Doom and Hexen format map lumps, and in the node lumps
+// that node builders write for them.
+//
+// Each layout gives the size of a record and the byte offset of every field in it. Decoders are
+// templated on the layout, so each format gets its own decode loop with the offsets folded in at
+// compile time, and the format is only checked once per lump rather than once per field.
+//
+// Fields are little endian, like everything else in a wad.
+
+/** 
+ * @brief The map formats. Hexen maps are told apart by having a BEHAVIOR lump, and UDMF maps by
+ *		  having their map in a TEXTMAP lump instead of the binary lumps. 
+ */
+enum class DoomMapFormat
+{
+	Doom,
+	Hexen,
+	Udmf
+};
+
+/** @brief Reads a field of a record */
+template<typename T>
+T readRecordField(const uint8_t* record, size_t offset)
+{
+	T value;
+	std::memcpy(&value, record + offset, sizeof(T));
+	return value;
+}
+
+/** @brief Reads an up to 8 character name from a record, as it's written */
+inline std::string readRecordName(const uint8_t* record, size_t offset)
+{
+	const char* name = reinterpret_cast<const char*>(record + offset);
+	return std::string(name, strnlen(name, 8));
+}
+
+/** @brief Reads an up to 8 character name, such as a texture name, from a record as a packed lump name */
+inline uint64_t readRecordPackedName(const uint8_t* record, size_t offset)
+{
+	return packLumpName(std::string_view(reinterpret_cast<const char*>(record + offset), 8));
+}
+
+struct DoomVertexLayout
+{
+	static constexpr uint32_t SIZE = 4;
+
+	static constexpr uint32_t X = 0;		// int16
+	static constexpr uint32_t Y = 2;		// int16
+};
+
+struct DoomSidedefLayout
+{
+	static constexpr uint32_t SIZE = 30;
+
+	static constexpr uint32_t X_OFFSET = 0;			// int16
+	static constexpr uint32_t Y_OFFSET = 2;			// int16
+	static constexpr uint32_t UPPER_TEXTURE = 4;	// char[8]
+	static constexpr uint32_t LOWER_TEXTURE = 12;	// char[8]
+	static constexpr uint32_t MIDDLE_TEXTURE = 20;	// char[8]
+	static constexpr uint32_t SECTOR = 28;			// uint16
+};
+
+struct DoomSectorLayout
+{
+	static constexpr uint32_t SIZE = 26;
+
+	static constexpr uint32_t FLOOR_Z = 0;			// int16
+	static constexpr uint32_t CEILING_Z = 2;		// int16
+	static constexpr uint32_t FLOOR_TEXTURE = 4;	// char[8]
+	static constexpr uint32_t CEILING_TEXTURE = 12;	// char[8]
+	static constexpr uint32_t LIGHT = 20;			// int16
+	static constexpr uint32_t SPECIAL = 22;			// int16
+	static constexpr uint32_t TAG = 24;				// int16
+};
+
+struct DoomLinedefLayout
+{
+	static constexpr uint32_t SIZE = 14;
+
+	static constexpr uint32_t START_VERTEX = 0;		// uint16
+	static constexpr uint32_t END_VERTEX = 2;		// uint16
+	static constexpr uint32_t FLAGS = 4;			// uint16
+	static constexpr uint32_t SPECIAL = 6;			// uint16
+	static constexpr uint32_t TAG = 8;				// uint16
+	static constexpr uint32_t FRONT_SIDEDEF = 10;	// uint16
+	static constexpr uint32_t BACK_SIDEDEF = 12;	// uint16
+};
+
+struct HexenLinedefLayout
+{
+	static constexpr uint32_t SIZE = 16;
+
+	static constexpr uint32_t START_VERTEX = 0;		// uint16
+	static constexpr uint32_t END_VERTEX = 2;		// uint16
+	static constexpr uint32_t FLAGS = 4;			// uint16
+	static constexpr uint32_t SPECIAL = 6;			// uint8
+	static constexpr uint32_t ARGS = 7;				// uint8[5]
+	static constexpr uint32_t FRONT_SIDEDEF = 12;	// uint16
+	static constexpr uint32_t BACK_SIDEDEF = 14;	// uint16
+};
+
+struct DoomThingLayout
+{
+	static constexpr uint32_t SIZE = 10;
+
+	static constexpr uint32_t X = 0;				// int16
+	static constexpr uint32_t Y = 2;				// int16
+	static constexpr uint32_t ANGLE = 4;			// int16, degrees
+	static constexpr uint32_t TYPE = 6;				// uint16
+	static constexpr uint32_t FLAGS = 8;			// uint16
+};
+
+struct HexenThingLayout
+{
+	static constexpr uint32_t SIZE = 20;
+
+	static constexpr uint32_t ID = 0;				// uint16
+	static constexpr uint32_t X = 2;				// int16
+	static constexpr uint32_t Y = 4;				// int16
+	static constexpr uint32_t Z = 6;				// int16, height above the floor
+	static constexpr uint32_t ANGLE = 8;			// int16, degrees
+	static constexpr uint32_t TYPE = 10;			// uint16
+	static constexpr uint32_t FLAGS = 12;			// uint16
+	static constexpr uint32_t SPECIAL = 14;			// uint8
+	static constexpr uint32_t ARGS = 15;			// uint8[5]
+};
+
+// DeePBSP's versions of the node lumps widen the vertex, seg and child indices to 32 bits. The
+// index fields' types are given by the layouts, so both versions share the same decoders. 
+
+struct DoomSegLayout
+{
+	using VertexIndex = uint16_t;
+
+	static constexpr uint32_t SIZE = 12;
+
+	static constexpr uint32_t START_VERTEX = 0;		// VertexIndex
+	static constexpr uint32_t END_VERTEX = 2;		// VertexIndex
+	static constexpr uint32_t ANGLE = 4;			// int16
+	static constexpr uint32_t LINEDEF = 6;			// uint16
+	static constexpr uint32_t DIRECTION = 8;		// uint16
+	static constexpr uint32_t OFFSET = 10;			// int16
+};
+
+struct DeePBspSegLayout
+{
+	using VertexIndex = uint32_t;
+
+	static constexpr uint32_t SIZE = 16;
+
+	static constexpr uint32_t START_VERTEX = 0;		// VertexIndex
+	static constexpr uint32_t END_VERTEX = 4;		// VertexIndex
+	static constexpr uint32_t ANGLE = 8;			// int16
+	static constexpr uint32_t LINEDEF = 10;			// uint16
+	static constexpr uint32_t DIRECTION = 12;		// uint16
+	static constexpr uint32_t OFFSET = 14;			// int16
+};
+
+struct DoomSubsectorLayout
+{
+	using SegIndex = uint16_t;
+
+	static constexpr uint32_t SIZE = 4;
+
+	static constexpr uint32_t SEG_COUNT = 0;		// uint16
+	static constexpr uint32_t FIRST_SEG = 2;		// SegIndex
+};
+
+struct DeePBspSubsectorLayout
+{
+	using SegIndex = uint32_t;
+
+	static constexpr uint32_t SIZE = 6;
+
+	static constexpr uint32_t SEG_COUNT = 0;		// uint16
+	static constexpr uint32_t FIRST_SEG = 2;		// SegIndex
+};
+
+struct DoomNodeLayout
+{
+	using ChildIndex = uint16_t;
+
+	// Children with this bit set are subsectors
+	static constexpr ChildIndex SUBSECTOR_BIT = 0x8000;
+
+	static constexpr uint32_t HEADER_SIZE = 0;
+	static constexpr uint32_t SIZE = 28;
+
+	static constexpr uint32_t X = 0;				// int16
+	static constexpr uint32_t Y = 2;				// int16
+	static constexpr uint32_t DX = 4;				// int16
+	static constexpr uint32_t DY = 6;				// int16
+	static constexpr uint32_t BOUNDS = 8;			// int16[2][4], right then left, as top, bottom, left, right
+	static constexpr uint32_t CHILDREN = 24;		// ChildIndex[2], right then left
+};
+
+struct DeePBspNodeLayout
+{
+	using ChildIndex = uint32_t;
+
+	static constexpr ChildIndex SUBSECTOR_BIT = 0x80000000;
+
+	// The lump starts with the "xNd4" signature, padded to 8 bytes
+	static constexpr uint32_t HEADER_SIZE = 8;
+	static constexpr uint32_t SIZE = 32;
+
+	static constexpr uint32_t X = 0;				// int16
+	static constexpr uint32_t Y = 2;				// int16
+	static constexpr uint32_t DX = 4;				// int16
+	static constexpr uint32_t DY = 6;				// int16
+	static constexpr uint32_t BOUNDS = 8;			// int16[2][4]
+	static constexpr uint32_t CHILDREN = 24;		// ChildIndex[2]
+};
+
+#endif//DOOM_FORMAT_HPP_INCLUDED
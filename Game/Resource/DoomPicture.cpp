@@ -0,0 +1,141 @@
+#include "DoomPicture.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <Resource/DoomFormat.hpp>
+
+namespace
+{
+	constexpr size_t PICTURE_HEADER_SIZE = 8;
+	constexpr uint8_t END_OF_COLUMN = 0xFF;
+
+	uint32_t packColor(uint8_t r, uint8_t g, uint8_t b)
+	{
+		return r | (g << 8) | (b << 16) | 0xFF000000u;
+	}
+}
+
+Palette Palette::fromPlaypal(const LumpView& lump, uint32_t paletteIndex)
+{
+	const size_t offset = static_cast<size_t>(paletteIndex) * PLAYPAL_PALETTE_SIZE;
+	if (offset + PLAYPAL_PALETTE_SIZE > lump.size())
+		throw std::runtime_error("PLAYPAL is too small for the requested palette");
+
+	Palette palette;
+	const uint8_t* rgb = lump.data() + offset;
+
+	for (uint32_t i = 0; i < COLOR_COUNT; i++)
+		palette.colors[i] = packColor(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+
+	return palette;
+}
+
+Palette Palette::grayscale()
+{
+	Palette palette;
+
+	for (uint32_t i = 0; i < COLOR_COUNT; i++)
+		palette.colors[i] = packColor(i, i, i);
+
+	return palette;
+}
+
+uint8_t Palette::brightestIndex() const
+{
+	uint32_t brightest = 0;
+	uint32_t brightestSum = 0;
+
+	for (uint32_t i = 0; i < COLOR_COUNT; i++) {
+		const uint32_t sum = (colors[i] & 0xFF) + ((colors[i] >> 8) & 0xFF) + ((colors[i] >> 16) & 0xFF);
+		if (sum > brightestSum) {
+			brightest = i;
+			brightestSum = sum;
+		}
+	}
+
+	return static_cast<uint8_t>(brightest);
+}
+
+ColorMap ColorMap::fromLump(const LumpView& lump)
+{
+	ColorMap colorMap;
+	if (lump.size() < colorMap.maps.size())
+		throw std::runtime_error("COLORMAP is too small for its light maps");
+
+	std::memcpy(colorMap.maps.data(), lump.data(), colorMap.maps.size());
+
+	return colorMap;
+}
+
+std::vector<uint32_t> IndexedImage::toRgba(const Palette& palette) const
+{
+	std::vector<uint32_t> rgba(indices.size());
+
+	for (size_t i = 0; i < indices.size(); i++)
+		rgba[i] = mask[i] ? palette.colors[indices[i]] : 0;
+
+	return rgba;
+}
+
+IndexedImage decodeDoomPicture(const LumpView& lump)
+{
+	if (lump.size() < PICTURE_HEADER_SIZE)
+		throw std::runtime_error("Picture is too small for its header");
+
+	const uint8_t* data = lump.data();
+
+	const int16_t width = readRecordField<int16_t>(data, 0);
+	const int16_t height = readRecordField<int16_t>(data, 2);
+
+	if (width <= 0 || height <= 0 || PICTURE_HEADER_SIZE + width * sizeof(uint32_t) > lump.size())
+		throw std::runtime_error("Picture has an invalid size");
+
+	IndexedImage image;
+	image.width = static_cast<uint32_t>(width);
+	image.height = static_cast<uint32_t>(height);
+	image.leftOffset = readRecordField<int16_t>(data, 4);
+	image.topOffset = readRecordField<int16_t>(data, 6);
+	image.indices.assign(static_cast<size_t>(image.width) * image.height, 0);
+	image.mask.assign(image.indices.size(), 0);
+
+	for (uint32_t x = 0; x < image.width; x++) {
+		size_t offset = readRecordField<uint32_t>(data, PICTURE_HEADER_SIZE + x * sizeof(uint32_t));
+		int32_t previousTop = -1;
+
+		while (true) {
+			if (offset >= lump.size())
+				throw std::runtime_error("Picture column runs past the end of the lump");
+
+			const uint8_t topDelta = data[offset];
+			if (topDelta == END_OF_COLUMN)
+				break;
+
+			if (offset + 4 > lump.size())
+				throw std::runtime_error("Picture column runs past the end of the lump");
+
+			// In tall patches, a post that doesn't start below the last one continues on from it.
+			int32_t top = topDelta;
+			if (static_cast<int32_t>(topDelta) <= previousTop)
+				top = previousTop + topDelta;
+			previousTop = top;
+
+			// Posts are a start, a length, a padding byte, the pixels, then another padding byte.
+			const uint32_t length = data[offset + 1];
+			const uint8_t* pixels = data + offset + 3;
+			offset += 4 + length;
+
+			if (offset > lump.size())
+				throw std::runtime_error("Picture post runs past the end of the lump");
+
+			// Posts that hang off the bottom are clipped, like Doom does.
+			for (uint32_t i = 0; i < length && top + i < image.height; i++) {
+				const size_t pixel = (top + i) * static_cast<size_t>(image.width) + x;
+				image.indices[pixel] = pixels[i];
+				image.mask[pixel] = 0xFF;
+			}
+		}
+	}
+
+	return image;
+}
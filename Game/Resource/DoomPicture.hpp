@@ -0,0 +1,85 @@
+#ifndef DOOM_PICTURE_HPP_INCLUDED
+#define DOOM_PICTURE_HPP_INCLUDED
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <Resource/Archive.hpp>
+
+/**
+ * @brief One of the palettes from PLAYPAL, as RGBA colors packed into 32 bits.
+ *
+ * @details Colors are packed with red in the lowest byte, so an array of them can be uploaded
+ *			as GL_RGBA/GL_UNSIGNED_BYTE on a little endian machine. Every color is fully opaque.
+ */
+struct Palette
+{
+	static constexpr uint32_t COLOR_COUNT = 256;
+	static constexpr uint32_t PLAYPAL_PALETTE_SIZE = COLOR_COUNT * 3;
+
+	std::array<uint32_t, COLOR_COUNT> colors;
+
+	/** @brief Reads one of the 14 palettes in a PLAYPAL lump. The first is the normal one */
+	static Palette fromPlaypal(const LumpView& lump, uint32_t paletteIndex = 0);
+
+	/** @brief A ramp from black to white, for when there's no PLAYPAL to load */
+	static Palette grayscale();
+
+	/** @brief Finds the index of the color closest to white, for drawing untextured surfaces */
+	uint8_t brightestIndex() const;
+};
+
+/**
+ * @brief The COLORMAP lump, which maps each palette index to the index it becomes under each of
+ *			Doom's light levels.
+ *
+ * @details There are 32 light maps going from fully lit to fully dark, followed by the 
+ *			invulnerability map and an all black map. Each is 256 bytes, one per palette index.
+ */
+struct ColorMap
+{
+	static constexpr uint32_t LIGHT_MAP_COUNT = 32;
+	static constexpr uint32_t MAP_COUNT = 34;
+
+	std::array<uint8_t, MAP_COUNT * Palette::COLOR_COUNT> maps;
+
+	static ColorMap fromLump(const LumpView& lump);
+};
+
+/**
+ * @brief A palette indexed image, stored row by row.
+ *
+ * @details Doom graphics can have holes in them, so each pixel also has a mask byte that is 0xFF
+ *			where the pixel is drawn and 0 where it's see-through. Keeping the mask as whole bytes
+ *			lets images be blended together 16 pixels at a time.
+ */
+struct IndexedImage
+{
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+
+	// Where the image is drawn relative to its origin. Only patches and sprites use these.
+	int32_t					leftOffset = 0;
+	int32_t					topOffset = 0;
+
+	std::vector<uint8_t>	indices;
+	std::vector<uint8_t>	mask;
+
+	bool empty() const { return width == 0 || height == 0; }
+
+	/** @brief Converts the image to RGBA. Masked out pixels become transparent black */
+	std::vector<uint32_t> toRgba(const Palette& palette) const;
+};
+
+/**
+ * @brief Decodes a picture in Doom's patch format, which wall patches and sprites are stored in.
+ *
+ * @details Pictures are stored as columns, each a list of posts: runs of pixels that start some
+ *			distance down the column. Tall patches, where a post's start is relative to the
+ *			previous post because the column is taller than 254 pixels, are supported too.
+ *			Throws if the picture is malformed.
+ */
+IndexedImage decodeDoomPicture(const LumpView& lump);
+
+#endif//DOOM_PICTURE_HPP_INCLUDED
@@ -0,0 +1,125 @@
+#include "FlatSet.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <Resource/ResourceManager.hpp>
+#include <Utility/ParallelFor.hpp>
+
+namespace
+{
+	/** @brief The first and last frames of one of Doom's animated flats */
+	struct FlatAnimationDef
+	{
+		const char* firstName;
+		const char* lastName;
+	};
+
+	// The flat animations from Doom's animdefs table. Heretic and Hexen read theirs from lumps.
+	constexpr FlatAnimationDef FLAT_ANIMATIONS[] = {
+		{ "NUKAGE1", "NUKAGE3" },
+		{ "FWATER1", "FWATER4" },
+		{ "SWATER1", "SWATER4" },
+		{ "LAVA1",   "LAVA4" },
+		{ "BLOOD1",  "BLOOD3" },
+		{ "RROCK05", "RROCK08" },
+		{ "SLIME01", "SLIME04" },
+		{ "SLIME05", "SLIME08" },
+		{ "SLIME09", "SLIME12" },
+	};
+
+	bool isFlatStart(const std::string& name)
+	{
+		return name == "F_START" || name == "FF_START";
+	}
+
+	bool isFlatEnd(const std::string& name)
+	{
+		return name == "F_END" || name == "FF_END";
+	}
+}
+
+FlatSet::FlatSet(const ResourceManager& resources, uint32_t threadCount)
+{
+	std::vector<ResourceManager::LumpRef> lumps;
+
+	// Walk each archive's flat namespace in directory order. The sub-markers (F1_START etc.) in 
+	// the IWADs are empty, so skipping empty lumps skips them too. 
+	for (uint32_t archiveIndex = 0; archiveIndex < resources.archiveCount(); archiveIndex++) {
+		const Archive& archive = resources.archive(archiveIndex);
+		bool inFlats = false;
+
+		for (uint32_t lumpIndex = 0; lumpIndex < archive.lumpCount(); lumpIndex++) {
+			const std::string& name = archive.lumpName(lumpIndex);
+
+			if (isFlatStart(name)) {
+				inFlats = true;
+				continue;
+			}
+			if (isFlatEnd(name)) {
+				inFlats = false;
+				continue;
+			}
+			if (!inFlats || archive.lumpSize(lumpIndex) < FLAT_PIXEL_COUNT)
+				continue;
+
+			auto [it, inserted] = layerIndex.try_emplace(packLumpName(name), static_cast<uint32_t>(names.size()));
+			if (inserted) {
+				names.push_back(name);
+				lumps.push_back({ archiveIndex, lumpIndex });
+			}
+			else {
+				lumps[it->second] = { archiveIndex, lumpIndex };
+			}
+		}
+	}
+
+	_indices.resize(names.size() * FLAT_PIXEL_COUNT);
+
+	// Some flats are a little longer than 64x64, and the extra bytes are ignored like Doom does. 
+	parallelFor(lumps.size(), threadCount, [&](size_t i) {
+		LumpView lump = resources.lumpData(lumps[i]);
+		std::memcpy(&_indices[i * FLAT_PIXEL_COUNT], lump.data(), FLAT_PIXEL_COUNT);
+	});
+
+	findAnimations();
+}
+
+std::optional<uint32_t> FlatSet::findLayer(const std::string& name) const
+{
+	auto it = layerIndex.find(packLumpName(name));
+	if (it == layerIndex.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+std::vector<uint32_t> FlatSet::toRgba(const Palette& palette) const
+{
+	std::vector<uint32_t> rgba(_indices.size());
+
+	for (size_t i = 0; i < _indices.size(); i++)
+		rgba[i] = palette.colors[_indices[i]];
+
+	return rgba;
+}
+
+void FlatSet::findAnimations()
+{
+	animations.resize(names.size());
+	for (uint32_t layer = 0; layer < names.size(); layer++)
+		animations[layer] = Animation{ layer, 1 };
+
+	// Like Doom, an animation is every layer from its first frame to its last, so it's skipped
+	// if either end is missing or they're out of order. 
+	for (const FlatAnimationDef& def : FLAT_ANIMATIONS) {
+		std::optional<uint32_t> first = findLayer(def.firstName);
+		std::optional<uint32_t> last = findLayer(def.lastName);
+
+		if (!first || !last || *last <= *first)
+			continue;
+
+		for (uint32_t layer = *first; layer <= *last; layer++)
+			animations[layer] = Animation{ *first, *last - *first + 1 };
+	}
+}
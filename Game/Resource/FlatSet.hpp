@@ -0,0 +1,71 @@
+#ifndef FLAT_SET_HPP_INCLUDED
+#define FLAT_SET_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include <Resource/DoomPicture.hpp>
+#include <Resource/LumpName.hpp>
+
+class ResourceManager;
+
+/**
+ * @brief Every flat between the F_START and F_END markers of the mounted archives, decoded into
+ *			one block of layers.
+ *
+ * @details Flats are raw 64x64 palette indexed lumps, so decoding them is just gathering their
+ *			pixels together, which happens on worker threads in case they need inflating. Each
+ *			flat becomes a layer, in the order of the archive directories. PWAD flats with the 
+ *			name of an earlier flat replace it in place, and new ones are added to the end, so 
+ *			animations keep their frames next to each other like Doom expects.
+ *
+ *			Doom's animated flats cycle through the layers from their first to their last frame.
+ *			Each layer knows which animation it belongs to, so the animation can be played just 
+ *			by offsetting the layer that is drawn.
+ */
+class FlatSet
+{
+public:
+	static constexpr uint32_t FLAT_SIZE = 64;
+	static constexpr uint32_t FLAT_PIXEL_COUNT = FLAT_SIZE * FLAT_SIZE;
+
+	// How many tics each frame of an animated flat is shown for, at Doom's 35 tics per second
+	static constexpr uint32_t ANIMATION_TICS = 8;
+
+	/** @brief The layers an animated flat cycles through. Flats that aren't animated have one frame */
+	struct Animation
+	{
+		uint32_t	firstLayer;
+		uint32_t	frameCount;
+	};
+
+	FlatSet(const ResourceManager& resources, uint32_t threadCount = 0);
+
+	uint32_t layerCount() const { return static_cast<uint32_t>(names.size()); }
+
+	const std::string& layerName(uint32_t layer) const { return names[layer]; }
+
+	/** @brief The palette indices of every layer, FLAT_PIXEL_COUNT per layer, stored row by row */
+	const std::vector<uint8_t>& indices() const { return _indices; }
+
+	const Animation& animation(uint32_t layer) const { return animations[layer]; }
+
+	std::optional<uint32_t> findLayer(const std::string& name) const;
+
+	/** @brief Converts every layer to RGBA, in the same layout as indices() */
+	std::vector<uint32_t> toRgba(const Palette& palette) const;
+
+private:
+	std::vector<std::string>	names;
+	std::vector<uint8_t>		_indices;
+	std::vector<Animation>		animations;
+
+	std::unordered_map<uint64_t, uint32_t, LumpNameHash> layerIndex;
+
+	void findAnimations();
+};
+
+#endif//FLAT_SET_HPP_INCLUDED
@@ -0,0 +1,450 @@
+#include "Inflate.hpp"
+
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr uint32_t MAX_CODE_BITS = 15;
+	constexpr uint32_t MAX_LITERAL_CODES = 288;
+	constexpr uint32_t MAX_DISTANCE_CODES = 30;
+
+	constexpr std::array<uint16_t, 29> LENGTH_BASE = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr std::array<uint8_t, 29> LENGTH_EXTRA = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr std::array<uint16_t, 30> DISTANCE_BASE = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr std::array<uint8_t, 30> DISTANCE_EXTRA = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// The order the code length code lengths are stored in a dynamic block header.
+	constexpr std::array<uint8_t, 19> CODE_LENGTH_ORDER = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	[[noreturn]] void fail(const char* message)
+	{
+		throw std::runtime_error(std::string("Invalid deflate data: ") + message);
+	}
+
+	/** @brief Reads the input a bit at a time, least significant bit first, 64 bits buffered */
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : _position(data), _end(data + size)
+		{
+		}
+
+		/** @brief Returns the next bits without consuming them. Missing bits past the end read as 0 */
+		uint32_t peek(uint32_t count)
+		{
+			refill();
+			return static_cast<uint32_t>(_bits & ((1ull << count) - 1));
+		}
+
+		void consume(uint32_t count)
+		{
+			if (count > _bitCount)
+				fail("unexpected end of data");
+
+			_bits >>= count;
+			_bitCount -= count;
+		}
+
+		uint32_t read(uint32_t count)
+		{
+			uint32_t value = peek(count);
+			consume(count);
+			return value;
+		}
+
+		/** @brief Skips to the next byte boundary and hands back any whole bytes still buffered */
+		void alignToByte()
+		{
+			consume(_bitCount % 8);
+			_position -= _bitCount / 8;
+			_bits = 0;
+			_bitCount = 0;
+		}
+
+		const uint8_t* position() const { return _position; }
+		size_t remaining() const { return _end - _position; }
+		void skipBytes(size_t count) { _position += count; }
+
+	private:
+		const uint8_t*	_position;
+		const uint8_t*	_end;
+		uint64_t		_bits = 0;
+		uint32_t		_bitCount = 0;
+
+		void refill()
+		{
+			while (_bitCount <= 56 && _position < _end) {
+				_bits |= static_cast<uint64_t>(*_position++) << _bitCount;
+				_bitCount += 8;
+			}
+		}
+	};
+
+	/**
+	 * @brief A canonical Huffman code.
+	 *
+	 * @details Codes up to FAST_BITS long are decoded with one lookup, indexed by the next bits
+	 *			of input. Each entry packs the symbol with the code length, or is 0 when the code
+	 *			is longer, in which case the code is decoded canonically from the per-length counts.
+	 */
+	class HuffmanCode
+	{
+	public:
+		static constexpr uint32_t FAST_BITS = 10;
+
+		void build(const uint8_t* lengths, uint32_t symbolCount)
+		{
+			_counts.fill(0);
+			_fast.fill(0);
+
+			for (uint32_t i = 0; i < symbolCount; i++)
+				_counts[lengths[i]]++;
+			_counts[0] = 0;
+
+			// Reject codes with more codes of some length than can exist. Incomplete codes are
+			// allowed, since a distance code with only one symbol is.
+			int32_t left = 1;
+			for (uint32_t length = 1; length <= MAX_CODE_BITS; length++) {
+				left = (left << 1) - _counts[length];
+				if (left < 0)
+					fail("over-subscribed Huffman code");
+			}
+
+			std::array<uint16_t, MAX_CODE_BITS + 1> offsets{};
+			for (uint32_t length = 1; length < MAX_CODE_BITS; length++)
+				offsets[length + 1] = offsets[length] + _counts[length];
+
+			for (uint32_t i = 0; i < symbolCount; i++)
+				if (lengths[i] != 0)
+					_symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+
+			// Assign the canonical codes in order, and fill in the table for the short ones.
+			uint32_t code = 0;
+			uint32_t symbolIndex = 0;
+			for (uint32_t length = 1; length <= FAST_BITS; length++) {
+				for (uint32_t i = 0; i < _counts[length]; i++, code++) {
+					uint32_t reversed = reverseBits(code, length);
+					uint16_t entry = static_cast<uint16_t>((_symbols[symbolIndex + i] << 4) | length);
+
+					for (uint32_t j = reversed; j < _fast.size(); j += 1u << length)
+						_fast[j] = entry;
+				}
+
+				symbolIndex += _counts[length];
+				code <<= 1;
+			}
+		}
+
+		uint32_t decode(BitReader& reader) const
+		{
+			uint32_t bits = reader.peek(MAX_CODE_BITS);
+
+			uint16_t entry = _fast[bits & ((1u << FAST_BITS) - 1)];
+			if (entry != 0) {
+				reader.consume(entry & 0xF);
+				return entry >> 4;
+			}
+
+			// Codes are stored most significant bit first, so they're rebuilt a bit at a time.
+			int32_t code = 0;
+			int32_t first = 0;
+			int32_t index = 0;
+			for (uint32_t length = 1; length <= MAX_CODE_BITS; length++) {
+				code |= (bits >> (length - 1)) & 1;
+				int32_t count = _counts[length];
+
+				if (code - first < count) {
+					reader.consume(length);
+					return _symbols[index + code - first];
+				}
+
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+
+			fail("invalid Huffman code");
+		}
+
+	private:
+		std::array<uint16_t, 1u << FAST_BITS>		_fast;
+		std::array<uint16_t, MAX_CODE_BITS + 1>		_counts;
+		std::array<uint16_t, MAX_LITERAL_CODES>		_symbols;
+
+		static uint32_t reverseBits(uint32_t code, uint32_t length)
+		{
+			uint32_t reversed = 0;
+			for (uint32_t i = 0; i < length; i++)
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			return reversed;
+		}
+	};
+
+	class Inflater
+	{
+	public:
+		Inflater(const uint8_t* data, size_t size, size_t expectedSize)
+			: reader(data, size), expectedSize(expectedSize)
+		{
+			output.resize(expectedSize != 0 ? expectedSize : size * 4 + 64);
+		}
+
+		std::vector<uint8_t> run()
+		{
+			bool lastBlock = false;
+			while (!lastBlock) {
+				lastBlock = reader.read(1) != 0;
+
+				switch (reader.read(2))
+				{
+				case 0: storedBlock();		break;
+				case 1: fixedBlock();		break;
+				case 2: dynamicBlock();		break;
+				default: fail("invalid block type");
+				}
+			}
+
+			if (expectedSize != 0 && outputSize != expectedSize)
+				fail("decompressed size doesn't match");
+
+			output.resize(outputSize);
+			return std::move(output);
+		}
+
+	private:
+		BitReader				reader;
+		size_t					expectedSize;
+		std::vector<uint8_t>	output;
+		size_t					outputSize = 0;
+
+		HuffmanCode				literalCode;
+		HuffmanCode				distanceCode;
+
+		void reserve(size_t count)
+		{
+			if (outputSize + count <= output.size())
+				return;
+
+			// With the size known up front, running past it means the data is bad.
+			if (expectedSize != 0)
+				fail("decompressed size doesn't match");
+
+			output.resize(std::max(output.size() * 2, outputSize + count));
+		}
+
+		void storedBlock()
+		{
+			reader.alignToByte();
+
+			if (reader.remaining() < 4)
+				fail("unexpected end of data");
+
+			const uint8_t* header = reader.position();
+			uint16_t length = static_cast<uint16_t>(header[0] | (header[1] << 8));
+			uint16_t inverseLength = static_cast<uint16_t>(header[2] | (header[3] << 8));
+			reader.skipBytes(4);
+
+			if (length != static_cast<uint16_t>(~inverseLength))
+				fail("stored block length is corrupt");
+			if (reader.remaining() < length)
+				fail("unexpected end of data");
+
+			reserve(length);
+			std::memcpy(output.data() + outputSize, reader.position(), length);
+			outputSize += length;
+			reader.skipBytes(length);
+		}
+
+		void fixedBlock()
+		{
+			struct FixedCodes
+			{
+				HuffmanCode literal;
+				HuffmanCode distance;
+
+				FixedCodes()
+				{
+					std::array<uint8_t, MAX_LITERAL_CODES> lengths;
+					std::fill(lengths.begin(), lengths.begin() + 144, 8);
+					std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+					std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+					std::fill(lengths.begin() + 280, lengths.end(), 8);
+					literal.build(lengths.data(), MAX_LITERAL_CODES);
+
+					lengths.fill(5);
+					distance.build(lengths.data(), MAX_DISTANCE_CODES);
+				}
+			};
+
+			static const FixedCodes fixed;
+			decodeBlock(fixed.literal, fixed.distance);
+		}
+
+		void dynamicBlock()
+		{
+			uint32_t literalCount = reader.read(5) + 257;
+			uint32_t distanceCount = reader.read(5) + 1;
+			uint32_t codeLengthCount = reader.read(4) + 4;
+
+			if (literalCount > MAX_LITERAL_CODES || distanceCount > MAX_DISTANCE_CODES)
+				fail("too many codes");
+
+			std::array<uint8_t, 19> codeLengthLengths{};
+			for (uint32_t i = 0; i < codeLengthCount; i++)
+				codeLengthLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.read(3));
+
+			HuffmanCode codeLengthCode;
+			codeLengthCode.build(codeLengthLengths.data(), 19);
+
+			// The literal and distance code lengths are run length coded as one sequence.
+			std::array<uint8_t, MAX_LITERAL_CODES + MAX_DISTANCE_CODES> lengths{};
+			uint32_t count = 0;
+			while (count < literalCount + distanceCount) {
+				uint32_t symbol = codeLengthCode.decode(reader);
+
+				if (symbol < 16) {
+					lengths[count++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				uint8_t repeated = 0;
+				uint32_t repeat = 0;
+
+				if (symbol == 16) {
+					if (count == 0)
+						fail("repeated code length with nothing before it");
+					repeated = lengths[count - 1];
+					repeat = 3 + reader.read(2);
+				}
+				else if (symbol == 17) {
+					repeat = 3 + reader.read(3);
+				}
+				else {
+					repeat = 11 + reader.read(7);
+				}
+
+				if (count + repeat > literalCount + distanceCount)
+					fail("too many code lengths");
+
+				std::fill_n(lengths.begin() + count, repeat, repeated);
+				count += repeat;
+			}
+
+			if (lengths[256] == 0)
+				fail("block has no end code");
+
+			literalCode.build(lengths.data(), literalCount);
+			distanceCode.build(lengths.data() + literalCount, distanceCount);
+
+			decodeBlock(literalCode, distanceCode);
+		}
+
+		void decodeBlock(const HuffmanCode& literals, const HuffmanCode& distances)
+		{
+			while (true) {
+				uint32_t symbol = literals.decode(reader);
+
+				if (symbol < 256) {
+					reserve(1);
+					output[outputSize++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				if (symbol == 256)
+					return;
+
+				symbol -= 257;
+				if (symbol >= LENGTH_BASE.size())
+					fail("invalid length code");
+
+				uint32_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+
+				uint32_t distanceSymbol = distances.decode(reader);
+				if (distanceSymbol >= DISTANCE_BASE.size())
+					fail("invalid distance code");
+
+				uint32_t distance = DISTANCE_BASE[distanceSymbol] + reader.read(DISTANCE_EXTRA[distanceSymbol]);
+				if (distance > outputSize)
+					fail("distance is further back than the start of the data");
+
+				reserve(length);
+
+				// The source and destination overlap when the distance is shorter than the length,
+				// which repeats the last few bytes, so the copy has to go a byte at a time.
+				uint8_t* destination = output.data() + outputSize;
+				const uint8_t* source = destination - distance;
+				if (distance >= length) {
+					std::memcpy(destination, source, length);
+				}
+				else {
+					for (uint32_t i = 0; i < length; i++)
+						destination[i] = source[i];
+				}
+
+				outputSize += length;
+			}
+		}
+	};
+
+	constexpr std::array<uint32_t, 256> makeCrcTable()
+	{
+		std::array<uint32_t, 256> table{};
+
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (uint32_t bit = 0; bit < 8; bit++)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+			table[i] = crc;
+		}
+
+		return table;
+	}
+
+	constexpr std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+}
+
+std::vector<uint8_t> decompressDeflate(const uint8_t* data, size_t size, size_t expectedSize)
+{
+	Inflater inflater(data, size, expectedSize);
+	return inflater.run();
+}
+
+std::vector<uint8_t> decompressZlib(const uint8_t* data, size_t size, size_t expectedSize)
+{
+	if (size < 2)
+		fail("missing zlib header");
+
+	// The method has to be deflate, the check bits have to work out, and there can't be a preset
+	// dictionary, since nothing that writes these files uses one.
+	const uint8_t method = data[0];
+	const uint8_t flags = data[1];
+
+	if ((method & 0x0F) != 8 || ((method << 8) | flags) % 31 != 0 || (flags & 0x20) != 0)
+		fail("invalid zlib header");
+
+	// The Adler-32 checksum after the data isn't checked.
+	Inflater inflater(data + 2, size - 2, expectedSize);
+	return inflater.run();
+}
+
+uint32_t computeCrc32(const uint8_t* data, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFFu;
+
+	for (size_t i = 0; i < size; i++)
+		crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc ^ 0xFFFFFFFFu;
+}
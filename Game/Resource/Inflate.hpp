@@ -0,0 +1,30 @@
+#ifndef INFLATE_HPP_INCLUDED
+#define INFLATE_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// A small inflate (deflate decompressor) for the compressed data found in game files: the
+// entries of PK3/zip files, ZDoom's compressed nodes, and PNG image data. It only decompresses
+// whole buffers at once, which is all any of them need, so there's no streaming state to carry
+// between calls.
+//
+// Huffman codes are decoded with a lookup table indexed by the next 10 bits of input, which
+// covers almost every code in practice. Longer codes fall back to a canonical decode.
+
+/**
+ * @brief Decompresses raw deflate data (RFC 1951), as stored in zip files.
+ *
+ * @param expectedSize	The size of the decompressed data if it's known, such as from a zip
+ *						directory. The output is checked against it. Pass 0 if it isn't known.
+ */
+std::vector<uint8_t> decompressDeflate(const uint8_t* data, size_t size, size_t expectedSize = 0);
+
+/** @brief Decompresses deflate data with a zlib header (RFC 1950), like ZDoom's compressed nodes and PNGs */
+std::vector<uint8_t> decompressZlib(const uint8_t* data, size_t size, size_t expectedSize = 0);
+
+/** @brief Computes the CRC-32 used by zip files to check their entries, and PNGs their chunks */
+uint32_t computeCrc32(const uint8_t* data, size_t size);
+
+#endif//INFLATE_HPP_INCLUDED
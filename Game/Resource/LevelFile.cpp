@@ -0,0 +1,252 @@
+#include "LevelFile.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <Resource/Utilities.hpp>
+
+// Compiled level file layout:
+//	Header:		magic "SLVL", version, and the element count of every section
+//	Sections:	vertices, linedefs, walls, sectors, texture names, flat names, 
+//				flat vertices + offsets, portals + offsets, compressed PVS rows + offsets
+//
+// Names are stored as their length followed by their characters. Everything is stored little
+// endian, in the same order as the header counts. Fields are written one at a time rather than
+// dumping the structs, so that padding and bools don't leak into the file format. 
+
+namespace
+{
+	const std::string	MAGIC			= "SLVL";
+	const uint32_t		FILE_VERSION	= 5;
+
+	void writeVec2(BinaryStreamWriter& writer, glm::vec2 value)
+	{
+		writer.writeFloat(value.x);
+		writer.writeFloat(value.y);
+	}
+
+	void writeVec3(BinaryStreamWriter& writer, glm::vec3 value)
+	{
+		writer.writeFloat(value.x);
+		writer.writeFloat(value.y);
+		writer.writeFloat(value.z);
+	}
+
+	glm::vec2 readVec2(BinaryStreamReader& reader)
+	{
+		float x = reader.readFloat();
+		float y = reader.readFloat();
+		return { x, y };
+	}
+
+	glm::vec3 readVec3(BinaryStreamReader& reader)
+	{
+		float x = reader.readFloat();
+		float y = reader.readFloat();
+		float z = reader.readFloat();
+		return { x, y, z };
+	}
+
+	void writeNames(BinaryStreamWriter& writer, const std::vector<std::string>& names)
+	{
+		for (const std::string& name : names) {
+			writer.writeUint32(static_cast<uint32_t>(name.size()));
+			writer.writeString(name, name.size());
+		}
+	}
+
+	void readNames(BinaryStreamReader& reader, uint32_t count, std::vector<std::string>& names)
+	{
+		names.reserve(count);
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t length = reader.readUint32();
+			names.push_back(reader.readString(length));
+		}
+	}
+}
+
+void saveCompiledLevel(const CompiledLevel& compiled, std::ostream& stream)
+{
+	const Level& level = *compiled.level;
+	BinaryStreamWriter writer(stream);
+
+	writer.writeString(MAGIC, MAGIC.size());
+	writer.writeUint32(FILE_VERSION);
+
+	writer.writeUint32(static_cast<uint32_t>(level.vertices.size()));
+	writer.writeUint32(static_cast<uint32_t>(level.lineDefs.size()));
+	writer.writeUint32(static_cast<uint32_t>(level.walls.size()));
+	writer.writeUint32(static_cast<uint32_t>(level.sectors.size()));
+	writer.writeUint32(static_cast<uint32_t>(compiled.flatVertices.size()));
+	writer.writeUint32(static_cast<uint32_t>(compiled.portals.size()));
+	writer.writeUint32(level.pvs.sectorCount);
+	writer.writeUint32(static_cast<uint32_t>(level.pvs.rows.size()));
+	writer.writeUint32(static_cast<uint32_t>(level.textureNames.size()));
+	writer.writeUint32(static_cast<uint32_t>(level.flatNames.size()));
+
+	for (const Vertex& vertex : level.vertices)
+		writeVec2(writer, vertex);
+
+	for (const LineDef& lineDef : level.lineDefs) {
+		writer.writeUint32(lineDef.startVertexId);
+		writer.writeUint32(lineDef.endVertexId);
+		writer.writeUint32(lineDef.frontWallId);
+		writer.writeUint32(lineDef.backWallId);
+	}
+
+	// Walls and sectors are written whole, with how they look, so the file doesn't depend on how
+	// the level splits them up. 
+	for (size_t i = 0; i < level.walls.size(); i++) {
+		const Wall& wall = level.walls[i];
+		const WallAppearance& appearance = level.wallAppearances[i];
+
+		writer.writeUint32(wall.lineDefId);
+		writer.writeUint32(wall.sectorId);
+		writer.writeUint8(wall.endOfLoop ? 1 : 0);
+		writeVec3(writer, appearance.color);
+		writer.writeUint32(appearance.upperTextureId);
+		writer.writeUint32(appearance.middleTextureId);
+		writer.writeUint32(appearance.lowerTextureId);
+	}
+
+	for (size_t i = 0; i < level.sectors.size(); i++) {
+		const Sector& sector = level.sectors[i];
+		const SectorAppearance& appearance = level.sectorAppearances[i];
+
+		writer.writeUint32(sector.firstWallId);
+		writer.writeUint32(sector.wallCount);
+		writer.writeFloat(sector.floorZ);
+		writer.writeFloat(sector.ceilingZ);
+		writer.writeFloat(appearance.lightLevel);
+		writeVec3(writer, appearance.floorColor);
+		writeVec3(writer, appearance.ceilingColor);
+		writer.writeUint32(appearance.floorFlatId);
+		writer.writeUint32(appearance.ceilingFlatId);
+	}
+
+	writeNames(writer, level.textureNames);
+	writeNames(writer, level.flatNames);
+
+	for (const glm::vec2& vertex : compiled.flatVertices)
+		writeVec2(writer, vertex);
+	writer.writeArray(compiled.flatVertexOffsets);
+
+	for (const CompiledLevel::Portal& portal : compiled.portals) {
+		writer.writeUint32(portal.wallId);
+		writer.writeUint32(portal.neighbourSectorId);
+	}
+	writer.writeArray(compiled.portalOffsets);
+
+	writer.writeArray(level.pvs.rows);
+	writer.writeArray(level.pvs.rowOffsets);
+
+	if (!stream)
+		throw std::runtime_error("Failed to write compiled level");
+}
+
+CompiledLevel loadCompiledLevel(std::istream& stream)
+{
+	BinaryStreamReader reader(stream);
+
+	if (reader.readString(MAGIC.size()) != MAGIC)
+		throw std::runtime_error("Not a compiled level file");
+
+	uint32_t version = reader.readUint32();
+	if (version != FILE_VERSION)
+		throw std::runtime_error("Unsupported compiled level version " + std::to_string(version));
+
+	uint32_t vertexCount		= reader.readUint32();
+	uint32_t lineDefCount		= reader.readUint32();
+	uint32_t wallCount			= reader.readUint32();
+	uint32_t sectorCount		= reader.readUint32();
+	uint32_t flatVertexCount	= reader.readUint32();
+	uint32_t portalCount		= reader.readUint32();
+	uint32_t pvsSectorCount		= reader.readUint32();
+	uint32_t pvsRowsSize		= reader.readUint32();
+	uint32_t textureNameCount	= reader.readUint32();
+	uint32_t flatNameCount		= reader.readUint32();
+
+	CompiledLevel compiled;
+	compiled.level = std::make_unique<Level>();
+	Level& level = *compiled.level;
+
+	level.vertices.reserve(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		level.vertices.push_back(readVec2(reader));
+
+	level.lineDefs.reserve(lineDefCount);
+	for (uint32_t i = 0; i < lineDefCount; i++) {
+		LineDef lineDef;
+		lineDef.startVertexId	= reader.readUint32();
+		lineDef.endVertexId		= reader.readUint32();
+		lineDef.frontWallId		= reader.readUint32();
+		lineDef.backWallId		= reader.readUint32();
+		level.lineDefs.push_back(lineDef);
+	}
+
+	level.walls.reserve(wallCount);
+	level.wallAppearances.reserve(wallCount);
+	for (uint32_t i = 0; i < wallCount; i++) {
+		Wall wall;
+		WallAppearance appearance;
+		wall.lineDefId	= reader.readUint32();
+		wall.sectorId	= reader.readUint32();
+		wall.endOfLoop	= reader.readUint8() != 0;
+		appearance.color			= readVec3(reader);
+		appearance.upperTextureId	= reader.readUint32();
+		appearance.middleTextureId	= reader.readUint32();
+		appearance.lowerTextureId	= reader.readUint32();
+		level.addWall(wall, appearance);
+	}
+
+	level.sectors.reserve(sectorCount);
+	level.sectorAppearances.reserve(sectorCount);
+	for (uint32_t i = 0; i < sectorCount; i++) {
+		Sector sector;
+		SectorAppearance appearance;
+		sector.firstWallId	= reader.readUint32();
+		sector.wallCount	= reader.readUint32();
+		sector.floorZ		= reader.readFloat();
+		sector.ceilingZ		= reader.readFloat();
+		appearance.lightLevel	= reader.readFloat();
+		appearance.floorColor	= readVec3(reader);
+		appearance.ceilingColor	= readVec3(reader);
+		appearance.floorFlatId		= reader.readUint32();
+		appearance.ceilingFlatId	= reader.readUint32();
+		level.addSector(sector, appearance);
+	}
+
+	readNames(reader, textureNameCount, level.textureNames);
+	readNames(reader, flatNameCount, level.flatNames);
+
+	compiled.flatVertices.reserve(flatVertexCount);
+	for (uint32_t i = 0; i < flatVertexCount; i++)
+		compiled.flatVertices.push_back(readVec2(reader));
+	reader.readArray(compiled.flatVertexOffsets, sectorCount + 1);
+
+	compiled.portals.reserve(portalCount);
+	for (uint32_t i = 0; i < portalCount; i++) {
+		CompiledLevel::Portal portal;
+		portal.wallId				= reader.readUint32();
+		portal.neighbourSectorId	= reader.readUint32();
+		compiled.portals.push_back(portal);
+	}
+	reader.readArray(compiled.portalOffsets, sectorCount + 1);
+
+	// The portals are the same as the level's sector graph, which also needs the sector behind
+	// every wall, so it is cheaper to build than to piece together from them. 
+	level.sectorGraph.build(level);
+	level.blockmap = Blockmap::build(level);
+
+	// Levels without a PVS store no rows and no offsets. 
+	level.pvs.sectorCount = pvsSectorCount;
+	reader.readArray(level.pvs.rows, pvsRowsSize);
+	reader.readArray(level.pvs.rowOffsets, pvsSectorCount > 0 ? pvsSectorCount + 1 : 0);
+
+	if (!stream)
+		throw std::runtime_error("Compiled level file is truncated");
+
+	return compiled;
+}
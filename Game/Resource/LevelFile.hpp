@@ -0,0 +1,51 @@
+#ifndef LEVEL_FILE_HPP_INCLUDED
+#define LEVEL_FILE_HPP_INCLUDED
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <istream>
+#include <ostream>
+
+#include <glm/glm.hpp>
+
+#include <Level.hpp>
+
+/**
+ * @brief A level along with the data that the map compiler precomputes for it. 
+ * 
+ * @details Everything past the level itself can be derived from the level, but is expensive
+ *			enough to compute that it is worth doing once offline instead of every time the level
+ *			is loaded. 
+ */
+struct CompiledLevel
+{
+	/**
+	 * @brief A two-sided wall that can be seen through into a neighbouring sector 
+	 */
+	struct Portal
+	{
+		uint32_t	wallId;				// The wall on the near side of the portal
+		uint32_t	neighbourSectorId;	// The sector that can be seen through the wall
+	};
+
+	std::unique_ptr<Level>	level;
+
+	// Triangulations of each sector's floor/ceiling shape, three vertices per triangle. The 
+	// vertices for sector i are in the range [flatVertexOffsets[i], flatVertexOffsets[i + 1])
+	std::vector<glm::vec2>	flatVertices;
+	std::vector<uint32_t>	flatVertexOffsets;
+
+	// The portals leading out of each sector. The portals for sector i are in the range
+	// [portalOffsets[i], portalOffsets[i + 1])
+	std::vector<Portal>		portals;
+	std::vector<uint32_t>	portalOffsets;
+};
+
+/** @brief Writes a compiled level to a binary stream */
+void saveCompiledLevel(const CompiledLevel& compiled, std::ostream& stream);
+
+/** @brief Reads a compiled level written by saveCompiledLevel */
+CompiledLevel loadCompiledLevel(std::istream& stream);
+
+#endif//LEVEL_FILE_HPP_INCLUDED
@@ -0,0 +1,62 @@
+#ifndef LUMP_NAME_HPP_INCLUDED
+#define LUMP_NAME_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * @brief Packs a lump name of up to 8 characters into a single integer.
+ * 
+ * @details Doom lump names are at most 8 characters and case-insensitive, so they fit exactly
+ *			into a uint64_t once uppercased. Comparing and hashing the packed value is much 
+ *			cheaper than doing the same with a std::string. Characters past the 8th are ignored. 
+ */
+constexpr uint64_t packLumpName(std::string_view name)
+{
+	uint64_t packed = 0;
+
+	for (size_t i = 0; i < name.size() && i < 8; i++) {
+		char c = name[i];
+		if (c == '\0')
+			break;
+		if (c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+
+		packed |= static_cast<uint64_t>(static_cast<uint8_t>(c)) << (i * 8);
+	}
+
+	return packed;
+}
+
+/** @brief Turns a packed lump name back into a string */
+inline std::string unpackLumpName(uint64_t packed)
+{
+	std::string name;
+
+	for (size_t i = 0; i < 8 && (packed >> (i * 8)) != 0; i++)
+		name.push_back(static_cast<char>((packed >> (i * 8)) & 0xFF));
+
+	return name;
+}
+
+/**
+ * @brief Hash for packed lump names.
+ * 
+ * @details Standard libraries often hash integers with the identity function, which clusters
+ *			badly for names that share a prefix (MAP01, MAP02, ...). This mixes the bits first. 
+ */
+struct LumpNameHash
+{
+	size_t operator()(uint64_t packed) const
+	{
+		packed ^= packed >> 33;
+		packed *= 0xff51afd7ed558ccdULL;
+		packed ^= packed >> 33;
+		packed *= 0xc4ceb9fe1a85ec53ULL;
+		packed ^= packed >> 33;
+		return static_cast<size_t>(packed);
+	}
+};
+
+#endif//LUMP_NAME_HPP_INCLUDED
@@ -6,60 +6,273 @@
 #include <vector>
 #include <exception>
 #include <format>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
 
 #include <Resource/WadFile.hpp>
-
-struct DoomLineAndSideDef
-{
-	uint16_t startVertId;
-	uint16_t endVertId;
-
-	uint16_t frontSector; 
-	uint16_t backSector;
-};
+#include <Resource/DoomFormat.hpp>
+#include <Resource/UdmfTokenizer.hpp>
+#include <Resource/Inflate.hpp>
+#include <Resource/ResourceManager.hpp>
 
 // Doom wad loading algorithm:
 //	1. Load vertices
 //	2. Load sectors, leaving the first wall and wall count blank. 
 //	3. Load sidedefs
 //  4. Load linedefs, mapping each linedef to the sector(s) it belongs to.
+//  5. Build the engine level, grouping the walls of each sector into closed loops.
+//  6. If the map has been through a node builder, load its segs, subsectors and nodes into
+//     the level's BSP tree.
+//  7. Things are loaded as they are. The game works out which sectors they're in. 
+
+namespace
+{
+	// Doom's thing flags that matter to the engine. The rest are Boom's, for deathmatch and coop.
+	constexpr uint16_t DOOM_THING_FLAGS = Thing::SKILL_EASY | Thing::SKILL_MEDIUM | Thing::SKILL_HARD | Thing::AMBUSH | Thing::MULTIPLAYER_ONLY;
+
+	// Hexen things share Doom's skill and ambush bits, but mark the game modes they're in instead
+	// of the ones they aren't. 
+	constexpr uint16_t HEXEN_THING_SINGLE_PLAYER = 0x0100;
+
+	/**
+	 * @brief Picks a color for a Doom texture name. 
+	 * 
+	 * @details The test maps name their textures after the RGB hex color they represent
+	 *			(e.g. "990000"), so those are decoded directly from the packed name. Anything else
+	 *			gets a neutral grey. The color is only used when the texture itself can't be found. 
+	 */
+	glm::vec3 colorFromTextureName(uint64_t packedName)
+	{
+		const glm::vec3 defaultColor{ 0.6f, 0.6f, 0.6f };
+
+		// Exactly 6 characters, so the 7th byte is the first that's empty. 
+		if ((packedName >> 40) == 0 || (packedName >> 48) != 0)
+			return defaultColor;
+
+		uint32_t rgb = 0;
+		for (uint32_t i = 0; i < 6; i++) {
+			const char c = static_cast<char>((packedName >> (i * 8)) & 0xFF);
+			uint32_t digit;
+			if (c >= '0' && c <= '9')		digit = c - '0';
+			else if (c >= 'A' && c <= 'F')	digit = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'f')	digit = c - 'a' + 10;
+			else							return defaultColor;
+
+			rgb = (rgb << 4) | digit;
+		}
+
+		return glm::vec3{ (rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF } / 255.0f;
+	}
+
+	/**
+	 * @brief Reads the packed little endian fields of an extended node lump in order. 
+	 * 
+	 * @details Unlike the other lumps, extended nodes aren't an array of fixed size records, so
+	 *			the fields are read one after another. Reading past the end returns 0 and sets
+	 *			overrun, which the loader checks once at the end. 
+	 */
+	struct RecordCursor
+	{
+		const uint8_t* data;
+		size_t size;
+		size_t offset = 0;
+		bool overrun = false;
+
+		template<typename T>
+		T read()
+		{
+			if (overrun || size - offset < sizeof(T)) {
+				overrun = true;
+				return 0;
+			}
+
+			T value = readRecordField<T>(data, offset);
+			offset += sizeof(T);
+			return value;
+		}
+
+		uint8_t readUint8() { return read<uint8_t>(); }
+		uint16_t readUint16() { return read<uint16_t>(); }
+		int16_t readInt16() { return read<int16_t>(); }
+		uint32_t readUint32() { return read<uint32_t>(); }
+		int32_t readInt32() { return read<int32_t>(); }
+	};
+}
 
 DoomMapLoader::DoomMapLoader(const std::string&& fileName, const std::string&& mapName)
-	: wadFile(fileName), mapName(mapName)
+	: mapName(mapName)
 {
 	/* We don't want to load the map in the constructor */
+	std::shared_ptr<const WadFile> wadFile = std::make_shared<const WadFile>(fileName);
+	mapMarkerIndex = wadFile->indexOfLump(mapName);
+	archive = std::move(wadFile);
+}
+
+DoomMapLoader::DoomMapLoader(std::shared_ptr<const Archive> archive, uint32_t mapMarkerIndex)
+	: archive(std::move(archive)), mapMarkerIndex(mapMarkerIndex)
+{
+	mapName = this->archive->lumpName(mapMarkerIndex);
+}
+
+DoomMapLoader::DoomMapLoader(const ResourceManager& resources, const std::string& mapName)
+	: mapName(mapName)
+{
+	std::optional<ResourceManager::LumpRef> marker = resources.findMap(mapName);
+	if (!marker)
+		throw std::runtime_error(std::format("Map '{}' not found in any mounted archive", mapName));
+
+	archive = resources.archivePtr(marker->archiveIndex);
+	mapMarkerIndex = marker->lumpIndex;
+}
+
+uint32_t DoomMapLoader::indexOfMapLump(const std::string& lumpName) const
+{
+	// Map lumps directly follow the map's marker, so only those need to be searched. 
+	for (uint32_t i = mapMarkerIndex + 1; i < archive->lumpCount(); i++) {
+		const std::string& name = archive->lumpName(i);
+
+		if (name == lumpName)
+			return i;
+		if (!ResourceManager::isMapDataLump(name))
+			break;
+	}
+
+	throw std::runtime_error(std::format("Map '{}' has no {} lump", mapName, lumpName));
+}
+
+bool DoomMapLoader::hasMapLump(const std::string& lumpName) const
+{
+	for (uint32_t i = mapMarkerIndex + 1; i < archive->lumpCount(); i++) {
+		const std::string& name = archive->lumpName(i);
+
+		if (name == lumpName)
+			return archive->lumpSize(i) > 0;
+		if (!ResourceManager::isMapDataLump(name))
+			break;
+	}
+
+	return false;
+}
+
+bool DoomMapLoader::isMapMarker(const std::string& lumpName)
+{
+	auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+	// Doom 2 style: MAPxx
+	if (lumpName.size() == 5 && lumpName.starts_with("MAP"))
+		return isDigit(lumpName[3]) && isDigit(lumpName[4]);
+
+	// Doom 1 style: ExMy
+	if (lumpName.size() == 4 && lumpName[0] == 'E' && lumpName[2] == 'M')
+		return isDigit(lumpName[1]) && isDigit(lumpName[3]);
+
+	return false;
 }
 
 std::unique_ptr<Level> DoomMapLoader::loadLevel()
 {
 	std::unique_ptr<Level> level = std::make_unique<Level>();
 
-	loadVertices();
-	loadSidedefs();
-	loadLinedefs();
-	loadSectors();
+	doomVertices.clear();
+	doomSidedefs.clear();
+	doomLinedefs.clear();
+	doomSectors.clear();
+	doomThings.clear();
+	doomSegs.clear();
+	doomSubsectors.clear();
+	doomNodes.clear();
+	nodeVertices.clear();
+
+	// UDMF maps keep everything in their TEXTMAP. Of the binary formats, Hexen maps are the only
+	// ones with ACS scripts, so a BEHAVIOR lump gives them away.
+	if (hasMapLump(LUMP_TEXTMAP))
+		format = DoomMapFormat::Udmf;
+	else if (hasMapLump(LUMP_BEHAVIOR))
+		format = DoomMapFormat::Hexen;
+	else
+		format = DoomMapFormat::Doom;
+
+	if (format == DoomMapFormat::Udmf) {
+		loadTextMap();
+	}
+	else {
+		loadVertices();
+		loadSidedefs();
+		loadLinedefs();
+		loadSectors();
+		loadThings();
+	}
+
+	linkSidedefs();
+
+	buildLevel(*level);
+	level->sectorGraph.build(*level);
+
+	// Maps that haven't been through a node builder just don't get a BSP, and the engine builds
+	// one itself. 
+	uint32_t nodeLumpIndex = 0;
+	switch (detectNodeFormat(nodeLumpIndex))
+	{
+	case NodeFormat::Vanilla:
+		// A map with a single subsector has no nodes at all, so only the subsectors are required.
+		loadSegs();
+		loadSubsectors();
+		if (hasMapLump(LUMP_NODES))
+			loadNodes();
+		break;
+
+	case NodeFormat::DeePBsp:
+		loadDeePBspNodes();
+		break;
+
+	case NodeFormat::Extended:
+	case NodeFormat::Compressed:
+		loadExtendedNodes(nodeLumpIndex);
+		break;
+
+	case NodeFormat::None:
+		break;
+	}
+
+	if (!doomSubsectors.empty())
+		buildBsp(*level);
+
+	if (hasMapLump(LUMP_REJECT))
+		loadReject(*level);
+
+	// UDMF maps don't have a BLOCKMAP, and big maps can overflow the format's 16-bit offsets, so
+	// maps without a usable one get one built. 
+	if (hasMapLump(LUMP_BLOCKMAP))
+		loadBlockmap(*level);
+	if (level->blockmap.empty())
+		level->blockmap = Blockmap::build(*level);
 
 	return std::move(level);
 }
 
-void DoomMapLoader::loadVertices()
+LumpView DoomMapLoader::readMapLump(const std::string& lumpName) const
 {
-	uint32_t vertexLumpIndex = wadFile.indexOfMapLump(mapName, LUMP_VERTICES);
-	uint32_t vertexCount = wadFile.lumpSize(vertexLumpIndex) / VERTEX_ENTRY_SIZE;
+	return archive->lumpData(indexOfMapLump(lumpName));
+}
 
-	FileSubsetStream vertexStream = wadFile.lumpStream(vertexLumpIndex);
+void DoomMapLoader::loadVertices()
+{
+	using Layout = DoomVertexLayout;
 
-	BinaryStreamReader reader(vertexStream);
+	LumpView lump = readMapLump(LUMP_VERTICES);
+	const size_t vertexCount = lump.size() / Layout::SIZE;
 
-	// TODO: Remove debugging lines
-	std::cout << "Loading map Vertices:" << std::endl;
-	std::cout << "\tidx\tx\ty\n";
+	doomVertices.reserve(vertexCount);
 
-	for (uint32_t i = 0; i < vertexCount; i++) {
-		int16_t x = reader.readInt16();
-		int16_t y = reader.readInt16();
+	for (size_t i = 0; i < vertexCount; i++) {
+		const uint8_t* record = &lump[i * Layout::SIZE];
 
-		std::cout << std::format("\t{}\t\t{}\t{}\n", i, x, y);
+		int16_t x = readRecordField<int16_t>(record, Layout::X);
+		int16_t y = readRecordField<int16_t>(record, Layout::Y);
 
 		doomVertices.push_back({ x, y });
 	}
@@ -67,35 +280,23 @@ void DoomMapLoader::loadVertices()
 
 void DoomMapLoader::loadSidedefs()
 {
-	uint32_t sidedefLumpIndex = wadFile.indexOfMapLump(mapName, LUMP_SIDEDEFS);
-	uint32_t sidedefCount = wadFile.lumpSize(sidedefLumpIndex) / SIDEDEF_ENTRY_SIZE;
+	using Layout = DoomSidedefLayout;
 
-	FileSubsetStream sidedefStream = wadFile.lumpStream(sidedefLumpIndex);
-	BinaryStreamReader reader(sidedefStream);
+	LumpView lump = readMapLump(LUMP_SIDEDEFS);
+	const size_t sidedefCount = lump.size() / Layout::SIZE;
 
-	std::cout << "Loading map sidedefs" << std::endl;
-	std::cout << "\tidx\tSecId\ttex u\t tex l\ttex m\tline id" << std::endl;
+	doomSidedefs.reserve(sidedefCount);
 
-	for (uint32_t i = 0; i < sidedefCount; i++) {
-		reader.skip(sizeof(uint16_t) * 2);
+	for (size_t i = 0; i < sidedefCount; i++) {
+		const uint8_t* record = &lump[i * Layout::SIZE];
 
 		DoomSidedef sidedef;
-		sidedef.upperTexture = reader.readString(TEX_NAME_SIZE);
-		sidedef.lowerTexture = reader.readString(TEX_NAME_SIZE);
-		sidedef.middleTexture = reader.readString(TEX_NAME_SIZE);
-
-		sidedef.sectorId = reader.readUint16();
-		sidedef.linedefId = 0xFFFF;
-
-		std::cout << std::format(
-			"\t{}\t{}\t{}\t{}\t{}\t{}\n",
-			i,
-			sidedef.sectorId,
-			sidedef.upperTexture,
-			sidedef.lowerTexture,
-			sidedef.middleTexture,
-			sidedef.linedefId
-		);
+		sidedef.upperTexture = textureNames.intern(readRecordPackedName(record, Layout::UPPER_TEXTURE));
+		sidedef.lowerTexture = textureNames.intern(readRecordPackedName(record, Layout::LOWER_TEXTURE));
+		sidedef.middleTexture = textureNames.intern(readRecordPackedName(record, Layout::MIDDLE_TEXTURE));
+
+		sidedef.sectorId = readRecordField<uint16_t>(record, Layout::SECTOR);
+		sidedef.linedefId = DoomSeg::NO_LINEDEF;
 
 		doomSidedefs.push_back(sidedef);
 	}
@@ -103,74 +304,816 @@ void DoomMapLoader::loadSidedefs()
 
 void DoomMapLoader::loadLinedefs()
 {
-	uint32_t linedefLumpIndex = wadFile.indexOfMapLump(mapName, LUMP_LINEDEFS);
-	uint32_t linedefCount = wadFile.lumpSize(linedefLumpIndex) / LINEDEF_ENTRY_SIZE;
+	LumpView lump = readMapLump(LUMP_LINEDEFS);
+
+	// The format is only checked once, and each format gets its own decode loop.
+	switch (format)
+	{
+	case DoomMapFormat::Doom:	decodeLinedefs<DoomLinedefLayout>(lump);	break;
+	case DoomMapFormat::Hexen:	decodeLinedefs<HexenLinedefLayout>(lump);	break;
+	case DoomMapFormat::Udmf:	break;	// Loaded from the TEXTMAP instead
+	}
+}
+
+template<typename Layout>
+void DoomMapLoader::decodeLinedefs(const LumpView& lump)
+{
+	const size_t linedefCount = lump.size() / Layout::SIZE;
 
-	FileSubsetStream linedefStream = wadFile.lumpStream(linedefLumpIndex);
-	BinaryStreamReader reader(linedefStream);
+	doomLinedefs.reserve(linedefCount);
 
-	std::cout << "Loading map linedefs" << std::endl;
-	std::cout << "\tidx\tstart\tend\tfront\tback" << std::endl;
+	// Sidedef indices are unsigned, so vanilla maps can have up to 65535 of them, with 0xFFFF
+	// meaning there is no sidedef. 
+	auto readSidedefId = [](const uint8_t* record, uint32_t offset) {
+		uint16_t sidedefId = readRecordField<uint16_t>(record, offset);
+		return sidedefId == 0xFFFF ? DoomLinedef::NO_SIDEDEF : static_cast<uint32_t>(sidedefId);
+	};
 
-	for (uint16_t i = 0; i < linedefCount; i++)
+	for (uint32_t i = 0; i < linedefCount; i++)
 	{
+		const uint8_t* record = &lump[i * Layout::SIZE];
+
 		DoomLinedef linedef;
-		linedef.startVertexId = reader.readUint16();
-		linedef.endVertexId = reader.readUint16();
+		linedef.startVertexId = readRecordField<uint16_t>(record, Layout::START_VERTEX);
+		linedef.endVertexId = readRecordField<uint16_t>(record, Layout::END_VERTEX);
+		linedef.frontSidedefId = readSidedefId(record, Layout::FRONT_SIDEDEF);
+		linedef.backSidedefId = readSidedefId(record, Layout::BACK_SIDEDEF);
 
-		reader.skip(3 * sizeof(uint16_t));
+		doomLinedefs.push_back(linedef);
+	}
+}
 
-		linedef.frontSidedefId = reader.readUint16();
-		linedef.backSidedefId = reader.readUint16();
+void DoomMapLoader::loadThings()
+{
+	// Things aren't needed to build the level, so maps without any still load. 
+	if (!hasMapLump(LUMP_THINGS))
+		return;
 
-		doomLinedefs.push_back(linedef);
+	LumpView lump = readMapLump(LUMP_THINGS);
+
+	switch (format)
+	{
+	case DoomMapFormat::Doom:	decodeThings<DoomThingLayout>(lump);	break;
+	case DoomMapFormat::Hexen:	decodeThings<HexenThingLayout>(lump);	break;
+	case DoomMapFormat::Udmf:	break;	// Loaded from the TEXTMAP instead
+	}
+}
+
+template<typename Layout>
+void DoomMapLoader::decodeThings(const LumpView& lump)
+{
+	const size_t thingCount = lump.size() / Layout::SIZE;
+
+	doomThings.reserve(thingCount);
+
+	for (size_t i = 0; i < thingCount; i++) {
+		const uint8_t* record = &lump[i * Layout::SIZE];
 
-		if (linedef.frontSidedefId != DoomLinedef::NO_SIDEDEF)
-			doomSidedefs[linedef.frontSidedefId].linedefId = i;
-		if (linedef.backSidedefId != DoomLinedef::NO_SIDEDEF)
-			doomSidedefs[linedef.backSidedefId].linedefId = i;
+		int16_t x = readRecordField<int16_t>(record, Layout::X);
+		int16_t y = readRecordField<int16_t>(record, Layout::Y);
+		int16_t angle = readRecordField<int16_t>(record, Layout::ANGLE);
+		uint16_t flags = readRecordField<uint16_t>(record, Layout::FLAGS);
 
-		std::cout << std::format(
-			"\t{}\t{}\t{}\t{}\t{}\n",
-			i,
-			linedef.startVertexId, 
-			linedef.endVertexId, 
-			linedef.frontSidedefId,
-			linedef.backSidedefId
-		);
+		Thing thing;
+		thing.position = glm::vec2(x, y);
+		thing.height = 0.0f;
+		thing.angle = glm::radians(static_cast<float>(angle));
+		thing.type = readRecordField<uint16_t>(record, Layout::TYPE);
+
+		if constexpr (std::is_same_v<Layout, HexenThingLayout>) {
+			thing.height = readRecordField<int16_t>(record, Layout::Z);
+			thing.flags = flags & (Thing::SKILL_EASY | Thing::SKILL_MEDIUM | Thing::SKILL_HARD | Thing::AMBUSH);
+			if (!(flags & HEXEN_THING_SINGLE_PLAYER))
+				thing.flags |= Thing::MULTIPLAYER_ONLY;
+		}
+		else {
+			thing.flags = flags & DOOM_THING_FLAGS;
+		}
+
+		doomThings.push_back(thing);
+	}
+}
+
+void DoomMapLoader::linkSidedefs()
+{
+	for (uint32_t i = 0; i < doomLinedefs.size(); i++) {
+		const DoomLinedef& linedef = doomLinedefs[i];
+
+		if (linedef.startVertexId >= doomVertices.size() || linedef.endVertexId >= doomVertices.size())
+			throw std::runtime_error(std::format("Map '{}' has a linedef with an invalid vertex", mapName));
+
+		for (uint32_t sidedefId : { linedef.frontSidedefId, linedef.backSidedefId }) {
+			if (sidedefId != DoomLinedef::NO_SIDEDEF && sidedefId < doomSidedefs.size())
+				doomSidedefs[sidedefId].linedefId = i;
+		}
+	}
+}
+
+void DoomMapLoader::loadTextMap()
+{
+	using Token = UdmfTokenizer::Token;
+	using TokenType = UdmfTokenizer::TokenType;
+
+	// The tokens point straight into the lump, so it has to stay around until parsing is done.
+	LumpView lump = readMapLump(LUMP_TEXTMAP);
+	UdmfTokenizer tokenizer(std::string_view(reinterpret_cast<const char*>(lump.data()), lump.size()));
+
+	auto is = UdmfTokenizer::identifierEquals;
+
+	auto isSymbol = [](const Token& token, char symbol) {
+		return token.type == TokenType::Symbol && token.text[0] == symbol;
+	};
+
+	auto expectSymbol = [&](char symbol) {
+		if (!isSymbol(tokenizer.next(), symbol))
+			tokenizer.fail(std::format("Expected '{}'", symbol));
+	};
+
+	auto expectValue = [&]() {
+		Token value = tokenizer.next();
+		if (value.type == TokenType::Symbol || value.type == TokenType::End)
+			tokenizer.fail("Expected a value");
+		return value;
+	};
+
+	auto toIndex = [&](const Token& value) {
+		int64_t index = tokenizer.parseInteger(value);
+		return index < 0 ? DoomLinedef::NO_SIDEDEF : static_cast<uint32_t>(index);
+	};
+
+	enum class Block
+	{
+		Vertex,
+		Linedef,
+		Sidedef,
+		Sector,
+		Thing,
+		Other	// Anything from extensions that the engine doesn't use
+	};
+
+	while (true) {
+		Token name = tokenizer.next();
+		if (name.type == TokenType::End)
+			break;
+		if (name.type != TokenType::Identifier)
+			tokenizer.fail("Expected a block or an assignment");
+
+		// Global assignments, like the namespace, don't change how the map is loaded. 
+		Token token = tokenizer.next();
+		if (isSymbol(token, '=')) {
+			expectValue();
+			expectSymbol(';');
+			continue;
+		}
+		if (!isSymbol(token, '{'))
+			tokenizer.fail("Expected '=' or '{'");
+
+		Block block = is(name.text, "vertex") ? Block::Vertex
+			: is(name.text, "linedef") ? Block::Linedef
+			: is(name.text, "sidedef") ? Block::Sidedef
+			: is(name.text, "sector") ? Block::Sector
+			: is(name.text, "thing") ? Block::Thing
+			: Block::Other;
+
+		// Fields that are left out take the defaults from the UDMF spec.
+		glm::vec2 vertex{ 0.0f, 0.0f };
+		DoomLinedef linedef{ 0, 0, DoomLinedef::NO_SIDEDEF, DoomLinedef::NO_SIDEDEF };
+		DoomSidedef sidedef{ 0, DoomSeg::NO_LINEDEF, TEX_NONE, TEX_NONE, TEX_NONE };
+		DoomSector sector{ 0.0f, 0.0f, UDMF_DEFAULT_LIGHT_LEVEL, TEX_NONE, TEX_NONE };
+
+		// UDMF things aren't in any skill or in single player unless they say so. 
+		Thing thing{ glm::vec2(0.0f, 0.0f), 0.0f, 0.0f, 0, Thing::MULTIPLAYER_ONLY };
+
+		while (true) {
+			Token key = tokenizer.next();
+			if (isSymbol(key, '}'))
+				break;
+			if (key.type != TokenType::Identifier)
+				tokenizer.fail("Expected a key or '}'");
+
+			expectSymbol('=');
+			Token value = expectValue();
+			expectSymbol(';');
+
+			switch (block)
+			{
+			case Block::Vertex:
+				if (is(key.text, "x"))					vertex.x = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "y"))				vertex.y = static_cast<float>(tokenizer.parseFloat(value));
+				break;
+
+			case Block::Linedef:
+				if (is(key.text, "v1"))					linedef.startVertexId = toIndex(value);
+				else if (is(key.text, "v2"))			linedef.endVertexId = toIndex(value);
+				else if (is(key.text, "sidefront"))		linedef.frontSidedefId = toIndex(value);
+				else if (is(key.text, "sideback"))		linedef.backSidedefId = toIndex(value);
+				break;
+
+			case Block::Sidedef:
+				if (is(key.text, "sector"))				sidedef.sectorId = toIndex(value);
+				else if (is(key.text, "texturetop"))	sidedef.upperTexture = textureNames.intern(value.text);
+				else if (is(key.text, "texturebottom"))	sidedef.lowerTexture = textureNames.intern(value.text);
+				else if (is(key.text, "texturemiddle"))	sidedef.middleTexture = textureNames.intern(value.text);
+				break;
+
+			case Block::Sector:
+				if (is(key.text, "heightfloor"))		sector.floorZ = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "heightceiling"))	sector.ceilingZ = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "lightlevel"))	sector.lightLevel = static_cast<float>(tokenizer.parseInteger(value));
+				else if (is(key.text, "texturefloor"))	sector.floorTexture = textureNames.intern(value.text);
+				else if (is(key.text, "textureceiling"))	sector.ceilingTexture = textureNames.intern(value.text);
+				break;
+
+			case Block::Thing:
+				if (is(key.text, "x"))					thing.position.x = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "y"))				thing.position.y = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "height"))		thing.height = static_cast<float>(tokenizer.parseFloat(value));
+				else if (is(key.text, "angle"))			thing.angle = glm::radians(static_cast<float>(tokenizer.parseInteger(value)));
+				else if (is(key.text, "type"))			thing.type = static_cast<uint16_t>(tokenizer.parseInteger(value));
+				else if (is(key.text, "skill1") || is(key.text, "skill2"))	thing.flags |= tokenizer.parseBool(value) ? Thing::SKILL_EASY : 0;
+				else if (is(key.text, "skill3"))		thing.flags |= tokenizer.parseBool(value) ? Thing::SKILL_MEDIUM : 0;
+				else if (is(key.text, "skill4") || is(key.text, "skill5"))	thing.flags |= tokenizer.parseBool(value) ? Thing::SKILL_HARD : 0;
+				else if (is(key.text, "ambush"))		thing.flags |= tokenizer.parseBool(value) ? Thing::AMBUSH : 0;
+				else if (is(key.text, "single") && tokenizer.parseBool(value))	thing.flags &= ~Thing::MULTIPLAYER_ONLY;
+				break;
+
+			case Block::Other:
+				break;
+			}
+		}
+
+		switch (block)
+		{
+		case Block::Vertex:		doomVertices.push_back(vertex);		break;
+		case Block::Linedef:	doomLinedefs.push_back(linedef);	break;
+		case Block::Sidedef:	doomSidedefs.push_back(sidedef);	break;
+		case Block::Sector:		doomSectors.push_back(sector);		break;
+		case Block::Thing:		doomThings.push_back(thing);		break;
+		case Block::Other:		break;
+		}
 	}
 }
 
 void DoomMapLoader::loadSectors()
 {
-	uint32_t sectorLumpIndex = wadFile.indexOfMapLump(mapName, LUMP_SECTORS);
-	uint32_t sectorCount = wadFile.lumpSize(sectorLumpIndex) / SECTOR_ENTRY_SIZE;
+	using Layout = DoomSectorLayout;
 
-	FileSubsetStream sectorStream = wadFile.lumpStream(sectorLumpIndex);
-	BinaryStreamReader reader(sectorStream);
+	LumpView lump = readMapLump(LUMP_SECTORS);
+	const size_t sectorCount = lump.size() / Layout::SIZE;
 
-	std::cout << "Loading map sectors" << std::endl;
-	std::cout << "\tidx\tfz\tcz\tft\tct" << std::endl;
+	doomSectors.reserve(sectorCount);
 
-	for (uint16_t i = 0; i < sectorCount; i++)
+	for (size_t i = 0; i < sectorCount; i++)
 	{
+		const uint8_t* record = &lump[i * Layout::SIZE];
+
 		DoomSector sector;
-		sector.floorZ = reader.readInt16();
-		sector.ceilingZ = reader.readInt16();
-		sector.floorTexture = reader.readString(TEX_NAME_SIZE);
-		sector.ceilingTexture = reader.readString(TEX_NAME_SIZE);
-
-		reader.skip(3 * sizeof(int16_t));
-
-		std::cout << std::format(
-			"\t{}\t{}\t{}\t{}\t{}\n",
-			i,
-			sector.floorZ,
-			sector.ceilingZ,
-			sector.floorTexture,
-			sector.ceilingTexture
-		);
+		sector.floorZ = readRecordField<int16_t>(record, Layout::FLOOR_Z);
+		sector.ceilingZ = readRecordField<int16_t>(record, Layout::CEILING_Z);
+		sector.lightLevel = readRecordField<int16_t>(record, Layout::LIGHT);
+		sector.floorTexture = textureNames.intern(readRecordPackedName(record, Layout::FLOOR_TEXTURE));
+		sector.ceilingTexture = textureNames.intern(readRecordPackedName(record, Layout::CEILING_TEXTURE));
 
 		doomSectors.push_back(sector);
 	}
 }
+
+void DoomMapLoader::loadSegs()
+{
+	decodeSegs<DoomSegLayout>(readMapLump(LUMP_SEGS));
+}
+
+void DoomMapLoader::loadSubsectors()
+{
+	decodeSubsectors<DoomSubsectorLayout>(readMapLump(LUMP_SUBSECTORS));
+}
+
+void DoomMapLoader::loadNodes()
+{
+	decodeNodes<DoomNodeLayout>(readMapLump(LUMP_NODES));
+}
+
+template<typename Layout>
+void DoomMapLoader::decodeSegs(const LumpView& lump)
+{
+	using VertexIndex = typename Layout::VertexIndex;
+
+	const size_t segCount = lump.size() / Layout::SIZE;
+
+	doomSegs.reserve(segCount);
+
+	for (size_t i = 0; i < segCount; i++) {
+		const uint8_t* record = &lump[i * Layout::SIZE];
+
+		DoomSeg seg;
+		seg.startVertexId = readRecordField<VertexIndex>(record, Layout::START_VERTEX);
+		seg.endVertexId = readRecordField<VertexIndex>(record, Layout::END_VERTEX);
+		seg.direction = readRecordField<uint16_t>(record, Layout::DIRECTION);
+
+		const uint16_t linedefId = readRecordField<uint16_t>(record, Layout::LINEDEF);
+		seg.linedefId = linedefId == 0xFFFF ? DoomSeg::NO_LINEDEF : linedefId;
+
+		doomSegs.push_back(seg);
+	}
+}
+
+template<typename Layout>
+void DoomMapLoader::decodeSubsectors(const LumpView& lump)
+{
+	const size_t subsectorCount = lump.size() / Layout::SIZE;
+
+	doomSubsectors.reserve(subsectorCount);
+
+	for (size_t i = 0; i < subsectorCount; i++) {
+		const uint8_t* record = &lump[i * Layout::SIZE];
+
+		DoomSubsector subsector;
+		subsector.segCount = readRecordField<uint16_t>(record, Layout::SEG_COUNT);
+		subsector.firstSegId = readRecordField<typename Layout::SegIndex>(record, Layout::FIRST_SEG);
+
+		doomSubsectors.push_back(subsector);
+	}
+}
+
+template<typename Layout>
+void DoomMapLoader::decodeNodes(const LumpView& lump)
+{
+	using ChildIndex = typename Layout::ChildIndex;
+
+	const size_t nodeCount = lump.size() > Layout::HEADER_SIZE ? (lump.size() - Layout::HEADER_SIZE) / Layout::SIZE : 0;
+
+	doomNodes.reserve(nodeCount);
+
+	for (size_t i = 0; i < nodeCount; i++) {
+		const uint8_t* record = &lump[Layout::HEADER_SIZE + i * Layout::SIZE];
+
+		DoomNode node;
+		node.x = readRecordField<int16_t>(record, Layout::X);
+		node.y = readRecordField<int16_t>(record, Layout::Y);
+		node.dx = readRecordField<int16_t>(record, Layout::DX);
+		node.dy = readRecordField<int16_t>(record, Layout::DY);
+
+		for (uint32_t side = 0; side < 2; side++)
+			for (uint32_t j = 0; j < 4; j++)
+				node.bounds[side][j] = readRecordField<int16_t>(record, Layout::BOUNDS + (side * 4 + j) * sizeof(int16_t));
+
+		// Each format marks subsectors with the top bit of its child indices.
+		for (uint32_t side = 0; side < 2; side++) {
+			const ChildIndex value = readRecordField<ChildIndex>(record, Layout::CHILDREN + side * sizeof(ChildIndex));
+			node.children[side] = (value & Layout::SUBSECTOR_BIT)
+				? (DoomNode::SUBSECTOR_BIT | (value & ~Layout::SUBSECTOR_BIT))
+				: value;
+		}
+
+		doomNodes.push_back(node);
+	}
+}
+
+DoomMapLoader::NodeFormat DoomMapLoader::detectNodeFormat(uint32_t& nodeLumpIndex) const
+{
+	// The extended formats are recognised by the signature at the start of their lump. UDMF maps
+	// keep their nodes in ZNODES, while binary maps keep them in NODES. 
+	for (const std::string& lumpName : { LUMP_ZNODES, LUMP_NODES }) {
+		if (!hasMapLump(lumpName))
+			continue;
+
+		nodeLumpIndex = indexOfMapLump(lumpName);
+
+		LumpView lump = archive->lumpData(nodeLumpIndex);
+		if (lump.size() < 4)
+			continue;
+
+		const std::string_view signature(reinterpret_cast<const char*>(lump.data()), 4);
+
+		if (signature == "XNOD" || signature == "XGLN" || signature == "XGL2" || signature == "XGL3")
+			return NodeFormat::Extended;
+		if (signature == "ZNOD" || signature == "ZGLN" || signature == "ZGL2" || signature == "ZGL3")
+			return NodeFormat::Compressed;
+		if (signature == "xNd4")
+			return NodeFormat::DeePBsp;
+	}
+
+	if (hasMapLump(LUMP_SEGS) && hasMapLump(LUMP_SUBSECTORS))
+		return NodeFormat::Vanilla;
+
+	return NodeFormat::None;
+}
+
+void DoomMapLoader::loadDeePBspNodes()
+{
+	// DeePBSP keeps the vanilla lumps, but widens every index to 32 bits. Only NODES has the 
+	// header. The vertices are still in VERTEXES. 
+	decodeSegs<DeePBspSegLayout>(readMapLump(LUMP_SEGS));
+	decodeSubsectors<DeePBspSubsectorLayout>(readMapLump(LUMP_SUBSECTORS));
+	decodeNodes<DeePBspNodeLayout>(readMapLump(LUMP_NODES));
+}
+
+void DoomMapLoader::loadExtendedNodes(uint32_t nodeLumpIndex)
+{
+	// ZDoom's extended nodes put the vertices, subsectors, segs and nodes in one lump, each 
+	// section starting with its count. The GL versions (XGLN, XGL2, XGL3) only store the start 
+	// vertex of each seg, since the segs of a subsector form a closed loop. XGL2 widens linedef 
+	// indices to 32 bits, and XGL3 also stores the partition lines as 16.16 fixed point. 
+	// The compressed versions (ZNOD, ZGLN, ZGL2, ZGL3) are the same after the signature, but 
+	// zlib compressed. 
+	LumpView lump = archive->lumpData(nodeLumpIndex);
+
+	std::string signature(reinterpret_cast<const char*>(lump.data()), 4);
+	const uint8_t* nodeData = lump.data() + 4;
+	size_t nodeDataSize = lump.size() - 4;
+
+	std::vector<uint8_t> inflated;
+	if (signature[0] == 'Z') {
+		try {
+			inflated = decompressZlib(nodeData, nodeDataSize);
+		}
+		catch (const std::runtime_error& e) {
+			throw std::runtime_error(std::format("Map '{}' has corrupt compressed nodes: {}", mapName, e.what()));
+		}
+
+		signature[0] = 'X';
+		nodeData = inflated.data();
+		nodeDataSize = inflated.size();
+	}
+
+	RecordCursor reader{ nodeData, nodeDataSize };
+
+	const bool glNodes = signature != "XNOD";
+	const bool wideLinedefIds = signature == "XGL2" || signature == "XGL3";
+	const bool fixedPointNodes = signature == "XGL3";
+
+	constexpr float FIXED_TO_FLOAT = 1.0f / 65536.0f;
+
+	// Vertices below the original count are the map's own, and the rest were added by the
+	// node builder. 
+	uint32_t originalVertexCount = reader.readUint32();
+	uint32_t newVertexCount = reader.readUint32();
+
+	if (originalVertexCount > doomVertices.size())
+		throw std::runtime_error(std::format("Map '{}' has extended nodes for a different set of vertices", mapName));
+
+	nodeVertices.assign(doomVertices.begin(), doomVertices.begin() + originalVertexCount);
+	nodeVertices.reserve(originalVertexCount + newVertexCount);
+
+	for (uint32_t i = 0; i < newVertexCount; i++) {
+		float x = reader.readInt32() * FIXED_TO_FLOAT;
+		float y = reader.readInt32() * FIXED_TO_FLOAT;
+		nodeVertices.push_back({ x, y });
+	}
+
+	// Subsectors only store their seg count. Their segs follow on from the previous subsector's. 
+	uint32_t subsectorCount = reader.readUint32();
+	doomSubsectors.reserve(subsectorCount);
+
+	uint32_t firstSegId = 0;
+	for (uint32_t i = 0; i < subsectorCount; i++) {
+		DoomSubsector subsector;
+		subsector.segCount = reader.readUint32();
+		subsector.firstSegId = firstSegId;
+
+		firstSegId += subsector.segCount;
+		doomSubsectors.push_back(subsector);
+	}
+
+	uint32_t segCount = reader.readUint32();
+	if (segCount != firstSegId)
+		throw std::runtime_error(std::format("Map '{}' has extended nodes with mismatched seg counts", mapName));
+
+	doomSegs.reserve(segCount);
+
+	for (uint32_t i = 0; i < segCount; i++) {
+		DoomSeg seg;
+		seg.startVertexId = reader.readUint32();
+		seg.endVertexId = reader.readUint32();	// The partner seg for GL nodes, which isn't needed
+
+		if (wideLinedefIds) {
+			seg.linedefId = reader.readUint32();
+		}
+		else {
+			uint16_t linedefId = reader.readUint16();
+			seg.linedefId = linedefId == 0xFFFF ? DoomSeg::NO_LINEDEF : linedefId;
+		}
+
+		seg.direction = reader.readUint8();
+
+		doomSegs.push_back(seg);
+	}
+
+	if (glNodes) {
+		for (const DoomSubsector& subsector : doomSubsectors) {
+			for (uint32_t i = 0; i < subsector.segCount; i++) {
+				uint32_t nextSegId = subsector.firstSegId + (i + 1) % subsector.segCount;
+				doomSegs[subsector.firstSegId + i].endVertexId = doomSegs[nextSegId].startVertexId;
+			}
+		}
+	}
+
+	uint32_t nodeCount = reader.readUint32();
+	doomNodes.reserve(nodeCount);
+
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		DoomNode node;
+
+		if (fixedPointNodes) {
+			node.x = reader.readInt32() * FIXED_TO_FLOAT;
+			node.y = reader.readInt32() * FIXED_TO_FLOAT;
+			node.dx = reader.readInt32() * FIXED_TO_FLOAT;
+			node.dy = reader.readInt32() * FIXED_TO_FLOAT;
+		}
+		else {
+			node.x = reader.readInt16();
+			node.y = reader.readInt16();
+			node.dx = reader.readInt16();
+			node.dy = reader.readInt16();
+		}
+
+		for (auto& bounds : node.bounds)
+			for (int16_t& value : bounds)
+				value = reader.readInt16();
+
+		node.children[0] = reader.readUint32();
+		node.children[1] = reader.readUint32();
+
+		doomNodes.push_back(node);
+	}
+
+	if (reader.overrun)
+		throw std::runtime_error(std::format("Map '{}' has truncated extended nodes", mapName));
+}
+
+void DoomMapLoader::buildBsp(Level& level) const
+{
+	BspTree& bsp = level.bsp;
+
+	if (doomSubsectors.empty())
+		return;
+
+	// Extended nodes can add their own vertices, on top of the map's. 
+	const std::vector<glm::vec2>& vertices = nodeVertices.empty() ? level.vertices : nodeVertices;
+
+	bsp.segs.reserve(doomSegs.size());
+	for (const DoomSeg& doomSeg : doomSegs) {
+		if (doomSeg.startVertexId >= vertices.size() || doomSeg.endVertexId >= vertices.size())
+			throw std::runtime_error(std::format("Map '{}' has a seg with an invalid vertex", mapName));
+
+		BspTree::Seg seg;
+		seg.start = vertices[doomSeg.startVertexId];
+		seg.end = vertices[doomSeg.endVertexId];
+		seg.wallId = BspTree::NO_WALL;
+
+		// Doom's front sidedef became the linedef's front wall when the level was built.
+		if (doomSeg.linedefId < level.lineDefs.size()) {
+			const LineDef& lineDef = level.lineDefs[doomSeg.linedefId];
+			seg.wallId = doomSeg.direction == 0 ? lineDef.frontWallId : lineDef.backWallId;
+		}
+
+		bsp.segs.push_back(seg);
+	}
+
+	bsp.subsectors.reserve(doomSubsectors.size());
+	for (const DoomSubsector& doomSubsector : doomSubsectors) {
+		BspTree::Subsector subsector{};
+		subsector.firstSegId = doomSubsector.firstSegId;
+		subsector.segCount = doomSubsector.segCount;
+		subsector.sectorId = 0;
+
+		if (static_cast<uint64_t>(subsector.firstSegId) + subsector.segCount > bsp.segs.size())
+			throw std::runtime_error(std::format("Map '{}' has a subsector with invalid segs", mapName));
+
+		// Every seg in a subsector faces the same sector, so the first real wall decides it. 
+		for (uint32_t i = 0; i < subsector.segCount; i++) {
+			uint32_t wallId = bsp.segs[subsector.firstSegId + i].wallId;
+			if (wallId != BspTree::NO_WALL) {
+				subsector.sectorId = level.walls[wallId].sectorId;
+				break;
+			}
+		}
+
+		bsp.subsectors.push_back(subsector);
+	}
+
+	auto convertChild = [&](uint32_t child) {
+		const bool isSubsector = (child & DoomNode::SUBSECTOR_BIT) != 0;
+		const uint32_t index = child & ~DoomNode::SUBSECTOR_BIT;
+
+		if (index >= (isSubsector ? doomSubsectors.size() : doomNodes.size()))
+			throw std::runtime_error(std::format("Map '{}' has a node with an invalid child", mapName));
+
+		return isSubsector ? (BspTree::LEAF_BIT | index) : index;
+	};
+
+	// Doom bounding boxes are stored as top, bottom, left, right.
+	auto convertBounds = [](const int16_t bounds[4]) {
+		return BspTree::QuantizedBox{ bounds[2], bounds[1], bounds[3], bounds[0] };
+	};
+
+	bsp.nodes.reserve(doomNodes.size());
+	bsp.children.reserve(doomNodes.size() * 2);
+	for (const DoomNode& doomNode : doomNodes) {
+		BspTree::Node node;
+		node.origin = glm::vec2{ doomNode.x, doomNode.y };
+		node.direction = glm::vec2{ doomNode.dx, doomNode.dy };
+		node.bounds[BspTree::FRONT] = convertBounds(doomNode.bounds[0]);
+		node.bounds[BspTree::BACK] = convertBounds(doomNode.bounds[1]);
+
+		bsp.nodes.push_back(node);
+		bsp.children.push_back(convertChild(doomNode.children[0]));
+		bsp.children.push_back(convertChild(doomNode.children[1]));
+	}
+
+	// The root is the last node. A map with only one subsector has no nodes at all. 
+	bsp.root = bsp.nodes.empty() ? BspTree::LEAF_BIT : static_cast<uint32_t>(bsp.nodes.size() - 1);
+
+	bsp.buildSubsectorPolygons();
+}
+
+void DoomMapLoader::loadReject(Level& level) const
+{
+	LumpView lump = readMapLump(LUMP_REJECT);
+
+	const uint64_t sectorCount = level.sectors.size();
+	const uint64_t rejectSize = (sectorCount * sectorCount + 7) / 8;
+
+	// Some editors write an empty or truncated REJECT, which can't be trusted. Levels without a
+	// PVS just treat every sector as visible. 
+	if (lump.size() < rejectSize)
+		return;
+
+	level.pvs = PotentiallyVisibleSet::fromReject(static_cast<uint32_t>(sectorCount), lump.data());
+}
+
+void DoomMapLoader::loadBlockmap(Level& level) const
+{
+	LumpView lump = readMapLump(LUMP_BLOCKMAP);
+
+	std::vector<uint16_t> words(lump.size() / sizeof(uint16_t));
+	std::memcpy(words.data(), lump.data(), words.size() * sizeof(uint16_t));
+
+	level.blockmap = Blockmap::fromLump(words, level.lineDefs.size());
+}
+
+void DoomMapLoader::buildLevel(Level& level) const
+{
+	level.vertices = doomVertices;
+	level.things = doomThings;
+
+	// Doom puts the front side of a line on its right, while the engine puts the front wall on
+	// the left so that walls wind counter-clockwise around their sector. Swapping the vertices
+	// of every line lets both formats agree on which side is the front. 
+	level.lineDefs.reserve(doomLinedefs.size());
+	for (const DoomLinedef& linedef : doomLinedefs) {
+		level.lineDefs.push_back(LineDef{
+			linedef.endVertexId,
+			linedef.startVertexId,
+			LineDef::NO_WALL,
+			LineDef::NO_WALL
+		});
+	}
+
+	// A wall that hasn't been placed into a loop yet. The start and end vertex are in the
+	// direction the wall winds around its sector. 
+	struct SectorEdge
+	{
+		uint32_t	lineDefId;
+		uint32_t	startVertexId;
+		uint32_t	endVertexId;
+		bool		isFront;
+		glm::vec3	color;
+		uint32_t	upperTextureId;
+		uint32_t	middleTextureId;
+		uint32_t	lowerTextureId;
+	};
+
+	std::vector<std::vector<SectorEdge>> sectorEdges(doomSectors.size());
+
+	// Each texture the level uses is stored once in it, and walls refer to it by index. The names
+	// are already interned, so the level's index for each is found by indexing a table. 
+	const TextureNameTable& names = textureNames;
+
+	std::vector<uint32_t> textureIds(names.size(), WallAppearance::NO_TEXTURE);
+	auto textureId = [&](TextureId name) {
+		if (name == TEX_NONE)
+			return WallAppearance::NO_TEXTURE;
+
+		if (textureIds[name] == WallAppearance::NO_TEXTURE) {
+			textureIds[name] = static_cast<uint32_t>(level.textureNames.size());
+			level.textureNames.push_back(names.name(name));
+		}
+
+		return textureIds[name];
+	};
+
+	// Flats are stored the same way, separately since they're a different namespace. 
+	std::vector<uint32_t> flatIds(names.size(), SectorAppearance::NO_FLAT);
+	auto flatId = [&](TextureId name) {
+		if (name == TEX_NONE)
+			return SectorAppearance::NO_FLAT;
+
+		if (flatIds[name] == SectorAppearance::NO_FLAT) {
+			flatIds[name] = static_cast<uint32_t>(level.flatNames.size());
+			level.flatNames.push_back(names.name(name));
+		}
+
+		return flatIds[name];
+	};
+
+	auto addEdge = [&](uint32_t lineDefId, uint32_t sidedefId, bool isFront) {
+		if (sidedefId == DoomLinedef::NO_SIDEDEF || sidedefId >= doomSidedefs.size())
+			return;
+
+		const DoomSidedef& sidedef = doomSidedefs[sidedefId];
+		if (sidedef.sectorId >= doomSectors.size())
+			return;
+
+		// Walls only have one color, so use the texture that is most likely to be visible. 
+		const TextureId texture = sidedef.middleTexture != TEX_NONE ? sidedef.middleTexture
+			: sidedef.lowerTexture != TEX_NONE ? sidedef.lowerTexture
+			: sidedef.upperTexture;
+
+		const LineDef& lineDef = level.lineDefs[lineDefId];
+		SectorEdge edge;
+		edge.lineDefId = lineDefId;
+		edge.startVertexId = isFront ? lineDef.startVertexId : lineDef.endVertexId;
+		edge.endVertexId = isFront ? lineDef.endVertexId : lineDef.startVertexId;
+		edge.isFront = isFront;
+		edge.color = colorFromTextureName(names.packedName(texture));
+		edge.upperTextureId = textureId(sidedef.upperTexture);
+		edge.middleTextureId = textureId(sidedef.middleTexture);
+		edge.lowerTextureId = textureId(sidedef.lowerTexture);
+
+		sectorEdges[sidedef.sectorId].push_back(edge);
+	};
+
+	for (uint32_t i = 0; i < doomLinedefs.size(); i++) {
+		addEdge(i, doomLinedefs[i].frontSidedefId, true);
+		addEdge(i, doomLinedefs[i].backSidedefId, false);
+	}
+
+	level.sectors.reserve(doomSectors.size());
+	level.sectorAppearances.reserve(doomSectors.size());
+	level.walls.reserve(doomSidedefs.size());
+	level.wallAppearances.reserve(doomSidedefs.size());
+
+	for (uint32_t sectorId = 0; sectorId < doomSectors.size(); sectorId++) {
+		const DoomSector& doomSector = doomSectors[sectorId];
+		std::vector<SectorEdge>& edges = sectorEdges[sectorId];
+
+		Sector sector;
+		sector.firstWallId = static_cast<uint32_t>(level.walls.size());
+		sector.wallCount = static_cast<uint32_t>(edges.size());
+		sector.floorZ = doomSector.floorZ;
+		sector.ceilingZ = doomSector.ceilingZ;
+
+		SectorAppearance appearance;
+		appearance.lightLevel = doomSector.lightLevel;
+		appearance.floorColor = colorFromTextureName(names.packedName(doomSector.floorTexture));
+		appearance.ceilingColor = colorFromTextureName(names.packedName(doomSector.ceilingTexture));
+		appearance.floorFlatId = flatId(doomSector.floorTexture);
+		appearance.ceilingFlatId = flatId(doomSector.ceilingTexture);
+
+		// Chain the edges into loops by following each edge to the one that starts where it ends.
+		// Sectors are small, so looking the next edge up in a multimap is plenty fast. 
+		std::multimap<uint32_t, size_t> edgesByStart;
+		for (size_t i = 0; i < edges.size(); i++)
+			edgesByStart.emplace(edges[i].startVertexId, i);
+
+		std::vector<bool> used(edges.size(), false);
+
+		for (size_t first = 0; first < edges.size(); first++) {
+			if (used[first])
+				continue;
+
+			size_t current = first;
+			while (true) {
+				used[current] = true;
+
+				const SectorEdge& edge = edges[current];
+				const uint32_t wallId = level.addWall(Wall{ edge.lineDefId, sectorId, false },
+					WallAppearance{ edge.color, edge.upperTextureId, edge.middleTextureId, edge.lowerTextureId });
+
+				LineDef& lineDef = level.lineDefs[edge.lineDefId];
+				(edge.isFront ? lineDef.frontWallId : lineDef.backWallId) = wallId;
+
+				// Find an unused edge that continues the loop. If there isn't one, either the loop
+				// is closed or the sector is broken. Either way this loop is finished. 
+				size_t next = edges.size();
+				auto [begin, end] = edgesByStart.equal_range(edge.endVertexId);
+				for (auto it = begin; it != end; ++it) {
+					if (!used[it->second]) {
+						next = it->second;
+						break;
+					}
+				}
+
+				if (next == edges.size() || edge.endVertexId == edges[first].startVertexId) {
+					level.walls.back().endOfLoop = true;
+					break;
+				}
+
+				current = next;
+			}
+		}
+
+		level.addSector(sector, appearance);
+	}
+}
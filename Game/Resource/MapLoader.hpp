@@ -10,9 +10,14 @@
 
 #include <glm/glm.hpp>
 
+#include <Resource/Archive.hpp>
 #include <Resource/WadFile.hpp>
+#include <Resource/DoomFormat.hpp>
+#include <Resource/TextureNames.hpp>
 #include <Level.hpp>
 
+class ResourceManager;
+
 /**
  * @brief Interface for map loaders, allowing multiple map formats to be supported. 
  * 
@@ -45,37 +50,83 @@ class DoomMapLoader : public MapLoader
 public:
 	DoomMapLoader(const std::string&& fileName, const std::string&& mapName = "MAP01");
 
+	/** @brief Loads the map with the given marker lump from an archive that is already open */
+	DoomMapLoader(std::shared_ptr<const Archive> archive, uint32_t mapMarkerIndex);
+
+	/** @brief Loads the winning instance of a map from the archives mounted in a resource manager */
+	DoomMapLoader(const ResourceManager& resources, const std::string& mapName = "MAP01");
+
+	/** @brief Returns true if the lump name is a Doom map marker (ExMy or MAPxx) */
+	static bool isMapMarker(const std::string& lumpName);
+
 	std::unique_ptr<Level> loadLevel() override;
 
 private:
+	// Doom's lumps store indices as 16 bits, while the extended node formats use 32 bits. Both are
+	// read into the same structures, so everything past loading works with 32-bit indices. 
+
 	struct DoomLinedef
 	{
-		static const uint16_t NO_SIDEDEF = 0xFFFF;
+		static const uint32_t NO_SIDEDEF = 0xFFFFFFFF;
 
-		uint16_t id;
-		uint16_t startVertexId;
-		uint16_t endVertexId;
-		uint16_t frontSidedefId;
-		uint16_t backSidedefId;
+		uint32_t startVertexId;
+		uint32_t endVertexId;
+		uint32_t frontSidedefId;
+		uint32_t backSidedefId;
 	};
 
 	struct DoomSidedef
 	{
-		uint16_t	id;
-		uint16_t	sectorId;
-		uint16_t	linedefId;
-		std::string upperTexture;
-		std::string middleTexture;
-		std::string lowerTexture;
+		uint32_t	sectorId;
+		uint32_t	linedefId;
+		TextureId	upperTexture;
+		TextureId	middleTexture;
+		TextureId	lowerTexture;
+	};
+
+	struct DoomSeg
+	{
+		static const uint32_t NO_LINEDEF = 0xFFFFFFFF;
+
+		uint32_t	startVertexId;
+		uint32_t	endVertexId;
+		uint32_t	linedefId;		// NO_LINEDEF for minisegs, which only GL nodes have
+		uint32_t	direction;		// 0 if the seg runs the same way as its linedef
+	};
+
+	struct DoomSubsector
+	{
+		uint32_t	segCount;
+		uint32_t	firstSegId;
+	};
+
+	struct DoomNode
+	{
+		static const uint32_t SUBSECTOR_BIT = 0x80000000;
+
+		float		x, y, dx, dy;	// Partition line. Only fractional for XGL3 nodes
+		int16_t		bounds[2][4];	// Right, then left child bounds, as top, bottom, left, right
+		uint32_t	children[2];	// Right, then left child
+	};
+
+	/** @brief The formats that node builders store their output in */
+	enum class NodeFormat
+	{
+		None,			// The map hasn't been through a node builder
+		Vanilla,		// Doom's own SEGS, SSECTORS and NODES, with 16-bit indices
+		DeePBsp,		// DeePBSP's version of the vanilla lumps with 32-bit indices, marked by "xNd4" in NODES
+		Extended,		// ZDoom's extended nodes in a single NODES or ZNODES lump: XNOD, XGLN, XGL2 or XGL3
+		Compressed		// The zlib compressed version of the extended nodes: ZNOD, ZGLN, ZGL2 or ZGL3
 	};
 
 	struct DoomSector
 	{
-		int16_t		floorZ;
-		int16_t		ceilingZ;
+		float		floorZ;
+		float		ceilingZ;
+		float		lightLevel;
 
-		std::string	floorTexture;
-		std::string ceilingTexture;
+		TextureId	floorTexture;
+		TextureId	ceilingTexture;
 	};
 
 	// Names for the different map lumps that are used by Doom
@@ -83,31 +134,98 @@ private:
 	const std::string LUMP_LINEDEFS	= "LINEDEFS";
 	const std::string LUMP_SIDEDEFS = "SIDEDEFS";
 	const std::string LUMP_SECTORS	= "SECTORS";
+	const std::string LUMP_THINGS	= "THINGS";
+	const std::string LUMP_SEGS		= "SEGS";
+	const std::string LUMP_SUBSECTORS = "SSECTORS";
+	const std::string LUMP_NODES	= "NODES";
+	const std::string LUMP_REJECT	= "REJECT";
+	const std::string LUMP_BLOCKMAP	= "BLOCKMAP";
+	const std::string LUMP_ZNODES	= "ZNODES";
+	const std::string LUMP_BEHAVIOR	= "BEHAVIOR";
+	const std::string LUMP_TEXTMAP	= "TEXTMAP";
+
+	// Texture id that corresponds to no texture, which maps write as "-"
+	static constexpr TextureId TEX_NONE = TextureNameTable::NO_TEXTURE;
+
+	// Light level of UDMF sectors that don't give one, from the UDMF spec
+	static constexpr float UDMF_DEFAULT_LIGHT_LEVEL = 160.0f;
 
-	// Sizes of individual object entries in the map files.
-	const uint32_t VERTEX_ENTRY_SIZE	= 4;
-	const uint32_t SIDEDEF_ENTRY_SIZE	= 30;
-	const uint32_t LINEDEF_ENTRY_SIZE	= 14;
-	const uint32_t SECTOR_ENTRY_SIZE	= 26;
+	std::shared_ptr<const Archive>	archive;
+	TextureNameTable&				textureNames = TextureNameTable::global();
+	uint32_t						mapMarkerIndex;
+	std::string						mapName;
+	DoomMapFormat					format = DoomMapFormat::Doom;
 
-	// Max number of characters in a texture name
-	const size_t TEX_NAME_SIZE = 8;
+	/** @brief Returns the index of one of this map's lumps, which follow the map's marker */
+	uint32_t indexOfMapLump(const std::string& lumpName) const;
 
-	// String that corresponds to no texture
-	const std::string TEX_NONE = "-";
+	/** @brief Returns true if the map has a non-empty lump with the given name */
+	bool hasMapLump(const std::string& lumpName) const;
 
-	WadFile			wadFile;
-	std::string		mapName;
+	/** @brief Reads the whole of one of this map's lumps */
+	LumpView readMapLump(const std::string& lumpName) const;
 
 	void loadVertices();
 	void loadSidedefs();
 	void loadLinedefs();
 	void loadSectors();
+	void loadThings();
+
+	template<typename Layout>
+	void decodeLinedefs(const LumpView& lump);
+
+	template<typename Layout>
+	void decodeThings(const LumpView& lump);
+
+	/** @brief Loads the vertices, sidedefs, linedefs, sectors and things of a UDMF map from its TEXTMAP */
+	void loadTextMap();
+
+	/** @brief Points each sidedef back at its linedef, checking the linedefs' indices on the way */
+	void linkSidedefs();
+
+	/** @brief Works out which format the map's nodes are in, and which lump holds them */
+	NodeFormat detectNodeFormat(uint32_t& nodeLumpIndex) const;
+
+	void loadSegs();
+	void loadSubsectors();
+	void loadNodes();
+
+	template<typename Layout>
+	void decodeSegs(const LumpView& lump);
+
+	template<typename Layout>
+	void decodeSubsectors(const LumpView& lump);
+
+	template<typename Layout>
+	void decodeNodes(const LumpView& lump);
+
+	void loadDeePBspNodes();
+	void loadExtendedNodes(uint32_t nodeLumpIndex);
+
+	/** @brief Converts the loaded Doom structures into the engine's level format */
+	void buildLevel(Level& level) const;
+
+	/** @brief Converts the node builder output into the level's BSP tree */
+	void buildBsp(Level& level) const;
+
+	/** @brief Uses the map's REJECT lump as the level's PVS, if it has a usable one */
+	void loadReject(Level& level) const;
+
+	/** @brief Reads the map's BLOCKMAP lump, leaving the level's blockmap empty if it's unusable */
+	void loadBlockmap(Level& level) const;
 
 	std::vector<glm::vec2>		doomVertices;
 	std::vector<DoomSidedef>	doomSidedefs;
 	std::vector<DoomLinedef>	doomLinedefs;
 	std::vector<DoomSector>		doomSectors;
+	std::vector<Thing>			doomThings;
+	std::vector<DoomSeg>		doomSegs;
+	std::vector<DoomSubsector>	doomSubsectors;
+	std::vector<DoomNode>		doomNodes;
+
+	// The vertices the segs refer to, when the node builder added its own. Empty when the segs
+	// only use the map's vertices. 
+	std::vector<glm::vec2>		nodeVertices;
 };
 
 #endif//MAP_LOADER_HPP_INCLUDED
\ No newline at end of file
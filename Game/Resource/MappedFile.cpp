@@ -0,0 +1,99 @@
+#include "MappedFile.hpp"
+
+#include <format>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+	_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE) {
+		_file = nullptr;
+		throw std::runtime_error(std::format("Failed to open file: {}", fileName));
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize)) {
+		CloseHandle(_file);
+		throw std::runtime_error(std::format("Failed to get the size of file: {}", fileName));
+	}
+
+	_size = static_cast<size_t>(fileSize.QuadPart);
+
+	// Empty files can't be mapped, but there's nothing to read from them anyway.
+	if (_size == 0)
+		return;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping != nullptr)
+		_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (_data == nullptr) {
+		if (_mapping != nullptr)
+			CloseHandle(_mapping);
+		CloseHandle(_file);
+		throw std::runtime_error(std::format("Failed to map file: {}", fileName));
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data != nullptr)
+		UnmapViewOfFile(_data);
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	if (_file != nullptr)
+		CloseHandle(_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error(std::format("Failed to open file: {}", fileName));
+
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		throw std::runtime_error(std::format("Failed to get the size of file: {}", fileName));
+	}
+
+	_size = static_cast<size_t>(status.st_size);
+
+	// The mapping stays valid after the file is closed. Empty files can't be mapped, but there's
+	// nothing to read from them anyway.
+	if (_size != 0) {
+		void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			close(file);
+			throw std::runtime_error(std::format("Failed to map file: {}", fileName));
+		}
+
+		_data = static_cast<const uint8_t*>(data);
+	}
+
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (_data != nullptr)
+		munmap(const_cast<uint8_t*>(_data), _size);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP_INCLUDED
+#define MAPPED_FILE_HPP_INCLUDED
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * @details Pages are only read from disk as they're touched, so mapping a large archive is
+ *			cheap, and parts of it can be handed out as views without copying. The mapping is
+ *			read-only, so it can be shared between threads.
+ */
+class MappedFile
+{
+public:
+	MappedFile(const std::string& fileName);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const { return _data; }
+	size_t size() const { return _size; }
+
+private:
+	const uint8_t*	_data = nullptr;
+	size_t			_size = 0;
+
+#ifdef _WIN32
+	void*			_file = nullptr;
+	void*			_mapping = nullptr;
+#endif
+};
+
+#endif//MAPPED_FILE_HPP_INCLUDED
@@ -0,0 +1,283 @@
+#include "PngDecoder.hpp"
+
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <format>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <Resource/Inflate.hpp>
+
+namespace
+{
+	constexpr uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	enum ColorType : uint8_t
+	{
+		Grayscale		= 0,
+		Rgb				= 2,
+		Indexed			= 3,
+		GrayscaleAlpha	= 4,
+		Rgba			= 6,
+	};
+
+	enum FilterType : uint8_t
+	{
+		None	= 0,
+		Sub		= 1,
+		Up		= 2,
+		Average	= 3,
+		Paeth	= 4,
+	};
+
+	/** @brief PNG stores its integers big endian */
+	uint32_t readBigEndian32(const uint8_t* data)
+	{
+		return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+	}
+
+	uint32_t packColor(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	uint8_t paethPredictor(int32_t left, int32_t up, int32_t upLeft)
+	{
+		const int32_t estimate = left + up - upLeft;
+		const int32_t distanceLeft = std::abs(estimate - left);
+		const int32_t distanceUp = std::abs(estimate - up);
+		const int32_t distanceUpLeft = std::abs(estimate - upLeft);
+
+		if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+			return static_cast<uint8_t>(left);
+		if (distanceUp <= distanceUpLeft)
+			return static_cast<uint8_t>(up);
+		return static_cast<uint8_t>(upLeft);
+	}
+
+	/**
+	 * @brief Undoes the filter on each row in place. Each row is its filter type followed by its
+	 *			bytes, and filters predict a byte from the ones to its left, above, and above left.
+	 */
+	void unfilter(std::vector<uint8_t>& data, uint32_t height, size_t rowSize, size_t bytesPerPixel)
+	{
+		const size_t stride = rowSize + 1;
+
+		for (uint32_t y = 0; y < height; y++) {
+			const uint8_t filter = data[y * stride];
+			uint8_t* row = &data[y * stride + 1];
+			const uint8_t* above = y > 0 ? &data[(y - 1) * stride + 1] : nullptr;
+
+			switch (filter)
+			{
+			case None:
+				break;
+
+			case Sub:
+				for (size_t i = bytesPerPixel; i < rowSize; i++)
+					row[i] += row[i - bytesPerPixel];
+				break;
+
+			case Up:
+				if (above != nullptr)
+					for (size_t i = 0; i < rowSize; i++)
+						row[i] += above[i];
+				break;
+
+			case Average:
+				for (size_t i = 0; i < rowSize; i++) {
+					const uint32_t left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					const uint32_t up = above != nullptr ? above[i] : 0;
+					row[i] += static_cast<uint8_t>((left + up) / 2);
+				}
+				break;
+
+			case Paeth:
+				for (size_t i = 0; i < rowSize; i++) {
+					const int32_t left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					const int32_t up = above != nullptr ? above[i] : 0;
+					const int32_t upLeft = above != nullptr && i >= bytesPerPixel ? above[i - bytesPerPixel] : 0;
+					row[i] += paethPredictor(left, up, upLeft);
+				}
+				break;
+
+			default:
+				throw std::runtime_error(std::format("PNG row {} has unknown filter type {}", y, filter));
+			}
+		}
+	}
+}
+
+RgbaImage decodePng(const uint8_t* data, size_t size)
+{
+	if (size < sizeof(PNG_SIGNATURE) || std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+		throw std::runtime_error("Not a PNG file");
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint8_t bitDepth = 0;
+	uint8_t colorType = 0;
+
+	// Palette colors, with the alpha from tRNS if there is one
+	std::array<uint32_t, 256> palette{};
+	uint32_t paletteSize = 0;
+
+	// Grayscale and RGB images can have one color that's transparent, stored at the image's depth
+	bool hasColorKey = false;
+	uint16_t colorKey[3] = {};
+
+	std::vector<uint8_t> compressed;
+	bool seenEnd = false;
+
+	// Every chunk is its length, its type, its data, and a CRC of the type and data.
+	size_t offset = sizeof(PNG_SIGNATURE);
+	while (!seenEnd) {
+		if (offset + 12 > size)
+			throw std::runtime_error("PNG is missing its IEND chunk");
+
+		const uint32_t length = readBigEndian32(data + offset);
+		if (length > size - offset - 12)
+			throw std::runtime_error("PNG chunk runs past the end of the file");
+
+		const uint8_t* type = data + offset + 4;
+		const uint8_t* chunk = data + offset + 8;
+
+		if (computeCrc32(type, length + 4) != readBigEndian32(chunk + length))
+			throw std::runtime_error(std::format("PNG chunk '{}' failed its CRC check", std::string(reinterpret_cast<const char*>(type), 4)));
+
+		if (std::memcmp(type, "IHDR", 4) == 0) {
+			if (length < 13)
+				throw std::runtime_error("PNG IHDR chunk is too small");
+
+			width = readBigEndian32(chunk);
+			height = readBigEndian32(chunk + 4);
+			bitDepth = chunk[8];
+			colorType = chunk[9];
+
+			if (chunk[12] != 0)
+				throw std::runtime_error("Interlaced PNGs are not supported");
+		}
+		else if (std::memcmp(type, "PLTE", 4) == 0) {
+			paletteSize = std::min<uint32_t>(length / 3, 256);
+			for (uint32_t i = 0; i < paletteSize; i++)
+				palette[i] = packColor(chunk[i * 3], chunk[i * 3 + 1], chunk[i * 3 + 2], 0xFF);
+		}
+		else if (std::memcmp(type, "tRNS", 4) == 0) {
+			if (colorType == Indexed) {
+				for (uint32_t i = 0; i < length && i < 256; i++)
+					palette[i] = (palette[i] & 0x00FFFFFF) | (static_cast<uint32_t>(chunk[i]) << 24);
+			}
+			else {
+				hasColorKey = true;
+				for (uint32_t i = 0; i < 3 && i * 2 + 1 < length; i++)
+					colorKey[i] = static_cast<uint16_t>((chunk[i * 2] << 8) | chunk[i * 2 + 1]);
+			}
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0) {
+			seenEnd = true;
+		}
+
+		offset += 12 + static_cast<size_t>(length);
+	}
+
+	uint32_t channels = 0;
+	switch (colorType)
+	{
+	case Grayscale:			channels = 1; break;
+	case Rgb:				channels = 3; break;
+	case Indexed:			channels = 1; break;
+	case GrayscaleAlpha:	channels = 2; break;
+	case Rgba:				channels = 4; break;
+	default:
+		throw std::runtime_error(std::format("PNG has unknown color type {}", colorType));
+	}
+
+	const bool validDepth = bitDepth == 8 || bitDepth == 16 || ((colorType == Grayscale || colorType == Indexed) && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4));
+	if (!validDepth || (colorType == Indexed && bitDepth == 16))
+		throw std::runtime_error(std::format("PNG has an invalid bit depth of {} for color type {}", bitDepth, colorType));
+
+	if (width == 0 || height == 0 || width > 0x8000 || height > 0x8000)
+		throw std::runtime_error(std::format("PNG has an unsupported size of {}x{}", width, height));
+
+	const size_t bitsPerPixel = static_cast<size_t>(channels) * bitDepth;
+	const size_t rowSize = (width * bitsPerPixel + 7) / 8;
+	const size_t bytesPerPixel = std::max<size_t>(bitsPerPixel / 8, 1);
+
+	std::vector<uint8_t> filtered = decompressZlib(compressed.data(), compressed.size(), height * (rowSize + 1));
+	unfilter(filtered, height, rowSize, bytesPerPixel);
+
+	RgbaImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(static_cast<size_t>(width) * height);
+
+	// Samples are read at the image's depth, then scaled up or cut down to 8 bits. 
+	const uint32_t sampleMax = (1u << std::min<uint32_t>(bitDepth, 8)) - 1;
+
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* row = &filtered[y * (rowSize + 1) + 1];
+		uint32_t* out = &image.pixels[static_cast<size_t>(y) * width];
+
+		auto sample = [&](size_t index) -> uint16_t {
+			if (bitDepth == 16)
+				return static_cast<uint16_t>((row[index * 2] << 8) | row[index * 2 + 1]);
+			if (bitDepth == 8)
+				return row[index];
+
+			const size_t bit = index * bitDepth;
+			return static_cast<uint16_t>((row[bit / 8] >> (8 - bitDepth - bit % 8)) & sampleMax);
+		};
+
+		auto to8Bits = [&](uint16_t value) -> uint32_t {
+			if (bitDepth == 16)
+				return value >> 8;
+			return value * 255 / sampleMax;
+		};
+
+		for (uint32_t x = 0; x < width; x++) {
+			switch (colorType)
+			{
+			case Grayscale: {
+				const uint16_t gray = sample(x);
+				const uint32_t value = to8Bits(gray);
+				const uint32_t alpha = hasColorKey && gray == colorKey[0] ? 0 : 0xFF;
+				out[x] = packColor(value, value, value, alpha);
+				break;
+			}
+
+			case Rgb: {
+				const uint16_t r = sample(x * 3), g = sample(x * 3 + 1), b = sample(x * 3 + 2);
+				const bool keyed = hasColorKey && r == colorKey[0] && g == colorKey[1] && b == colorKey[2];
+				out[x] = packColor(to8Bits(r), to8Bits(g), to8Bits(b), keyed ? 0 : 0xFF);
+				break;
+			}
+
+			case Indexed: {
+				const uint16_t index = sample(x);
+				if (index >= paletteSize)
+					throw std::runtime_error(std::format("PNG pixel uses color {} of a {} color palette", index, paletteSize));
+				out[x] = palette[index];
+				break;
+			}
+
+			case GrayscaleAlpha: {
+				const uint32_t value = to8Bits(sample(x * 2));
+				out[x] = packColor(value, value, value, to8Bits(sample(x * 2 + 1)));
+				break;
+			}
+
+			case Rgba:
+				out[x] = packColor(to8Bits(sample(x * 4)), to8Bits(sample(x * 4 + 1)), to8Bits(sample(x * 4 + 2)), to8Bits(sample(x * 4 + 3)));
+				break;
+			}
+		}
+	}
+
+	return image;
+}
@@ -0,0 +1,19 @@
+#ifndef PNG_DECODER_HPP_INCLUDED
+#define PNG_DECODER_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+
+#include <Resource/RgbaImage.hpp>
+
+/**
+ * @brief Decodes a PNG file into an RGBA image.
+ *
+ * @details Every color type and bit depth in the PNG spec is supported, including palettes and
+ *			tRNS transparency. 16-bit channels are cut down to 8 bits. Interlaced images aren't
+ *			supported, since nothing the game ships uses them. Throws if the data isn't a valid 
+ *			PNG, or a chunk fails its CRC check.
+ */
+RgbaImage decodePng(const uint8_t* data, size_t size);
+
+#endif//PNG_DECODER_HPP_INCLUDED
@@ -0,0 +1,133 @@
+#include "ResourceManager.hpp"
+
+#include <array>
+#include <format>
+#include <stdexcept>
+
+#include <Resource/WadFile.hpp>
+#include <Resource/ZipArchive.hpp>
+#include <Resource/MapLoader.hpp>
+
+void ResourceManager::mount(const std::string& fileName)
+{
+	if (ZipArchive::isZipFile(fileName))
+		mount(std::make_shared<const ZipArchive>(fileName));
+	else
+		mount(std::make_shared<const WadFile>(fileName));
+}
+
+void ResourceManager::mount(std::shared_ptr<const Archive> archive)
+{
+	const uint32_t archiveIndex = static_cast<uint32_t>(archives.size());
+	archives.push_back(archive);
+
+	lumpIndex.reserve(lumpIndex.size() + archive->lumpCount());
+
+	const uint32_t lumpCount = archive->lumpCount();
+	for (uint32_t i = 0; i < lumpCount; i++) {
+		const std::string& name = archive->lumpName(i);
+		const uint64_t packedName = packLumpName(name);
+		const LumpRef ref{ archiveIndex, i };
+
+		// A marker has to be followed by the map's lumps. PK3s can have files that happen to be 
+		// named like markers, such as the wads in their maps directory. 
+		const bool hasMapLumps = i + 1 < lumpCount && isMapDataLump(archive->lumpName(i + 1));
+
+		if (DoomMapLoader::isMapMarker(name) && hasMapLumps) {
+			auto [it, inserted] = mapIndex.insert_or_assign(packedName, ref);
+			if (inserted)
+				mapOrder.push_back(packedName);
+
+			// Skip past the map's data lumps. They're found relative to the marker. 
+			while (i + 1 < lumpCount && isMapDataLump(archive->lumpName(i + 1)))
+				i++;
+
+			continue;
+		}
+
+		// Later archives simply overwrite the entries from earlier ones. Within one archive,
+		// Doom uses the last instance of a name too, so the same rule applies. 
+		lumpIndex.insert_or_assign(packedName, ref);
+	}
+}
+
+std::optional<ResourceManager::LumpRef> ResourceManager::findLump(const std::string& lumpName) const
+{
+	auto it = lumpIndex.find(packLumpName(lumpName));
+	if (it == lumpIndex.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+std::optional<ResourceManager::LumpRef> ResourceManager::findMap(const std::string& mapName) const
+{
+	auto it = mapIndex.find(packLumpName(mapName));
+	if (it == mapIndex.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+FileSubsetStream ResourceManager::lumpStream(const std::string& lumpName) const
+{
+	std::optional<LumpRef> lump = findLump(lumpName);
+	if (!lump)
+		throw std::runtime_error(std::format("Lump '{}' not found in any mounted archive", lumpName));
+
+	return lumpStream(*lump);
+}
+
+FileSubsetStream ResourceManager::lumpStream(LumpRef lump) const
+{
+	return archives[lump.archiveIndex]->lumpStream(lump.lumpIndex);
+}
+
+LumpView ResourceManager::lumpData(const std::string& lumpName) const
+{
+	std::optional<LumpRef> lump = findLump(lumpName);
+	if (!lump)
+		throw std::runtime_error(std::format("Lump '{}' not found in any mounted archive", lumpName));
+
+	return lumpData(*lump);
+}
+
+LumpView ResourceManager::lumpData(LumpRef lump) const
+{
+	return archives[lump.archiveIndex]->lumpData(lump.lumpIndex);
+}
+
+uint32_t ResourceManager::lumpSize(LumpRef lump) const
+{
+	return archives[lump.archiveIndex]->lumpSize(lump.lumpIndex);
+}
+
+std::vector<std::string> ResourceManager::mapNames() const
+{
+	std::vector<std::string> names;
+	names.reserve(mapOrder.size());
+
+	for (uint64_t packedName : mapOrder)
+		names.push_back(unpackLumpName(packedName));
+
+	return names;
+}
+
+bool ResourceManager::isMapDataLump(const std::string& lumpName)
+{
+	static const std::array<uint64_t, 16> mapLumps = {
+		packLumpName("THINGS"),		packLumpName("LINEDEFS"),	packLumpName("SIDEDEFS"),
+		packLumpName("VERTEXES"),	packLumpName("SEGS"),		packLumpName("SSECTORS"),
+		packLumpName("NODES"),		packLumpName("SECTORS"),	packLumpName("REJECT"),
+		packLumpName("BLOCKMAP"),	packLumpName("BEHAVIOR"),	packLumpName("SCRIPTS"),
+		packLumpName("TEXTMAP"),	packLumpName("ZNODES"),		packLumpName("DIALOGUE"),
+		packLumpName("ENDMAP"),
+	};
+
+	const uint64_t packedName = packLumpName(lumpName);
+	for (uint64_t mapLump : mapLumps)
+		if (mapLump == packedName)
+			return true;
+
+	return false;
+}
@@ -0,0 +1,88 @@
+#ifndef RESOURCE_MANAGER_HPP_INCLUDED
+#define RESOURCE_MANAGER_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include <Resource/Archive.hpp>
+#include <Resource/LumpName.hpp>
+
+/**
+ * @brief Mounts an ordered stack of archives and resolves lumps across all of them. 
+ * 
+ * @details Archives are mounted in order, usually an IWAD followed by any number of PWADs. When
+ *			several archives contain a lump with the same name, the one mounted last wins, the 
+ *			same way Doom resolves PWAD overrides. 
+ * 
+ *			The directories of the mounted archives are merged into a single hash table as each 
+ *			archive is mounted, so finding a lump is one hash lookup no matter how many archives
+ *			are mounted. 
+ * 
+ *			Map lumps (THINGS, LINEDEFS, etc.) are found by their position after the map's marker
+ *			rather than by name, so they are left out of the merged index. Overriding a map 
+ *			overrides all of its lumps together, since they all come from the archive with the
+ *			last marker for that map. 
+ */
+class ResourceManager
+{
+public:
+	/** @brief Where a lump lives within the mounted archives */
+	struct LumpRef
+	{
+		uint32_t	archiveIndex;	// Index of the archive in mount order
+		uint32_t	lumpIndex;		// Index of the lump within that archive's directory
+	};
+
+	/** @brief Opens and mounts an archive file, either a WAD or a PK3/zip, on top of those already mounted */
+	void mount(const std::string& fileName);
+
+	/** @brief Mounts an already opened archive on top of those already mounted */
+	void mount(std::shared_ptr<const Archive> archive);
+
+	uint32_t archiveCount() const { return static_cast<uint32_t>(archives.size()); }
+
+	const Archive& archive(uint32_t index) const { return *archives[index]; }
+	std::shared_ptr<const Archive> archivePtr(uint32_t index) const { return archives[index]; }
+
+	/** @brief Finds the winning instance of a lump, if any archive has it */
+	std::optional<LumpRef> findLump(const std::string& lumpName) const;
+
+	/** @brief Finds the marker lump of a map. The map's lumps follow it in the same archive */
+	std::optional<LumpRef> findMap(const std::string& mapName) const;
+
+	bool contains(const std::string& lumpName) const { return findLump(lumpName).has_value(); }
+
+	/** @brief Returns a stream for the winning instance of a lump. Throws if no archive has it */
+	FileSubsetStream lumpStream(const std::string& lumpName) const;
+
+	FileSubsetStream lumpStream(LumpRef lump) const;
+
+	/** @brief Returns the data of the winning instance of a lump. Throws if no archive has it */
+	LumpView lumpData(const std::string& lumpName) const;
+
+	LumpView lumpData(LumpRef lump) const;
+
+	uint32_t lumpSize(LumpRef lump) const;
+
+	/** @brief Returns the names of every map in the mounted archives, in mount order */
+	std::vector<std::string> mapNames() const;
+
+	/** @brief Returns true if the lump name is one of the lumps that make up a Doom map */
+	static bool isMapDataLump(const std::string& lumpName);
+
+private:
+	std::vector<std::shared_ptr<const Archive>> archives;
+
+	// Merged directory of every mounted archive, keyed by the packed lump name.
+	std::unordered_map<uint64_t, LumpRef, LumpNameHash> lumpIndex;
+
+	// Map markers are kept separate from other lumps so a map can't be shadowed by a lump 
+	// with the same name, and so maps can be listed without a full scan. 
+	std::unordered_map<uint64_t, LumpRef, LumpNameHash> mapIndex;
+	std::vector<uint64_t> mapOrder;
+};
+
+#endif//RESOURCE_MANAGER_HPP_INCLUDED
@@ -0,0 +1,119 @@
+#include "RgbaImage.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RGBA_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	/** @brief Averages four pixels channel by channel, rounding to nearest */
+	uint32_t averagePixels(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		uint32_t result = 0;
+
+		for (uint32_t shift = 0; shift < 32; shift += 8) {
+			const uint32_t sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+			result |= ((sum + 2) / 4) << shift;
+		}
+
+		return result;
+	}
+
+	/** @brief Box filters one output row from the two source rows under it */
+	void downsampleRow(const uint32_t* top, const uint32_t* bottom, uint32_t* out, uint32_t outWidth, bool halveWidth)
+	{
+		uint32_t x = 0;
+
+		// Without a width to halve, the column is only averaged vertically. 
+		if (!halveWidth) {
+			for (; x < outWidth; x++)
+				out[x] = averagePixels(top[x], top[x], bottom[x], bottom[x]);
+			return;
+		}
+
+#ifdef RGBA_IMAGE_SSE2
+		// Four output pixels at a time. The even and odd pixels of each row are split apart, then
+		// all four are summed per channel in 16 bits so nothing overflows. 
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		for (; x + 4 <= outWidth; x += 4) {
+			auto sumPairs = [&](const uint32_t* row, __m128i& low, __m128i& high) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 2));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 2 + 4));
+
+				__m128i even = _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0)));
+				__m128i odd = _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 3, 1)));
+
+				low = _mm_add_epi16(_mm_unpacklo_epi8(even, zero), _mm_unpacklo_epi8(odd, zero));
+				high = _mm_add_epi16(_mm_unpackhi_epi8(even, zero), _mm_unpackhi_epi8(odd, zero));
+			};
+
+			__m128i topLow, topHigh, bottomLow, bottomHigh;
+			sumPairs(top, topLow, topHigh);
+			sumPairs(bottom, bottomLow, bottomHigh);
+
+			__m128i low = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(topLow, bottomLow), rounding), 2);
+			__m128i high = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(topHigh, bottomHigh), rounding), 2);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(low, high));
+		}
+#endif
+
+		for (; x < outWidth; x++)
+			out[x] = averagePixels(top[x * 2], top[x * 2 + 1], bottom[x * 2], bottom[x * 2 + 1]);
+	}
+}
+
+RgbaImage downsampleBox(const RgbaImage& image)
+{
+	RgbaImage result;
+	result.width = std::max<uint32_t>(image.width / 2, 1);
+	result.height = std::max<uint32_t>(image.height / 2, 1);
+	result.pixels.resize(static_cast<size_t>(result.width) * result.height);
+
+	const bool halveWidth = image.width > 1;
+	const bool halveHeight = image.height > 1;
+
+	for (uint32_t y = 0; y < result.height; y++) {
+		const uint32_t* top = &image.pixels[static_cast<size_t>(halveHeight ? y * 2 : y) * image.width];
+		const uint32_t* bottom = halveHeight ? top + image.width : top;
+
+		downsampleRow(top, bottom, &result.pixels[static_cast<size_t>(y) * result.width], result.width, halveWidth);
+	}
+
+	return result;
+}
+
+std::vector<RgbaImage> buildMipChain(RgbaImage image)
+{
+	std::vector<RgbaImage> levels;
+	levels.push_back(std::move(image));
+
+	while (levels.back().width > 1 || levels.back().height > 1)
+		levels.push_back(downsampleBox(levels.back()));
+
+	return levels;
+}
+
+RgbaImage resizeNearest(const RgbaImage& image, uint32_t width, uint32_t height)
+{
+	RgbaImage result;
+	result.width = width;
+	result.height = height;
+	result.pixels.resize(static_cast<size_t>(width) * height);
+
+	for (uint32_t y = 0; y < height; y++) {
+		const uint32_t sourceY = static_cast<uint32_t>(static_cast<uint64_t>(y) * image.height / height);
+
+		for (uint32_t x = 0; x < width; x++) {
+			const uint32_t sourceX = static_cast<uint32_t>(static_cast<uint64_t>(x) * image.width / width);
+			result.pixels[static_cast<size_t>(y) * width + x] = image.pixels[static_cast<size_t>(sourceY) * image.width + sourceX];
+		}
+	}
+
+	return result;
+}
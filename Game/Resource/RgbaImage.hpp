@@ -0,0 +1,36 @@
+#ifndef RGBA_IMAGE_HPP_INCLUDED
+#define RGBA_IMAGE_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief A true color image, stored row by row with the first row at the top.
+ *
+ * @details Pixels are packed the same way as Palette colors, with red in the lowest byte, so they
+ *			can be uploaded as GL_RGBA/GL_UNSIGNED_BYTE.
+ */
+struct RgbaImage
+{
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	std::vector<uint32_t>	pixels;
+
+	bool empty() const { return width == 0 || height == 0; }
+};
+
+/**
+ * @brief Halves an image with a 2x2 box filter, like the next level of a mipmap chain.
+ *
+ * @details Sizes round down and never go below 1, the same as OpenGL's mipmap sizes. When a side
+ *			is odd, its last row or column is left out. Uses SSE2 where it's available.
+ */
+RgbaImage downsampleBox(const RgbaImage& image);
+
+/** @brief Builds every mipmap level of an image, starting with the image itself and ending at 1x1 */
+std::vector<RgbaImage> buildMipChain(RgbaImage image);
+
+/** @brief Scales an image to a new size by picking the nearest pixel */
+RgbaImage resizeNearest(const RgbaImage& image, uint32_t width, uint32_t height);
+
+#endif//RGBA_IMAGE_HPP_INCLUDED
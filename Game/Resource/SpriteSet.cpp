@@ -0,0 +1,190 @@
+#include "SpriteSet.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <Resource/ResourceManager.hpp>
+#include <Utility/ParallelFor.hpp>
+
+namespace
+{
+	constexpr size_t SPRITE_NAME_LENGTH = 4;
+
+	bool isSpriteStart(const std::string& name)
+	{
+		return name == "S_START" || name == "SS_START";
+	}
+
+	bool isSpriteEnd(const std::string& name)
+	{
+		return name == "S_END" || name == "SS_END";
+	}
+
+	/** @brief Packs the name a lump would have if it only held one rotation of a frame */
+	uint64_t packRotationName(std::string_view spriteName, char frame, char rotation)
+	{
+		char name[SPRITE_NAME_LENGTH + 2] = {};
+		std::memcpy(name, spriteName.data(), std::min(spriteName.size(), SPRITE_NAME_LENGTH));
+		name[SPRITE_NAME_LENGTH] = frame;
+		name[SPRITE_NAME_LENGTH + 1] = rotation;
+
+		return packLumpName(std::string_view(name, sizeof(name)));
+	}
+}
+
+SpriteSet::SpriteSet(const ResourceManager& resources, const std::vector<std::string>& spriteNames, uint32_t threadCount)
+{
+	std::unordered_set<uint64_t, LumpNameHash> wantedSprites;
+	for (const std::string& name : spriteNames)
+		wantedSprites.insert(packLumpName(std::string_view(name).substr(0, SPRITE_NAME_LENGTH)));
+
+	struct RotationLump
+	{
+		ResourceManager::LumpRef	lump;
+		bool						mirrored;
+	};
+	std::unordered_map<uint64_t, RotationLump, LumpNameHash> rotationLumps;
+
+	// Walk each archive's sprite namespace in directory order, so PWADs replace the rotations
+	// they have lumps for. Lumps that name two rotations are found under both.
+	for (uint32_t archiveIndex = 0; archiveIndex < resources.archiveCount(); archiveIndex++) {
+		const Archive& archive = resources.archive(archiveIndex);
+		bool inSprites = false;
+
+		for (uint32_t lumpIndex = 0; lumpIndex < archive.lumpCount(); lumpIndex++) {
+			const std::string& name = archive.lumpName(lumpIndex);
+
+			if (isSpriteStart(name)) {
+				inSprites = true;
+				continue;
+			}
+			if (isSpriteEnd(name)) {
+				inSprites = false;
+				continue;
+			}
+			if (!inSprites || name.size() < SPRITE_NAME_LENGTH + 2 || archive.lumpSize(lumpIndex) == 0)
+				continue;
+
+			const std::string_view spriteName = std::string_view(name).substr(0, SPRITE_NAME_LENGTH);
+			if (!wantedSprites.contains(packLumpName(spriteName)))
+				continue;
+
+			const ResourceManager::LumpRef lump{ archiveIndex, lumpIndex };
+			rotationLumps.insert_or_assign(packRotationName(spriteName, name[4], name[5]), RotationLump{ lump, false });
+
+			if (name.size() >= SPRITE_NAME_LENGTH + 4)
+				rotationLumps.insert_or_assign(packRotationName(spriteName, name[6], name[7]), RotationLump{ lump, true });
+		}
+	}
+
+	// Each lump becomes one frame, however many rotations use it.
+	std::unordered_map<uint64_t, uint32_t> frameIds;
+	std::vector<ResourceManager::LumpRef> frameLumps;
+
+	for (const auto& [rotationName, rotationLump] : rotationLumps) {
+		const uint64_t lumpKey = (static_cast<uint64_t>(rotationLump.lump.archiveIndex) << 32) | rotationLump.lump.lumpIndex;
+
+		auto [it, inserted] = frameIds.try_emplace(lumpKey, static_cast<uint32_t>(frameLumps.size()));
+		if (inserted)
+			frameLumps.push_back(rotationLump.lump);
+
+		rotations.emplace(rotationName, Rotation{ it->second, rotationLump.mirrored });
+	}
+
+	// Pictures that fail to decode are left empty, and don't get a place in the pages.
+	std::vector<IndexedImage> pictures(frameLumps.size());
+
+	parallelFor(frameLumps.size(), threadCount, [&](size_t i) {
+		try {
+			pictures[i] = decodeDoomPicture(resources.lumpData(frameLumps[i]));
+		}
+		catch (const std::exception&) {
+		}
+	});
+
+	pack(pictures);
+}
+
+SpriteSet::Rotation SpriteSet::findRotation(std::string_view spriteName, char frame, uint32_t rotation) const
+{
+	auto it = rotations.find(packRotationName(spriteName, frame, static_cast<char>('0' + rotation)));
+	if (it == rotations.end() && rotation != 0)
+		it = rotations.find(packRotationName(spriteName, frame, '0'));
+
+	if (it == rotations.end() || _frames[it->second.frameId].width == 0)
+		return Rotation{};
+
+	return it->second;
+}
+
+void SpriteSet::pack(const std::vector<IndexedImage>& pictures)
+{
+	_frames.assign(pictures.size(), Frame{ 0, 0, 0, 0, 0, 0, 0 });
+
+	// Shelves waste the least space when the pictures on them are about as tall as each other,
+	// so the tallest are packed first.
+	std::vector<uint32_t> order(pictures.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return pictures[a].height > pictures[b].height;
+	});
+
+	uint32_t pageCount = 0;
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t shelfHeight = 0;
+
+	for (uint32_t frameId : order) {
+		const IndexedImage& picture = pictures[frameId];
+		if (picture.empty() || picture.width > PAGE_SIZE || picture.height > PAGE_SIZE)
+			continue;
+
+		if (pageCount == 0)
+			pageCount = 1;
+
+		if (x + picture.width > PAGE_SIZE) {
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (y + picture.height > PAGE_SIZE) {
+			x = 0;
+			y = 0;
+			shelfHeight = 0;
+			pageCount++;
+		}
+
+		_frames[frameId] = Frame{ pageCount - 1, x, y, picture.width, picture.height, picture.leftOffset, picture.topOffset };
+
+		x += picture.width;
+		shelfHeight = std::max(shelfHeight, picture.height);
+		_pageHeight = std::max(_pageHeight, y + picture.height);
+	}
+
+	_pages.resize(pageCount);
+	for (IndexedImage& page : _pages) {
+		page.width = PAGE_SIZE;
+		page.height = _pageHeight;
+		page.indices.assign(static_cast<size_t>(PAGE_SIZE) * _pageHeight, 0);
+		page.mask.assign(page.indices.size(), 0);
+	}
+
+	for (uint32_t frameId = 0; frameId < _frames.size(); frameId++) {
+		const Frame& frame = _frames[frameId];
+		const IndexedImage& picture = pictures[frameId];
+		if (frame.width == 0)
+			continue;
+
+		IndexedImage& page = _pages[frame.page];
+		for (uint32_t row = 0; row < frame.height; row++) {
+			const size_t target = static_cast<size_t>(frame.y + row) * PAGE_SIZE + frame.x;
+			const size_t source = static_cast<size_t>(row) * picture.width;
+
+			std::memcpy(&page.indices[target], &picture.indices[source], picture.width);
+			std::memcpy(&page.mask[target], &picture.mask[source], picture.width);
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef SPRITE_SET_HPP_INCLUDED
+#define SPRITE_SET_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <unordered_map>
+
+#include <Resource/DoomPicture.hpp>
+#include <Resource/LumpName.hpp>
+
+class ResourceManager;
+
+/**
+ * @brief The pictures of a set of sprites from between the S_START and S_END markers, decoded
+ *			and packed into pages of one atlas.
+ *
+ * @details Sprite lumps are named with the sprite's four letters, a frame letter and a rotation:
+ *			0 for pictures that look the same from every angle, or 1 to 8 going round the thing
+ *			from its front. A lump can name a second frame and rotation after the first, which
+ *			is drawn mirrored, so the two are only stored once. PWAD lumps replace the ones with
+ *			the same frame and rotation.
+ *
+ *			Every picture of the sprites asked for is decoded on worker threads, then packed onto
+ *			shelves in PAGE_SIZE wide pages, tallest first. All pages are as tall as the tallest
+ *			one needs to be, so they can be layers of one texture array.
+ */
+class SpriteSet
+{
+public:
+	static constexpr uint32_t PAGE_SIZE = 1024;
+	static constexpr uint32_t NO_FRAME = std::numeric_limits<uint32_t>::max();
+
+	/** @brief Where a picture is in the pages, and where it's drawn from relative to its thing */
+	struct Frame
+	{
+		uint32_t	page;
+		uint32_t	x;
+		uint32_t	y;
+		uint32_t	width;
+		uint32_t	height;
+		int32_t		leftOffset;	// How far left of the thing the picture starts
+		int32_t		topOffset;	// How far above the thing's feet the picture starts
+	};
+
+	/** @brief The frame one rotation is drawn with */
+	struct Rotation
+	{
+		uint32_t	frameId = NO_FRAME;
+		bool		mirrored = false;
+	};
+
+	SpriteSet(const ResourceManager& resources, const std::vector<std::string>& spriteNames, uint32_t threadCount = 0);
+
+	/**
+	 * @brief Finds the frame for one rotation of a sprite's frame.
+	 *
+	 * @details Rotations that don't have a picture of their own use rotation 0, if there is one.
+	 *			Pictures that are missing or couldn't be decoded have no frame.
+	 */
+	Rotation findRotation(std::string_view spriteName, char frame, uint32_t rotation) const;
+
+	const std::vector<Frame>& frames() const { return _frames; }
+
+	uint32_t pageCount() const { return static_cast<uint32_t>(_pages.size()); }
+	uint32_t pageHeight() const { return _pageHeight; }
+
+	/** @brief A page's palette indices and mask, PAGE_SIZE wide and pageHeight() tall */
+	const IndexedImage& page(uint32_t index) const { return _pages[index]; }
+
+private:
+	std::vector<Frame>			_frames;
+	std::vector<IndexedImage>	_pages;
+	uint32_t					_pageHeight = 0;
+
+	// The rotations of every frame, keyed by the packed name of a lump with just the one rotation,
+	// like "POSSA2".
+	std::unordered_map<uint64_t, Rotation, LumpNameHash> rotations;
+
+	void pack(const std::vector<IndexedImage>& pictures);
+};
+
+#endif//SPRITE_SET_HPP_INCLUDED
@@ -0,0 +1,213 @@
+#include "TextureComposer.hpp"
+
+#include <format>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Resource/DoomFormat.hpp>
+#include <Resource/ResourceManager.hpp>
+#include <Utility/ParallelFor.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPOSER_SSE2
+#include <emmintrin.h>
+#endif
+
+TextureComposer::TextureComposer(const ResourceManager& resources)
+	: resources(resources), _palette(Palette::grayscale())
+{
+	if (resources.contains("PLAYPAL"))
+		_palette = Palette::fromPlaypal(resources.lumpData("PLAYPAL"));
+
+	if (resources.contains("PNAMES"))
+		readPatchNames();
+
+	// TEXTURE2 only exists in the registered and commercial IWADs.
+	for (const char* lumpName : { "TEXTURE1", "TEXTURE2" })
+		if (resources.contains(lumpName))
+			readTextureDefinitions(lumpName);
+}
+
+bool TextureComposer::isDefined(const std::string& name) const
+{
+	return definitionIndex.contains(packLumpName(name));
+}
+
+std::vector<ComposedTexture> TextureComposer::compose(const std::vector<std::string>& names, uint32_t threadCount) const
+{
+	std::vector<ComposedTexture> textures(names.size());
+	std::vector<const TextureDefinition*> textureDefinitions(names.size(), nullptr);
+
+	// Work out which patches are needed, so each is only decoded once no matter how many of the
+	// textures use it.
+	std::vector<uint32_t> patchSlots(patchNames.size(), UINT32_MAX);
+	std::vector<uint32_t> neededPatchIds;
+
+	for (size_t i = 0; i < names.size(); i++) {
+		textures[i].name = names[i];
+
+		auto it = definitionIndex.find(packLumpName(names[i]));
+		if (it == definitionIndex.end())
+			continue;
+
+		textureDefinitions[i] = &definitions[it->second];
+
+		for (const PatchPlacement& placement : textureDefinitions[i]->patches) {
+			if (patchSlots[placement.patchId] == UINT32_MAX) {
+				patchSlots[placement.patchId] = static_cast<uint32_t>(neededPatchIds.size());
+				neededPatchIds.push_back(placement.patchId);
+			}
+		}
+	}
+
+	// Patches that are missing or fail to decode are left empty, and get skipped when composing.
+	std::vector<IndexedImage> decodedPatches(neededPatchIds.size());
+
+	parallelFor(neededPatchIds.size(), threadCount, [&](size_t i) {
+		std::optional<ResourceManager::LumpRef> lump = resources.findLump(patchNames[neededPatchIds[i]]);
+		if (!lump)
+			return;
+
+		try {
+			decodedPatches[i] = decodeDoomPicture(resources.lumpData(*lump));
+		}
+		catch (const std::exception&) {
+		}
+	});
+
+	std::vector<const IndexedImage*> patchesById(patchNames.size(), nullptr);
+	for (size_t i = 0; i < neededPatchIds.size(); i++)
+		if (!decodedPatches[i].empty())
+			patchesById[neededPatchIds[i]] = &decodedPatches[i];
+
+	parallelFor(names.size(), threadCount, [&](size_t i) {
+		if (textureDefinitions[i] != nullptr)
+			composeTexture(*textureDefinitions[i], patchesById, textures[i].image);
+	});
+
+	return textures;
+}
+
+void TextureComposer::readPatchNames()
+{
+	LumpView lump = resources.lumpData("PNAMES");
+	if (lump.size() < sizeof(uint32_t))
+		throw std::runtime_error("PNAMES is too small for its header");
+
+	const uint32_t count = readRecordField<uint32_t>(lump.data(), 0);
+	if (sizeof(uint32_t) + static_cast<size_t>(count) * LUMP_NAME_SIZE > lump.size())
+		throw std::runtime_error("PNAMES is too small for its patch count");
+
+	patchNames.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+		patchNames.push_back(readRecordName(lump.data(), sizeof(uint32_t) + i * LUMP_NAME_SIZE));
+}
+
+void TextureComposer::readTextureDefinitions(const std::string& lumpName)
+{
+	// The lump starts with a count and an offset to each texture. Each texture is its name, a
+	// masked flag, its size, an unused column directory, then its patches. Each patch is where
+	// it goes, which patch from PNAMES it is, and two unused fields.
+	LumpView lump = resources.lumpData(lumpName);
+	const uint8_t* data = lump.data();
+
+	if (lump.size() < sizeof(uint32_t))
+		throw std::runtime_error(std::format("{} is too small for its header", lumpName));
+
+	const uint32_t count = readRecordField<uint32_t>(data, 0);
+	if (sizeof(uint32_t) * (1 + static_cast<size_t>(count)) > lump.size())
+		throw std::runtime_error(std::format("{} is too small for its texture count", lumpName));
+
+	for (uint32_t i = 0; i < count; i++) {
+		const size_t offset = readRecordField<uint32_t>(data, sizeof(uint32_t) * (1 + i));
+		if (offset + TEXTURE_HEADER_SIZE > lump.size())
+			throw std::runtime_error(std::format("Texture {} in {} runs past the end of the lump", i, lumpName));
+
+		TextureDefinition definition;
+		definition.name = readRecordName(data, offset);
+		definition.width = readRecordField<uint16_t>(data, offset + 12);
+		definition.height = readRecordField<uint16_t>(data, offset + 14);
+
+		const uint16_t patchCount = readRecordField<uint16_t>(data, offset + 20);
+		if (offset + TEXTURE_HEADER_SIZE + patchCount * PATCH_PLACEMENT_SIZE > lump.size())
+			throw std::runtime_error(std::format("Texture '{}' in {} runs past the end of the lump", definition.name, lumpName));
+
+		definition.patches.reserve(patchCount);
+		for (uint32_t j = 0; j < patchCount; j++) {
+			const size_t patchOffset = offset + TEXTURE_HEADER_SIZE + j * PATCH_PLACEMENT_SIZE;
+
+			PatchPlacement placement;
+			placement.originX = readRecordField<int16_t>(data, patchOffset);
+			placement.originY = readRecordField<int16_t>(data, patchOffset + 2);
+			placement.patchId = readRecordField<uint16_t>(data, patchOffset + 4);
+
+			if (placement.patchId < patchNames.size())
+				definition.patches.push_back(placement);
+		}
+
+		// The first definition of a name is the one used, as with R_TextureNumForName, so later
+		// duplicates (usually from TEXTURE2) are dropped.
+		if (definitionIndex.try_emplace(packLumpName(definition.name), static_cast<uint32_t>(definitions.size())).second)
+			definitions.push_back(std::move(definition));
+	}
+}
+
+void TextureComposer::composeTexture(const TextureDefinition& definition, const std::vector<const IndexedImage*>& patches, IndexedImage& texture)
+{
+	texture.width = definition.width;
+	texture.height = definition.height;
+	texture.indices.assign(static_cast<size_t>(texture.width) * texture.height, 0);
+	texture.mask.assign(texture.indices.size(), 0);
+
+	// Patches are drawn in order, so later ones cover earlier ones. Each is clipped to the texture.
+	for (const PatchPlacement& placement : definition.patches) {
+		const IndexedImage* patch = patches[placement.patchId];
+		if (patch == nullptr)
+			continue;
+
+		const int32_t left = std::max<int32_t>(placement.originX, 0);
+		const int32_t right = std::min<int32_t>(placement.originX + patch->width, texture.width);
+		const int32_t top = std::max<int32_t>(placement.originY, 0);
+		const int32_t bottom = std::min<int32_t>(placement.originY + patch->height, texture.height);
+
+		if (left >= right || top >= bottom)
+			continue;
+
+		for (int32_t y = top; y < bottom; y++) {
+			const size_t target = static_cast<size_t>(y) * texture.width + left;
+			const size_t source = static_cast<size_t>(y - placement.originY) * patch->width + (left - placement.originX);
+
+			blendSpan(&texture.indices[target], &texture.mask[target],
+				&patch->indices[source], &patch->mask[source], right - left);
+		}
+	}
+}
+
+void TextureComposer::blendSpan(uint8_t* indices, uint8_t* mask, const uint8_t* sourceIndices, const uint8_t* sourceMask, size_t count)
+{
+	size_t i = 0;
+
+#ifdef TEXTURE_COMPOSER_SSE2
+	// The mask bytes are all or nothing, so they select between the two images directly.
+	for (; i + 16 <= count; i += 16) {
+		__m128i select = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceMask + i));
+		__m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceIndices + i));
+		__m128i target = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+		__m128i targetMask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+
+		target = _mm_or_si128(_mm_and_si128(select, source), _mm_andnot_si128(select, target));
+		targetMask = _mm_or_si128(targetMask, select);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), target);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mask + i), targetMask);
+	}
+#endif
+
+	for (; i < count; i++) {
+		if (sourceMask[i]) {
+			indices[i] = sourceIndices[i];
+			mask[i] = 0xFF;
+		}
+	}
+}
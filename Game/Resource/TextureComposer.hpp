@@ -0,0 +1,90 @@
+#ifndef TEXTURE_COMPOSER_HPP_INCLUDED
+#define TEXTURE_COMPOSER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <Resource/DoomPicture.hpp>
+#include <Resource/LumpName.hpp>
+
+class ResourceManager;
+
+/** @brief A wall texture, put together from its patches */
+struct ComposedTexture
+{
+	std::string		name;
+	IndexedImage	image;		// Empty if the texture isn't defined by any TEXTURE lump
+};
+
+/**
+ * @brief Builds Doom's wall textures out of the patches that TEXTURE1 and TEXTURE2 lay out.
+ *
+ * @details PLAYPAL, PNAMES and the TEXTURE lumps are read when the composer is created, which is
+ *			cheap since they're small. The patches themselves are only decoded when a texture
+ *			using them is composed.
+ *
+ *			Composing a batch of textures decodes each patch they use once, spread over worker
+ *			threads, then composes the textures on the same threads. Patches are blended into
+ *			their texture a row at a time, with SSE2 where it's available, using each patch's
+ *			mask to keep what's behind its holes.
+ */
+class TextureComposer
+{
+public:
+	TextureComposer(const ResourceManager& resources);
+
+	const Palette& palette() const { return _palette; }
+
+	/** @brief Returns true if a TEXTURE lump defines the texture */
+	bool isDefined(const std::string& name) const;
+
+	/**
+	 * @brief Composes textures by name.
+	 *
+	 * @return	One texture per name, in the same order. Names without a definition come back with
+	 *			an empty image. Patches that are missing or broken are left out of their textures.
+	 */
+	std::vector<ComposedTexture> compose(const std::vector<std::string>& names, uint32_t threadCount = 0) const;
+
+private:
+	struct PatchPlacement
+	{
+		int16_t		originX;
+		int16_t		originY;
+		uint32_t	patchId;	// Index into PNAMES
+	};
+
+	struct TextureDefinition
+	{
+		std::string					name;
+		uint32_t					width;
+		uint32_t					height;
+		std::vector<PatchPlacement>	patches;
+	};
+
+	// Sizes of the Doom format entries in the TEXTURE lumps
+	static constexpr size_t TEXTURE_HEADER_SIZE = 22;
+	static constexpr size_t PATCH_PLACEMENT_SIZE = 10;
+	static constexpr size_t LUMP_NAME_SIZE = 8;
+
+	const ResourceManager&		resources;
+	Palette						_palette;
+
+	std::vector<std::string>	patchNames;
+	std::vector<TextureDefinition> definitions;
+
+	// Maps packed texture names to their definition. The first definition of a name wins.
+	std::unordered_map<uint64_t, uint32_t, LumpNameHash> definitionIndex;
+
+	void readPatchNames();
+	void readTextureDefinitions(const std::string& lumpName);
+
+	static void composeTexture(const TextureDefinition& definition, const std::vector<const IndexedImage*>& patches, IndexedImage& texture);
+
+	/** @brief Copies the pixels of a span where its mask is set, and marks them as set */
+	static void blendSpan(uint8_t* indices, uint8_t* mask, const uint8_t* sourceIndices, const uint8_t* sourceMask, size_t count);
+};
+
+#endif//TEXTURE_COMPOSER_HPP_INCLUDED
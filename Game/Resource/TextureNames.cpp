@@ -0,0 +1,102 @@
+#include "TextureNames.hpp"
+
+#include <mutex>
+#include <algorithm>
+
+namespace
+{
+	constexpr uint64_t PACKED_NO_TEXTURE = packLumpName("-");
+}
+
+TextureNameTable::TextureNameTable()
+{
+	add("-", PACKED_NO_TEXTURE);
+	idsByPackedName.emplace(0, NO_TEXTURE);
+}
+
+TextureNameTable& TextureNameTable::global()
+{
+	static TextureNameTable table;
+	return table;
+}
+
+TextureId TextureNameTable::intern(uint64_t packedName)
+{
+	{
+		std::shared_lock lock(mutex);
+
+		auto it = idsByPackedName.find(packedName);
+		if (it != idsByPackedName.end())
+			return it->second;
+	}
+
+	// Another thread may have added the name between the two locks.
+	std::unique_lock lock(mutex);
+
+	auto it = idsByPackedName.find(packedName);
+	if (it != idsByPackedName.end())
+		return it->second;
+
+	return add(unpackLumpName(packedName), packedName);
+}
+
+TextureId TextureNameTable::intern(std::string_view name)
+{
+	// Names end at the first null, the same as packing them does. 
+	name = name.substr(0, name.find('\0'));
+
+	if (name.size() <= PACKED_NAME_LENGTH)
+		return intern(packLumpName(name));
+
+	std::string upper(name);
+	std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c; });
+
+	{
+		std::shared_lock lock(mutex);
+
+		auto it = idsByLongName.find(upper);
+		if (it != idsByLongName.end())
+			return it->second;
+	}
+
+	std::unique_lock lock(mutex);
+
+	auto it = idsByLongName.find(upper);
+	if (it != idsByLongName.end())
+		return it->second;
+
+	const TextureId id = add(upper, 0);
+	idsByLongName.emplace(std::move(upper), id);
+	return id;
+}
+
+const std::string& TextureNameTable::name(TextureId id) const
+{
+	std::shared_lock lock(mutex);
+	return names[id];
+}
+
+uint64_t TextureNameTable::packedName(TextureId id) const
+{
+	std::shared_lock lock(mutex);
+	return packedNames[id];
+}
+
+uint32_t TextureNameTable::size() const
+{
+	std::shared_lock lock(mutex);
+	return static_cast<uint32_t>(names.size());
+}
+
+TextureId TextureNameTable::add(std::string name, uint64_t packedName)
+{
+	const TextureId id = static_cast<TextureId>(names.size());
+
+	names.push_back(std::move(name));
+	packedNames.push_back(packedName);
+
+	if (packedName != 0)
+		idsByPackedName.emplace(packedName, id);
+
+	return id;
+}
@@ -0,0 +1,67 @@
+#ifndef TEXTURE_NAMES_HPP_INCLUDED
+#define TEXTURE_NAMES_HPP_INCLUDED
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <Resource/LumpName.hpp>
+
+/** @brief An interned texture or flat name. Ids are dense, so anything kept per name can be an array */
+using TextureId = uint32_t;
+
+/**
+ * @brief Interns texture and flat names, so each is only stored once however often maps use it.
+ *
+ * @details Names of up to 8 characters, which is every name in a binary map, are looked up by
+ *			their packed form, so interning one straight out of a lump never allocates. UDMF maps
+ *			can use longer names, which are kept in a separate table by their uppercased string.
+ *			Both are case-insensitive, like Doom's names.
+ *
+ *			Names are never removed, so ids and the names they return stay valid for the life of
+ *			the program. Maps can be loaded on several threads at once, so the table is guarded
+ *			by a reader-writer lock. Names that are already interned only take the shared lock.
+ */
+class TextureNameTable
+{
+public:
+	// "-" and empty names both mean there's no texture, and always have this id
+	static constexpr TextureId NO_TEXTURE = 0;
+
+	TextureNameTable();
+
+	/** @brief The table that maps are loaded with */
+	static TextureNameTable& global();
+
+	TextureId intern(uint64_t packedName);
+	TextureId intern(std::string_view name);
+
+	/** @brief Returns the name of an id, uppercased, or "-" for NO_TEXTURE */
+	const std::string& name(TextureId id) const;
+
+	/** @brief Returns the packed name of an id, or 0 if the name is too long to pack */
+	uint64_t packedName(TextureId id) const;
+
+	uint32_t size() const;
+
+private:
+	static constexpr size_t PACKED_NAME_LENGTH = 8;
+
+	mutable std::shared_mutex	mutex;
+
+	// A deque, so the references name() returns aren't moved by names added after them
+	std::deque<std::string>		names;
+	std::vector<uint64_t>		packedNames;
+
+	std::unordered_map<uint64_t, TextureId, LumpNameHash>	idsByPackedName;
+	std::unordered_map<std::string, TextureId>				idsByLongName;
+
+	/** @brief Adds a name that isn't in the table yet. The exclusive lock must be held. */
+	TextureId add(std::string name, uint64_t packedName);
+};
+
+#endif//TEXTURE_NAMES_HPP_INCLUDED
@@ -0,0 +1,312 @@
+#include "UdmfTokenizer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <format>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UDMF_TOKENIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool isWhitespace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	bool isHexDigit(char c)
+	{
+		return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+	}
+
+	bool isIdentifierStart(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	bool isIdentifierChar(char c)
+	{
+		return isIdentifierStart(c) || isDigit(c);
+	}
+
+#ifdef UDMF_TOKENIZER_SSE2
+	/** @brief Returns a mask of the bytes in a chunk that lie in the range [low, high] */
+	__m128i inRange(__m128i chunk, char low, char high)
+	{
+		return _mm_and_si128(
+			_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+			_mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+	}
+#endif
+}
+
+UdmfTokenizer::UdmfTokenizer(std::string_view text)
+	: start(text.data()), position(text.data()), end(text.data() + text.size()), tokenStart(text.data())
+{
+}
+
+void UdmfTokenizer::skipWhitespace()
+{
+#ifdef UDMF_TOKENIZER_SSE2
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+
+	while (end - position >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+
+		__m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriageReturn)));
+
+		uint32_t notWhitespace = ~static_cast<uint32_t>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+		if (notWhitespace != 0) {
+			position += std::countr_zero(notWhitespace);
+			return;
+		}
+
+		position += 16;
+	}
+#endif
+
+	while (position < end && isWhitespace(*position))
+		position++;
+}
+
+const char* UdmfTokenizer::scanIdentifier(const char* from) const
+{
+	const char* p = from;
+
+#ifdef UDMF_TOKENIZER_SSE2
+	// Bytes above 127 compare as negative, so they're never counted as part of an identifier.
+	while (end - p >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+		__m128i identifier = _mm_or_si128(
+			_mm_or_si128(inRange(chunk, 'a', 'z'), inRange(chunk, 'A', 'Z')),
+			_mm_or_si128(inRange(chunk, '0', '9'), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'))));
+
+		uint32_t notIdentifier = ~static_cast<uint32_t>(_mm_movemask_epi8(identifier)) & 0xFFFF;
+		if (notIdentifier != 0)
+			return p + std::countr_zero(notIdentifier);
+
+		p += 16;
+	}
+#endif
+
+	while (p < end && isIdentifierChar(*p))
+		p++;
+
+	return p;
+}
+
+void UdmfTokenizer::skipWhitespaceAndComments()
+{
+	while (true) {
+		skipWhitespace();
+
+		if (end - position < 2 || position[0] != '/')
+			return;
+
+		if (position[1] == '/') {
+			const void* lineEnd = std::memchr(position, '\n', end - position);
+			position = lineEnd != nullptr ? static_cast<const char*>(lineEnd) + 1 : end;
+		}
+		else if (position[1] == '*') {
+			std::string_view rest(position + 2, end - position - 2);
+			size_t commentEnd = rest.find("*/");
+			position = commentEnd != std::string_view::npos ? rest.data() + commentEnd + 2 : end;
+		}
+		else {
+			return;
+		}
+	}
+}
+
+UdmfTokenizer::Token UdmfTokenizer::next()
+{
+	skipWhitespaceAndComments();
+
+	tokenStart = position;
+
+	if (position >= end)
+		return { TokenType::End, {} };
+
+	const char c = *position;
+
+	if (c == '=' || c == ';' || c == '{' || c == '}') {
+		position++;
+		return { TokenType::Symbol, std::string_view(tokenStart, 1) };
+	}
+
+	if (c == '"') {
+		const char* p = position + 1;
+		while (p < end && *p != '"') {
+			if (*p == '\\')
+				p++;
+			p++;
+		}
+
+		if (p >= end)
+			fail("Unterminated string");
+
+		Token token{ TokenType::String, std::string_view(position + 1, p - position - 1) };
+		position = p + 1;
+		return token;
+	}
+
+	if (isDigit(c) || c == '-' || c == '+' || c == '.') {
+		const char* p = position;
+		if (*p == '-' || *p == '+')
+			p++;
+
+		TokenType type = TokenType::Integer;
+
+		if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+			p += 2;
+			const char* digitsStart = p;
+
+			while (p < end && isHexDigit(*p))
+				p++;
+
+			if (p == digitsStart)
+				fail("Expected a number");
+		}
+		else {
+			const char* digitsStart = p;
+
+			while (p < end && isDigit(*p))
+				p++;
+
+			if (p < end && *p == '.') {
+				type = TokenType::Float;
+				p++;
+				while (p < end && isDigit(*p))
+					p++;
+			}
+
+			if (p < end && (*p == 'e' || *p == 'E')) {
+				type = TokenType::Float;
+				p++;
+				if (p < end && (*p == '-' || *p == '+'))
+					p++;
+				while (p < end && isDigit(*p))
+					p++;
+			}
+
+			if (p == digitsStart)
+				fail("Expected a number");
+		}
+
+		Token token{ type, std::string_view(position, p - position) };
+		position = p;
+		return token;
+	}
+
+	if (isIdentifierStart(c)) {
+		const char* p = scanIdentifier(position + 1);
+
+		Token token{ TokenType::Identifier, std::string_view(position, p - position) };
+		position = p;
+		return token;
+	}
+
+	fail(std::format("Unexpected character '{}'", c));
+}
+
+size_t UdmfTokenizer::currentLine() const
+{
+	return std::count(start, tokenStart, '\n') + 1;
+}
+
+bool UdmfTokenizer::identifierEquals(std::string_view identifier, std::string_view lowercaseName)
+{
+	if (identifier.size() != lowercaseName.size())
+		return false;
+
+	for (size_t i = 0; i < identifier.size(); i++) {
+		char c = identifier[i];
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		if (c != lowercaseName[i])
+			return false;
+	}
+
+	return true;
+}
+
+double UdmfTokenizer::parseFloat(const Token& token) const
+{
+	if (token.type == TokenType::Integer)
+		return static_cast<double>(parseInteger(token));
+	if (token.type != TokenType::Float)
+		fail(std::format("Expected a number, got '{}'", token.text));
+
+	// from_chars doesn't accept a leading plus sign.
+	std::string_view text = token.text;
+	if (text.front() == '+')
+		text.remove_prefix(1);
+
+	double value = 0.0;
+	auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (result.ec != std::errc())
+		fail(std::format("Invalid number '{}'", token.text));
+
+	return value;
+}
+
+int64_t UdmfTokenizer::parseInteger(const Token& token) const
+{
+	if (token.type != TokenType::Integer)
+		fail(std::format("Expected an integer, got '{}'", token.text));
+
+	std::string_view text = token.text;
+
+	bool negative = false;
+	if (text.front() == '-' || text.front() == '+') {
+		negative = text.front() == '-';
+		text.remove_prefix(1);
+	}
+
+	int base = 10;
+	if (text.size() >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+		base = 16;
+		text.remove_prefix(2);
+	}
+
+	int64_t value = 0;
+	auto result = std::from_chars(text.data(), text.data() + text.size(), value, base);
+	if (result.ec != std::errc() || result.ptr != text.data() + text.size())
+		fail(std::format("Invalid integer '{}'", token.text));
+
+	return negative ? -value : value;
+}
+
+bool UdmfTokenizer::parseBool(const Token& token) const
+{
+	if (token.type == TokenType::Identifier) {
+		if (identifierEquals(token.text, "true"))
+			return true;
+		if (identifierEquals(token.text, "false"))
+			return false;
+	}
+
+	fail(std::format("Expected true or false, got '{}'", token.text));
+}
+
+void UdmfTokenizer::fail(const std::string& message) const
+{
+	throw std::runtime_error(std::format("TEXTMAP line {}: {}", currentLine(), message));
+}
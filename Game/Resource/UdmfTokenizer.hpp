@@ -0,0 +1,66 @@
+#ifndef UDMF_TOKENIZER_HPP_INCLUDED
+#define UDMF_TOKENIZER_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * @brief Splits UDMF text (the TEXTMAP lump) into tokens.
+ *
+ * @details Tokens are views into the text, so the text has to outlive them, but nothing is
+ *			allocated while tokenizing. Whitespace and identifiers are scanned 16 bytes at a time
+ *			with SSE2 where it is available, since they make up most of a TEXTMAP.
+ *
+ *			Comments (both // and block comments) are skipped along with whitespace.
+ */
+class UdmfTokenizer
+{
+public:
+	enum class TokenType
+	{
+		Identifier,		// Block names, keys and the keywords true and false
+		Integer,		// Decimal, or hexadecimal starting with 0x
+		Float,
+		String,			// The text between the quotes, with escapes left in place
+		Symbol,			// One of = ; { }
+		End
+	};
+
+	struct Token
+	{
+		TokenType			type;
+		std::string_view	text;
+	};
+
+	UdmfTokenizer(std::string_view text);
+
+	/** @brief Returns the next token, or an End token once the text runs out */
+	Token next();
+
+	/** @brief Returns the line the last token was on, for error messages. This is slow. */
+	size_t currentLine() const;
+
+	/** @brief Compares an identifier with a lowercase name, ignoring case like UDMF does */
+	static bool identifierEquals(std::string_view identifier, std::string_view lowercaseName);
+
+	/** @brief Parsers for the values of tokens. These throw if the token isn't the right type. */
+	double parseFloat(const Token& token) const;
+	int64_t parseInteger(const Token& token) const;
+	bool parseBool(const Token& token) const;
+
+	/** @brief Throws an error pointing at the current line */
+	[[noreturn]] void fail(const std::string& message) const;
+
+private:
+	const char* start;
+	const char* position;
+	const char* end;
+	const char* tokenStart;
+
+	void skipWhitespaceAndComments();
+	void skipWhitespace();
+	const char* scanIdentifier(const char* from) const;
+};
+
+#endif//UDMF_TOKENIZER_HPP_INCLUDED
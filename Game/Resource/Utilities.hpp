@@ -4,6 +4,11 @@
 #include <iostream>>
 #include <istream>
 #include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <vector>
+#include <string>
 
 /**
  * @brief Helper class for reading from a binary streams.
@@ -65,6 +70,16 @@ public:
 	int32_t readInt32() { return readType<int32_t>(); }
 	int64_t readInt64() { return readType<int64_t>(); }
 
+	float readFloat() { return readType<float>(); }
+
+	/** @brief Reads an array of trivially copyable values, written by BinaryStreamWriter::writeArray */
+	template<typename T>
+	void readArray(std::vector<T>& values, size_t count)
+	{
+		values.resize(count);
+		_stream->read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+	}
+
 	void skip(size_t bytes) { _stream->seekg(bytes, std::ios::cur); }
 
 	std::istream& stream() { return *_stream; }
@@ -80,6 +95,54 @@ private:
 	}
 };
 
+/**
+ * @brief Helper class for writing to binary streams.
+ *
+ * @details Counterpart to BinaryStreamReader, used when writing files the engine
+ *          reads back later, such as compiled levels.
+ */
+class BinaryStreamWriter
+{
+public:
+	BinaryStreamWriter(std::ostream& _stream) : _stream(&_stream)
+	{
+	}
+
+	/** @brief Writes a fixed-length string to the stream, padding it with nulls */
+	void writeString(const std::string& string, size_t length)
+	{
+		for (size_t i = 0; i < length; i++)
+			_stream->put(i < string.size() ? string[i] : '\0');
+	}
+
+	void writeUint8(uint8_t value) { writeType(value); }
+	void writeUint16(uint16_t value) { writeType(value); }
+	void writeUint32(uint32_t value) { writeType(value); }
+	void writeUint64(uint64_t value) { writeType(value); }
+
+	void writeInt16(int16_t value) { writeType(value); }
+	void writeInt32(int32_t value) { writeType(value); }
+
+	void writeFloat(float value) { writeType(value); }
+
+	/** @brief Writes the raw bytes of an array of trivially copyable values */
+	template<typename T>
+	void writeArray(const std::vector<T>& values)
+	{
+		_stream->write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+
+	std::ostream& stream() { return *_stream; }
+
+private:
+	std::ostream* _stream;
+
+	template<typename T>
+	void writeType(T value) {
+		_stream->write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+};
+
 /**
  * @brief std::istream for reading a specified subset of a file. 
  * 
@@ -131,6 +194,12 @@ public:
         this->str(std::string(buffer.data(), buffer.size()));
 	}
 
+	/** @brief Creates a stream over a copy of data that's already in memory */
+	FileSubsetStream(const uint8_t* data, size_t size)
+	{
+		this->str(std::string(reinterpret_cast<const char*>(data), size));
+	}
+
 	FileSubsetStream(FileSubsetStream&& other)
 		: std::istringstream(std::move(other.str())), buffer(std::move(other.buffer))
 	{
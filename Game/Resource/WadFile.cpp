@@ -6,6 +6,7 @@
 #include <map>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 #include <Resource/Utilities.hpp>
 
@@ -36,11 +37,26 @@ void WadFile::printDirectory(std::ostream& ostream) const
 	}
 }
 
+const std::string& WadFile::archiveName() const
+{
+	return fileName;
+}
+
+uint32_t WadFile::lumpCount() const
+{
+	return static_cast<uint32_t>(directory.size());
+}
+
 uint32_t WadFile::lumpSize(uint32_t index) const
 {
 	return directory[index].size;
 }
 
+const std::string& WadFile::lumpName(uint32_t index) const
+{
+	return directory[index].name;
+}
+
 uint32_t WadFile::indexOfLump(const std::string& lumpName, uint32_t afterIndex) const
 {
 	// Find the list of lumps with the name we are looking for. 
@@ -56,11 +72,11 @@ uint32_t WadFile::indexOfLump(const std::string& lumpName, uint32_t afterIndex)
 				return i;
 
 		std::string msg = std::format("Lump with name '{}' after index {} not found", lumpName, afterIndex);
-		throw std::exception(msg.c_str());
+		throw std::runtime_error(msg);
 	}
 	else {
 		std::string msg = std::format("Lump with name '{}' after index {} not found", lumpName, afterIndex);
-		throw std::exception(msg.c_str());
+		throw std::runtime_error(msg);
 	}
 }
 
@@ -71,7 +87,7 @@ uint32_t WadFile::indexOfMapLump(const std::string& mapName, const std::string&
 	return indexOfLump(lumpName, mapMarkerIndex);
 }
 
-FileSubsetStream WadFile::lumpStream(uint32_t index)
+FileSubsetStream WadFile::lumpStream(uint32_t index) const
 {
 	const DirectoryEntry& entry = directory[index];
 		
@@ -80,14 +96,14 @@ FileSubsetStream WadFile::lumpStream(uint32_t index)
  	return stream;
 }
 
-FileSubsetStream WadFile::lumpStream(std::string& lumpName, uint32_t afterIndex)
+FileSubsetStream WadFile::lumpStream(const std::string& lumpName, uint32_t afterIndex) const
 {
 	uint32_t index = indexOfLump(lumpName, afterIndex);
 
 	return lumpStream(index);
 }
 
-FileSubsetStream WadFile::mapLumpStream(std::string& mapName, std::string& lumpName)
+FileSubsetStream WadFile::mapLumpStream(const std::string& mapName, const std::string& lumpName) const
 {
 	uint32_t index = indexOfMapLump(mapName, lumpName);
 
@@ -97,11 +113,11 @@ FileSubsetStream WadFile::mapLumpStream(std::string& mapName, std::string& lumpN
 void WadFile::loadHeader(BinaryStreamReader& reader)
 {
 	magicString = reader.readString(MAGIC_LENGTH);
-	lumpCount = reader.readUint32();
+	directoryLumpCount = reader.readUint32();
 	directoryOffset = reader.readUint32();
 
 	if (magicString != "PWAD" && magicString != "IWAD") {
-		throw std::exception("Not a valid wad file");
+		throw std::runtime_error("Not a valid wad file");
 	}
 }
 
@@ -109,7 +125,7 @@ void WadFile::loadDirectory(BinaryStreamReader& reader)
 {
 	reader.stream().seekg(directoryOffset, std::istream::beg);
 
-	for (uint32_t i = 0; i < lumpCount; i++) {
+	for (uint32_t i = 0; i < directoryLumpCount; i++) {
 		DirectoryEntry newEntry;
 		newEntry.index = i;
 		newEntry.offset = reader.readUint32();
@@ -7,11 +7,12 @@
 #include <fstream>
 
 #include <Resource/Utilities.hpp>
+#include <Resource/Archive.hpp>
 
 /**
  * @brief Class that abstracts the reading of Doom WAD files
  */
-class WadFile
+class WadFile : public Archive
 {
 public:
 	WadFile(const std::string&& fileName);
@@ -19,7 +20,15 @@ public:
 
 	void printDirectory(std::ostream& stream) const;
 
-	uint32_t lumpSize(uint32_t index) const;
+	const std::string& archiveName() const override;
+
+	/** @brief Returns the number of lumps in the wad's directory */
+	uint32_t lumpCount() const override;
+
+	uint32_t lumpSize(uint32_t index) const override;
+
+	/** @brief Returns the name of the lump at the specified index */
+	const std::string& lumpName(uint32_t index) const override;
 
 	/** @brief Returns the index of the first intance of a lump name, after the specified index */
 	uint32_t indexOfLump(const std::string& lumpName, uint32_t afterIndex = 0) const;
@@ -28,13 +37,13 @@ public:
 	uint32_t indexOfMapLump(const std::string& mapName, const std::string& lumpName) const;
 
 	/** @brief Returns a stream for reading a lump specified by the given index */
-	FileSubsetStream lumpStream(uint32_t index);
+	FileSubsetStream lumpStream(uint32_t index) const override;
 
 	/** @brief Returns a stream for reading the first insteance of a lump name, after the specified index */
-	FileSubsetStream lumpStream(std::string& lumpName, uint32_t afterIndex = 0);
+	FileSubsetStream lumpStream(const std::string& lumpName, uint32_t afterIndex = 0) const;
 	
 	/** @brief Returns a stream for reading the specified map lump for a given map name */
-	FileSubsetStream mapLumpStream(std::string& mapName, std::string& lumpName);
+	FileSubsetStream mapLumpStream(const std::string& mapName, const std::string& lumpName) const;
 
 private:
 	const size_t MAGIC_LENGTH = 4;		
@@ -63,7 +72,7 @@ private:
 	
 	std::string					magicString;
 	uint32_t					directoryOffset;
-	uint32_t					lumpCount;
+	uint32_t					directoryLumpCount;
 
 	void loadHeader(BinaryStreamReader& reader);
 	void loadDirectory(BinaryStreamReader& reader);
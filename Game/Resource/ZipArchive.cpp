@@ -0,0 +1,356 @@
+#include "ZipArchive.hpp"
+
+#include <atomic>
+#include <thread>
+#include <format>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Resource/DoomFormat.hpp>
+#include <Resource/Inflate.hpp>
+
+namespace
+{
+	constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+	constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014B50;
+	constexpr uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054B50;
+
+	constexpr size_t LOCAL_HEADER_SIZE = 30;
+	constexpr size_t CENTRAL_HEADER_SIZE = 46;
+	constexpr size_t END_OF_DIRECTORY_SIZE = 22;
+	constexpr size_t MAX_COMMENT_SIZE = 0xFFFF;
+
+	constexpr uint16_t FLAG_ENCRYPTED = 0x0001;
+
+	char toLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+
+	bool pathsEqual(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); i++)
+			if (toLower(a[i]) != toLower(b[i]))
+				return false;
+
+		return true;
+	}
+
+	/** @brief Turns a path into a lump name: the file name without its extension, at most 8 characters */
+	std::string lumpNameFromPath(std::string_view path)
+	{
+		size_t nameStart = path.find_last_of('/');
+		std::string_view name = nameStart == std::string_view::npos ? path : path.substr(nameStart + 1);
+		name = name.substr(0, name.find('.'));
+
+		std::string lumpName;
+		for (char c : name.substr(0, 8))
+			lumpName.push_back((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+
+		return lumpName;
+	}
+}
+
+ZipArchive::ZipArchive(const std::string& fileName, size_t cacheBytes)
+	: fileName(fileName), file(std::make_shared<const MappedFile>(fileName)), cacheCapacity(cacheBytes)
+{
+	readCentralDirectory();
+}
+
+bool ZipArchive::isZipFile(const std::string& fileName)
+{
+	std::ifstream stream(fileName, std::ifstream::binary);
+
+	char signature[4] = {};
+	stream.read(signature, sizeof(signature));
+
+	// Empty zips are nothing but an end of directory record.
+	return stream && signature[0] == 'P' && signature[1] == 'K'
+		&& ((signature[2] == 3 && signature[3] == 4) || (signature[2] == 5 && signature[3] == 6));
+}
+
+const std::string& ZipArchive::archiveName() const
+{
+	return fileName;
+}
+
+uint32_t ZipArchive::lumpCount() const
+{
+	return static_cast<uint32_t>(entries.size());
+}
+
+uint32_t ZipArchive::lumpSize(uint32_t index) const
+{
+	return entries[index].size;
+}
+
+const std::string& ZipArchive::lumpName(uint32_t index) const
+{
+	return entries[index].name;
+}
+
+FileSubsetStream ZipArchive::lumpStream(uint32_t index) const
+{
+	LumpView data = lumpData(index);
+
+	return FileSubsetStream(data.data(), data.size());
+}
+
+LumpView ZipArchive::lumpData(uint32_t index) const
+{
+	const Entry& entry = entries[index];
+
+	if (entry.method == static_cast<uint16_t>(Method::Stored)) {
+		if (entry.compressedSize != entry.size)
+			throw std::runtime_error(std::format("Zip entry '{}' in '{}' has mismatched sizes", entry.path, fileName));
+
+		return LumpView(entryData(entry), entry.size, file);
+	}
+
+	if (std::shared_ptr<const std::vector<uint8_t>> cached = findCached(index))
+		return LumpView(std::move(cached));
+
+	// Inflating happens outside the lock, so threads reading different entries don't wait on each
+	// other. Two threads reading the same entry at once both inflate it, which is harmless.
+	std::shared_ptr<const std::vector<uint8_t>> data = inflateEntry(entry);
+	insertCached(index, data);
+
+	return LumpView(std::move(data));
+}
+
+const std::string& ZipArchive::entryPath(uint32_t index) const
+{
+	return entries[index].path;
+}
+
+std::optional<uint32_t> ZipArchive::findEntry(std::string_view path) const
+{
+	auto [first, last] = pathIndex.equal_range(hashPath(path));
+
+	for (auto it = first; it != last; ++it)
+		if (pathsEqual(entries[it->second].path, path))
+			return it->second;
+
+	return std::nullopt;
+}
+
+void ZipArchive::prefetch(const std::vector<uint32_t>& indices, uint32_t threadCount) const
+{
+	std::vector<uint32_t> pending;
+	{
+		std::lock_guard lock(cacheMutex);
+
+		for (uint32_t index : indices)
+			if (entries[index].method != static_cast<uint16_t>(Method::Stored) && !cache.contains(index))
+				pending.push_back(index);
+	}
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	threadCount = std::clamp(threadCount, 1u, std::max(static_cast<uint32_t>(pending.size()), 1u));
+
+	std::atomic<size_t> nextIndex = 0;
+
+	// Entries that fail to inflate are skipped. The error comes back up when they're read.
+	auto worker = [&] {
+		for (size_t i = nextIndex++; i < pending.size(); i = nextIndex++) {
+			try {
+				insertCached(pending[i], inflateEntry(entries[pending[i]]));
+			}
+			catch (const std::exception&) {
+			}
+		}
+	};
+
+	std::vector<std::jthread> threads;
+	for (uint32_t i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+
+	worker();
+}
+
+size_t ZipArchive::cachedBytes() const
+{
+	std::lock_guard lock(cacheMutex);
+
+	return cacheSize;
+}
+
+void ZipArchive::readCentralDirectory()
+{
+	const uint8_t* data = file->data();
+	const size_t size = file->size();
+
+	if (size < END_OF_DIRECTORY_SIZE)
+		throw std::runtime_error(std::format("'{}' is not a valid zip file", fileName));
+
+	// The end of directory record is at the very end, unless the zip has a comment after it.
+	const size_t searchEnd = size - END_OF_DIRECTORY_SIZE;
+	const size_t searchStart = searchEnd > MAX_COMMENT_SIZE ? searchEnd - MAX_COMMENT_SIZE : 0;
+
+	const uint8_t* endOfDirectory = nullptr;
+	for (size_t offset = searchEnd + 1; offset-- > searchStart; ) {
+		if (readRecordField<uint32_t>(data, offset) == END_OF_DIRECTORY_SIGNATURE) {
+			endOfDirectory = data + offset;
+			break;
+		}
+	}
+
+	if (endOfDirectory == nullptr)
+		throw std::runtime_error(std::format("'{}' is not a valid zip file", fileName));
+
+	const uint16_t entryCount = readRecordField<uint16_t>(endOfDirectory, 10);
+	const uint32_t directorySize = readRecordField<uint32_t>(endOfDirectory, 12);
+	const uint32_t directoryOffset = readRecordField<uint32_t>(endOfDirectory, 16);
+
+	if (entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFF)
+		throw std::runtime_error(std::format("'{}' is a ZIP64 file, which isn't supported", fileName));
+	if (static_cast<size_t>(directoryOffset) + directorySize > size)
+		throw std::runtime_error(std::format("'{}' has a corrupt central directory", fileName));
+
+	entries.reserve(entryCount);
+	pathIndex.reserve(entryCount);
+
+	size_t offset = directoryOffset;
+	const size_t directoryEnd = static_cast<size_t>(directoryOffset) + directorySize;
+
+	for (uint32_t i = 0; i < entryCount; i++) {
+		if (offset + CENTRAL_HEADER_SIZE > directoryEnd || readRecordField<uint32_t>(data, offset) != CENTRAL_HEADER_SIGNATURE)
+			throw std::runtime_error(std::format("'{}' has a corrupt central directory", fileName));
+
+		const uint8_t* header = data + offset;
+		const uint16_t pathLength = readRecordField<uint16_t>(header, 28);
+		const uint16_t extraLength = readRecordField<uint16_t>(header, 30);
+		const uint16_t commentLength = readRecordField<uint16_t>(header, 32);
+
+		if (offset + CENTRAL_HEADER_SIZE + pathLength > directoryEnd)
+			throw std::runtime_error(std::format("'{}' has a corrupt central directory", fileName));
+
+		std::string path(reinterpret_cast<const char*>(header + CENTRAL_HEADER_SIZE), pathLength);
+		offset += CENTRAL_HEADER_SIZE + pathLength + extraLength + commentLength;
+
+		// Windows tools sometimes write backslashes. Directories only exist to hold their files.
+		std::replace(path.begin(), path.end(), '\\', '/');
+		if (path.empty() || path.back() == '/')
+			continue;
+
+		Entry entry;
+		entry.flags = readRecordField<uint16_t>(header, 8);
+		entry.method = readRecordField<uint16_t>(header, 10);
+		entry.crc32 = readRecordField<uint32_t>(header, 16);
+		entry.compressedSize = readRecordField<uint32_t>(header, 20);
+		entry.size = readRecordField<uint32_t>(header, 24);
+		entry.localHeaderOffset = readRecordField<uint32_t>(header, 42);
+		entry.name = lumpNameFromPath(path);
+		entry.path = std::move(path);
+
+		// Later entries with the same path win, like later lumps with the same name do. Other
+		// paths with the same hash are left alone.
+		const uint64_t hash = hashPath(entry.path);
+		const uint32_t index = static_cast<uint32_t>(entries.size());
+
+		auto [first, last] = pathIndex.equal_range(hash);
+		auto existing = std::find_if(first, last, [&](const auto& indexed) { return pathsEqual(entries[indexed.second].path, entry.path); });
+
+		if (existing != last)
+			existing->second = index;
+		else
+			pathIndex.emplace(hash, index);
+
+		entries.push_back(std::move(entry));
+	}
+}
+
+const uint8_t* ZipArchive::entryData(const Entry& entry) const
+{
+	const uint8_t* data = file->data();
+	const size_t size = file->size();
+	const size_t offset = entry.localHeaderOffset;
+
+	if (offset + LOCAL_HEADER_SIZE > size || readRecordField<uint32_t>(data, offset) != LOCAL_HEADER_SIGNATURE)
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}' has a corrupt header", entry.path, fileName));
+
+	// The local header repeats the path, but its extra field can differ from the central one.
+	const size_t dataOffset = offset + LOCAL_HEADER_SIZE
+		+ readRecordField<uint16_t>(data, offset + 26) + readRecordField<uint16_t>(data, offset + 28);
+
+	if (dataOffset + entry.compressedSize > size)
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}' runs past the end of the file", entry.path, fileName));
+
+	return data + dataOffset;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ZipArchive::inflateEntry(const Entry& entry) const
+{
+	if (entry.flags & FLAG_ENCRYPTED)
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}' is encrypted", entry.path, fileName));
+	if (entry.method != static_cast<uint16_t>(Method::Deflated))
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}' uses unsupported compression method {}", entry.path, fileName, entry.method));
+
+	std::vector<uint8_t> data;
+	try {
+		data = decompressDeflate(entryData(entry), entry.compressedSize, entry.size);
+	}
+	catch (const std::runtime_error& e) {
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}': {}", entry.path, fileName, e.what()));
+	}
+
+	if (data.size() != entry.size || computeCrc32(data.data(), data.size()) != entry.crc32)
+		throw std::runtime_error(std::format("Zip entry '{}' in '{}' is corrupt", entry.path, fileName));
+
+	return std::make_shared<const std::vector<uint8_t>>(std::move(data));
+}
+
+std::shared_ptr<const std::vector<uint8_t>> ZipArchive::findCached(uint32_t index) const
+{
+	std::lock_guard lock(cacheMutex);
+
+	auto it = cache.find(index);
+	if (it == cache.end())
+		return nullptr;
+
+	lruOrder.splice(lruOrder.begin(), lruOrder, it->second.lruPosition);
+	return it->second.data;
+}
+
+void ZipArchive::insertCached(uint32_t index, std::shared_ptr<const std::vector<uint8_t>> data) const
+{
+	const size_t size = data->size();
+
+	// Entries bigger than the whole cache would just push everything else out.
+	if (size > cacheCapacity)
+		return;
+
+	std::lock_guard lock(cacheMutex);
+
+	if (cache.contains(index))
+		return;
+
+	while (cacheSize + size > cacheCapacity && !lruOrder.empty()) {
+		auto evicted = cache.find(lruOrder.back());
+		cacheSize -= evicted->second.data->size();
+		cache.erase(evicted);
+		lruOrder.pop_back();
+	}
+
+	lruOrder.push_front(index);
+	cache.emplace(index, CachedEntry{ std::move(data), lruOrder.begin() });
+	cacheSize += size;
+}
+
+uint64_t ZipArchive::hashPath(std::string_view path)
+{
+	// FNV-1a over the lowercased path. The result is mixed again by LumpNameHash.
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (char c : path) {
+		hash ^= static_cast<uint8_t>(toLower(c));
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
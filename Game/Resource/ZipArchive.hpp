@@ -0,0 +1,126 @@
+#ifndef ZIP_ARCHIVE_HPP_INCLUDED
+#define ZIP_ARCHIVE_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <Resource/Archive.hpp>
+#include <Resource/LumpName.hpp>
+#include <Resource/MappedFile.hpp>
+
+/**
+ * @brief Archive backend for zip files, which newer Doom content ships as PK3s.
+ *
+ * @details The file is memory mapped and only its central directory is read when it's opened.
+ *			Each file in the zip becomes a lump named after its file name without the extension,
+ *			uppercased and cut to 8 characters, so "flats/FLOOR0_1.png" is the lump FLOOR0_1.
+ *			Directories are left out. The full paths are kept in a hash table, keyed by the
+ *			lowercased path, for looking entries up by path.
+ *
+ *			Stored entries are handed out as views straight into the mapping, without copying.
+ *			Deflated entries are inflated the first time they're read and kept in a cache, which
+ *			drops the least recently used entries once it grows past its budget. The cache is
+ *			guarded by a mutex, so the archive can still be shared between threads, and prefetch()
+ *			can inflate a batch of entries ahead of time on worker threads.
+ */
+class ZipArchive : public Archive
+{
+public:
+	static constexpr size_t DEFAULT_CACHE_BYTES = 64 * 1024 * 1024;
+
+	ZipArchive(const std::string& fileName, size_t cacheBytes = DEFAULT_CACHE_BYTES);
+
+	/** @brief Returns true if a file starts with a zip signature */
+	static bool isZipFile(const std::string& fileName);
+
+	const std::string& archiveName() const override;
+
+	uint32_t lumpCount() const override;
+
+	uint32_t lumpSize(uint32_t index) const override;
+
+	const std::string& lumpName(uint32_t index) const override;
+
+	FileSubsetStream lumpStream(uint32_t index) const override;
+
+	LumpView lumpData(uint32_t index) const override;
+
+	/** @brief Returns the full path of an entry within the zip */
+	const std::string& entryPath(uint32_t index) const;
+
+	/** @brief Finds an entry by its full path, ignoring case */
+	std::optional<uint32_t> findEntry(std::string_view path) const;
+
+	/**
+	 * @brief Inflates entries into the cache ahead of time, so reading them later doesn't stall.
+	 *
+	 * @param threadCount	Number of worker threads to inflate on, or 0 to use every core.
+	 *						Stored entries and entries that are already cached are skipped.
+	 */
+	void prefetch(const std::vector<uint32_t>& indices, uint32_t threadCount = 0) const;
+
+	/** @brief Returns the number of bytes of inflated data currently in the cache */
+	size_t cachedBytes() const;
+
+private:
+	enum class Method : uint16_t
+	{
+		Stored = 0,
+		Deflated = 8
+	};
+
+	struct Entry
+	{
+		std::string		path;
+		std::string		name;
+		uint32_t		localHeaderOffset;
+		uint32_t		compressedSize;
+		uint32_t		size;
+		uint32_t		crc32;
+		uint16_t		method;
+		uint16_t		flags;
+	};
+
+	struct CachedEntry
+	{
+		std::shared_ptr<const std::vector<uint8_t>>		data;
+		std::list<uint32_t>::iterator					lruPosition;
+	};
+
+	std::string						fileName;
+	std::shared_ptr<const MappedFile>	file;
+
+	std::vector<Entry>				entries;
+
+	// Keyed by a hash of the lowercased path. Paths that collide each keep their own entry, and
+	// the path is compared on lookup to pick the right one.
+	std::unordered_multimap<uint64_t, uint32_t, LumpNameHash> pathIndex;
+
+	// Inflated entries, most recently used at the front of the list.
+	mutable std::mutex				cacheMutex;
+	mutable std::unordered_map<uint32_t, CachedEntry> cache;
+	mutable std::list<uint32_t>		lruOrder;
+	mutable size_t					cacheSize = 0;
+	size_t							cacheCapacity;
+
+	void readCentralDirectory();
+
+	/** @brief Finds the start of an entry's data, which comes after its local header */
+	const uint8_t* entryData(const Entry& entry) const;
+
+	std::shared_ptr<const std::vector<uint8_t>> inflateEntry(const Entry& entry) const;
+
+	std::shared_ptr<const std::vector<uint8_t>> findCached(uint32_t index) const;
+	void insertCached(uint32_t index, std::shared_ptr<const std::vector<uint8_t>> data) const;
+
+	static uint64_t hashPath(std::string_view path);
+};
+
+#endif//ZIP_ARCHIVE_HPP_INCLUDED
@@ -0,0 +1,55 @@
+#ifndef FIXED_TIMESTEP_HPP_INCLUDED
+#define FIXED_TIMESTEP_HPP_INCLUDED
+
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief Turns variable frame times into a whole number of fixed length simulation ticks.
+ * 
+ * @details Frame time goes into an accumulator, and each tick takes a fixed slice out of it, so
+ *			the simulation runs at the same rate no matter how fast frames are drawn. What is left
+ *			over is less than a tick, and as a fraction of a tick it says how far between the last
+ *			two ticks the frame falls, for interpolating what is drawn. 
+ *
+ *			If frames take so long that more than maxTicks would be due, the extra time is dropped
+ *			and the simulation slows down, instead of falling further behind with every frame
+ *			it spends catching up.
+ */
+class FixedTimestep
+{
+public:
+	FixedTimestep(float tickSeconds, uint32_t maxTicks = 8)
+		: _tickSeconds(tickSeconds), maxTicks(maxTicks)
+	{
+	}
+
+	/** @brief Adds a frame's time, and returns how many ticks to run for it */
+	uint32_t advance(float frameSeconds)
+	{
+		accumulator += frameSeconds;
+
+		uint32_t ticks = static_cast<uint32_t>(accumulator / _tickSeconds);
+		if (ticks > maxTicks) {
+			ticks = maxTicks;
+			accumulator = 0.0f;
+		}
+		else {
+			accumulator -= ticks * _tickSeconds;
+		}
+
+		return ticks;
+	}
+
+	/** @brief How far the frame is between the last tick and the next, from 0 to 1 */
+	float alpha() const { return std::clamp(accumulator / _tickSeconds, 0.0f, 1.0f); }
+
+	float tickSeconds() const { return _tickSeconds; }
+
+private:
+	float		_tickSeconds;
+	uint32_t	maxTicks;
+	float		accumulator = 0.0f;
+};
+
+#endif//FIXED_TIMESTEP_HPP_INCLUDED
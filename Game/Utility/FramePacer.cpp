@@ -0,0 +1,103 @@
+#include "FramePacer.hpp"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+namespace
+{
+	// How early to wake up before a frame is due, to start with and at most.
+	constexpr std::chrono::microseconds INITIAL_SPIN_MARGIN(1500);
+	constexpr std::chrono::microseconds MAX_SPIN_MARGIN(4000);
+}
+
+FramePacer::FramePacer()
+	: spinMargin(INITIAL_SPIN_MARGIN), frameStart(Clock::now()), nextFrameDue(frameStart)
+{
+}
+
+void FramePacer::setTargetFps(float fps)
+{
+	_targetFps = std::max(fps, 0.0f);
+	framePeriod = _targetFps > 0.0f
+		? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _targetFps))
+		: Clock::duration::zero();
+
+	nextFrameDue = Clock::now();
+}
+
+float FramePacer::beginFrame()
+{
+	const Clock::time_point now = Clock::now();
+	const float seconds = std::chrono::duration<float>(now - frameStart).count();
+	frameStart = now;
+
+	frameTimes[nextFrame] = seconds * 1000.0f;
+	nextFrame = (nextFrame + 1) % FRAME_HISTORY;
+	frameCount++;
+
+	return seconds;
+}
+
+void FramePacer::waitForNextFrame()
+{
+	if (framePeriod == Clock::duration::zero())
+		return;
+
+	nextFrameDue += framePeriod;
+
+	// When a frame ran long, start counting again from now instead of rushing the next frames
+	// out to catch up. 
+	Clock::time_point now = Clock::now();
+	if (nextFrameDue < now) {
+		nextFrameDue = now;
+		return;
+	}
+
+	const Clock::time_point wakeUp = nextFrameDue - spinMargin;
+	if (wakeUp > now) {
+		std::this_thread::sleep_until(wakeUp);
+
+		// Wake up earlier next time if the OS overslept into the margin, and slowly creep
+		// back later when it's on time.
+		const Clock::duration overslept = Clock::now() - wakeUp;
+		if (overslept * 4 > spinMargin * 3)
+			spinMargin = std::min<Clock::duration>(spinMargin * 5 / 4, MAX_SPIN_MARGIN);
+		else
+			spinMargin = std::max<Clock::duration>(spinMargin * 63 / 64, std::chrono::microseconds(250));
+	}
+
+	while (Clock::now() < nextFrameDue)
+		std::this_thread::yield();
+}
+
+FramePacer::Stats FramePacer::stats() const
+{
+	Stats stats;
+
+	const uint32_t count = std::min(frameCount, FRAME_HISTORY);
+	if (count == 0)
+		return stats;
+
+	stats.lastMs = frameTimes[(nextFrame + FRAME_HISTORY - 1) % FRAME_HISTORY];
+	stats.minMs = frameTimes[0];
+	stats.maxMs = frameTimes[0];
+
+	double sum = 0.0;
+	for (uint32_t i = 0; i < count; i++) {
+		sum += frameTimes[i];
+		stats.minMs = std::min(stats.minMs, frameTimes[i]);
+		stats.maxMs = std::max(stats.maxMs, frameTimes[i]);
+	}
+
+	const double average = sum / count;
+
+	double variance = 0.0;
+	for (uint32_t i = 0; i < count; i++)
+		variance += (frameTimes[i] - average) * (frameTimes[i] - average);
+
+	stats.averageMs = static_cast<float>(average);
+	stats.deviationMs = static_cast<float>(std::sqrt(variance / count));
+
+	return stats;
+}
@@ -0,0 +1,70 @@
+#ifndef FRAME_PACER_HPP_INCLUDED
+#define FRAME_PACER_HPP_INCLUDED
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Measures frame times, and holds frames to a target rate when vsync isn't doing it.
+ * 
+ * @details OS sleeps can overshoot by a millisecond or more, which is a lot of a frame at high
+ *			rates. The pacer sleeps until a little before the frame is due, then spins for the
+ *			rest. How early it wakes up adapts to how late the OS has been waking it. 
+ *
+ *			The last FRAME_HISTORY frame times are kept, for the profiler to show how much they
+ *			vary as well as how long they take.
+ */
+class FramePacer
+{
+public:
+	static constexpr uint32_t FRAME_HISTORY = 128;
+
+	struct Stats
+	{
+		float lastMs = 0.0f;
+		float averageMs = 0.0f;
+		float deviationMs = 0.0f;	// Standard deviation of the frame times in the history
+		float minMs = 0.0f;
+		float maxMs = 0.0f;
+	};
+
+	FramePacer();
+
+	/** @brief Sets the frame rate to hold to. 0 lets frames run as fast as they can */
+	void setTargetFps(float fps);
+	float targetFps() const { return _targetFps; }
+
+	/**
+	 * @brief Marks the start of a frame.
+	 * 
+	 * @return The seconds since the previous frame started
+	 */
+	float beginFrame();
+
+	/** @brief Waits until the next frame is due, if there's a target rate */
+	void waitForNextFrame();
+
+	/** @brief Frame time statistics over the history */
+	Stats stats() const;
+
+	/** @brief The frame times in milliseconds, oldest first from historyStart() */
+	const std::array<float, FRAME_HISTORY>& history() const { return frameTimes; }
+	uint32_t historyStart() const { return frameCount < FRAME_HISTORY ? 0 : nextFrame; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	float				_targetFps = 0.0f;
+	Clock::duration		framePeriod {};
+	Clock::duration		spinMargin;
+
+	Clock::time_point	frameStart;
+	Clock::time_point	nextFrameDue;
+
+	std::array<float, FRAME_HISTORY> frameTimes {};
+	uint32_t			nextFrame = 0;
+	uint32_t			frameCount = 0;
+};
+
+#endif//FRAME_PACER_HPP_INCLUDED
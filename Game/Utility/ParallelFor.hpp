@@ -0,0 +1,38 @@
+#ifndef PARALLEL_FOR_HPP_INCLUDED
+#define PARALLEL_FOR_HPP_INCLUDED
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief Runs a job for every index in [0, count) on a pool of threads.
+ * 
+ * @details Threads take the next index from a shared counter, so jobs of uneven cost still
+ *			spread evenly. The calling thread works too, and the call returns once every job is
+ *			done. A thread count of 0 uses one thread per hardware thread.
+ */
+template<typename Job>
+void parallelFor(size_t count, uint32_t threadCount, Job job)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	threadCount = std::clamp<uint32_t>(threadCount, 1, static_cast<uint32_t>(std::max<size_t>(count, 1)));
+
+	std::atomic<size_t> nextIndex = 0;
+
+	auto worker = [&] {
+		for (size_t i = nextIndex++; i < count; i = nextIndex++)
+			job(i);
+	};
+
+	std::vector<std::jthread> threads;
+	for (uint32_t i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+
+	worker();
+}
+
+#endif//PARALLEL_FOR_HPP_INCLUDED
@@ -0,0 +1,156 @@
+#include "Collision.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Level.hpp>
+
+namespace
+{
+	// Moves stop this far short of walls, so rounding doesn't leave bodies inside them.
+	constexpr float SKIN_WIDTH = 1.0f / 32.0f;
+
+	constexpr uint32_t MAX_SLIDES = 3;
+
+	/** @brief The earliest point along a move where a circle touches something */
+	struct Contact
+	{
+		float		time = std::numeric_limits<float>::max();	// Fraction of the move
+		glm::vec2	normal { 0.0f };
+	};
+
+	/** @brief Sweeps a circle against a point, which is how it hits the ends of lines */
+	void sweepAgainstPoint(glm::vec2 start, glm::vec2 offset, float radius, glm::vec2 point, Contact& contact)
+	{
+		const glm::vec2 toStart = start - point;
+		const float b = glm::dot(toStart, offset);
+		const float c = glm::dot(toStart, toStart) - radius * radius;
+
+		// Moving away from the point, or alongside it, never hits it.
+		if (b >= 0.0f)
+			return;
+
+		// Already touching it and moving closer, so it stops the move before it starts. 
+		if (c <= 0.0f) {
+			if (contact.time > 0.0f)
+				contact = { 0.0f, glm::normalize(toStart) };
+			return;
+		}
+
+		const float a = glm::dot(offset, offset);
+		const float discriminant = b * b - a * c;
+		if (discriminant < 0.0f)
+			return;
+
+		const float time = (-b - std::sqrt(discriminant)) / a;
+		if (time <= 1.0f && time < contact.time)
+			contact = { time, glm::normalize(toStart + offset * time) };
+	}
+
+	/** @brief Sweeps a circle against a line segment */
+	void sweepAgainstSegment(glm::vec2 start, glm::vec2 offset, float radius, glm::vec2 a, glm::vec2 b, Contact& contact)
+	{
+		const glm::vec2 along = b - a;
+		const float length = glm::length(along);
+
+		if (length > 0.0f) {
+			const glm::vec2 direction = along / length;
+
+			// Face the normal towards where the circle starts. 
+			glm::vec2 normal{ -direction.y, direction.x };
+			float distance = glm::dot(start - a, normal);
+			if (distance < 0.0f) {
+				normal = -normal;
+				distance = -distance;
+			}
+
+			const float approach = -glm::dot(offset, normal);
+			if (approach > 0.0f) {
+				const float time = std::max(distance - radius, 0.0f) / approach;
+				const float position = glm::dot(start + offset * time - a, direction);
+
+				if (time <= 1.0f && time < contact.time && position >= 0.0f && position <= length)
+					contact = { time, normal };
+			}
+		}
+
+		sweepAgainstPoint(start, offset, radius, a, contact);
+		sweepAgainstPoint(start, offset, radius, b, contact);
+	}
+}
+
+Collision::MoveResult Collision::slideMove(const Level& level, glm::vec3 position, glm::vec2 offset, const CollisionBody& body)
+{
+	MoveResult result{ position, false };
+
+	glm::vec2 point{ position };
+	glm::vec2 remaining = offset;
+
+	for (uint32_t slide = 0; slide < MAX_SLIDES && glm::dot(remaining, remaining) > SKIN_WIDTH * SKIN_WIDTH; slide++) {
+		const glm::vec2 end = point + remaining;
+
+		// Levels without a blockmap are small hand built ones, where checking every line is fine.
+		if (!level.blockmap.empty()) {
+			level.blockmap.findLines(glm::min(point, end) - body.radius, glm::max(point, end) + body.radius, candidateLineDefIds);
+		}
+		else {
+			candidateLineDefIds.resize(level.lineDefs.size());
+			for (uint32_t i = 0; i < candidateLineDefIds.size(); i++)
+				candidateLineDefIds[i] = i;
+		}
+
+		Contact contact;
+		for (uint32_t lineDefId : candidateLineDefIds) {
+			if (!blocks(level, lineDefId, position.z, body))
+				continue;
+
+			const LineDef& lineDef = level.lineDefs[lineDefId];
+			sweepAgainstSegment(point, remaining, body.radius, level.vertices[lineDef.startVertexId],
+				level.vertices[lineDef.endVertexId], contact);
+		}
+
+		if (contact.time > 1.0f) {
+			point = end;
+			break;
+		}
+
+		// Move up to the wall, then slide the rest of the way along it. 
+		result.hitWall = true;
+		point += remaining * contact.time + contact.normal * SKIN_WIDTH;
+
+		remaining *= 1.0f - contact.time;
+		remaining -= contact.normal * glm::dot(remaining, contact.normal);
+	}
+
+	result.position = glm::vec3{ point, position.z };
+
+	// Keep the body from sinking below the floor of the sector it's in, which steps it up onto
+	// anything it was allowed to walk onto, and keep its head under the ceiling where there's
+	// room. Bodies above the floor stay there, since nothing falls yet. 
+	if (!level.bsp.empty()) {
+		const Sector& sector = level.sectors[level.bsp.findSector(point)];
+
+		result.position.z = std::min(result.position.z, sector.ceilingZ - body.height);
+		result.position.z = std::max(result.position.z, sector.floorZ);
+	}
+
+	return result;
+}
+
+bool Collision::blocks(const Level& level, uint32_t lineDefId, float feetZ, const CollisionBody& body)
+{
+	const LineDef& lineDef = level.lineDefs[lineDefId];
+	if (lineDef.frontWallId == LineDef::NO_WALL || lineDef.backWallId == LineDef::NO_WALL)
+		return true;
+
+	const Sector& front = level.sectors[level.walls[lineDef.frontWallId].sectorId];
+	const Sector& back = level.sectors[level.walls[lineDef.backWallId].sectorId];
+
+	const float openingBottom = std::max(front.floorZ, back.floorZ);
+	const float openingTop = std::min(front.ceilingZ, back.ceilingZ);
+
+	return openingTop - openingBottom < body.height
+		|| openingBottom - feetZ > body.stepHeight
+		|| openingTop - feetZ < body.height;
+}
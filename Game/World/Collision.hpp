@@ -0,0 +1,56 @@
+#ifndef COLLISION_HPP_INCLUDED
+#define COLLISION_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/** @brief The shape of something that collides with walls: an upright cylinder */
+struct CollisionBody
+{
+	float radius;
+	float height;
+	float stepHeight;	// The highest ledge the body can step up onto
+};
+
+/**
+ * @brief Moves bodies through a level, stopping them at walls and sliding them along.
+ *
+ * @details Bodies are swept as circles against the lines near their path, which come from the
+ *			level's blockmap. One-sided lines always block. Two-sided lines block when the
+ *			opening between their sectors is too short for the body, or its bottom is more than
+ *			a step above the body's feet, like Doom. 
+ *
+ *			When a body hits a wall, the rest of its move is projected along the wall and tried
+ *			again, a few times over, so it slides into corners instead of sticking to them. 
+ */
+class Collision
+{
+public:
+	struct MoveResult
+	{
+		glm::vec3	position;		// Where the body's feet ended up
+		bool		hitWall;
+	};
+
+	/**
+	 * @brief Moves a body from where its feet are by a horizontal offset.
+	 *
+	 * @details Positions and offsets are in level units. After moving, the body is kept between
+	 *			the floor and ceiling of the sector it ends up in, which is how it steps up onto
+	 *			ledges. It's only ever pushed up to the floor, never down to it. 
+	 */
+	MoveResult slideMove(const Level& level, glm::vec3 position, glm::vec2 offset, const CollisionBody& body);
+
+private:
+	// Reused between moves, so moving doesn't allocate
+	std::vector<uint32_t> candidateLineDefIds;
+
+	/** @brief Returns true if a line stops a body whose feet are at a height */
+	static bool blocks(const Level& level, uint32_t lineDefId, float feetZ, const CollisionBody& body);
+};
+
+#endif//COLLISION_HPP_INCLUDED
@@ -0,0 +1,121 @@
+#include "LevelSnapshot.hpp"
+
+#include <World/SectorInterpolation.hpp>
+
+void LevelSnapshot::capture(const Level& level, const ThinkerChanges& changes, const SectorInterpolation& interpolation)
+{
+	sectors.clear();
+	vertices.clear();
+
+	for (uint32_t sectorId : changes.sectorIds()) {
+		const Sector& sector = level.sectors[sectorId];
+		const SectorInterpolation::Heights& previous = interpolation.previousHeights(sectorId);
+
+		sectors.push_back({ sectorId, sector.floorZ, sector.ceilingZ, previous.floorZ, previous.ceilingZ,
+			level.sectorAppearances[sectorId].lightLevel });
+	}
+
+	for (uint32_t vertexId : changes.vertexIds())
+		vertices.push_back({ vertexId, level.vertices[vertexId] });
+}
+
+void LevelSnapshot::apply(Level& level) const
+{
+	for (const SectorState& state : sectors) {
+		Sector& sector = level.sectors[state.sectorId];
+		sector.floorZ = state.floorZ;
+		sector.ceilingZ = state.ceilingZ;
+		level.sectorAppearances[state.sectorId].lightLevel = state.lightLevel;
+	}
+
+	for (const VertexState& state : vertices)
+		level.vertices[state.vertexId] = state.position;
+
+	if (bspChanged)
+		level.bsp.applyUpdate(bspUpdate);
+}
+
+void LevelSnapshot::interpolate(Level& level) const
+{
+	for (const SectorState& state : sectors) {
+		Sector& sector = level.sectors[state.sectorId];
+		sector.floorZ = glm::mix(state.previousFloorZ, state.floorZ, alpha);
+		sector.ceilingZ = glm::mix(state.previousCeilingZ, state.ceilingZ, alpha);
+	}
+}
+
+void LevelSnapshot::restore(Level& level) const
+{
+	for (const SectorState& state : sectors) {
+		Sector& sector = level.sectors[state.sectorId];
+		sector.floorZ = state.floorZ;
+		sector.ceilingZ = state.ceilingZ;
+	}
+}
+
+CameraState LevelSnapshot::interpolatedCamera() const
+{
+	CameraState interpolated;
+	interpolated.position = glm::mix(previousCamera.position, camera.position, alpha);
+	interpolated.angle = glm::mix(previousCamera.angle, camera.angle, alpha);
+	interpolated.yaw = glm::mix(previousCamera.yaw, camera.yaw, alpha);
+	return interpolated;
+}
+
+LevelSnapshot* SnapshotExchange::beginWrite()
+{
+	// The slot is free once the render thread is done with the snapshot that was in it.
+	uint64_t seen = consumed.load(std::memory_order_acquire);
+	while (writeCount - seen >= SLOT_COUNT) {
+		if (closed.load(std::memory_order_acquire))
+			return nullptr;
+
+		consumed.wait(seen, std::memory_order_acquire);
+		seen = consumed.load(std::memory_order_acquire);
+	}
+
+	if (closed.load(std::memory_order_acquire))
+		return nullptr;
+
+	return &slots[writeCount % SLOT_COUNT];
+}
+
+void SnapshotExchange::publish()
+{
+	published.store(++writeCount, std::memory_order_release);
+	published.notify_one();
+}
+
+const LevelSnapshot* SnapshotExchange::beginRead()
+{
+	uint64_t seen = published.load(std::memory_order_acquire);
+	while (seen <= readCount) {
+		if (closed.load(std::memory_order_acquire))
+			return nullptr;
+
+		published.wait(seen, std::memory_order_acquire);
+		seen = published.load(std::memory_order_acquire);
+	}
+
+	if (closed.load(std::memory_order_acquire))
+		return nullptr;
+
+	return &slots[readCount % SLOT_COUNT];
+}
+
+void SnapshotExchange::release()
+{
+	consumed.store(++readCount, std::memory_order_release);
+	consumed.notify_one();
+}
+
+void SnapshotExchange::close()
+{
+	closed.store(true, std::memory_order_release);
+
+	// Waiting threads only wake up when the counter they're waiting on changes. 
+	published.fetch_add(SLOT_COUNT, std::memory_order_acq_rel);
+	published.notify_all();
+	consumed.fetch_add(SLOT_COUNT, std::memory_order_acq_rel);
+	consumed.notify_all();
+}
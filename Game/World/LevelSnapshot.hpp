@@ -0,0 +1,139 @@
+#ifndef LEVEL_SNAPSHOT_HPP_INCLUDED
+#define LEVEL_SNAPSHOT_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <Level.hpp>
+#include <Geometry/BspBuilder.hpp>
+
+class SectorInterpolation;
+
+/** @brief Where the camera is and which way it's looking */
+struct CameraState
+{
+	glm::vec3	position { 0.0f };
+	float		angle = 0.0f;
+	float		yaw = 0.0f;
+};
+
+/**
+ * @brief What changed in a level during one frame of simulation, for the render thread to bring
+ *			its own copy of the level up to date with.
+ *
+ * @details Only what the simulation can change is captured, and only for the sectors and
+ *			vertices that changed, so a snapshot is usually tiny next to the level. On frames
+ *			that rebuilt part of the BSP, only the rebuilt part and the nodes above it are sent.
+ *			Since each snapshot only holds changes, the render thread has to apply every one of
+ *			them, in order. 
+ *
+ *			The blockmap and spatial index aren't sent, so the render thread's copy of the
+ *			level mustn't have them. The sector graph never changes once a level is loaded. 
+ *
+ *			Sectors that moved during the last tick keep their heights from before it too, so
+ *			they can be drawn partway between the two ticks like the camera. 
+ */
+struct LevelSnapshot
+{
+	struct SectorState
+	{
+		uint32_t	sectorId;
+		float		floorZ;
+		float		ceilingZ;
+		float		previousFloorZ;		// Heights before the last tick
+		float		previousCeilingZ;
+		float		lightLevel;
+	};
+
+	struct VertexState
+	{
+		uint32_t	vertexId;
+		Vertex		position;
+	};
+
+	std::vector<SectorState>	sectors;
+	std::vector<VertexState>	vertices;
+
+	bool				bspChanged = false;
+	BspTreeUpdate		bspUpdate;
+	BspBuilder::Stats	bspStats;
+
+	CameraState			previousCamera;		// The camera before the last tick
+	CameraState			camera;
+
+	float				alpha = 0.0f;		// How far the frame is between the last tick and the next
+	uint32_t			ticks = 0;			// Ticks run this frame
+	float				simMilliseconds = 0.0f;
+
+	/** @brief Fills the snapshot with the state of the sectors and vertices that changed */
+	void capture(const Level& level, const ThinkerChanges& changes, const SectorInterpolation& interpolation);
+
+	/** @brief Copies the captured state into another copy of the level, which must have had every earlier snapshot applied */
+	void apply(Level& level) const;
+
+	/** @brief Moves the captured sectors to their heights between the last two ticks, for drawing */
+	void interpolate(Level& level) const;
+
+	/** @brief Undoes interpolate() */
+	void restore(Level& level) const;
+
+	/** @brief The camera between the last two ticks */
+	CameraState interpolatedCamera() const;
+};
+
+/**
+ * @brief Hands level snapshots from the game thread to the render thread.
+ *
+ * @details There are two snapshot slots. The game thread fills one while the render thread
+ *			draws from the other, so simulating the next frame overlaps drawing the current one,
+ *			and a frame takes as long as the slower of the two instead of both added together.
+ *
+ *			Each side only ever touches its own slot, and the two counters say which slots are
+ *			which, so handing a slot over is a single atomic store. A side only blocks when it is
+ *			a whole frame ahead of the other, and then it waits on the counter, not a lock. 
+ */
+class SnapshotExchange
+{
+public:
+	/**
+	 * @brief Game thread: waits for a slot to be free and returns it to be filled.
+	 *
+	 * @return The slot, or nullptr once the exchange has been closed
+	 */
+	LevelSnapshot* beginWrite();
+
+	/** @brief Game thread: hands the slot from beginWrite() to the render thread */
+	void publish();
+
+	/**
+	 * @brief Render thread: waits for the next snapshot and returns it.
+	 *
+	 * @return The snapshot, or nullptr once the exchange has been closed
+	 */
+	const LevelSnapshot* beginRead();
+
+	/** @brief Render thread: hands the slot from beginRead() back to the game thread */
+	void release();
+
+	/** @brief Wakes both threads up and makes every later call return nullptr */
+	void close();
+
+private:
+	static constexpr uint64_t SLOT_COUNT = 2;
+
+	std::array<LevelSnapshot, SLOT_COUNT> slots;
+
+	std::atomic<uint64_t>	published = 0;	// Snapshots the game thread has finished
+	std::atomic<uint64_t>	consumed = 0;	// Snapshots the render thread has finished
+	std::atomic<bool>		closed = false;
+
+	// Only touched by the game and render threads respectively
+	uint64_t writeCount = 0;
+	uint64_t readCount = 0;
+};
+
+#endif//LEVEL_SNAPSHOT_HPP_INCLUDED
@@ -0,0 +1,311 @@
+#include "Raycast.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <Level.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYCAST_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t NO_LINE = std::numeric_limits<uint32_t>::max();
+
+	// How far past the ends of a wall a ray still counts as crossing it, as a fraction of the
+	// wall. Without it, rays passing exactly through a vertex can slip between the two walls.
+	constexpr float END_TOLERANCE = 1.0e-5f;
+
+	// Packets are as wide as an SSE register
+	constexpr size_t PACKET_SIZE = 4;
+
+	/** @brief Where a ray is up to while it's being cast */
+	struct RayState
+	{
+		glm::vec3	origin;
+		glm::vec3	direction;			// Normalized, so distances along it are in map units
+		float		maxDistance;
+
+		uint32_t	sectorId;
+		uint32_t	enteredLineDefId;	// The line the ray came into the sector through
+		float		enterDistance;		// How far along the ray it came into the sector
+		uint32_t	steps;				// How many sectors it has gone through
+
+		bool		done;
+		RayHit		hit;
+	};
+
+	/** @brief The wall a ray leaves its sector through */
+	struct Exit
+	{
+		uint32_t	wallId = RayHit::NO_WALL;
+		float		distance = std::numeric_limits<float>::max();
+	};
+
+	void finish(RayState& state, RayHit::Surface surface, float distance, uint32_t wallId = RayHit::NO_WALL)
+	{
+		state.done = true;
+		state.hit = { surface, state.sectorId, wallId, distance };
+	}
+
+	RayState beginRay(const Level& level, const Ray& ray)
+	{
+		RayState state;
+		state.origin = ray.origin;
+		state.maxDistance = ray.maxDistance;
+		state.sectorId = ray.sectorId;
+		state.enteredLineDefId = NO_LINE;
+		state.enterDistance = 0.0f;
+		state.steps = 0;
+		state.done = false;
+
+		if (state.sectorId == Ray::NO_SECTOR) {
+			if (!level.bsp.empty())
+				state.sectorId = level.bsp.findSector(glm::vec2(ray.origin));
+			else if (!level.spatialIndex.empty())
+				state.sectorId = level.spatialIndex.findSector(level, glm::vec2(ray.origin));
+		}
+
+		const float length = glm::length(ray.direction);
+
+		if (state.sectorId == Ray::NO_SECTOR || length == 0.0f) {
+			state.direction = glm::vec3{ 0.0f };
+			finish(state, RayHit::Surface::None, 0.0f);
+		}
+		else {
+			state.direction = ray.direction / length;
+		}
+
+		return state;
+	}
+
+	/** @brief Finds the nearest wall of the ray's sector past where it came in */
+	Exit findExit(const Level& level, const RayState& state)
+	{
+		const Sector& sector = level.sectors[state.sectorId];
+		Exit exit;
+
+		for (uint32_t wallId = sector.firstWallId; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+			const uint32_t lineDefId = level.walls[wallId].lineDefId;
+			if (lineDefId == state.enteredLineDefId)
+				continue;
+
+			const LineDef& lineDef = level.lineDefs[lineDefId];
+			const glm::vec2 start = level.vertices[lineDef.startVertexId];
+			const glm::vec2 end = level.vertices[lineDef.endVertexId];
+
+			// Solve origin + direction * t = start + (end - start) * u
+			const float edgeX = end.x - start.x;
+			const float edgeY = end.y - start.y;
+			const float toStartX = start.x - state.origin.x;
+			const float toStartY = start.y - state.origin.y;
+
+			const float denominator = state.direction.x * edgeY - state.direction.y * edgeX;
+			if (denominator == 0.0f)
+				continue;
+
+			const float t = (toStartX * edgeY - toStartY * edgeX) / denominator;
+			const float u = (toStartX * state.direction.y - toStartY * state.direction.x) / denominator;
+
+			if (u >= -END_TOLERANCE && u <= 1.0f + END_TOLERANCE && t > state.enterDistance && t < exit.distance)
+				exit = { wallId, t };
+		}
+
+		return exit;
+	}
+
+	/** @brief Finishes the ray if it hits something in its sector, or moves it into the next one */
+	void advance(const Level& level, RayState& state, const Exit& exit)
+	{
+		const Sector& sector = level.sectors[state.sectorId];
+		const float limit = std::min(exit.distance, state.maxDistance);
+
+		// The floor or ceiling is hit if the ray reaches it before leaving the sector.
+		if (state.direction.z < 0.0f) {
+			const float distance = std::max((sector.floorZ - state.origin.z) / state.direction.z, state.enterDistance);
+			if (distance < limit) {
+				finish(state, RayHit::Surface::Floor, distance);
+				return;
+			}
+		}
+		else if (state.direction.z > 0.0f) {
+			const float distance = std::max((sector.ceilingZ - state.origin.z) / state.direction.z, state.enterDistance);
+			if (distance < limit) {
+				finish(state, RayHit::Surface::Ceiling, distance);
+				return;
+			}
+		}
+
+		// Rays that go too far, or somehow don't leave the sector, hit nothing. Neither does a ray
+		// going round in circles, which only happens in broken levels.
+		if (exit.wallId == RayHit::NO_WALL || exit.distance >= state.maxDistance || ++state.steps > level.walls.size()) {
+			finish(state, RayHit::Surface::None, state.maxDistance);
+			return;
+		}
+
+		const uint32_t behindSectorId = level.sectorGraph.behindSector(exit.wallId);
+		if (behindSectorId == SectorGraph::NO_SECTOR) {
+			finish(state, RayHit::Surface::Wall, exit.distance, exit.wallId);
+			return;
+		}
+
+		// Two-sided walls only let the ray through the opening between the two sectors.
+		const Sector& behind = level.sectors[behindSectorId];
+		const float z = state.origin.z + state.direction.z * exit.distance;
+
+		if (z < std::max(sector.floorZ, behind.floorZ) || z > std::min(sector.ceilingZ, behind.ceilingZ)) {
+			finish(state, RayHit::Surface::Wall, exit.distance, exit.wallId);
+			return;
+		}
+
+		state.sectorId = behindSectorId;
+		state.enteredLineDefId = level.walls[exit.wallId].lineDefId;
+		state.enterDistance = exit.distance;
+	}
+
+#ifdef RAYCAST_SSE2
+	__m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	/**
+	 * @brief Casts up to four rays together.
+	 *
+	 * @details Each pass takes the sector of the first ray still going, and tests its walls
+	 *			against every ray in it at once. The arithmetic is the same as findExit's, so
+	 *			rays come out the same whichever way they're cast.
+	 */
+	void castPacket(const Level& level, RayState* states, size_t count)
+	{
+		alignas(16) float originX[PACKET_SIZE] = {};
+		alignas(16) float originY[PACKET_SIZE] = {};
+		alignas(16) float directionX[PACKET_SIZE] = {};
+		alignas(16) float directionY[PACKET_SIZE] = {};
+		alignas(16) float enterDistances[PACKET_SIZE] = {};
+		alignas(16) uint32_t enteredLineDefIds[PACKET_SIZE] = {};
+		alignas(16) float exitDistances[PACKET_SIZE];
+		alignas(16) uint32_t exitWallIds[PACKET_SIZE];
+
+		for (size_t i = 0; i < count; i++) {
+			originX[i] = states[i].origin.x;
+			originY[i] = states[i].origin.y;
+			directionX[i] = states[i].direction.x;
+			directionY[i] = states[i].direction.y;
+		}
+
+		const __m128 orgX = _mm_load_ps(originX);
+		const __m128 orgY = _mm_load_ps(originY);
+		const __m128 dirX = _mm_load_ps(directionX);
+		const __m128 dirY = _mm_load_ps(directionY);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 lowU = _mm_set1_ps(-END_TOLERANCE);
+		const __m128 highU = _mm_set1_ps(1.0f + END_TOLERANCE);
+
+		while (true) {
+			size_t leader = 0;
+			while (leader < count && states[leader].done)
+				leader++;
+
+			if (leader == count)
+				break;
+
+			const uint32_t sectorId = states[leader].sectorId;
+
+			// Rays in other sectors, or already done, can't exit through anything.
+			for (size_t i = 0; i < PACKET_SIZE; i++) {
+				const bool inSector = i < count && !states[i].done && states[i].sectorId == sectorId;
+				enterDistances[i] = inSector ? states[i].enterDistance : std::numeric_limits<float>::infinity();
+				enteredLineDefIds[i] = inSector ? states[i].enteredLineDefId : NO_LINE;
+			}
+
+			const __m128 enter = _mm_load_ps(enterDistances);
+			const __m128i entered = _mm_load_si128(reinterpret_cast<const __m128i*>(enteredLineDefIds));
+
+			__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128 bestWall = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(RayHit::NO_WALL)));
+
+			const Sector& sector = level.sectors[sectorId];
+
+			for (uint32_t wallId = sector.firstWallId; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+				const uint32_t lineDefId = level.walls[wallId].lineDefId;
+				const LineDef& lineDef = level.lineDefs[lineDefId];
+				const glm::vec2 start = level.vertices[lineDef.startVertexId];
+				const glm::vec2 end = level.vertices[lineDef.endVertexId];
+
+				const __m128 edgeX = _mm_set1_ps(end.x - start.x);
+				const __m128 edgeY = _mm_set1_ps(end.y - start.y);
+				const __m128 toStartX = _mm_sub_ps(_mm_set1_ps(start.x), orgX);
+				const __m128 toStartY = _mm_sub_ps(_mm_set1_ps(start.y), orgY);
+
+				const __m128 denominator = _mm_sub_ps(_mm_mul_ps(dirX, edgeY), _mm_mul_ps(dirY, edgeX));
+				const __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(toStartX, edgeY), _mm_mul_ps(toStartY, edgeX)), denominator);
+				const __m128 u = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(toStartX, dirY), _mm_mul_ps(toStartY, dirX)), denominator);
+
+				const __m128 sameLine = _mm_castsi128_ps(_mm_cmpeq_epi32(entered, _mm_set1_epi32(static_cast<int32_t>(lineDefId))));
+
+				__m128 hit = _mm_cmpneq_ps(denominator, zero);
+				hit = _mm_and_ps(hit, _mm_cmpge_ps(u, lowU));
+				hit = _mm_and_ps(hit, _mm_cmple_ps(u, highU));
+				hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, enter));
+				hit = _mm_and_ps(hit, _mm_cmplt_ps(t, best));
+				hit = _mm_andnot_ps(sameLine, hit);
+
+				best = select(hit, t, best);
+				bestWall = select(hit, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int32_t>(wallId))), bestWall);
+			}
+
+			_mm_store_ps(exitDistances, best);
+			_mm_store_si128(reinterpret_cast<__m128i*>(exitWallIds), _mm_castps_si128(bestWall));
+
+			for (size_t i = 0; i < count; i++)
+				if (!states[i].done && states[i].sectorId == sectorId)
+					advance(level, states[i], { exitWallIds[i], exitDistances[i] });
+		}
+	}
+#endif
+}
+
+RayHit castRay(const Level& level, const Ray& ray)
+{
+	RayState state = beginRay(level, ray);
+
+	while (!state.done)
+		advance(level, state, findExit(level, state));
+
+	return state.hit;
+}
+
+void castRays(const Level& level, const std::vector<Ray>& rays, std::vector<RayHit>& hits)
+{
+	hits.resize(rays.size());
+
+#ifdef RAYCAST_SSE2
+	for (size_t first = 0; first < rays.size(); first += PACKET_SIZE) {
+		const size_t count = std::min(PACKET_SIZE, rays.size() - first);
+
+		RayState states[PACKET_SIZE];
+		for (size_t i = 0; i < count; i++)
+			states[i] = beginRay(level, rays[first + i]);
+
+		castPacket(level, states, count);
+
+		for (size_t i = 0; i < count; i++)
+			hits[first + i] = states[i].hit;
+	}
+#else
+	for (size_t i = 0; i < rays.size(); i++)
+		hits[i] = castRay(level, rays[i]);
+#endif
+}
+
+bool hasLineOfSight(const Level& level, glm::vec3 from, glm::vec3 to, uint32_t fromSectorId)
+{
+	const float distance = glm::length(to - from);
+	if (distance == 0.0f)
+		return true;
+
+	return castRay(level, { from, to - from, distance, fromSectorId }).surface == RayHit::Surface::None;
+}
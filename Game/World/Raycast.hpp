@@ -0,0 +1,72 @@
+#ifndef RAYCAST_HPP_INCLUDED
+#define RAYCAST_HPP_INCLUDED
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/** @brief A ray to cast through a level, for hitscan weapons or sight checks */
+struct Ray
+{
+	static constexpr uint32_t NO_SECTOR = std::numeric_limits<uint32_t>::max();
+
+	glm::vec3	origin;
+	glm::vec3	direction;		// Doesn't need to be normalized
+	float		maxDistance;
+
+	// The sector the ray starts in. Looked up from the level's BSP when not given, so callers
+	// that already know it, like things firing, save a lookup.
+	uint32_t	sectorId = NO_SECTOR;
+};
+
+/** @brief What a ray hit */
+struct RayHit
+{
+	static constexpr uint32_t NO_WALL = std::numeric_limits<uint32_t>::max();
+
+	enum class Surface : uint8_t
+	{
+		None,		// Nothing within the ray's distance, or the ray has no direction or start sector
+		Wall,
+		Floor,
+		Ceiling,
+	};
+
+	Surface		surface = Surface::None;
+	uint32_t	sectorId = Ray::NO_SECTOR;	// The sector the ray was in when it hit
+	uint32_t	wallId = NO_WALL;			// The wall that was hit, for wall hits
+	float		distance = 0.0f;			// How far along the ray the hit is, in map units
+};
+
+/**
+ * @brief Casts a ray through a level, returning the first wall, floor or ceiling it hits.
+ *
+ * @details The ray walks the sector graph from the sector it starts in, so only the walls of
+ *			sectors it passes through are tested. Within each sector it finds the wall it
+ *			leaves through, and checks whether it hits the floor or ceiling before getting
+ *			there. One-sided walls stop the ray. So do two-sided walls, when the ray is above
+ *			or below the opening into the sector behind, which is how it hits steps and the
+ *			parts of walls above doorways.
+ *
+ *			The BSP puts every point in some sector, so a ray that starts outside the level is
+ *			cast from whichever sector the BSP puts its origin in, like one that starts inside.
+ */
+RayHit castRay(const Level& level, const Ray& ray);
+
+/**
+ * @brief Casts a batch of rays, with one hit per ray in the same order.
+ *
+ * @details Rays are cast four at a time with SSE2 where it's available. The rays in a packet
+ *			that are in the same sector test its walls together, so rays that start near each
+ *			other and go the same way, like a shotgun blast, share most of the work.
+ */
+void castRays(const Level& level, const std::vector<Ray>& rays, std::vector<RayHit>& hits);
+
+/** @brief Returns true if nothing in the level blocks the way between two points */
+bool hasLineOfSight(const Level& level, glm::vec3 from, glm::vec3 to, uint32_t fromSectorId = Ray::NO_SECTOR);
+
+#endif//RAYCAST_HPP_INCLUDED
@@ -0,0 +1,26 @@
+#include "SectorInterpolation.hpp"
+
+#include <Level.hpp>
+
+void SectorInterpolation::reset(const Level& level)
+{
+	previous.clear();
+	previous.reserve(level.sectors.size());
+
+	for (const Sector& sector : level.sectors)
+		previous.push_back({ sector.floorZ, sector.ceilingZ });
+}
+
+void SectorInterpolation::beginTick(const Level& level)
+{
+	if (previous.size() != level.sectors.size()) {
+		reset(level);
+		return;
+	}
+
+	// Sectors the last tick didn't change already have their heights from before it. 
+	for (uint32_t sectorId : level.thinkers.changes().sectorIds()) {
+		const Sector& sector = level.sectors[sectorId];
+		previous[sectorId] = { sector.floorZ, sector.ceilingZ };
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef SECTOR_INTERPOLATION_HPP_INCLUDED
+#define SECTOR_INTERPOLATION_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+struct Level;
+
+/**
+ * @brief Remembers where sectors were before the last simulation tick, so their movement can be
+ *			smoothed out between ticks.
+ *
+ * @details The simulation runs at a fixed rate that has nothing to do with how often frames are
+ *			drawn, so drawing sectors where the last tick left them makes moving floors and
+ *			ceilings stutter. This keeps the floor and ceiling height each sector had before the
+ *			last tick, for drawing to blend with where the sector is now.
+ *
+ *			Only the sectors that thinkers changed during the last tick are touched, so the cost
+ *			goes with how much is moving, not the size of the level.
+ */
+class SectorInterpolation
+{
+public:
+	struct Heights
+	{
+		float floorZ;
+		float ceilingZ;
+	};
+
+	/** @brief Starts over for a level, with every sector standing still */
+	void reset(const Level& level);
+
+	/** @brief Remembers the heights of the sectors that are moving. Call before every tick */
+	void beginTick(const Level& level);
+
+	/** @brief The heights a sector had before the last tick */
+	const Heights& previousHeights(uint32_t sectorId) const { return previous[sectorId]; }
+
+private:
+	std::vector<Heights> previous;	// Heights before the last tick, one per sector
+};
+
+#endif//SECTOR_INTERPOLATION_HPP_INCLUDED
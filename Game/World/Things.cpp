@@ -0,0 +1,133 @@
+#include "Things.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Level.hpp>
+
+namespace
+{
+	struct ThingTypeSprite
+	{
+		uint16_t	type;
+		const char*	name;
+		char		frame;
+	};
+
+	// Doom and Doom II's thing types, from the DoomEd numbers in Doom's mobjinfo table. Corpses
+	// are drawn with the last frame of their death.
+	constexpr ThingTypeSprite THING_SPRITES[] = {
+		// Monsters
+		{ 3004, "POSS", 'A' },	{ 9,    "SPOS", 'A' },	{ 65,   "CPOS", 'A' },	{ 3001, "TROO", 'A' },
+		{ 3002, "SARG", 'A' },	{ 58,   "SARG", 'A' },	{ 3006, "SKUL", 'A' },	{ 3005, "HEAD", 'A' },
+		{ 69,   "BOS2", 'A' },	{ 3003, "BOSS", 'A' },	{ 68,   "BSPI", 'A' },	{ 71,   "PAIN", 'A' },
+		{ 66,   "SKEL", 'A' },	{ 67,   "FATT", 'A' },	{ 64,   "VILE", 'A' },	{ 7,    "SPID", 'A' },
+		{ 16,   "CYBR", 'A' },	{ 84,   "SSWV", 'A' },	{ 72,   "KEEN", 'A' },	{ 88,   "BBRN", 'A' },
+
+		// Weapons
+		{ 2001, "SHOT", 'A' },	{ 82,   "SGN2", 'A' },	{ 2002, "MGUN", 'A' },	{ 2003, "LAUN", 'A' },
+		{ 2004, "PLAS", 'A' },	{ 2006, "BFUG", 'A' },	{ 2005, "CSAW", 'A' },
+
+		// Ammo
+		{ 2007, "CLIP", 'A' },	{ 2048, "AMMO", 'A' },	{ 2008, "SHEL", 'A' },	{ 2049, "SBOX", 'A' },
+		{ 2010, "ROCK", 'A' },	{ 2046, "BROK", 'A' },	{ 2047, "CELL", 'A' },	{ 17,   "CELP", 'A' },
+		{ 8,    "BPAK", 'A' },
+
+		// Health, armor and powerups
+		{ 2011, "STIM", 'A' },	{ 2012, "MEDI", 'A' },	{ 2014, "BON1", 'A' },	{ 2015, "BON2", 'A' },
+		{ 2018, "ARM1", 'A' },	{ 2019, "ARM2", 'A' },	{ 83,   "MEGA", 'A' },	{ 2013, "SOUL", 'A' },
+		{ 2022, "PINV", 'A' },	{ 2023, "PSTR", 'A' },	{ 2024, "PINS", 'A' },	{ 2025, "SUIT", 'A' },
+		{ 2026, "PMAP", 'A' },	{ 2045, "PVIS", 'A' },
+
+		// Keys
+		{ 5,    "BKEY", 'A' },	{ 6,    "YKEY", 'A' },	{ 13,   "RKEY", 'A' },	{ 40,   "BSKU", 'A' },
+		{ 39,   "YSKU", 'A' },	{ 38,   "RSKU", 'A' },
+
+		// Obstacles and decorations
+		{ 2035, "BAR1", 'A' },	{ 70,   "FCAN", 'A' },	{ 43,   "TRE1", 'A' },	{ 47,   "SMIT", 'A' },
+		{ 54,   "TRE2", 'A' },	{ 2028, "COLU", 'A' },	{ 30,   "COL1", 'A' },	{ 31,   "COL2", 'A' },
+		{ 32,   "COL3", 'A' },	{ 33,   "COL4", 'A' },	{ 36,   "COL5", 'A' },	{ 37,   "COL6", 'A' },
+		{ 41,   "CEYE", 'A' },	{ 42,   "FSKU", 'A' },	{ 44,   "TBLU", 'A' },	{ 45,   "TGRN", 'A' },
+		{ 46,   "TRED", 'A' },	{ 55,   "SMBT", 'A' },	{ 56,   "SMGT", 'A' },	{ 57,   "SMRT", 'A' },
+		{ 48,   "ELEC", 'A' },	{ 34,   "CAND", 'A' },	{ 35,   "CBRA", 'A' },	{ 85,   "TLMP", 'A' },
+		{ 86,   "TLP2", 'A' },	{ 25,   "POL1", 'A' },	{ 26,   "POL6", 'A' },	{ 27,   "POL4", 'A' },
+		{ 28,   "POL2", 'A' },	{ 29,   "POL3", 'A' },	{ 24,   "POL5", 'A' },	{ 79,   "POB1", 'A' },
+		{ 80,   "POB2", 'A' },	{ 81,   "BRS1", 'A' },	{ 49,   "GOR1", 'A' },	{ 63,   "GOR1", 'A' },
+		{ 50,   "GOR2", 'A' },	{ 59,   "GOR2", 'A' },	{ 51,   "GOR3", 'A' },	{ 61,   "GOR3", 'A' },
+		{ 52,   "GOR4", 'A' },	{ 60,   "GOR4", 'A' },	{ 53,   "GOR5", 'A' },	{ 62,   "GOR5", 'A' },
+		{ 73,   "HDB1", 'A' },	{ 74,   "HDB2", 'A' },	{ 75,   "HDB3", 'A' },	{ 76,   "HDB4", 'A' },
+		{ 77,   "HDB5", 'A' },	{ 78,   "HDB6", 'A' },
+
+		// Corpses
+		{ 10,   "PLAY", 'W' },	{ 12,   "PLAY", 'W' },	{ 15,   "PLAY", 'N' },	{ 18,   "POSS", 'L' },
+		{ 19,   "SPOS", 'L' },	{ 20,   "TROO", 'M' },	{ 21,   "SARG", 'N' },	{ 22,   "HEAD", 'L' },
+		{ 23,   "SKUL", 'K' },
+	};
+}
+
+std::optional<ThingSprite> findThingSprite(uint16_t type)
+{
+	static const std::unordered_map<uint16_t, const ThingTypeSprite*> spritesByType = [] {
+		std::unordered_map<uint16_t, const ThingTypeSprite*> sprites;
+		for (const ThingTypeSprite& sprite : THING_SPRITES)
+			sprites.emplace(sprite.type, &sprite);
+		return sprites;
+	}();
+
+	auto it = spritesByType.find(type);
+	if (it == spritesByType.end())
+		return std::nullopt;
+
+	return ThingSprite{ it->second->name, it->second->frame };
+}
+
+std::vector<std::string> findThingSpriteNames(const Level& level)
+{
+	std::vector<std::string> names;
+	std::unordered_set<uint16_t> seenTypes;
+	std::unordered_set<std::string_view> seenNames;
+
+	for (const Thing& thing : level.things) {
+		if (!seenTypes.insert(thing.type).second)
+			continue;
+
+		std::optional<ThingSprite> sprite = findThingSprite(thing.type);
+		if (sprite && seenNames.insert(sprite->name).second)
+			names.emplace_back(sprite->name);
+	}
+
+	return names;
+}
+
+void bucketThingsBySector(Level& level)
+{
+	std::vector<glm::vec2> positions(level.things.size());
+	for (size_t i = 0; i < level.things.size(); i++)
+		positions[i] = level.things[i].position;
+
+	std::vector<uint32_t> sectorIds;
+	level.spatialIndex.findSectors(level, positions, sectorIds, 0);
+
+	// A counting sort, which keeps things in the same order within each sector.
+	level.sectorThingOffsets.assign(level.sectors.size() + 1, 0);
+	for (uint32_t sectorId : sectorIds)
+		if (sectorId != SpatialIndex::NO_SECTOR)
+			level.sectorThingOffsets[sectorId + 1]++;
+
+	for (size_t i = 1; i < level.sectorThingOffsets.size(); i++)
+		level.sectorThingOffsets[i] += level.sectorThingOffsets[i - 1];
+
+	std::vector<Thing> things(level.sectorThingOffsets.back());
+	std::vector<uint32_t> nextThingIds(level.sectorThingOffsets.begin(), level.sectorThingOffsets.end() - 1);
+
+	for (size_t i = 0; i < level.things.size(); i++) {
+		if (sectorIds[i] == SpatialIndex::NO_SECTOR)
+			continue;
+
+		Thing& thing = things[nextThingIds[sectorIds[i]]++];
+		thing = level.things[i];
+		thing.sectorId = sectorIds[i];
+	}
+
+	level.things = std::move(things);
+}
@@ -0,0 +1,69 @@
+#ifndef THINGS_HPP_INCLUDED
+#define THINGS_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <limits>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/**
+ * @brief Something placed in a level, like a monster, an item or a decoration.
+ *
+ * @details Flags use Doom's bits whatever format the map is in, so Hexen and UDMF things are
+ *			converted when they're loaded.
+ */
+struct Thing
+{
+	static constexpr uint32_t NO_SECTOR = std::numeric_limits<uint32_t>::max();
+
+	static constexpr uint16_t SKILL_EASY		= 0x0001;	// Skills 1 and 2
+	static constexpr uint16_t SKILL_MEDIUM		= 0x0002;	// Skill 3
+	static constexpr uint16_t SKILL_HARD		= 0x0004;	// Skills 4 and 5
+	static constexpr uint16_t AMBUSH			= 0x0008;	// Monsters wait until they see the player
+	static constexpr uint16_t MULTIPLAYER_ONLY	= 0x0010;
+
+	glm::vec2	position;
+	float		height;		// How far above the floor it is
+	float		angle;		// Which way it faces, in radians counter-clockwise from east
+	uint16_t	type;		// Its DoomEd number, which says what it is
+	uint16_t	flags;
+	uint32_t	sectorId = NO_SECTOR;
+};
+
+static_assert(sizeof(Thing) == 24, "Things should stay small, since there can be thousands of them");
+
+/** @brief The sprite a type of thing is drawn with */
+struct ThingSprite
+{
+	std::string_view	name;	// The four letters every lump of the sprite starts with
+	char				frame;	// The frame it's drawn with while it isn't doing anything
+};
+
+/**
+ * @brief Looks up how a DoomEd thing type is drawn.
+ *
+ * @details Only Doom and Doom II's types are known. Things that aren't drawn, like player starts
+ *			and teleport destinations, and types from other games return nothing.
+ */
+std::optional<ThingSprite> findThingSprite(uint16_t type);
+
+/** @brief Returns the name of every sprite the things in a level are drawn with, each once */
+std::vector<std::string> findThingSpriteNames(const Level& level);
+
+/**
+ * @brief Sorts a level's things by the sector they're in, and works out where each sector's
+ *			things start.
+ *
+ * @details Sectors are found with the level's spatial index, so that has to be built first.
+ *			Things keep their map order within each sector, and things outside every sector are
+ *			dropped, since they can never be seen or reached.
+ */
+void bucketThingsBySector(Level& level);
+
+#endif//THINGS_HPP_INCLUDED
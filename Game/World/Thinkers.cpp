@@ -0,0 +1,235 @@
+#include "Thinkers.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <Level.hpp>
+
+namespace
+{
+	// Doom's flashing lights count their waits in tics, of which there are 35 a second.
+	constexpr float TIC_SECONDS = 1.0f / 35.0f;
+	constexpr uint32_t FLICKER_BRIGHT_TICS = 64;
+	constexpr uint32_t FLICKER_DARK_TICS = 7;
+
+	uint32_t nextRandom(uint32_t& state)
+	{
+		// xorshift32, which only needs the state to be non-zero
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	bool think(PlatformThinker& platform, Level& level, float deltaTime, ThinkerChanges& changes)
+	{
+		if (!platform.moving) {
+			platform.timer += deltaTime;
+
+			if (platform.timer >= platform.pauseTime) {
+				platform.direction = -platform.direction;
+				platform.timer = 0.0f;
+				platform.moving = true;
+			}
+
+			return true;
+		}
+
+		Sector& sector = level.sectors[platform.sectorId];
+
+		sector.floorZ += platform.speed * platform.direction * deltaTime;
+		sector.ceilingZ += platform.speed * platform.direction * deltaTime;
+
+		// If we reach the end of our movement range, stop the movement and clamp the position. 
+		if (platform.direction < 0 && sector.floorZ <= platform.baseFloorZ) {
+			sector.floorZ = platform.baseFloorZ;
+			sector.ceilingZ = platform.baseCeilingZ;
+			platform.moving = false;
+		}
+		if (platform.direction > 0 && sector.floorZ >= platform.baseFloorZ + platform.travel) {
+			sector.floorZ = platform.baseFloorZ + platform.travel;
+			sector.ceilingZ = platform.baseCeilingZ + platform.travel;
+			platform.moving = false;
+		}
+
+		changes.markSector(platform.sectorId);
+		return true;
+	}
+
+	bool think(DoorThinker& door, Level& level, float deltaTime, ThinkerChanges& changes)
+	{
+		Sector& sector = level.sectors[door.sectorId];
+
+		switch (door.state) {
+		case DoorThinker::State::Opening:
+			sector.ceilingZ = std::min(sector.ceilingZ + door.speed * deltaTime, door.openCeilingZ);
+			if (sector.ceilingZ >= door.openCeilingZ)
+				door.state = DoorThinker::State::Waiting;
+			break;
+
+		case DoorThinker::State::Waiting:
+			door.timer += deltaTime;
+			if (door.timer >= door.waitTime)
+				door.state = DoorThinker::State::Closing;
+			return true;
+
+		case DoorThinker::State::Closing:
+			sector.ceilingZ = std::max(sector.ceilingZ - door.speed * deltaTime, door.closedCeilingZ);
+			if (sector.ceilingZ <= door.closedCeilingZ) {
+				changes.markSector(door.sectorId);
+				return false;
+			}
+			break;
+		}
+
+		changes.markSector(door.sectorId);
+		return true;
+	}
+
+	bool think(LightFlickerThinker& flicker, Level& level, float deltaTime, ThinkerChanges& changes)
+	{
+		flicker.timer -= deltaTime;
+		if (flicker.timer > 0.0f)
+			return true;
+
+		// Like Doom, the light stays bright for a long while and goes dark only briefly. 
+		float& lightLevel = level.sectorAppearances[flicker.sectorId].lightLevel;
+		const bool goingDark = lightLevel == flicker.maxLight;
+		const uint32_t tics = (nextRandom(flicker.randomState) & (goingDark ? FLICKER_DARK_TICS : FLICKER_BRIGHT_TICS)) + 1;
+
+		lightLevel = goingDark ? flicker.minLight : flicker.maxLight;
+		flicker.timer += tics * TIC_SECONDS;
+
+		changes.markSector(flicker.sectorId);
+		return true;
+	}
+
+	bool think(OrbitThinker& orbit, Level& level, float deltaTime, ThinkerChanges& changes)
+	{
+		const glm::vec2 center = glm::vec2{ std::cos(orbit.angle), std::sin(orbit.angle) } * orbit.radius;
+
+		for (size_t i = 0; i < orbit.vertexIds.size(); i++) {
+			level.vertices[orbit.vertexIds[i]] = center + orbit.startPositions[i];
+			changes.markVertex(orbit.vertexIds[i]);
+		}
+
+		for (uint32_t sectorId : orbit.affectedSectorIds)
+			changes.markSector(sectorId);
+
+		orbit.angle += orbit.speed * deltaTime;
+		return true;
+	}
+
+	template<typename T>
+	void thinkAll(ThinkerPool<T>& pool, Level& level, float deltaTime, ThinkerChanges& changes)
+	{
+		pool.update([&](T& thinker) { return think(thinker, level, deltaTime, changes); });
+	}
+}
+
+void ThinkerChanges::reset(size_t sectorCount, size_t vertexCount)
+{
+	// Only the flags that were set need clearing, which is far fewer than the whole level.
+	for (uint32_t sectorId : _sectorIds)
+		sectorFlags[sectorId] = 0;
+	for (uint32_t vertexId : _vertexIds)
+		vertexFlags[vertexId] = 0;
+
+	_sectorIds.clear();
+	_vertexIds.clear();
+
+	sectorFlags.resize(sectorCount, 0);
+	vertexFlags.resize(vertexCount, 0);
+}
+
+void ThinkerSystem::addPlatform(const Level& level, uint32_t sectorId, float travel, float speed, float pauseTime)
+{
+	const Sector& sector = level.sectors[sectorId];
+
+	PlatformThinker platform;
+	platform.sectorId = sectorId;
+	platform.travel = travel;
+	platform.speed = speed;
+	platform.pauseTime = pauseTime;
+	platform.baseFloorZ = sector.floorZ;
+	platform.baseCeilingZ = sector.ceilingZ;
+
+	platforms.add(platform);
+}
+
+void ThinkerSystem::addDoor(const Level& level, uint32_t sectorId, float openCeilingZ, float speed, float waitTime)
+{
+	DoorThinker door;
+	door.sectorId = sectorId;
+	door.closedCeilingZ = level.sectors[sectorId].ceilingZ;
+	door.openCeilingZ = openCeilingZ;
+	door.speed = speed;
+	door.waitTime = waitTime;
+
+	doors.add(door);
+}
+
+void ThinkerSystem::addLightFlicker(const Level& level, uint32_t sectorId, float minLight, uint32_t seed)
+{
+	LightFlickerThinker flicker;
+	flicker.sectorId = sectorId;
+	flicker.maxLight = level.sectorAppearances[sectorId].lightLevel;
+	flicker.minLight = minLight;
+	flicker.randomState = seed != 0 ? seed : 1;
+
+	lightFlickers.add(flicker);
+}
+
+void ThinkerSystem::addOrbit(const Level& level, uint32_t sectorId, float radius, float speed)
+{
+	const Sector& sector = level.sectors[sectorId];
+
+	OrbitThinker orbit;
+	orbit.sectorId = sectorId;
+	orbit.radius = radius;
+	orbit.speed = speed;
+
+	for (uint32_t wallId = sector.firstWallId; wallId < sector.firstWallId + sector.wallCount; wallId++) {
+		const LineDef& lineDef = level.lineDefs[level.walls[wallId].lineDefId];
+
+		for (uint32_t vertexId : { lineDef.startVertexId, lineDef.endVertexId }) {
+			if (std::find(orbit.vertexIds.begin(), orbit.vertexIds.end(), vertexId) == orbit.vertexIds.end()) {
+				orbit.vertexIds.push_back(vertexId);
+				orbit.startPositions.push_back(level.vertices[vertexId]);
+			}
+		}
+	}
+
+	// The sectors on the other side of the walls share the moving vertices, so they change too.
+	orbit.affectedSectorIds.push_back(sectorId);
+	if (!level.sectorGraph.empty()) {
+		for (const SectorGraph::Portal& portal : level.sectorGraph.neighbours(sectorId))
+			if (std::find(orbit.affectedSectorIds.begin(), orbit.affectedSectorIds.end(), portal.neighbourSectorId) == orbit.affectedSectorIds.end())
+				orbit.affectedSectorIds.push_back(portal.neighbourSectorId);
+	}
+
+	orbits.add(std::move(orbit));
+}
+
+void ThinkerSystem::think(Level& level, float deltaTime)
+{
+	_changes.reset(level.sectors.size(), level.vertices.size());
+
+	thinkAll(platforms, level, deltaTime, _changes);
+	thinkAll(doors, level, deltaTime, _changes);
+	thinkAll(lightFlickers, level, deltaTime, _changes);
+	thinkAll(orbits, level, deltaTime, _changes);
+}
+
+size_t ThinkerSystem::count() const
+{
+	return platforms.size() + doors.size() + lightFlickers.size() + orbits.size();
+}
+
+void ThinkerSystem::clear()
+{
+	platforms.clear();
+	doors.clear();
+	lightFlickers.clear();
+	orbits.clear();
+}
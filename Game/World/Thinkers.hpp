@@ -0,0 +1,202 @@
+#ifndef THINKERS_HPP_INCLUDED
+#define THINKERS_HPP_INCLUDED
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+struct Level;
+
+/**
+ * @brief Moves a sector's floor and ceiling up and down between two heights, pausing at each end.
+ */
+struct PlatformThinker
+{
+	uint32_t	sectorId;
+	float		travel;			// How far above its starting height the sector rises
+	float		speed;			// Units per second
+	float		pauseTime;		// Seconds spent waiting at each end
+
+	float		baseFloorZ;
+	float		baseCeilingZ;
+
+	float		timer = 0.0f;
+	float		direction = -1.0f;
+	bool		moving = false;
+};
+
+/**
+ * @brief Opens a door by raising its sector's ceiling, waits, then closes it again, like Doom's
+ *			vertical doors. The thinker goes away once the door has closed.
+ */
+struct DoorThinker
+{
+	enum class State : uint8_t { Opening, Waiting, Closing };
+
+	uint32_t	sectorId;
+	float		closedCeilingZ;
+	float		openCeilingZ;
+	float		speed;			// Units per second
+	float		waitTime;		// Seconds spent open
+
+	float		timer = 0.0f;
+	State		state = State::Opening;
+};
+
+/**
+ * @brief Flickers a sector's light between a bright and a dark level at random intervals, like
+ *			Doom's flashing lights.
+ */
+struct LightFlickerThinker
+{
+	uint32_t	sectorId;
+	float		maxLight;
+	float		minLight;
+
+	float		timer = 0.0f;
+	uint32_t	randomState;
+};
+
+/**
+ * @brief Moves a whole sector around in a circle by moving its vertices.
+ */
+struct OrbitThinker
+{
+	uint32_t	sectorId;
+	float		radius;
+	float		speed;			// Radians per second
+
+	float		angle = 0.0f;
+
+	// The vertices the sector is made of, where each started out, and every sector that shares
+	// them and so changes shape too. 
+	std::vector<uint32_t>	vertexIds;
+	std::vector<glm::vec2>	startPositions;
+	std::vector<uint32_t>	affectedSectorIds;
+};
+
+/**
+ * @brief The sectors and vertices that thinkers changed during an update, each listed once, so
+ *			caches over the level can update just those parts.
+ */
+class ThinkerChanges
+{
+public:
+	const std::vector<uint32_t>& sectorIds() const { return _sectorIds; }
+	const std::vector<uint32_t>& vertexIds() const { return _vertexIds; }
+
+	bool empty() const { return _sectorIds.empty() && _vertexIds.empty(); }
+
+	/** @brief Clears the changes, and sizes the lookups for a level */
+	void reset(size_t sectorCount, size_t vertexCount);
+
+	void markSector(uint32_t sectorId)
+	{
+		if (!sectorFlags[sectorId]) {
+			sectorFlags[sectorId] = 1;
+			_sectorIds.push_back(sectorId);
+		}
+	}
+
+	void markVertex(uint32_t vertexId)
+	{
+		if (!vertexFlags[vertexId]) {
+			vertexFlags[vertexId] = 1;
+			_vertexIds.push_back(vertexId);
+		}
+	}
+
+private:
+	std::vector<uint32_t>	_sectorIds;
+	std::vector<uint32_t>	_vertexIds;
+
+	std::vector<uint8_t>	sectorFlags;
+	std::vector<uint8_t>	vertexFlags;
+};
+
+/**
+ * @brief A pool of thinkers of one kind, kept packed together in memory.
+ *
+ * @details Thinkers that are done are removed by moving the last thinker into their place, so
+ *			the order of thinkers in a pool isn't kept. 
+ */
+template<typename T>
+class ThinkerPool
+{
+public:
+	void add(T thinker) { _thinkers.push_back(std::move(thinker)); }
+	void clear() { _thinkers.clear(); }
+
+	size_t size() const { return _thinkers.size(); }
+	const std::vector<T>& thinkers() const { return _thinkers; }
+
+	/** @brief Runs a function over every thinker, removing those it returns false for */
+	template<typename Think>
+	void update(Think&& think)
+	{
+		for (size_t i = 0; i < _thinkers.size();) {
+			if (think(_thinkers[i])) {
+				i++;
+			}
+			else {
+				_thinkers[i] = std::move(_thinkers.back());
+				_thinkers.pop_back();
+			}
+		}
+	}
+
+private:
+	std::vector<T> _thinkers;
+};
+
+/**
+ * @brief Everything in a level that changes over time, a replacement for Doom's thinker list.
+ *
+ * @details Doom keeps every thinker in one linked list and calls each through a function
+ *			pointer. Here each kind of thinker has its own pool, and a level update runs through
+ *			the pools one after another, so each kind is updated by a tight loop over packed data
+ *			that the compiler can inline, instead of jumping around memory and through a pointer
+ *			per thinker.
+ *
+ *			Every update collects the sectors and vertices the thinkers changed, for anything
+ *			caching data about the level, like the BSP, to update only what changed.
+ */
+class ThinkerSystem
+{
+public:
+	/** @brief Makes a sector rise by travel units and fall back again, forever */
+	void addPlatform(const Level& level, uint32_t sectorId, float travel, float speed, float pauseTime);
+
+	/** @brief Opens a door sector up to a ceiling height, then closes it after waiting */
+	void addDoor(const Level& level, uint32_t sectorId, float openCeilingZ, float speed, float waitTime);
+
+	/** @brief Flickers a sector between its current light level and a darker one */
+	void addLightFlicker(const Level& level, uint32_t sectorId, float minLight, uint32_t seed = 1);
+
+	/** @brief Moves a sector around a circle centered on where it starts */
+	void addOrbit(const Level& level, uint32_t sectorId, float radius, float speed);
+
+	/** @brief Updates every thinker, collecting what they changed into changes() */
+	void think(Level& level, float deltaTime);
+
+	/** @brief What the thinkers changed during the last update */
+	const ThinkerChanges& changes() const { return _changes; }
+
+	/** @brief Total number of thinkers across the pools */
+	size_t count() const;
+
+	void clear();
+
+private:
+	ThinkerPool<PlatformThinker>		platforms;
+	ThinkerPool<DoorThinker>			doors;
+	ThinkerPool<LightFlickerThinker>	lightFlickers;
+	ThinkerPool<OrbitThinker>			orbits;
+
+	ThinkerChanges	_changes;
+};
+
+#endif//THINKERS_HPP_INCLUDED
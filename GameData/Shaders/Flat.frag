@@ -0,0 +1,50 @@
+#version 330 core
+
+in vec3 fUv;
+in vec3 fColor;
+in float fLight;
+in float fDistance;
+flat in uint fTextured;
+
+out vec4 oColor;
+
+uniform sampler2DArray flatTextures;
+
+// Indexed color works the same as for walls, see Main.frag. Untextured flats use the palette's
+// closest color to white. 
+uniform bool indexedColor;
+uniform sampler2D colorMap;
+uniform sampler2D palette;
+uniform float distanceScale;
+uniform int whiteIndex;
+
+int lightMap(float light, float distance)
+{
+	float lightStep = clamp(floor(light / 16.0), 0.0, 15.0);
+	float startMap = (15.0 - lightStep) * 4.0;
+
+	return int(clamp(startMap - 1280.0 / max(distance, 1.0), 0.0, 31.0));
+}
+
+void main()
+{
+	if (indexedColor) {
+		int index = whiteIndex;
+		if (fTextured != 0u)
+			index = int(texture(flatTextures, fUv).r * 255.0 + 0.5);
+
+		int shaded = int(texelFetch(colorMap, ivec2(index, lightMap(fLight, fDistance * distanceScale)), 0).r * 255.0 + 0.5);
+
+		oColor = vec4(texelFetch(palette, ivec2(shaded, 0), 0).rgb * fColor, 1.0);
+		return;
+	}
+
+	float depth = (1 - gl_FragCoord.z) * 50;
+	depth =  clamp(depth, 0.05, 0.95);
+
+	vec3 texel = vec3(1.0);
+	if (fTextured != 0u)
+		texel = texture(flatTextures, fUv).rgb;
+
+	oColor = vec4(texel * fColor * depth, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+layout(location = 0) in vec3 vPosition;
+layout(location = 1) in vec3 vColor;
+layout(location = 2) in uvec3 vFlat;	// Layer, first layer of its animation, and frame count
+layout(location = 3) in float vLight;
+
+out vec3 fUv;
+out vec3 fColor;
+out float fLight;
+out float fDistance;
+flat out uint fTextured;
+
+uniform mat4 matTrans;
+uniform uint flatAnimationFrame;
+
+void main()
+{
+    fColor = vColor;
+    fTextured = vFlat.z;
+
+    // Animated flats step through their frames from the one the sector uses. 
+    uint layer = vFlat.x;
+    if (vFlat.z > 1u)
+        layer = vFlat.y + (vFlat.x - vFlat.y + flatAnimationFrame) % vFlat.z;
+
+    // Flats are lined up with the world at one texel per unit. Their rows go down the map. 
+    fUv = vec3(vPosition.x / 64.0, -vPosition.y / 64.0, float(layer));
+
+    gl_Position = matTrans * vec4(vPosition, 1.0);
+
+    fLight = vLight;
+    fDistance = gl_Position.w;
+}
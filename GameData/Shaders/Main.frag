@@ -1,13 +1,53 @@
 #version 330 core
 
+in vec2 fUv;
 in vec3 fColor;
+in float fLight;
+in float fDistance;
 
 out vec4 oColor;
 
+uniform sampler2D wallTexture;
+
+// With indexed color, textures hold a palette index in red and a mask in green, which are turned
+// into colors through COLORMAP and PLAYPAL. 
+uniform bool indexedColor;
+uniform sampler2D colorMap;
+uniform sampler2D palette;
+uniform float distanceScale;	// Converts distances to level units
+
+// Picks the light map Doom would use for a light level at a distance. Doom splits light levels
+// into 16 steps, each starting on a light map and getting darker with distance, which its light
+// tables work out for a 320 pixel wide screen. 
+int lightMap(float light, float distance)
+{
+	float lightStep = clamp(floor(light / 16.0), 0.0, 15.0);
+	float startMap = (15.0 - lightStep) * 4.0;
+
+	return int(clamp(startMap - 1280.0 / max(distance, 1.0), 0.0, 31.0));
+}
+
 void main()
 {
+	if (indexedColor) {
+		vec2 texel = texture(wallTexture, fUv).rg;
+		if (texel.g < 0.5)
+			discard;
+
+		int index = int(texel.r * 255.0 + 0.5);
+		int shaded = int(texelFetch(colorMap, ivec2(index, lightMap(fLight, fDistance * distanceScale)), 0).r * 255.0 + 0.5);
+
+		oColor = vec4(texelFetch(palette, ivec2(shaded, 0), 0).rgb * fColor, 1.0);
+		return;
+	}
+
 	float depth = (1 - gl_FragCoord.z) * 50;
 	depth =  clamp(depth, 0.05, 0.95);
 
-	oColor = vec4(fColor * depth, 1.0);
-}
\ No newline at end of file
+	// Holes in wall textures are see-through
+	vec4 texel = texture(wallTexture, fUv);
+	if (texel.a < 0.5)
+		discard;
+
+	oColor = vec4(texel.rgb * fColor * depth, 1.0);
+}
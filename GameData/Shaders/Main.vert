@@ -1,16 +1,26 @@
 #version 330 core
 
 layout(location = 0) in vec3 vPosition;
-layout(location = 1) in vec3 vColor;
+layout(location = 1) in vec2 vUv;
+layout(location = 2) in vec3 vColor;
+layout(location = 3) in float vLight;
 
+out vec2 fUv;
 out vec3 fColor;
+out float fLight;
+out float fDistance;
 
 uniform mat4 matTrans;
 
 void main()
 {
+    fUv = vUv;
     fColor =  vColor;
     
     // Here we swap the z and y components because our world has the Z axis set to be up.
     gl_Position = matTrans * vec4(vPosition, 1.0);
+
+    // With a perspective projection, w is the distance from the camera along the view direction
+    fLight = vLight;
+    fDistance = gl_Position.w;
 }
\ No newline at end of file
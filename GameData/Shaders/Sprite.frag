@@ -0,0 +1,52 @@
+#version 330 core
+
+in vec2 fTexel;
+flat in ivec4 fFrameRect;
+flat in int fPage;
+in float fLight;
+in float fDistance;
+
+out vec4 oColor;
+
+// Pages of the sprite atlas. Texels are fetched rather than sampled, and kept inside the frame,
+// so the pictures next to it never bleed in.
+uniform sampler2DArray spriteAtlas;
+
+// Indexed color works the same as for walls, see Main.frag.
+uniform bool indexedColor;
+uniform sampler2D colorMap;
+uniform sampler2D palette;
+uniform float distanceScale;
+
+int lightMap(float light, float distance)
+{
+	float lightStep = clamp(floor(light / 16.0), 0.0, 15.0);
+	float startMap = (15.0 - lightStep) * 4.0;
+
+	return int(clamp(startMap - 1280.0 / max(distance, 1.0), 0.0, 31.0));
+}
+
+void main()
+{
+	ivec2 texelCoord = clamp(ivec2(floor(fTexel)), fFrameRect.xy, fFrameRect.zw);
+	vec4 texel = texelFetch(spriteAtlas, ivec3(texelCoord, fPage), 0);
+
+	if (indexedColor) {
+		if (texel.g < 0.5)
+			discard;
+
+		int index = int(texel.r * 255.0 + 0.5);
+		int shaded = int(texelFetch(colorMap, ivec2(index, lightMap(fLight, fDistance * distanceScale)), 0).r * 255.0 + 0.5);
+
+		oColor = vec4(texelFetch(palette, ivec2(shaded, 0), 0).rgb, 1.0);
+		return;
+	}
+
+	if (texel.a < 0.5)
+		discard;
+
+	float depth = (1 - gl_FragCoord.z) * 50;
+	depth =  clamp(depth, 0.05, 0.95);
+
+	oColor = vec4(texel.rgb * depth, 1.0);
+}
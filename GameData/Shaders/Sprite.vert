@@ -0,0 +1,88 @@
+#version 330 core
+
+// Sprites have no vertex attributes. Each instance is a sprite, and its four vertices make a
+// quad from what the buffers say about its thing and frame.
+
+const float PI = 3.14159265;
+
+out vec2 fTexel;
+flat out ivec4 fFrameRect;	// The first and last texel of the frame in its page
+flat out int fPage;
+out float fLight;
+out float fDistance;
+
+uniform mat4 matTrans;
+uniform vec2 cameraPosition;	// In level units
+uniform vec2 cameraRight;
+
+// Where the sprites of each visible sector start, among those drawn and among every instance,
+// and the sector's floor height and light.
+uniform usamplerBuffer spriteSectors;
+uniform int spriteSectorCount;
+
+// Each thing's position and height above its floor, then which way it faces as a binary angle
+// in the low 16 bits and its rotation table in the high 16 bits.
+uniform usamplerBuffer spriteInstances;
+
+// Two texels per rotation table: the frames of rotations 1 to 8, with the lowest bit set for
+// the ones that are drawn mirrored.
+uniform usamplerBuffer spriteRotations;
+
+// Two texels per frame: where it is in its page and its size, then its offsets and page.
+uniform isamplerBuffer spriteFrames;
+
+void main()
+{
+    // The instance belongs to the last visible sector whose sprites start at or before it.
+    int low = 0;
+    int high = spriteSectorCount - 1;
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (int(texelFetch(spriteSectors, middle).x) <= gl_InstanceID)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    uvec4 sector = texelFetch(spriteSectors, low);
+    uvec4 instance = texelFetch(spriteInstances, int(sector.y) + gl_InstanceID - int(sector.x));
+
+    vec2 thingPosition = uintBitsToFloat(instance.xy);
+
+    // Pick the rotation the way Doom does. Rotation 1 is seen from straight in front of the
+    // thing, and each eighth of a turn counter-clockwise round it is the next one. Each rotation
+    // is seen from the eighth of a turn centered on it.
+    vec2 toThing = thingPosition - cameraPosition;
+    float facing = float(instance.w & 0xFFFFu) / 65536.0;
+    float viewed = atan(toThing.y, toThing.x) / (2.0 * PI);
+    int rotation = int(fract(viewed - facing + 0.5 + 1.0 / 16.0) * 8.0) & 7;
+
+    uvec4 rotations = texelFetch(spriteRotations, int(instance.w >> 16u) * 2 + rotation / 4);
+    uint entry = rotations[rotation % 4];
+
+    int frameId = int(entry >> 1u);
+    bool mirrored = (entry & 1u) != 0u;
+
+    ivec4 frameRect = texelFetch(spriteFrames, frameId * 2);
+    ivec4 framePlacement = texelFetch(spriteFrames, frameId * 2 + 1);
+
+    // Vertices go left to right, then bottom to top, which makes a strip facing the camera.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    // The frame's offsets put the thing's position that far into the picture from its left,
+    // and that far below its top. Mirrored frames keep their offsets, like in Doom, and only
+    // flip the picture.
+    float across = corner.x * float(frameRect.z) - float(framePlacement.x);
+    float up = float(framePlacement.y) - (1.0 - corner.y) * float(frameRect.w);
+
+    vec3 position = vec3(thingPosition + cameraRight * across, uintBitsToFloat(sector.z) + uintBitsToFloat(instance.z) + up);
+    gl_Position = matTrans * vec4(position, 1.0);
+
+    // Picture rows go down from the top.
+    fTexel = vec2(frameRect.xy) + vec2(mirrored ? 1.0 - corner.x : corner.x, 1.0 - corner.y) * vec2(frameRect.zw);
+    fFrameRect = ivec4(frameRect.xy, frameRect.xy + frameRect.zw - 1);
+    fPage = framePlacement.z;
+
+    fLight = uintBitsToFloat(sector.w);
+    fDistance = gl_Position.w;
+}
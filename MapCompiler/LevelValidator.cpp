@@ -0,0 +1,124 @@
+#include "LevelValidator.hpp"
+
+#include <vector>
+#include <string>
+#include <format>
+
+ValidationReport validateLevel(const Level& level)
+{
+	ValidationReport report;
+
+	const size_t vertexCount = level.vertices.size();
+	const size_t wallCount = level.walls.size();
+	const size_t sectorCount = level.sectors.size();
+
+	// Everything past here indexes appearances by wall and sector id. 
+	if (level.wallAppearances.size() != wallCount || level.sectorAppearances.size() != sectorCount) {
+		report.errors.push_back("The level doesn't have an appearance for every wall and sector");
+		return report;
+	}
+
+	// Check the linedefs first, since everything else depends on them being valid. 
+	bool lineDefsValid = true;
+	for (size_t i = 0; i < level.lineDefs.size(); i++) {
+		const LineDef& lineDef = level.lineDefs[i];
+
+		if (lineDef.startVertexId >= vertexCount || lineDef.endVertexId >= vertexCount) {
+			report.errors.push_back(std::format("LineDef {} references a vertex that doesn't exist", i));
+			lineDefsValid = false;
+			continue;
+		}
+
+		if (level.vertices[lineDef.startVertexId] == level.vertices[lineDef.endVertexId])
+			report.warnings.push_back(std::format("LineDef {} has zero length", i));
+
+		if (lineDef.frontWallId == LineDef::NO_WALL)
+			report.warnings.push_back(std::format("LineDef {} has no front wall", i));
+
+		for (uint32_t wallId : { lineDef.frontWallId, lineDef.backWallId }) {
+			if (wallId == LineDef::NO_WALL)
+				continue;
+
+			if (wallId >= wallCount) {
+				report.errors.push_back(std::format("LineDef {} references wall {} which doesn't exist", i, wallId));
+				lineDefsValid = false;
+			}
+			else if (level.walls[wallId].lineDefId != i) {
+				report.errors.push_back(std::format("LineDef {} references wall {} which lies on another line", i, wallId));
+				lineDefsValid = false;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < wallCount; i++) {
+		const Wall& wall = level.walls[i];
+
+		if (wall.lineDefId >= level.lineDefs.size()) {
+			report.errors.push_back(std::format("Wall {} references a linedef that doesn't exist", i));
+			lineDefsValid = false;
+		}
+		if (wall.sectorId >= sectorCount)
+			report.errors.push_back(std::format("Wall {} references a sector that doesn't exist", i));
+	}
+
+	// Following the wall loops requires valid linedefs, so stop here if they are broken.
+	if (!lineDefsValid)
+		return report;
+
+	uint32_t expectedFirstWall = 0;
+	for (uint32_t sectorId = 0; sectorId < sectorCount; sectorId++) {
+		const Sector& sector = level.sectors[sectorId];
+
+		if (sector.wallCount == 0) {
+			report.warnings.push_back(std::format("Sector {} has no walls", sectorId));
+			continue;
+		}
+		if (sector.firstWallId + sector.wallCount > wallCount) {
+			report.errors.push_back(std::format("Sector {} has walls past the end of the wall list", sectorId));
+			continue;
+		}
+		if (sector.firstWallId != expectedFirstWall)
+			report.warnings.push_back(std::format("Sector {} walls are not stored directly after the previous sector's", sectorId));
+		expectedFirstWall = sector.firstWallId + sector.wallCount;
+
+		if (sector.ceilingZ < sector.floorZ)
+			report.warnings.push_back(std::format("Sector {} has its ceiling below its floor", sectorId));
+
+		// Walk each loop, making sure every wall starts where the previous one ended, and the 
+		// last wall of the loop ends where the first one started. 
+		uint32_t loopStartVertexId = LineDef::NO_WALL;
+		uint32_t previousEndVertexId = LineDef::NO_WALL;
+
+		for (uint32_t i = 0; i < sector.wallCount; i++) {
+			const uint32_t wallId = sector.firstWallId + i;
+			const Wall& wall = level.walls[wallId];
+			const LineDef& lineDef = level.lineDefs[wall.lineDefId];
+
+			if (wall.sectorId != sectorId)
+				report.errors.push_back(std::format("Wall {} is stored in sector {} but belongs to sector {}", wallId, sectorId, wall.sectorId));
+
+			const bool wallFollowsLine = wallId == lineDef.frontWallId;
+			const uint32_t startVertexId = wallFollowsLine ? lineDef.startVertexId : lineDef.endVertexId;
+			const uint32_t endVertexId = wallFollowsLine ? lineDef.endVertexId : lineDef.startVertexId;
+
+			if (loopStartVertexId == LineDef::NO_WALL)
+				loopStartVertexId = startVertexId;
+			else if (startVertexId != previousEndVertexId)
+				report.errors.push_back(std::format("Sector {} wall loop is broken at wall {}", sectorId, wallId));
+
+			previousEndVertexId = endVertexId;
+
+			if (wall.endOfLoop) {
+				if (endVertexId != loopStartVertexId)
+					report.errors.push_back(std::format("Sector {} has a wall loop that isn't closed, ending at wall {}", sectorId, wallId));
+
+				loopStartVertexId = LineDef::NO_WALL;
+			}
+		}
+
+		if (loopStartVertexId != LineDef::NO_WALL)
+			report.errors.push_back(std::format("Sector {} has a wall loop without an end", sectorId));
+	}
+
+	return report;
+}
@@ -0,0 +1,30 @@
+#ifndef LEVEL_VALIDATOR_HPP_INCLUDED
+#define LEVEL_VALIDATOR_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+
+#include <Level.hpp>
+
+/**
+ * @brief The problems found while checking the topology of a level
+ * 
+ * @details Errors are problems that would break later compile stages or the renderer, such
+ *			as indices that are out of range or wall loops that aren't closed. Warnings are
+ *			things that are suspicious, but can still be compiled. 
+ */
+struct ValidationReport
+{
+	std::vector<std::string> errors;
+	std::vector<std::string> warnings;
+
+	bool ok() const { return errors.empty(); }
+};
+
+/**
+ * @brief Checks that a level's vertices, linedefs, walls and sectors all reference each other
+ *        correctly, and that every sector is made of closed wall loops. 
+ */
+ValidationReport validateLevel(const Level& level);
+
+#endif//LEVEL_VALIDATOR_HPP_INCLUDED
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <charconv>
+#include <string_view>
+
+#include <Resource/WadFile.hpp>
+#include <Resource/MapLoader.hpp>
+#include <Utility/Timer.hpp>
+
+#include "MapCompiler.hpp"
+
+// SectorMapc - Offline map compiler
+//
+// Usage: SectorMapc [-o <output directory>] [-j <threads>] <wad files...>
+//
+// Every map in every wad given is compiled in parallel, using all cores by default. 
+
+struct CompileJob
+{
+	std::shared_ptr<const WadFile>	wadFile;
+	std::string						wadName;
+	uint32_t						mapMarkerIndex;
+};
+
+void printUsage()
+{
+	std::cout << "Usage: SectorMapc [-o <output directory>] [-j <threads>] <wad files...>\n";
+}
+
+void printResult(const MapCompiler::Result& result)
+{
+	std::cout << std::format("{:<16} {:<6} {}", result.wadName, result.mapName, result.succeeded ? "OK  " : "FAIL");
+
+	for (size_t i = 0; i < MapCompiler::STAGE_COUNT; i++) {
+		auto stage = static_cast<MapCompiler::Stage>(i);
+		std::cout << std::format("  {} {:8.3f}ms", MapCompiler::stageName(stage), result.stageMilliseconds[i]);
+	}
+
+	std::cout << std::format("  ({} sectors, {} triangles, {} portals, {:.1f} visible sectors avg, {} byte PVS)\n", 
+		result.sectorCount, result.triangleCount, result.portalCount, result.averageVisibleSectors, result.pvsBytes);
+
+	for (const std::string& warning : result.warnings)
+		std::cout << "    warning: " << warning << "\n";
+	for (const std::string& error : result.errors)
+		std::cout << "    error: " << error << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path outputDirectory = ".";
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::string> wadPaths;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "-o" && i + 1 < argc) {
+			outputDirectory = argv[++i];
+		}
+		else if (arg == "-j" && i + 1 < argc) {
+			const std::string_view value = argv[++i];
+			int count = 0;
+
+			auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+			if (error != std::errc() || end != value.data() + value.size()) {
+				std::cerr << "Invalid thread count '" << value << "'" << std::endl;
+				printUsage();
+				return -1;
+			}
+
+			threadCount = std::max(1, count);
+		}
+		else if (arg == "-h" || arg == "--help") {
+			printUsage();
+			return 0;
+		}
+		else {
+			wadPaths.push_back(arg);
+		}
+	}
+
+	if (wadPaths.empty()) {
+		printUsage();
+		return -1;
+	}
+
+	std::filesystem::create_directories(outputDirectory);
+
+	Timer totalTimer;
+	totalTimer.start();
+
+	// Open every wad and find all of the maps in them. Each wad is only opened once and 
+	// shared between the jobs for its maps. 
+	std::vector<CompileJob> jobs;
+	for (const std::string& wadPath : wadPaths) {
+		std::shared_ptr<const WadFile> wadFile;
+
+		try {
+			wadFile = std::make_shared<const WadFile>(wadPath);
+		}
+		catch (const std::exception& e) {
+			std::cerr << "Could not open wad '" << wadPath << "': " << e.what() << std::endl;
+			return -1;
+		}
+
+		std::string wadName = std::filesystem::path(wadPath).stem().string();
+
+		for (uint32_t i = 0; i < wadFile->lumpCount(); i++) {
+			if (DoomMapLoader::isMapMarker(wadFile->lumpName(i)))
+				jobs.push_back({ wadFile, wadName, i });
+		}
+	}
+
+	threadCount = std::min<unsigned int>(threadCount, std::max<size_t>(jobs.size(), 1));
+
+	std::cout << std::format("Compiling {} maps from {} wads on {} threads\n", jobs.size(), wadPaths.size(), threadCount);
+
+	// Each worker pulls the next job off of the list until there are none left. Maps vary
+	// a lot in size, so this balances better than splitting the list up front. 
+	MapCompiler compiler(outputDirectory);
+	std::vector<MapCompiler::Result> results(jobs.size());
+	std::atomic<size_t> nextJob = 0;
+
+	{
+		std::vector<std::jthread> workers;
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back([&] {
+				for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+					results[job] = compiler.compile(jobs[job].wadFile, jobs[job].wadName, jobs[job].mapMarkerIndex);
+			});
+		}
+	}
+
+	totalTimer.stop();
+
+	// Print the results in order once everything is done, so the output from different 
+	// threads doesn't get interleaved. 
+	std::array<float, MapCompiler::STAGE_COUNT> stageTotals{};
+	size_t failedCount = 0;
+
+	for (const MapCompiler::Result& result : results) {
+		printResult(result);
+
+		for (size_t i = 0; i < MapCompiler::STAGE_COUNT; i++)
+			stageTotals[i] += result.stageMilliseconds[i];
+
+		if (!result.succeeded)
+			failedCount++;
+	}
+
+	std::cout << "\nTotal time per stage (summed across threads):\n";
+	for (size_t i = 0; i < MapCompiler::STAGE_COUNT; i++) {
+		auto stage = static_cast<MapCompiler::Stage>(i);
+		std::cout << std::format("    {:<12} {:10.3f}ms\n", MapCompiler::stageName(stage), stageTotals[i]);
+	}
+
+	std::cout << std::format("\nCompiled {} of {} maps in {:.3f}ms\n", 
+		jobs.size() - failedCount, jobs.size(), totalTimer.milleseconds());
+
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include "MapCompiler.hpp"
+
+#include <fstream>
+#include <exception>
+#include <format>
+
+#include <Resource/MapLoader.hpp>
+#include <Geometry/Triangulation.hpp>
+#include <Geometry/Pvs.hpp>
+#include <Utility/Timer.hpp>
+
+#include "LevelValidator.hpp"
+
+MapCompiler::MapCompiler(std::filesystem::path outputDirectory)
+	: outputDirectory(std::move(outputDirectory))
+{
+}
+
+const char* MapCompiler::stageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::Load:			return "Load";
+	case Stage::Validate:		return "Validate";
+	case Stage::Triangulate:	return "Triangulate";
+	case Stage::Portals:		return "Portals";
+	case Stage::Visibility:		return "Visibility";
+	case Stage::Write:			return "Write";
+	default:					return "Unknown";
+	}
+}
+
+MapCompiler::Result MapCompiler::compile(const std::shared_ptr<const Archive>& archive, const std::string& wadName, uint32_t mapMarkerIndex) const
+{
+	const std::string& mapName = archive->lumpName(mapMarkerIndex);
+
+	Result result;
+	result.wadName = wadName;
+	result.mapName = mapName;
+
+	std::array<Timer, STAGE_COUNT> timers;
+	Stage stage = Stage::Load;
+
+	// Runs a single stage, recording how long it took. 
+	auto runStage = [&](Stage nextStage, auto&& function) {
+		stage = nextStage;
+
+		Timer& timer = timers[static_cast<size_t>(stage)];
+		timer.start();
+		function();
+		timer.stop();
+
+		result.stageMilliseconds[static_cast<size_t>(stage)] = timer.milleseconds();
+	};
+
+	try {
+		CompiledLevel compiled;
+
+		runStage(Stage::Load, [&] {
+			DoomMapLoader loader(archive, mapMarkerIndex);
+			compiled.level = loader.loadLevel();
+		});
+
+		ValidationReport report;
+		runStage(Stage::Validate, [&] {
+			report = validateLevel(*compiled.level);
+		});
+
+		result.warnings = std::move(report.warnings);
+		if (!report.ok()) {
+			result.errors = std::move(report.errors);
+			return result;
+		}
+
+		runStage(Stage::Triangulate, [&] { triangulate(compiled); });
+		runStage(Stage::Portals, [&] { findPortals(compiled); });
+		runStage(Stage::Visibility, [&] { computeVisibility(compiled, result); });
+
+		std::filesystem::path outputPath = outputDirectory / std::format("{}_{}.slvl", wadName, mapName);
+		runStage(Stage::Write, [&] {
+			std::ofstream stream(outputPath, std::ios::binary);
+			if (!stream.is_open())
+				throw std::runtime_error("Could not open output file " + outputPath.string());
+
+			saveCompiledLevel(compiled, stream);
+		});
+
+		result.outputPath = outputPath.string();
+		result.sectorCount = compiled.level->sectors.size();
+		result.triangleCount = compiled.flatVertices.size() / 3;
+		result.portalCount = compiled.portals.size();
+		result.succeeded = true;
+	}
+	catch (const std::exception& e) {
+		result.errors.push_back(std::format("{} stage failed: {}", stageName(stage), e.what()));
+	}
+
+	return result;
+}
+
+void MapCompiler::triangulate(CompiledLevel& compiled) const
+{
+	const Level& level = *compiled.level;
+
+	compiled.flatVertexOffsets.reserve(level.sectors.size() + 1);
+
+	for (const Sector& sector : level.sectors) {
+		compiled.flatVertexOffsets.push_back(static_cast<uint32_t>(compiled.flatVertices.size()));
+		triangulateSector(level, sector, compiled.flatVertices);
+	}
+
+	compiled.flatVertexOffsets.push_back(static_cast<uint32_t>(compiled.flatVertices.size()));
+}
+
+void MapCompiler::findPortals(CompiledLevel& compiled) const
+{
+	// The level's sector graph already holds the portals in the same layout they're saved in. 
+	const SectorGraph& graph = compiled.level->sectorGraph;
+
+	compiled.portals.reserve(graph.portals.size());
+	for (const SectorGraph::Portal& portal : graph.portals)
+		compiled.portals.push_back({ portal.wallId, portal.neighbourSectorId });
+
+	compiled.portalOffsets = graph.portalOffsets;
+}
+
+void MapCompiler::computeVisibility(CompiledLevel& compiled, Result& result) const
+{
+	Level& level = *compiled.level;
+
+	// The PVS from portal flow replaces the one loaded from the map's REJECT lump, which is only
+	// as good as the tool that built it. 
+	level.pvs = computePvs(level);
+
+	result.pvsBytes = level.pvs.rows.size();
+
+	PotentiallyVisibleSet::SectorSet visible;
+	size_t visibleCount = 0;
+
+	for (uint32_t sectorId = 0; sectorId < level.pvs.sectorCount; sectorId++) {
+		level.pvs.decompressRow(sectorId, visible);
+
+		for (uint32_t otherId = 0; otherId < level.pvs.sectorCount; otherId++)
+			visibleCount += visible.contains(otherId) ? 1 : 0;
+	}
+
+	if (level.pvs.sectorCount > 0)
+		result.averageVisibleSectors = (float)visibleCount / (float)level.pvs.sectorCount;
+}
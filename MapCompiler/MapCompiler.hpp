@@ -0,0 +1,81 @@
+#ifndef MAP_COMPILER_HPP_INCLUDED
+#define MAP_COMPILER_HPP_INCLUDED
+
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <filesystem>
+
+#include <Resource/Archive.hpp>
+#include <Resource/LevelFile.hpp>
+
+/**
+ * @brief Converts maps from wads into compiled levels that the engine can load directly. 
+ * 
+ * @details Each map goes through the following stages:
+ *			1. Load		 - Read the map from the wad and convert it into the engine's format
+ *			2. Validate	 - Check the level's topology, stopping if the level is broken
+ *			3. Triangulate - Precompute the floor/ceiling triangulation of every sector
+ *			4. Portals	 - Precompute the portals leading out of each sector for visibility
+ *			5. Visibility - Flow visibility through the portals to find each sector's PVS
+ *			6. Write	 - Save the compiled level to the output directory
+ * 
+ *			Compiling a map only reads from the wad and writes its own output file, so any 
+ *			number of maps can be compiled at once from different threads. 
+ */
+class MapCompiler
+{
+public:
+	enum class Stage
+	{
+		Load,
+		Validate,
+		Triangulate,
+		Portals,
+		Visibility,
+		Write,
+
+		Count
+	};
+
+	static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::Count);
+
+	/** @brief The outcome of compiling a single map */
+	struct Result
+	{
+		std::string		wadName;
+		std::string		mapName;
+		std::string		outputPath;
+
+		bool			succeeded = false;
+
+		std::vector<std::string>		errors;
+		std::vector<std::string>		warnings;
+
+		std::array<float, STAGE_COUNT>	stageMilliseconds{};
+
+		size_t	sectorCount		= 0;
+		size_t	triangleCount	= 0;
+		size_t	portalCount		= 0;
+
+		size_t	pvsBytes		= 0;	// Size of the compressed PVS
+		float	averageVisibleSectors = 0.0f;
+	};
+
+	MapCompiler(std::filesystem::path outputDirectory);
+
+	static const char* stageName(Stage stage);
+
+	/** @brief Compiles the map with the given marker lump from an open archive */
+	Result compile(const std::shared_ptr<const Archive>& archive, const std::string& wadName, uint32_t mapMarkerIndex) const;
+
+private:
+	std::filesystem::path outputDirectory;
+
+	void triangulate(CompiledLevel& compiled) const;
+	void findPortals(CompiledLevel& compiled) const;
+	void computeVisibility(CompiledLevel& compiled, Result& result) const;
+};
+
+#endif//MAP_COMPILER_HPP_INCLUDED